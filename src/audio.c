@@ -30,6 +30,9 @@ static struct controllable audio_initializing_controllable;
 
 #define AUDIO_SLEEP_US 200000
 
+#define AUDIO_STREAM_LEN_S 2
+#define AUDIO_STREAM_PREFILL_DIV 2
+
 void audio_init_int ();
 void audio_destroy_int ();
 const gchar *audio_name ();
@@ -99,6 +102,84 @@ audio_is_stopped ()
   return s == AUDIO_STATUS_STOPPED;
 }
 
+//Called with the mutex locked. Returns FALSE when the stream is over.
+//Mono mixing is not applied as streams are used to transfer data to devices.
+
+static gboolean
+audio_read_from_stream (void *buffer, gint frames)
+{
+  guint8 *dst, *src;
+  guint32 n, pos;
+  struct audio_stream *stream = audio.stream;
+
+  memset (buffer, 0,
+	  frames * FRAME_SIZE (AUDIO_CHANNELS, sample_get_internal_format ()));
+
+  if (audio.status == AUDIO_STATUS_PREPARING_PLAYBACK)
+    {
+      audio.status = AUDIO_STATUS_PLAYING;
+      return TRUE;
+    }
+
+  if (audio.status == AUDIO_STATUS_STOPPING_PLAYBACK)
+    {
+      return FALSE;
+    }
+
+  g_mutex_lock (&stream->mutex);
+
+  if (stream->closed && !stream->len)
+    {
+      g_mutex_unlock (&stream->mutex);
+      return FALSE;
+    }
+
+  n = MIN (frames, stream->len);
+  if (n < frames && !stream->closed)
+    {
+      debug_print (1, "Stream underrun (%d frames missing)", frames - n);
+      stream->underruns++;
+    }
+
+  dst = buffer;
+  pos = stream->start;
+  for (guint32 i = 0; i < n; i++)
+    {
+      src = &stream->data[pos * stream->frame_size];
+      if (audio.float_mode)
+	{
+	  audio_copy_sample_f32 ((gfloat *) dst, (gfloat *) src);
+	  src += sizeof (gfloat);
+	  dst += sizeof (gfloat);
+	  audio_copy_sample_f32 ((gfloat *) dst, (gfloat *) src);
+	  dst += sizeof (gfloat);
+	}
+      else
+	{
+	  audio_copy_sample_s16 ((gint16 *) dst, (gint16 *) src);
+	  src += sizeof (gint16);
+	  dst += sizeof (gint16);
+	  audio_copy_sample_s16 ((gint16 *) dst, (gint16 *) src);
+	  dst += sizeof (gint16);
+	}
+
+      pos++;
+      if (pos == stream->capacity)
+	{
+	  pos = 0;
+	}
+    }
+
+  stream->start = pos;
+  stream->len -= n;
+  stream->played += n;
+  g_cond_signal (&stream->cond);
+
+  g_mutex_unlock (&stream->mutex);
+
+  return TRUE;
+}
+
 void
 audio_write_to_output (void *buffer, gint frames)
 {
@@ -113,6 +194,12 @@ audio_write_to_output (void *buffer, gint frames)
 
   sample_info = audio.sample.info;
 
+  if (audio.stream)
+    {
+      stopping = !audio_read_from_stream (buffer, frames);
+      goto end;
+    }
+
   if (!sample_info)
     {
       goto end;
@@ -259,7 +346,7 @@ audio_write_to_output (void *buffer, gint frames)
     }
 
 end:
-  if (!sample_info || stopping)
+  if ((!sample_info && !audio.stream) || stopping)
     {
       audio.release_frames += frames;
       if (audio.cursor_notifier)
@@ -481,6 +568,7 @@ audio_init (audio_ready_callback ready_callback,
   audio.sel_start = -1;
   audio.sel_end = -1;
   audio.record_options = 0;
+  audio.stream = NULL;
 
   audio_init_int ();
 }
@@ -507,6 +595,14 @@ audio_reset_sample ()
   debug_print (1, "Resetting sample...");
 
   g_mutex_lock (&audio.control.controllable.mutex);
+  if (audio.stream)
+    {
+      g_mutex_lock (&audio.stream->mutex);
+      audio.stream->detached = TRUE;
+      g_cond_signal (&audio.stream->cond);
+      g_mutex_unlock (&audio.stream->mutex);
+      audio.stream = NULL;
+    }
   idata_clear (&audio.sample);
   sample_info_clear (&audio.sample_info_src);
   audio.pos = 0;
@@ -620,6 +716,206 @@ audio_set_play_and_wait (struct idata *sample, struct task_control *control)
     }
 }
 
+void
+audio_stream_init (struct audio_stream *stream, guint32 total)
+{
+  g_mutex_init (&stream->mutex);
+  g_cond_init (&stream->cond);
+  stream->frame_size = FRAME_SIZE (AUDIO_CHANNELS,
+				   sample_get_internal_format ());
+  stream->capacity = audio.rate * AUDIO_STREAM_LEN_S;
+  stream->prefill = stream->capacity / AUDIO_STREAM_PREFILL_DIV;
+  stream->data = g_malloc (stream->capacity * stream->frame_size);
+  stream->start = 0;
+  stream->len = 0;
+  stream->total = total;
+  stream->played = 0;
+  stream->progress = NULL;
+  stream->progress_data = NULL;
+  stream->started = FALSE;
+  stream->closed = FALSE;
+  stream->detached = FALSE;
+  stream->underruns = 0;
+}
+
+static void
+audio_stream_start (struct audio_stream *stream)
+{
+  debug_print (1, "Starting stream playback...");
+
+  audio_reset_sample ();
+
+  g_mutex_lock (&audio.control.controllable.mutex);
+  audio.stream = stream;
+  audio.control.callback = NULL;
+  audio.sel_start = -1;
+  audio.sel_end = -1;
+  g_mutex_unlock (&audio.control.controllable.mutex);
+
+  stream->started = TRUE;
+
+  audio_start_playback (NULL);
+}
+
+static void
+audio_stream_set_progress (struct audio_stream *stream,
+			   struct task_control *control)
+{
+  guint32 played;
+
+  if (!control || !stream->total)
+    {
+      return;
+    }
+
+  g_mutex_lock (&stream->mutex);
+  played = stream->played;
+  g_mutex_unlock (&stream->mutex);
+
+  if (stream->progress)
+    {
+      stream->progress (played, control, stream->progress_data);
+      return;
+    }
+
+  task_control_set_progress (control, MIN (played / (gdouble) stream->total,
+					   1.0));
+}
+
+gint
+audio_stream_write (struct audio_stream *stream, const void *frames,
+		    guint32 len, struct task_control *control)
+{
+  gint err = 0;
+  gboolean start;
+  guint32 n, end, chunk;
+  const guint8 *src = frames;
+
+  while (len)
+    {
+      g_mutex_lock (&stream->mutex);
+
+      while (stream->len == stream->capacity && !stream->detached)
+	{
+	  g_cond_wait_until (&stream->cond, &stream->mutex,
+			     g_get_monotonic_time () + AUDIO_SLEEP_US);
+	  if (control && !controllable_is_active (&control->controllable))
+	    {
+	      err = -ECANCELED;
+	      break;
+	    }
+	}
+
+      if (!err && stream->detached)
+	{
+	  error_print ("Stream playback interrupted");
+	  err = -EIO;
+	}
+
+      if (err)
+	{
+	  g_mutex_unlock (&stream->mutex);
+	  return err;
+	}
+
+      n = MIN (len, stream->capacity - stream->len);
+      end = (stream->start + stream->len) % stream->capacity;
+      chunk = MIN (n, stream->capacity - end);
+      memcpy (&stream->data[end * stream->frame_size], src,
+	      chunk * stream->frame_size);
+      memcpy (stream->data, &src[chunk * stream->frame_size],
+	      (n - chunk) * stream->frame_size);
+      stream->len += n;
+      start = !stream->started && stream->len >= stream->prefill;
+
+      g_mutex_unlock (&stream->mutex);
+
+      src += n * stream->frame_size;
+      len -= n;
+
+      if (start)
+	{
+	  audio_stream_start (stream);
+	}
+    }
+
+  audio_stream_set_progress (stream, control);
+
+  return 0;
+}
+
+static gboolean
+audio_stream_is_playing (struct audio_stream *stream)
+{
+  gboolean detached;
+
+  g_mutex_lock (&stream->mutex);
+  detached = stream->detached;
+  g_mutex_unlock (&stream->mutex);
+
+  return !detached && !audio_is_stopped ();
+}
+
+gint
+audio_stream_end (struct audio_stream *stream, struct task_control *control)
+{
+  gint err = 0;
+  guint32 underruns;
+  gboolean active, attached;
+
+  active = control ? controllable_is_active (&control->controllable) : TRUE;
+
+  g_mutex_lock (&stream->mutex);
+  stream->closed = TRUE;
+  g_mutex_unlock (&stream->mutex);
+
+  //Short streams never reach the prefill.
+  if (active && !stream->started && stream->len)
+    {
+      audio_stream_start (stream);
+    }
+
+  while (stream->started && active && audio_stream_is_playing (stream))
+    {
+      usleep (AUDIO_SLEEP_US);
+      if (control)
+	{
+	  audio_stream_set_progress (stream, control);
+	  active = controllable_is_active (&control->controllable);
+	}
+    }
+
+  g_mutex_lock (&audio.control.controllable.mutex);
+  attached = audio.stream == stream;
+  g_mutex_unlock (&audio.control.controllable.mutex);
+
+  if (attached)
+    {
+      audio_stop_playback ();
+      audio_reset_sample ();
+    }
+
+  g_mutex_lock (&stream->mutex);
+  underruns = stream->underruns;
+  g_mutex_unlock (&stream->mutex);
+
+  if (!active)
+    {
+      err = -ECANCELED;
+    }
+  else if (underruns)
+    {
+      error_print ("Stream playback had %d underruns", underruns);
+      err = -EIO;
+    }
+
+  g_free (stream->data);
+  g_cond_clear (&stream->cond);
+  g_mutex_clear (&stream->mutex);
+
+  return err;
+}
+
 void
 audio_record_and_wait (guint32 options, struct task_control *control)
 {
@@ -48,6 +48,32 @@ typedef void (*audio_volume_change_callback) (gdouble);
 #define RECORD_STEREO (RECORD_LEFT | RECORD_RIGHT)
 #define RECORD_MONITOR_ONLY 0x4
 
+typedef void (*audio_stream_progress) (guint32 played,
+				       struct task_control * control,
+				       gpointer data);
+
+//Bounded ring buffer of frames in the output format that are played while they are being produced.
+//The producer writes with audio_stream_write and the audio callback reads from it.
+struct audio_stream
+{
+  GMutex mutex;
+  GCond cond;			//Signaled when frames are consumed
+  guint8 *data;
+  guint32 frame_size;
+  guint32 capacity;		//In frames
+  guint32 prefill;		//Frames written before starting the playback
+  guint32 start;
+  guint32 len;
+  guint32 total;		//Expected frames, only used for progress
+  guint32 played;
+  audio_stream_progress progress;	//If NULL, played / total is used
+  gpointer progress_data;
+  gboolean started;
+  gboolean closed;		//No more frames will be written
+  gboolean detached;		//Playback was reset by someone else
+  guint32 underruns;		//Reads filled with silence before closing
+};
+
 enum audio_status
 {
   AUDIO_STATUS_PREPARING_PLAYBACK,
@@ -97,6 +123,7 @@ struct audio
   gfloat monitor_level_l;
   gfloat monitor_level_r;
   audio_playback_cursor_notifier cursor_notifier;
+  struct audio_stream *stream;	//When set, it's played instead of sample
 };
 
 extern struct audio audio;
@@ -139,6 +166,18 @@ void audio_init_and_wait ();
 void audio_set_play_and_wait (struct idata *sample,
 			      struct task_control *control);
 
+void audio_stream_init (struct audio_stream *stream, guint32 total);
+
+//Blocks while the stream is full. Playback starts once the prefill is reached.
+gint audio_stream_write (struct audio_stream *stream, const void *frames,
+			 guint32 len, struct task_control *control);
+
+//Waits until all the written frames have been played and frees the stream.
+//It must always be called, even after a failed write.
+//As silence corrupts the data sent to devices, it fails if there was any underrun.
+gint audio_stream_end (struct audio_stream *stream,
+		       struct task_control *control);
+
 void audio_record_and_wait (guint32 options, struct task_control *control);
 
 #endif
@@ -19,14 +19,12 @@
  */
 
 #include "backend.h"
+#include "connector_cache.h"
 #include "local.h"
 #include "sample.h"
 #include "preferences.h"
 #include "utils.h"
 
-// This can be allocated statically as the only function that uses it is synchronized.
-static guint8 tmp_buffer[BE_MAX_BUFF_SIZE];
-
 struct connector *system_connector = NULL;
 GSList *connectors = NULL;
 
@@ -37,6 +35,8 @@ gint backend_tx_sysex_int (struct backend *backend,
 			   struct sysex_transfer *sysex_transfer,
 			   struct controllable *controllable);
 
+ssize_t backend_tx_raw_int (struct backend *, guint8 *, guint);
+ssize_t backend_rx_raw_int (struct backend *, guint8 *, guint);
 void backend_rx_drain_int (struct backend *);
 void backend_destroy_int (struct backend *);
 gint backend_init_int (struct backend *, const gchar *);
@@ -177,6 +177,7 @@ backend_midi_handshake (struct backend *backend)
   backend->fs_ops = NULL;
   backend->upgrade_os = NULL;
   backend->get_storage_stats = NULL;
+  backend->calibrate = NULL;
   memset (&backend->midi_info, 0, sizeof (struct backend_midi_info));
 
   tx_msg = g_byte_array_sized_new (sizeof (BE_MIDI_IDENTITY_REQUEST));
@@ -233,16 +234,98 @@ backend_midi_handshake (struct backend *backend)
 
   free_msg (rx_msg);
 
-  usleep (BE_REST_TIME_US);
+  backend_rest (backend, BE_REST_TIME_US);
+}
+
+void
+backend_rest (struct backend *backend, guint us)
+{
+  if (!backend->capture || !backend->capture->fast)
+    {
+      usleep (us);
+    }
+  telemetry_add_rest (&backend->telemetry, us);
 }
 
 //Not synchronized
 
+ssize_t
+backend_tx_raw (struct backend *backend, guint8 *data, guint len)
+{
+  ssize_t tx_len;
+
+  if (backend->capture && backend->capture->replay)
+    {
+      return capture_replay_tx (backend->capture, data, len);
+    }
+
+  tx_len = backend_tx_raw_int (backend, data, len);
+  if (tx_len > 0 && backend->capture)
+    {
+      capture_add (backend->capture, CAPTURE_DIR_TX, data, tx_len);
+    }
+
+  return tx_len;
+}
+
+ssize_t
+backend_rx_raw (struct backend *backend, guint8 *buffer, guint len)
+{
+  ssize_t rx_len;
+
+  if (backend->capture && backend->capture->replay)
+    {
+      return capture_replay_rx (backend->capture, buffer, len,
+				BE_POLL_TIMEOUT_MS * 1000);
+    }
+
+  rx_len = backend_rx_raw_int (backend, buffer, len);
+  if (rx_len > 0 && backend->capture)
+    {
+      capture_add (backend->capture, CAPTURE_DIR_RX, buffer, rx_len);
+    }
+
+  return rx_len;
+}
+
 gint
 backend_tx_sysex (struct backend *backend, struct sysex_transfer *transfer,
 		  struct controllable *controllable)
 {
-  return backend_tx_sysex_int (backend, transfer, controllable);
+  guint msgs = 0;
+  guint len = transfer->raw->len;
+  const guint8 *b = transfer->raw->data;
+  gint err;
+
+  if (backend->capture && backend->capture->replay)
+    {
+      sysex_transfer_set_status (transfer, controllable,
+				 SYSEX_TRANSFER_STATUS_SENDING);
+      err = capture_replay_tx (backend->capture, transfer->raw->data, len);
+      transfer->err = err < 0 ? err : 0;
+      err = transfer->err;
+      sysex_transfer_set_status (transfer, controllable,
+				 SYSEX_TRANSFER_STATUS_FINISHED);
+    }
+  else
+    {
+      err = backend_tx_sysex_int (backend, transfer, controllable);
+      if (!err && backend->capture)
+	{
+	  capture_add (backend->capture, CAPTURE_DIR_TX, b, len);
+	}
+    }
+
+  if (!err)
+    {
+      for (guint i = 0; i < len; i++, b++)
+	{
+	  msgs += *b == 0xf7;
+	}
+      telemetry_add_tx (&backend->telemetry, msgs, len);
+    }
+
+  return err;
 }
 
 //Synchronized
@@ -285,10 +368,13 @@ backend_tx_and_rx_sysex_transfer (struct backend *backend,
 				  struct sysex_transfer *transfer,
 				  struct controllable *controllable)
 {
+  gint64 start = 0;
+
   g_mutex_lock (&backend->mutex);
 
   if (transfer->raw)
     {
+      start = g_get_monotonic_time ();
       backend_tx_sysex (backend, transfer, controllable);
       sysex_transfer_clear (transfer);
     }
@@ -296,6 +382,11 @@ backend_tx_and_rx_sysex_transfer (struct backend *backend,
   if (!transfer->err)
     {
       backend_rx_sysex (backend, transfer, controllable);
+      if (!transfer->err && start)
+	{
+	  telemetry_add_rtt (&backend->telemetry, TELEMETRY_MSG_TYPE_SYSEX,
+			     g_get_monotonic_time () - start);
+	}
     }
 
   g_mutex_unlock (&backend->mutex);
@@ -400,14 +491,86 @@ backend_send_rpn (struct backend *backend, guint8 channel,
   return err;
 }
 
+static void
+backend_rx_buffer_free (struct backend_rx_buffer *buffer)
+{
+  g_free (buffer->data);
+  buffer->data = NULL;
+}
+
 static gint
-backend_init_midi (struct backend *backend, const gchar *id)
+backend_init_capture (struct backend *backend, const gchar *id,
+		      const gchar *name)
+{
+  gint err;
+  const gchar *path = g_getenv (CAPTURE_ENV_FILE);
+
+  backend->capture = NULL;
+
+  if (g_str_has_prefix (id, CAPTURE_REPLAY_ID_PREFIX))
+    {
+      backend->capture = g_malloc (sizeof (struct capture));
+      err = capture_load (backend->capture,
+			  &id[strlen (CAPTURE_REPLAY_ID_PREFIX)],
+			  g_getenv (CAPTURE_ENV_REPLAY_FAST) != NULL);
+    }
+  else
+    {
+      err = backend_init_int (backend, id);
+      if (err || !path)
+	{
+	  return err;
+	}
+      backend->capture = g_malloc (sizeof (struct capture));
+      err = capture_open (backend->capture, path, name);
+      if (err)
+	{
+	  backend_destroy_int (backend);
+	}
+    }
+
+  if (err)
+    {
+      g_free (backend->capture);
+      backend->capture = NULL;
+    }
+
+  return err;
+}
+
+static void
+backend_destroy_capture (struct backend *backend)
+{
+  if (!backend->capture || !backend->capture->replay)
+    {
+      backend_destroy_int (backend);
+    }
+
+  if (backend->capture)
+    {
+      capture_close (backend->capture);
+      g_free (backend->capture);
+      backend->capture = NULL;
+    }
+}
+
+static gint
+backend_init_midi (struct backend *backend, const gchar *id,
+		   const gchar *name)
 {
   debug_print (1, "Initializing backend (%s) to '%s'...",
 	       backend_name (), id);
   backend->type = BE_TYPE_MIDI;
-  gint err = backend_init_int (backend, id);
-  if (!err)
+  snprintf (backend->device_name, LABEL_MAX, "%s", name);
+  backend->buffer.data = g_malloc (BE_RX_BUFF_SIZE);
+  backend->buffer.start = 0;
+  backend->buffer.len = 0;
+  gint err = backend_init_capture (backend, id, name);
+  if (err)
+    {
+      backend_rx_buffer_free (&backend->buffer);
+    }
+  else
     {
       g_mutex_lock (&backend->mutex);
       backend_rx_drain (backend);
@@ -421,7 +584,7 @@ backend_init_midi (struct backend *backend, const gchar *id)
 	{
 	  error_print ("Error while stopping device");
 	}
-      usleep (BE_REST_TIME_US);
+      backend_rest (backend, BE_REST_TIME_US);
     }
 
   return err;
@@ -430,8 +593,23 @@ backend_init_midi (struct backend *backend, const gchar *id)
 void
 backend_destroy (struct backend *backend)
 {
+  const gchar *stats_file = g_getenv (TELEMETRY_ENV_FILE);
+
   debug_print (1, "Destroying backend...");
 
+  if (backend->type == BE_TYPE_MIDI && stats_file)
+    {
+      //Every session is appended so that the previous ones are kept.
+      gchar *json = telemetry_to_json (&backend->telemetry);
+      gchar *line = g_strconcat (json, "\n", NULL);
+      debug_print (1, "Appending transport statistics to '%s'...",
+		   stats_file);
+      file_append_data (stats_file, (guint8 *) line, strlen (line));
+      g_free (line);
+      g_free (json);
+    }
+  telemetry_clear (&backend->telemetry);
+
   if (backend->destroy_data)
     {
       backend->destroy_data (backend);
@@ -439,22 +617,34 @@ backend_destroy (struct backend *backend)
 
   if (backend->type == BE_TYPE_MIDI)
     {
-      backend_destroy_int (backend);
+      backend_destroy_capture (backend);
+      backend_rx_buffer_free (&backend->buffer);
     }
 
   backend->upgrade_os = NULL;
   backend->get_storage_stats = NULL;
+  backend->calibrate = NULL;
   backend->destroy_data = NULL;
   backend->type = BE_TYPE_NONE;
   g_slist_free (backend->fs_ops);
 }
 
+gboolean
+backend_uses_disk_caches (struct backend *backend)
+{
+  return backend->capture == NULL;
+}
+
 gboolean
 backend_check (struct backend *backend)
 {
   switch (backend->type)
     {
     case BE_TYPE_MIDI:
+      if (backend->capture && backend->capture->replay)
+	{
+	  return TRUE;
+	}
       return backend_check_int (backend);
     case BE_TYPE_SYSTEM:
     case BE_TYPE_NO_MIDI:
@@ -464,41 +654,123 @@ backend_check (struct backend *backend)
     }
 }
 
-static guint8 *
-backend_get_sysex_start (guint8 *tmp, ssize_t *size)
+static void
+backend_rx_buffer_consume (struct backend_rx_buffer *buffer, guint len)
 {
-  guint i, total = *size;
-  guint8 *msg_start;
+  buffer->start += len;
+  buffer->len -= len;
+  if (!buffer->len)
+    {
+      buffer->start = 0;
+    }
+}
+
+//Data is always read after the stored data and there must be room for a whole read.
+//Stored data are only moved to the beginning when there is no room left, which only happens with incomplete messages.
 
+static gint
+backend_rx_buffer_reserve (struct backend_rx_buffer *buffer, guint len)
+{
+  if (buffer->start + buffer->len + len <= BE_RX_BUFF_SIZE)
+    {
+      return 0;
+    }
+
+  if (buffer->len + len > BE_RX_BUFF_SIZE)
+    {
+      return -ENOBUFS;
+    }
+
+  debug_print (4, "Moving %d bytes to the internal buffer start...",
+	       buffer->len);
+  memmove (buffer->data, buffer->data + buffer->start, buffer->len);
+  buffer->start = 0;
+
+  return 0;
+}
+
+static guint8 *
+backend_get_sysex_start (guint8 *data, ssize_t *size)
+{
   //Everything is skipped until a 0xf0 is found. This includes every RT MIDI message.
-  msg_start = tmp;
-  for (i = 0; i < total; i++, msg_start++, (*size)--)
+  guint8 *msg_start = memchr (data, 0xf0, *size);
+  guint skipped = msg_start ? msg_start - data : *size;
+
+  debug_print_hex (4, data, skipped, "Skipping non SysEx data (%d): %s",
+		   skipped);
+
+  *size -= skipped;
+
+  return data + skipped;
+}
+
+static inline gboolean
+backend_is_sysex_byte (guint8 v)
+{
+  return v == 0xf0 || v == 0xf7 || (v & 0xf0) != 0xf0;
+}
+
+//Copies len bytes from src to dst (dst <= src) except the System Common and System Real-Time bytes that are not SysEx start or end bytes.
+//8 bytes are checked at once and only the words containing a 0xfX byte are filtered byte by byte.
+//As the only 0xfX bytes in a SysEx stream are typically the start and end bytes, almost every word is just moved or even left as is.
+
+static guint
+backend_filter_sysex_bytes (guint8 *dst, const guint8 *src, guint len)
+{
+  guint64 w, x;
+  guint8 *start = dst;
+  const guint8 *end = src + len;
+
+  while (src + sizeof (guint64) <= end)
     {
-      if (*msg_start == 0xf0)
+      memcpy (&w, src, sizeof (guint64));
+      //A zero byte in x means that the high nibble of the byte is 0xf.
+      x = (w & BE_SWAR_HIGH_NIBBLES) ^ BE_SWAR_HIGH_NIBBLES;
+      if (!((x - BE_SWAR_ONES) & ~x & BE_SWAR_HIGH_BITS))
 	{
-	  break;
+	  if (dst != src)
+	    {
+	      memmove (dst, src, sizeof (guint64));
+	    }
+	  dst += sizeof (guint64);
+	  src += sizeof (guint64);
+	  continue;
+	}
+
+      for (guint i = 0; i < sizeof (guint64); i++, src++)
+	{
+	  if (backend_is_sysex_byte (*src))
+	    {
+	      *dst = *src;
+	      dst++;
+	    }
 	}
     }
 
-  if (debug_level >= 4)
+  for (; src < end; src++)
     {
-      gchar *text = debug_get_hex_data (debug_level, tmp, i);
-      debug_print (4, "Skipping non SysEx data (%d): %s", i, text);
-      g_free (text);
+      if (backend_is_sysex_byte (*src))
+	{
+	  *dst = *src;
+	  dst++;
+	}
     }
 
-  return msg_start;
+  return dst - start;
 }
 
+//next_check is the position in the stored data from where the caller looks for the message end. It is reset if the stored data are discarded.
+
 static ssize_t
 backend_rx_raw_loop (struct backend *backend, struct sysex_transfer *transfer,
-		     struct controllable *controllable)
+		     struct controllable *controllable, guint *next_check)
 {
-  gchar *text;
-  ssize_t rx_len;
-  guint8 *msg_start;
+  ssize_t rx_len, read_len;
+  guint8 *rx_data, *msg_start;
+  guint queued;
+  struct backend_rx_buffer *buffer = &backend->buffer;
 
-  if (!backend->inputp)
+  if (!backend->inputp && !backend->capture)
     {
       error_print ("Input port is NULL");
       return -ENOTCONN;
@@ -522,16 +794,22 @@ backend_rx_raw_loop (struct backend *backend, struct sysex_transfer *transfer,
 	  && transfer->time >= transfer->timeout)
 	{
 	  debug_print (1, "Timeout (%d)", transfer->timeout);
-	  gchar *text =
-	    debug_get_hex_data (debug_level, backend->buffer->data,
-				backend->buffer->len);
-	  debug_print (4, "Internal buffer data (%u): %s",
-		       backend->buffer->len, text);
-	  g_free (text);
+	  debug_print_hex (4, buffer->data + buffer->start, buffer->len,
+			   "Internal buffer data (%u): %s", buffer->len);
 	  return -ETIMEDOUT;
 	}
 
-      rx_len = backend_rx_raw (backend, tmp_buffer, BE_MAX_BUFF_SIZE);
+      if (backend_rx_buffer_reserve (buffer, BE_MAX_BUFF_SIZE))
+	{
+	  error_print ("No message end found in %d bytes. Discarding...",
+		       buffer->len);
+	  buffer->start = 0;
+	  buffer->len = 0;
+	  *next_check = 0;
+	}
+
+      rx_data = buffer->data + buffer->start + buffer->len;
+      rx_len = backend_rx_raw (backend, rx_data, BE_MAX_BUFF_SIZE);
       if (rx_len < 0)
 	{
 	  return rx_len;
@@ -547,79 +825,66 @@ backend_rx_raw_loop (struct backend *backend, struct sysex_transfer *transfer,
 	  continue;
 	}
 
-      if (debug_level >= 4)
-	{
-	  gchar *text = debug_get_hex_data (debug_level, tmp_buffer, rx_len);
-	  debug_print (4, "Read data (%zd): %s", rx_len, text);
-	  g_free (text);
-	}
+      debug_print_hex (4, rx_data, rx_len, "Read data (%zd): %s", rx_len);
 
-      if (backend->buffer->len)
+      read_len = rx_len;
+      if (buffer->len)
 	{
-	  msg_start = tmp_buffer;
+	  msg_start = rx_data;
 	}
       else
 	{
-	  msg_start = backend_get_sysex_start (tmp_buffer, &rx_len);
+	  msg_start = backend_get_sysex_start (rx_data, &rx_len);
 	}
 
       if (rx_len == 0)
 	{
+	  telemetry_add_rx_skipped (&backend->telemetry, read_len);
 	  transfer->time += BE_POLL_TIMEOUT_MS;
 	  continue;
 	}
 
-      if (rx_len > 0)
+      queued = backend_filter_sysex_bytes (rx_data, msg_start, rx_len);
+      if (read_len != queued)
 	{
-	  guint8 *v = msg_start;
-	  for (guint i = 0; i < rx_len; i++, v++)
-	    {
-	      if (*v == 0xf0 || *v == 0xf7 || (*v & 0xf0) != 0xf0)
-		{
-		  g_byte_array_append (backend->buffer, v, 1);
-		}
-	    }
-	  if (debug_level >= 3)
-	    {
-	      text = debug_get_hex_data (debug_level, msg_start, rx_len);
-	      debug_print (3, "Queued data (%zu): %s", rx_len, text);
-	      g_free (text);
-	    }
-	  break;
+	  telemetry_add_rx_skipped (&backend->telemetry, read_len - queued);
 	}
+      buffer->len += queued;
+      debug_print_hex (3, rx_data, queued, "Queued data (%u): %s", queued);
+      break;
     }
 
-
-  return backend->buffer->len;
+  return buffer->len;
 }
 
-//Access to this function must be synchronized.
-
-gint
-backend_rx_sysex (struct backend *backend, struct sysex_transfer *transfer,
-		  struct controllable *controllable)
+static gint
+backend_rx_sysex_int (struct backend *backend,
+		      struct sysex_transfer *transfer,
+		      struct controllable *controllable)
 {
-  gint next_check, len, i;
-  guint8 *b;
+  guint next_check, len, i;
+  guint8 *b, *v;
   ssize_t rx_len;
+  struct backend_rx_buffer *buffer = &backend->buffer;
 
   transfer->err = 0;
   transfer->time = 0;
-  transfer->raw = g_byte_array_sized_new (BE_INT_BUFF_SIZE);
+  transfer->raw = NULL;
   sysex_transfer_set_status (transfer, controllable,
 			     SYSEX_TRANSFER_STATUS_WAITING);
 
   next_check = 0;
   while (1)
     {
-      if (backend->buffer->len == next_check)
+      if (buffer->len == next_check)
 	{
 	  debug_print (4, "Reading from MIDI device...");
 	  if (transfer->batch)
 	    {
 	      transfer->time = 0;
 	    }
-	  rx_len = backend_rx_raw_loop (backend, transfer, controllable);
+	  rx_len = backend_rx_raw_loop (backend, transfer, controllable,
+					&next_check);
 
 	  if (rx_len == -ENODATA || rx_len == -ETIMEDOUT
 	      || rx_len == -ECANCELED)
@@ -647,92 +912,71 @@ backend_rx_sysex (struct backend *backend, struct sysex_transfer *transfer,
 
       sysex_transfer_set_status (transfer, controllable,
 				 SYSEX_TRANSFER_STATUS_RECEIVING);
-      len = -1;
-      b = backend->buffer->data + next_check;
-      for (; next_check < backend->buffer->len; next_check++, b++)
+
+      b = buffer->data + buffer->start;
+      v = memchr (b + next_check, 0xf7, buffer->len - next_check);
+      if (!v)
 	{
-	  if (*b == 0xf7)
-	    {
-	      next_check++;
-	      len = next_check;
-	      break;
-	    }
+	  next_check = buffer->len;
+	  debug_print (4, "No message in the queue. Continuing...");
+	  continue;
 	}
 
+      len = v - b + 1;
+
       //We filter out any SysEx message not suitable.
+      //Filter out everything until an 0xf0 is found.
+      v = memchr (b, 0xf0, len);
+      i = v ? v - b : len;
+      if (i > 0)
+	{
+	  debug_print_hex (4, b, i,
+			   "Skipping non SysEx data in buffer (%d): %s", i);
+	  telemetry_add_rx_skipped (&backend->telemetry, i);
+	}
 
-      if (len > 0)
+      //Filter empty message
+      if (len - i == 2)
+	{
+	  debug_print (4, "Removing empty message...");
+	}
+      else if (len - i)
 	{
-	  //Filter out everything until an 0xf0 is found.
-	  b = backend->buffer->data;
-	  for (i = 0; i < len && *b != 0xf0; i++, b++);
-	  if (i > 0 && debug_level >= 4)
-	    {
-	      gchar *text = debug_get_hex_data (debug_level,
-						backend->buffer->data, i);
-	      debug_print (4, "Skipping non SysEx data in buffer (%d): %s",
-			   i, text);
-	      g_free (text);
-	    }
 	  debug_print (3, "Copying %d bytes...", len - i);
-	  g_byte_array_append (transfer->raw, b, len - i);
-
-	  g_byte_array_remove_range (backend->buffer, 0, len);
-
-	  transfer->err = 0;
-	  next_check = 0;
-
-	  //Filter empty message
-	  if (transfer->raw->len == 2
-	      && !memcmp (transfer->raw->data, "\xf0\xf7", 2))
+	  if (!transfer->raw)
 	    {
-	      debug_print (4, "Removing empty message...");
-	      g_byte_array_remove_range (transfer->raw, 0, 2);
-	      continue;
-	    }
-
-	  if (debug_level >= 4)
-	    {
-	      gchar *text =
-		debug_get_hex_data (debug_level, transfer->raw->data,
-				    transfer->raw->len);
-	      debug_print (4, "Queued data (%d): %s",
-			   transfer->raw->len, text);
-	      g_free (text);
+	      transfer->raw = g_byte_array_sized_new (len - i);
 	    }
+	  g_byte_array_append (transfer->raw, v, len - i);
+	  telemetry_add_rx (&backend->telemetry, 1, len - i);
+	  debug_print_hex_msg (4, transfer->raw, "Queued data (%d): %s",
+			       transfer->raw->len);
 	}
-      else
-	{
-	  debug_print (4, "No message in the queue. Continuing...");
-	}
 
-      if (transfer->raw->len && !transfer->batch)
+      backend_rx_buffer_consume (buffer, len);
+
+      transfer->err = 0;
+      next_check = 0;
+
+      if (transfer->raw && !transfer->batch)
 	{
 	  break;
 	}
     }
 
 end:
-  if (!transfer->raw->len)
+  if (!transfer->raw)
     {
       transfer->err = -ETIMEDOUT;
     }
   if (transfer->err)
     {
-      free_msg (transfer->raw);
-      transfer->raw = NULL;
+      sysex_transfer_clear (transfer);
     }
   else
     {
-      if (debug_level >= 2)
-	{
-	  gchar *text = debug_get_hex_data (debug_level, transfer->raw->data,
-					    transfer->raw->len);
-	  debug_print (2, "Raw message received (%d): %s",
-		       transfer->raw->len, text);
-	  g_free (text);
-	}
-
+      debug_print_hex_msg (2, transfer->raw, "Raw message received (%d): %s",
+			   transfer->raw->len);
     }
 
   sysex_transfer_set_status (transfer, controllable,
@@ -743,6 +987,20 @@ end:
 
 //Access to this function must be synchronized.
 
+gint
+backend_rx_sysex (struct backend *backend, struct sysex_transfer *transfer,
+		  struct controllable *controllable)
+{
+  gint err = backend_rx_sysex_int (backend, transfer, controllable);
+  if (err == -ETIMEDOUT)
+    {
+      telemetry_add_timeout (&backend->telemetry);
+    }
+  return err;
+}
+
+//Access to this function must be synchronized.
+
 void
 backend_rx_drain (struct backend *backend)
 {
@@ -751,9 +1009,14 @@ backend_rx_drain (struct backend *backend)
   sysex_transfer_init_rx (&transfer, 1000, FALSE);
 
   debug_print (2, "Draining buffers...");
-  backend->buffer->len = 0;
-  backend_rx_drain_int (backend);
-  while (!backend_rx_sysex (backend, &transfer, NULL))
+  backend->buffer.start = 0;
+  backend->buffer.len = 0;
+  if (!backend->capture || !backend->capture->replay)
+    {
+      backend_rx_drain_int (backend);
+    }
+  //Draining always ends with a timeout, which is not accounted.
+  while (!backend_rx_sysex_int (backend, &transfer, NULL))
     {
       sysex_transfer_clear (&transfer);
     }
@@ -788,6 +1051,8 @@ backend_get_devices ()
   guint id;
   GSList *c;
   GArray *devices;
+  const gchar *replay_file;
+  struct capture capture;
   struct backend_device *backend_device;
 
   devices = g_array_new (FALSE, FALSE, sizeof (struct backend_device));
@@ -802,6 +1067,19 @@ backend_get_devices ()
   //Actually present devices
   backend_fill_devices_array (devices);
 
+  //Replayed device
+  replay_file = g_getenv (CAPTURE_ENV_REPLAY_FILE);
+  if (replay_file && !capture_load (&capture, replay_file, FALSE))
+    {
+      backend_device = g_malloc (sizeof (struct backend_device));
+      backend_device->type = BE_TYPE_MIDI;
+      snprintf (backend_device->id, LABEL_MAX, "%s%s",
+		CAPTURE_REPLAY_ID_PREFIX, replay_file);
+      snprintf (backend_device->name, LABEL_MAX, "%s", capture.name);
+      g_array_append_vals (devices, backend_device, 1);
+      capture_close (&capture);
+    }
+
   //Devices that need a manual handshake. These may or may not be a present device.
   id = 0;
   c = connectors;
@@ -826,6 +1104,35 @@ backend_get_devices ()
   return devices;
 }
 
+static const guint8 BE_ANY_COMPANY[BE_COMPANY_LEN] = { 0 };
+static const guint8 BE_ANY_FAMILY[BE_FAMILY_LEN] = { 0 };
+
+//If the device did not reply to the MIDI identity request, every connector is accepted.
+
+static gboolean
+backend_connector_accepts (const struct connector *connector,
+			   const struct backend_midi_info *midi_info)
+{
+  if (!memcmp (midi_info->company, BE_ANY_COMPANY, BE_COMPANY_LEN))
+    {
+      return TRUE;
+    }
+
+  if (memcmp (connector->midi_company, BE_ANY_COMPANY, BE_COMPANY_LEN) &&
+      memcmp (connector->midi_company, midi_info->company, BE_COMPANY_LEN))
+    {
+      return FALSE;
+    }
+
+  if (memcmp (connector->midi_family, BE_ANY_FAMILY, BE_FAMILY_LEN) &&
+      memcmp (connector->midi_family, midi_info->family, BE_FAMILY_LEN))
+    {
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
 // A handshake function might return these values:
 // 0, the device matches the connector.
 // -ENODEV, the device does not match the connector but we can continue with the next connector.
@@ -840,6 +1147,10 @@ backend_init_connector (struct backend *backend,
   gint err;
   GSList *list = NULL, *iterator;
   GSList *c;
+  gchar *cached = NULL;
+  struct backend_midi_info midi_info;
+
+  telemetry_init (&backend->telemetry);
 
   if (device->type == BE_TYPE_SYSTEM)
     {
@@ -871,17 +1182,35 @@ backend_init_connector (struct backend *backend,
 	}
     }
 
-  err = backend_init_midi (backend, device->id);
+  err = backend_init_midi (backend, device->id, device->name);
   if (err)
     {
       return err;
     }
 
+  //A failed handshake might change the MIDI info of the backend so a copy is used.
+  memset (&midi_info, 0, sizeof (struct backend_midi_info));
+  if (!conn_name)
+    {
+      backend_midi_handshake (backend);
+      midi_info = backend->midi_info;
+      //A capture must include the whole detection to be replayable.
+      if (backend_uses_disk_caches (backend))
+	{
+	  cached = connector_cache_get (device->name, &midi_info);
+	}
+    }
+
   c = connectors;
   while (c)
     {
       struct connector *connector = c->data;
-      if (connector->regex)
+      if (!backend_connector_accepts (connector, &midi_info))
+	{
+	  debug_print (1, "Connector %s does not accept the device",
+		       connector->name);
+	}
+      else if (connector->regex)
 	{
 	  GRegex *regex = g_regex_new (connector->regex, G_REGEX_CASELESS,
 				       0, NULL);
@@ -904,15 +1233,22 @@ backend_init_connector (struct backend *backend,
       c = c->next;
     }
 
-  if (!CONTROLLABLE_IS_NULL_OR_ACTIVE (controllable))
+  //The connector that last succeeded with the device is tested first.
+  for (iterator = list; cached && iterator; iterator = iterator->next)
     {
-      err = -ECANCELED;
-      goto end;
+      const struct connector *c = iterator->data;
+      if (!strcmp (c->name, cached))
+	{
+	  list = g_slist_remove_link (list, iterator);
+	  list = g_slist_concat (iterator, list);
+	  break;
+	}
     }
 
-  if (!conn_name)
+  if (!CONTROLLABLE_IS_NULL_OR_ACTIVE (controllable))
     {
-      backend_midi_handshake (backend);
+      err = -ECANCELED;
+      goto end;
     }
 
   err = -ENODEV;
@@ -958,6 +1294,10 @@ backend_init_connector (struct backend *backend,
 	    {
 	      debug_print (1, "Using %s connector...", c->name);
 	      backend->conn_name = c->name;
+	      if (!(c->options & CONNECTOR_OPTION_FALLBACK))
+		{
+		  connector_cache_set (device->name, &midi_info, c->name);
+		}
 	      goto end;
 	    }
 	}
@@ -966,6 +1306,7 @@ backend_init_connector (struct backend *backend,
   error_print ("No device recognized");
 
 end:
+  g_free (cached);
   g_slist_free (list);
   if (err)
     {
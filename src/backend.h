@@ -19,8 +19,12 @@
  */
 
 #include "utils.h"
+#include "telemetry.h"
+#include "capture.h"
 
-#if defined(ELEKTROID_RTMIDI)
+#if defined(ELEKTROID_VIRTUAL)
+#include "backend_virtual.h"
+#elif defined(ELEKTROID_RTMIDI)
 #include <fcntl.h>
 #include <rtmidi_c.h>
 #else
@@ -34,10 +38,16 @@
 
 #define BE_POLL_TIMEOUT_MS 20
 #define BE_MAX_TX_LEN KI	//With a higher value than 4 KB, functions behave erratically.
-#define BE_INT_BUFF_SIZE (128 * KI)	//Used as the default size for the GByteArray buffer.
+#define BE_INT_BUFF_SIZE (128 * KI)	//Used as the RtMidi input queue size.
 #define BE_DEV_RING_BUF_LEN (256 * KI)
 //This size is required by RtMidi as it needs enough space for a message. Therefore, this must be the maximum size of all the possible messages.
 #define BE_MAX_BUFF_SIZE MI
+//Received data is stored here. There is always room for a read of BE_MAX_BUFF_SIZE bytes after an incomplete message.
+#define BE_RX_BUFF_SIZE (2 * BE_MAX_BUFF_SIZE)
+
+#define BE_SWAR_ONES 0x0101010101010101ULL
+#define BE_SWAR_HIGH_BITS 0x8080808080808080ULL
+#define BE_SWAR_HIGH_NIBBLES 0xf0f0f0f0f0f0f0f0ULL
 
 #define BE_REST_TIME_US 50000
 #define BE_SYSEX_TIMEOUT_MS 5000
@@ -72,6 +82,10 @@ typedef gint (*t_get_storage_stats) (struct backend * backend, guint8 type,
 				     struct backend_storage_stats * stats,
 				     const gchar * path);
 
+//Measures the minimum rest time in us between packets the device handles without errors. The item at path might be overwritten.
+typedef gint (*t_calibrate) (struct backend * backend, const gchar * path,
+			     struct task_control * control, gint * rest_time);
+
 struct backend_midi_info
 {
   gchar company[BE_COMPANY_LEN];
@@ -110,24 +124,56 @@ struct sysex_transfer
 typedef gint (*t_sysex_transfer) (struct backend *, struct sysex_transfer *,
 				  struct controllable * controllable);
 
+#if defined(ELEKTROID_RTMIDI)
+#define BE_RTMIDI_QUEUE_SIZE (2 * BE_MAX_BUFF_SIZE)	//It must be a power of 2.
+#define BE_RTMIDI_LATENCY_HISTOGRAM_LEN 16
+
+//Single producer (the RtMidi callback thread) and single consumer queue.
+//Every message is stored as its length, its arrival time and its bytes. head and tail are free running counters only written by the consumer and the producer respectively.
+//The mutex and the condition are only used to wait for data and never to access the queue.
+struct backend_rtmidi_queue
+{
+  guint8 *data;
+  guint head;
+  guint tail;
+  GMutex mutex;
+  GCond cond;
+  //Latency between the message arrival and its reading in powers of 2 of us.
+  guint64 latency_histogram[BE_RTMIDI_LATENCY_HISTOGRAM_LEN];
+};
+#endif
+
+//Fixed capacity buffer for the received data. Messages are consumed from the start and incomplete messages are kept contiguous.
+struct backend_rx_buffer
+{
+  guint8 *data;
+  guint start;
+  guint len;
+};
+
 struct backend
 {
-// ALSA or RtMidi backend
-#if defined(ELEKTROID_RTMIDI)
+// ALSA, RtMidi or virtual backend
+#if defined(ELEKTROID_VIRTUAL)
+  struct backend_virtual_device *inputp;
+  struct backend_virtual_device *outputp;
+#elif defined(ELEKTROID_RTMIDI)
   struct RtMidiWrapper *inputp;
   struct RtMidiWrapper *outputp;
+  struct backend_rtmidi_queue queue;
 #else
   snd_rawmidi_t *inputp;
   snd_rawmidi_t *outputp;
   gint npfds;
   struct pollfd *pfds;
 #endif
-  GByteArray *buffer;
+  struct backend_rx_buffer buffer;
   enum backend_type type;
   struct backend_midi_info midi_info;
   gchar name[LABEL_MAX];
   gchar version[LABEL_MAX];
   gchar description[LABEL_MAX];
+  gchar device_name[LABEL_MAX];	//MIDI port name. It tells identical devices apart.
   GMutex mutex;
   //This must be filled by the concrete connector.
   const gchar *conn_name;
@@ -136,6 +182,9 @@ struct backend
   t_destroy_data destroy_data;
   t_sysex_transfer upgrade_os;	//This function is device function, not a filesystem function.
   t_get_storage_stats get_storage_stats;	//This function is a device function, not a filesystem function. Several filesystems might share the same memory.
+  t_calibrate calibrate;	//This function is a device function, not a filesystem function.
+  struct telemetry telemetry;
+  struct capture *capture;	//Recorded or replayed session. NULL if none.
 };
 
 struct backend_device
@@ -176,6 +225,9 @@ void backend_rx_drain (struct backend *);
 
 gboolean backend_check (struct backend *);
 
+//Returns FALSE while capturing or replaying as the capture must contain every request and the replay must read them.
+gboolean backend_uses_disk_caches (struct backend *);
+
 GArray *backend_get_devices ();
 
 const struct fs_operations *backend_get_fs_operations_by_id (struct backend *,
@@ -193,6 +245,9 @@ void backend_destroy_data (struct backend *);
 
 void backend_midi_handshake (struct backend *backend);
 
+//Sleeps the given time accounting it in the telemetry.
+void backend_rest (struct backend *backend, guint us);
+
 gint backend_program_change (struct backend *, guint8, guint8);
 
 gint backend_send_controller (struct backend *backend, guint8 channel,
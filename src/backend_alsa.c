@@ -55,12 +55,6 @@ backend_destroy_int (struct backend *backend)
       backend->outputp = NULL;
     }
 
-  if (backend->buffer)
-    {
-      g_free (backend->buffer);
-      backend->buffer = NULL;
-    }
-
   if (backend->pfds)
     {
       g_free (backend->pfds);
@@ -78,8 +72,6 @@ backend_init_int (struct backend *backend, const gchar *id)
   backend->outputp = NULL;
   backend->pfds = NULL;
 
-  backend->buffer = g_byte_array_sized_new (BE_INT_BUFF_SIZE);
-
   if ((err = snd_rawmidi_open (&backend->inputp, &backend->outputp, id,
 			       SND_RAWMIDI_NONBLOCK | SND_RAWMIDI_SYNC)) < 0)
     {
@@ -135,12 +127,11 @@ cleanup_params:
   snd_rawmidi_params_free (params);
 cleanup:
   backend_destroy (backend);
-  g_free (backend->buffer);
   return err;
 }
 
 ssize_t
-backend_tx_raw (struct backend *backend, guint8 *data, guint len)
+backend_tx_raw_int (struct backend *backend, guint8 *data, guint len)
 {
   ssize_t tx_len;
 
@@ -186,7 +177,7 @@ backend_tx_sysex_int (struct backend *backend,
 	  len = BE_MAX_TX_LEN;
 	}
 
-      tx_len = backend_tx_raw (backend, b, len);
+      tx_len = backend_tx_raw_int (backend, b, len);
       if (tx_len < 0)
 	{
 	  transfer->err = tx_len;
@@ -201,12 +192,10 @@ backend_tx_sysex_int (struct backend *backend,
       transfer->err = -ECANCELED;
     }
 
-  if (!transfer->err && debug_level >= 2)
+  if (!transfer->err)
     {
-      gchar *text = debug_get_hex_data (debug_level, transfer->raw->data,
-					transfer->raw->len);
-      debug_print (2, "Raw message sent (%d): %s", transfer->raw->len, text);
-      g_free (text);
+      debug_print_hex_msg (2, transfer->raw, "Raw message sent (%d): %s",
+			   transfer->raw->len);
     }
 
   sysex_transfer_set_status (transfer, controllable,
@@ -222,7 +211,7 @@ backend_rx_drain_int (struct backend *backend)
 }
 
 ssize_t
-backend_rx_raw (struct backend *backend, guint8 *buffer, guint len)
+backend_rx_raw_int (struct backend *backend, guint8 *buffer, guint len)
 {
   gint err;
   ssize_t rx_len;
@@ -21,8 +21,6 @@
 #include <rtmidi_c.h>
 #include "backend.h"
 
-#define RTMIDI_TMP_BUFF_SIZE 1024
-
 #if defined(__linux__)
 #define ELEKTROID_RTMIDI_API RTMIDI_API_LINUX_ALSA
 #define FIRST_OUTPUT_PORT 1	//Skip Midi Through
@@ -36,16 +34,130 @@
 
 #define INPUT_OUTPUT_SEPARATOR " :: "
 
+#define QUEUE_MASK (BE_RTMIDI_QUEUE_SIZE - 1)
+#define QUEUE_MSG_HEADER_LEN (sizeof (guint32) + sizeof (gint64))
+
 void
 sysex_transfer_set_status (struct sysex_transfer *sysex_transfer,
 			   struct controllable *controllable,
 			   enum sysex_transfer_status status);
 
+static void
+backend_queue_write (struct backend_rtmidi_queue *queue, guint *pos,
+		     const void *src, guint len)
+{
+  guint offset = *pos & QUEUE_MASK;
+  guint first = BE_RTMIDI_QUEUE_SIZE - offset;
+
+  if (first > len)
+    {
+      first = len;
+    }
+
+  memcpy (&queue->data[offset], src, first);
+  memcpy (queue->data, (guint8 *) src + first, len - first);
+  *pos += len;
+}
+
+static void
+backend_queue_read (struct backend_rtmidi_queue *queue, guint *pos,
+		    void *dst, guint len)
+{
+  guint offset = *pos & QUEUE_MASK;
+  guint first = BE_RTMIDI_QUEUE_SIZE - offset;
+
+  if (first > len)
+    {
+      first = len;
+    }
+
+  memcpy (dst, &queue->data[offset], first);
+  memcpy ((guint8 *) dst + first, queue->data, len - first);
+  *pos += len;
+}
+
+//This runs on the RtMidi thread, which is the only producer.
+
+static void
+backend_rtmidi_callback (double timestamp, const unsigned char *message,
+			 size_t size, void *user_data)
+{
+  struct backend_rtmidi_queue *queue = user_data;
+  guint head = g_atomic_int_get (&queue->head);
+  guint tail = queue->tail;
+  guint32 len = size;
+  gint64 time = g_get_monotonic_time ();
+
+  if (BE_RTMIDI_QUEUE_SIZE - (tail - head) < QUEUE_MSG_HEADER_LEN + size)
+    {
+      error_print ("Input queue full. Discarding %zu bytes...", size);
+      return;
+    }
+
+  backend_queue_write (queue, &tail, &len, sizeof (guint32));
+  backend_queue_write (queue, &tail, &time, sizeof (gint64));
+  backend_queue_write (queue, &tail, message, len);
+  g_atomic_int_set (&queue->tail, tail);
+
+  g_mutex_lock (&queue->mutex);
+  g_cond_signal (&queue->cond);
+  g_mutex_unlock (&queue->mutex);
+}
+
+static void
+backend_queue_init (struct backend_rtmidi_queue *queue)
+{
+  queue->data = g_malloc (BE_RTMIDI_QUEUE_SIZE);
+  queue->head = 0;
+  queue->tail = 0;
+  g_mutex_init (&queue->mutex);
+  g_cond_init (&queue->cond);
+  memset (queue->latency_histogram, 0, sizeof (queue->latency_histogram));
+}
+
+static void
+backend_queue_clear (struct backend_rtmidi_queue *queue)
+{
+  if (!queue->data)
+    {
+      return;
+    }
+
+  for (guint i = 0; i < BE_RTMIDI_LATENCY_HISTOGRAM_LEN; i++)
+    {
+      if (queue->latency_histogram[i])
+	{
+	  debug_print (1, "Receive latency < %d us: %" PRIu64 " messages",
+		       1 << (i + 1), queue->latency_histogram[i]);
+	}
+    }
+
+  g_free (queue->data);
+  queue->data = NULL;
+  g_mutex_clear (&queue->mutex);
+  g_cond_clear (&queue->cond);
+}
+
+static void
+backend_queue_add_latency (struct backend_rtmidi_queue *queue, gint64 time)
+{
+  guint i = 0;
+  gint64 latency = g_get_monotonic_time () - time;
+
+  while (latency > 1 && i < BE_RTMIDI_LATENCY_HISTOGRAM_LEN - 1)
+    {
+      latency >>= 1;
+      i++;
+    }
+  queue->latency_histogram[i]++;
+}
+
 void
 backend_destroy_int (struct backend *backend)
 {
   if (backend->inputp)
     {
+      rtmidi_in_cancel_callback (backend->inputp);
       rtmidi_close_port (backend->inputp);
       rtmidi_in_free (backend->inputp);
       backend->inputp = NULL;
@@ -56,11 +168,7 @@ backend_destroy_int (struct backend *backend)
       rtmidi_in_free (backend->outputp);
       backend->outputp = NULL;
     }
-  if (backend->buffer)
-    {
-      g_free (backend->buffer);
-      backend->buffer = NULL;
-    }
+  backend_queue_clear (&backend->queue);
 }
 
 gint
@@ -81,7 +189,7 @@ backend_init_int (struct backend *backend, const gchar *id)
 
   backend->inputp = NULL;
   backend->outputp = NULL;
-  backend->buffer = NULL;
+  backend->queue.data = NULL;
 
   if (!(inputp = rtmidi_in_create_default ()))
     {
@@ -129,12 +237,13 @@ backend_init_int (struct backend *backend, const gchar *id)
 						  PACKAGE_NAME,
 						  BE_INT_BUFF_SIZE);
 	      rtmidi_in_ignore_types (backend->inputp, false, true, true);
+	      backend_queue_init (&backend->queue);
+	      rtmidi_in_set_callback (backend->inputp, backend_rtmidi_callback,
+				      &backend->queue);
 	      rtmidi_open_port (backend->inputp, i, PACKAGE_NAME);
 	      backend->outputp =
 		rtmidi_out_create (ELEKTROID_RTMIDI_API, PACKAGE_NAME);
 	      rtmidi_open_port (backend->outputp, j, PACKAGE_NAME);
-
-	      backend->buffer = g_byte_array_sized_new (BE_INT_BUFF_SIZE);
 	      goto cleanup_output;
 	    }
 	}
@@ -164,12 +273,10 @@ backend_tx_sysex_int (struct backend *backend,
 			   transfer->raw->len);
   transfer->err = backend->outputp->ok ? 0 : -EIO;
 
-  if (!transfer->err && debug_level >= 2)
+  if (!transfer->err)
     {
-      gchar *text = debug_get_hex_data (debug_level, transfer->raw->data,
-					transfer->raw->len);
-      debug_print (2, "Raw message sent (%d): %s", transfer->raw->len, text);
-      g_free (text);
+      debug_print_hex_msg (2, transfer->raw, "Raw message sent (%d): %s",
+			   transfer->raw->len);
     }
 
   sysex_transfer_set_status (transfer, controllable,
@@ -179,7 +286,7 @@ backend_tx_sysex_int (struct backend *backend,
 }
 
 ssize_t
-backend_tx_raw (struct backend *backend, guint8 *data, guint len)
+backend_tx_raw_int (struct backend *backend, guint8 *data, guint len)
 {
   GByteArray *msg;
   struct sysex_transfer transfer;
@@ -197,38 +304,64 @@ backend_tx_raw (struct backend *backend, guint8 *data, guint len)
 void
 backend_rx_drain_int (struct backend *backend)
 {
-  guint8 tmp[RTMIDI_TMP_BUFF_SIZE];
-  while (1)
-    {
-      size_t size = RTMIDI_TMP_BUFF_SIZE;
-      //The size is not important here. As long as there are no more data.
-      rtmidi_in_get_message (backend->inputp, tmp, &size);
-      if (size == 0)
-	{
-	  break;
-	}
-    }
+  //The consumer owns the head so the queued messages can be discarded at once.
+  g_atomic_int_set (&backend->queue.head,
+		    g_atomic_int_get (&backend->queue.tail));
 }
 
-// rtmidi_in_get_message requires enough space in the buffer to store the message.
-// As this is unknown, quite a large buffer needs to be allocated for this.
+//Whole messages are read from the queue as long as they fit in the buffer.
+//If there are no messages, this waits until the callback signals a new one or the polling period expires.
 
 ssize_t
-backend_rx_raw (struct backend *backend, guint8 *buffer, guint s)
+backend_rx_raw_int (struct backend *backend, guint8 *buffer, guint s)
 {
-  size_t size = s;
-  rtmidi_in_get_message (backend->inputp, buffer, &size);
-  if (!backend->inputp->ok)
+  guint head, tail, pos;
+  guint32 len;
+  gint64 time, end_time;
+  ssize_t total = 0;
+  struct backend_rtmidi_queue *queue = &backend->queue;
+
+  head = queue->head;
+  if (head == g_atomic_int_get (&queue->tail))
     {
-      return -EIO;
+      end_time = g_get_monotonic_time () + BE_POLL_TIMEOUT_MS * 1000;
+      g_mutex_lock (&queue->mutex);
+      while (head == g_atomic_int_get (&queue->tail))
+	{
+	  if (!g_cond_wait_until (&queue->cond, &queue->mutex, end_time))
+	    {
+	      break;
+	    }
+	}
+      g_mutex_unlock (&queue->mutex);
     }
 
-  if (!size)
+  tail = g_atomic_int_get (&queue->tail);
+  while (head != tail)
     {
-      usleep (BE_POLL_TIMEOUT_MS * 1000);
+      pos = head;
+      backend_queue_read (queue, &pos, &len, sizeof (guint32));
+      if (total + len > s)
+	{
+	  if (total)
+	    {
+	      break;
+	    }
+	  error_print ("Message too long (%u B). Discarding...", len);
+	  head += QUEUE_MSG_HEADER_LEN + len;
+	  continue;
+	}
+
+      backend_queue_read (queue, &pos, &time, sizeof (gint64));
+      backend_queue_read (queue, &pos, &buffer[total], len);
+      backend_queue_add_latency (queue, time);
+      total += len;
+      head = pos;
     }
 
-  return size;
+  g_atomic_int_set (&queue->head, head);
+
+  return total;
 }
 
 gboolean
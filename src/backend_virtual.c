@@ -0,0 +1,2161 @@
+/*
+ *   backend_virtual.c
+ *   Copyright (C) 2024 David García Goñi <dagargo@gmail.com>
+ *
+ *   This file is part of Elektroid.
+ *
+ *   Elektroid is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Elektroid is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Elektroid. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <zlib.h>
+#include "backend.h"
+#include "backend_virtual.h"
+#include "sysex_codec.h"
+
+#define BE_DEVICE_NAME "virtual:%d"
+#define BE_DEVICE_NAME_PREFIX "virtual:"
+
+#define BE_VIRTUAL_ELEKTRON_HEADER_LEN 6
+#define BE_VIRTUAL_ELEKTRON_MIN_LEN 12
+#define BE_VIRTUAL_ELEKTRON_BLOCK_LEN 0x2000
+#define BE_VIRTUAL_ELEKTRON_DRIVE_SIZE (1024 * MI)
+#define BE_VIRTUAL_ELEKTRON_RAM_SIZE (64 * MI)
+#define BE_VIRTUAL_ELEKTRON_RAW_EXT ".mc-snd"
+#define BE_VIRTUAL_ELEKTRON_VERSION "1.00"
+#define BE_VIRTUAL_ELEKTRON_DATA_BANKS "ABCDEFGH"
+
+#define BE_VIRTUAL_SDS_HEADER_LEN 21
+#define BE_VIRTUAL_SDS_PACKET_LEN 127
+#define BE_VIRTUAL_SDS_PACKET_PAYLOAD_LEN 120
+#define BE_VIRTUAL_SDS_PACKET_CKSUM_POS 125
+#define BE_VIRTUAL_SDS_ACK 0x7f
+#define BE_VIRTUAL_SDS_NAK 0x7e
+#define BE_VIRTUAL_SDS_CANCEL 0x7d
+#define BE_VIRTUAL_SDS_WAIT 0x7c
+
+#define BE_VIRTUAL_MICROFREAK_HEADER_LEN 6
+#define BE_VIRTUAL_MICROFREAK_PRESETS 512
+#define BE_VIRTUAL_MICROFREAK_PRESET_HEADER_LEN 0x23
+#define BE_VIRTUAL_MICROFREAK_PRESET_PARTS 146
+#define BE_VIRTUAL_MICROFREAK_PRESET_PART_LEN 0x20
+#define BE_VIRTUAL_MICROFREAK_PRESET_DATA_LEN (BE_VIRTUAL_MICROFREAK_PRESET_PARTS * BE_VIRTUAL_MICROFREAK_PRESET_PART_LEN)
+#define BE_VIRTUAL_MICROFREAK_PRESET_INIT 0x08
+#define BE_VIRTUAL_MICROFREAK_PRESET_NAME "Init"
+
+void
+sysex_transfer_set_status (struct sysex_transfer *sysex_transfer,
+			   struct controllable *controllable,
+			   enum sysex_transfer_status status);
+
+struct backend_virtual_device;
+
+typedef void (*backend_virtual_handler) (struct backend_virtual_device *,
+					 GByteArray *);
+
+typedef void (*backend_virtual_data_func) (struct backend_virtual_device *);
+
+//The identity is the company, family, model and version as in the MIDI identity reply.
+struct backend_virtual_model
+{
+  const gchar *name;
+  const guint8 *identity;
+  guint identity_len;
+  guint8 elektron_id;
+  backend_virtual_handler handler;
+  backend_virtual_data_func init;
+  backend_virtual_data_func free;
+};
+
+//Message sent by the device. It can be read by the host after time.
+struct backend_virtual_msg
+{
+  GByteArray *data;
+  guint pos;
+  gint64 time;
+};
+
+//As there are no actual ports, the device is both the input and the output of the backend.
+struct backend_virtual_device
+{
+  const struct backend_virtual_model *model;
+  struct backend_virtual_link link;
+  GMutex mutex;
+  GByteArray *input;		//Incomplete message sent by the host.
+  GQueue *output;
+  gint64 tx_busy;		//The link from the host to the device is busy until this time.
+  gint64 rx_busy;		//The link from the device to the host is busy until this time.
+  gint64 time;			//Arrival time of the message being handled.
+  guint dropped;
+  guint corrupted;
+  void *data;
+};
+
+struct backend_virtual_item
+{
+  gboolean dir;
+  GByteArray *content;
+};
+
+struct backend_virtual_job
+{
+  guint fs;
+  gchar *path;
+  GByteArray *content;
+};
+
+enum backend_virtual_elektron_fs
+{
+  BE_VIRTUAL_ELEKTRON_FS_SAMPLE,
+  BE_VIRTUAL_ELEKTRON_FS_RAW,
+  BE_VIRTUAL_ELEKTRON_FS_DATA,
+  BE_VIRTUAL_ELEKTRON_FS_MAX
+};
+
+struct backend_virtual_elektron
+{
+  guint16 seq;
+  GHashTable *items[BE_VIRTUAL_ELEKTRON_FS_MAX];	//Path to struct backend_virtual_item.
+  GHashTable *jobs;		//Id to struct backend_virtual_job.
+  guint32 next_id;
+};
+
+struct backend_virtual_sds_sample
+{
+  guint8 header[BE_VIRTUAL_SDS_HEADER_LEN];
+  GByteArray *payload;		//Data packets payloads as sent by the host.
+  gchar *name;
+};
+
+enum backend_virtual_sds_status
+{
+  BE_VIRTUAL_SDS_STATUS_IDLE,
+  BE_VIRTUAL_SDS_STATUS_UPLOADING,
+  BE_VIRTUAL_SDS_STATUS_DOWNLOADING
+};
+
+struct backend_virtual_sds
+{
+  GHashTable *samples;		//Id to struct backend_virtual_sds_sample.
+  enum backend_virtual_sds_status status;
+  struct backend_virtual_sds_sample *sample;
+  guint id;
+  guint packet;			//Next packet to receive or to send.
+  guint packets;
+  gboolean started;
+};
+
+struct backend_virtual_microfreak_preset
+{
+  guint8 header[BE_VIRTUAL_MICROFREAK_PRESET_HEADER_LEN];
+  guint8 data[BE_VIRTUAL_MICROFREAK_PRESET_DATA_LEN];
+};
+
+struct backend_virtual_microfreak
+{
+  struct backend_virtual_microfreak_preset
+    presets[BE_VIRTUAL_MICROFREAK_PRESETS];
+  guint id;
+  guint part;
+};
+
+static const guint8 BE_VIRTUAL_IDENTITY_REQUEST[] =
+  { 0xf0, 0x7e, 0x7f, 0x06, 0x01, 0xf7 };
+
+static const guint8 BE_VIRTUAL_ELEKTRON_HEADER[] =
+  { 0xf0, 0x00, 0x20, 0x3c, 0x10, 0x00 };
+
+static const guint8 BE_VIRTUAL_MICROFREAK_HEADER[] =
+  { 0xf0, 0x00, 0x20, 0x6b, 0x07, 0x01 };
+
+static const guint8 DIGITAKT_IDENTITY[] =
+  { 0x00, 0x20, 0x3c, 0x0c, 0x00, 0x00, 0x00, 1, 0, 0, 0 };
+
+static const guint8 MODEL_CYCLES_IDENTITY[] =
+  { 0x00, 0x20, 0x3c, 0x1b, 0x00, 0x00, 0x00, 1, 0, 0, 0 };
+
+//Non commercial company id.
+static const guint8 SDS_IDENTITY[] = { 0x7d, 0x00, 0x00, 0x00, 0x00, 1, 0,
+  0, 0
+};
+
+static const guint8 MICROFREAK_IDENTITY[] =
+  { 0x00, 0x20, 0x6b, 0x06, 0x00, 0x06, 0x01, 5, 0, 0, 0 };
+
+static struct backend_virtual_link backend_virtual_link;
+static gboolean backend_virtual_link_set = FALSE;
+
+static void backend_virtual_elektron_handler (struct backend_virtual_device
+					      *, GByteArray *);
+static void backend_virtual_elektron_init (struct backend_virtual_device *);
+static void backend_virtual_elektron_free (struct backend_virtual_device *);
+static void backend_virtual_sds_handler (struct backend_virtual_device *,
+					 GByteArray *);
+static void backend_virtual_sds_init (struct backend_virtual_device *);
+static void backend_virtual_sds_free (struct backend_virtual_device *);
+static void backend_virtual_microfreak_handler (struct backend_virtual_device
+						*, GByteArray *);
+static void backend_virtual_microfreak_init (struct backend_virtual_device *);
+static void backend_virtual_microfreak_free (struct backend_virtual_device *);
+
+static const struct backend_virtual_model BE_VIRTUAL_MODELS[] = {
+  {
+   .name = "Elektron Digitakt",
+   .identity = DIGITAKT_IDENTITY,
+   .identity_len = sizeof (DIGITAKT_IDENTITY),
+   .elektron_id = 12,
+   .handler = backend_virtual_elektron_handler,
+   .init = backend_virtual_elektron_init,
+   .free = backend_virtual_elektron_free},
+  {
+   .name = "Elektron Model:Cycles",
+   .identity = MODEL_CYCLES_IDENTITY,
+   .identity_len = sizeof (MODEL_CYCLES_IDENTITY),
+   .elektron_id = 27,
+   .handler = backend_virtual_elektron_handler,
+   .init = backend_virtual_elektron_init,
+   .free = backend_virtual_elektron_free},
+  {
+   .name = "SDS sampler",
+   .identity = SDS_IDENTITY,
+   .identity_len = sizeof (SDS_IDENTITY),
+   .handler = backend_virtual_sds_handler,
+   .init = backend_virtual_sds_init,
+   .free = backend_virtual_sds_free},
+  {
+   .name = "Arturia MicroFreak",
+   .identity = MICROFREAK_IDENTITY,
+   .identity_len = sizeof (MICROFREAK_IDENTITY),
+   .handler = backend_virtual_microfreak_handler,
+   .init = backend_virtual_microfreak_init,
+   .free = backend_virtual_microfreak_free}
+};
+
+#define BE_VIRTUAL_MODELS_LEN (sizeof (BE_VIRTUAL_MODELS) / sizeof (struct backend_virtual_model))
+
+void
+backend_virtual_set_link (const struct backend_virtual_link *link)
+{
+  backend_virtual_link = *link;
+  backend_virtual_link_set = TRUE;
+}
+
+gint
+backend_virtual_parse_link (struct backend_virtual_link *link, const gchar *s)
+{
+  gint err = 0;
+  gchar **tokens, **token;
+
+  memset (link, 0, sizeof (struct backend_virtual_link));
+
+  tokens = g_strsplit (s, ",", -1);
+  for (token = tokens; *token && !err; token++)
+    {
+      guint *v;
+      gchar *rem;
+      gchar **pair = g_strsplit (*token, "=", 2);
+
+      if (!pair[0] || !pair[1])
+	{
+	  err = -EINVAL;
+	  goto next;
+	}
+
+      if (!strcmp (pair[0], "bandwidth"))
+	{
+	  v = &link->bandwidth;
+	}
+      else if (!strcmp (pair[0], "latency"))
+	{
+	  v = &link->latency;
+	}
+      else if (!strcmp (pair[0], "drop"))
+	{
+	  v = &link->drop_period;
+	}
+      else if (!strcmp (pair[0], "corrupt"))
+	{
+	  v = &link->corrupt_period;
+	}
+      else
+	{
+	  err = -EINVAL;
+	  goto next;
+	}
+
+      errno = 0;
+      *v = (guint) g_ascii_strtoull (pair[1], &rem, 10);
+      if (errno || rem == pair[1] || *rem)
+	{
+	  err = -EINVAL;
+	}
+
+    next:
+      if (err)
+	{
+	  error_print ("Illegal link parameter '%s'", *token);
+	}
+      g_strfreev (pair);
+    }
+  g_strfreev (tokens);
+
+  return err;
+}
+
+static inline guint32
+backend_virtual_get_u32 (const guint8 *data)
+{
+  guint32 v;
+  memcpy (&v, data, sizeof (guint32));
+  return g_ntohl (v);
+}
+
+static inline void
+backend_virtual_append_u8 (GByteArray *msg, guint8 v)
+{
+  g_byte_array_append (msg, &v, sizeof (guint8));
+}
+
+static inline void
+backend_virtual_append_u16 (GByteArray *msg, guint16 v)
+{
+  v = g_htons (v);
+  g_byte_array_append (msg, (guint8 *) & v, sizeof (guint16));
+}
+
+static inline void
+backend_virtual_append_u32 (GByteArray *msg, guint32 v)
+{
+  v = g_htonl (v);
+  g_byte_array_append (msg, (guint8 *) & v, sizeof (guint32));
+}
+
+static inline void
+backend_virtual_append_u64 (GByteArray *msg, guint64 v)
+{
+  v = GUINT64_TO_BE (v);
+  g_byte_array_append (msg, (guint8 *) & v, sizeof (guint64));
+}
+
+static inline void
+backend_virtual_append_string (GByteArray *msg, const gchar *s)
+{
+  g_byte_array_append (msg, (guint8 *) s, strlen (s) + 1);
+}
+
+static gint64
+backend_virtual_get_tx_time (struct backend_virtual_device *device,
+			     guint len)
+{
+  if (!device->link.bandwidth)
+    {
+      return 0;
+    }
+  return (gint64) len *G_USEC_PER_SEC / device->link.bandwidth;
+}
+
+//Every n-th long enough message gets its last data byte altered, which is usually a checksum or sample data.
+
+static void
+backend_virtual_corrupt (struct backend_virtual_device *device,
+			 GByteArray *msg, const gchar *direction)
+{
+  if (!device->link.corrupt_period || msg->len < BE_VIRTUAL_CORRUPT_MIN_LEN)
+    {
+      return;
+    }
+
+  device->corrupted++;
+  if (device->corrupted % device->link.corrupt_period)
+    {
+      return;
+    }
+
+  debug_print (1, "Corrupting message %s (%d B)...", direction, msg->len);
+  msg->data[msg->len - 2] ^= 1;
+}
+
+//Must be called with the mutex locked.
+
+static void
+backend_virtual_send (struct backend_virtual_device *device, GByteArray *data)
+{
+  gint64 start;
+  struct backend_virtual_msg *msg;
+
+  if (device->link.drop_period)
+    {
+      device->dropped++;
+      if (device->dropped % device->link.drop_period == 0)
+	{
+	  debug_print (1, "Dropping message from device (%d B)...",
+		       data->len);
+	  free_msg (data);
+	  return;
+	}
+    }
+
+  backend_virtual_corrupt (device, data, "from device");
+
+  //Messages are serialized in the link and are received after the latency.
+  start = MAX (device->time, device->rx_busy);
+  device->rx_busy = start + backend_virtual_get_tx_time (device, data->len);
+
+  msg = g_malloc (sizeof (struct backend_virtual_msg));
+  msg->data = data;
+  msg->pos = 0;
+  msg->time = device->rx_busy + device->link.latency;
+  g_queue_push_tail (device->output, msg);
+}
+
+static void
+backend_virtual_free_msg (gpointer data)
+{
+  struct backend_virtual_msg *msg = data;
+  free_msg (msg->data);
+  g_free (msg);
+}
+
+static void
+backend_virtual_send_identity (struct backend_virtual_device *device)
+{
+  GByteArray *msg = g_byte_array_new ();
+  g_byte_array_append (msg, (guint8 *) "\xf0\x7e\x00\x06\x02", 5);
+  g_byte_array_append (msg, device->model->identity,
+		       device->model->identity_len);
+  backend_virtual_append_u8 (msg, 0xf7);
+  backend_virtual_send (device, msg);
+}
+
+static void
+backend_virtual_handle (struct backend_virtual_device *device,
+			GByteArray *msg)
+{
+  debug_print_hex_msg (3, msg, "Virtual device message received (%d): %s",
+		       msg->len);
+
+  backend_virtual_corrupt (device, msg, "from host");
+
+  if (msg->len == sizeof (BE_VIRTUAL_IDENTITY_REQUEST) &&
+      msg->data[1] == BE_VIRTUAL_IDENTITY_REQUEST[1] &&
+      !memcmp (&msg->data[3], &BE_VIRTUAL_IDENTITY_REQUEST[3], 3))
+    {
+      backend_virtual_send_identity (device);
+      return;
+    }
+
+  device->model->handler (device, msg);
+}
+
+static struct backend_virtual_item *
+backend_virtual_item_new (gboolean dir, GByteArray *content)
+{
+  struct backend_virtual_item *item =
+    g_malloc (sizeof (struct backend_virtual_item));
+  item->dir = dir;
+  item->content = content;
+  return item;
+}
+
+static void
+backend_virtual_item_free (gpointer data)
+{
+  struct backend_virtual_item *item = data;
+  if (item->content)
+    {
+      g_byte_array_free (item->content, TRUE);
+    }
+  g_free (item);
+}
+
+static void
+backend_virtual_job_free (gpointer data)
+{
+  struct backend_virtual_job *job = data;
+  g_free (job->path);
+  if (job->content)
+    {
+      g_byte_array_free (job->content, TRUE);
+    }
+  g_free (job);
+}
+
+static inline guint32
+backend_virtual_get_hash (GByteArray *content)
+{
+  return content ? crc32 (0, content->data, content->len) : 0;
+}
+
+static gboolean
+backend_virtual_is_dir (GHashTable *items, const gchar *path)
+{
+  struct backend_virtual_item *item = g_hash_table_lookup (items, path);
+  return item && item->dir;
+}
+
+static gboolean
+backend_virtual_is_parent_dir (GHashTable *items, const gchar *path)
+{
+  gchar *dir = g_path_get_dirname (path);
+  gboolean res = backend_virtual_is_dir (items, dir);
+  g_free (dir);
+  return res;
+}
+
+//Names only made of digits, which are slots, are sorted numerically.
+
+static gint
+backend_virtual_compare_names (gconstpointer a, gconstpointer b)
+{
+  gchar *rema, *remb;
+  const gchar *na = strrchr (a, '/') + 1;
+  const gchar *nb = strrchr (b, '/') + 1;
+  guint64 ia = g_ascii_strtoull (na, &rema, 10);
+  guint64 ib = g_ascii_strtoull (nb, &remb, 10);
+
+  if (*na && *nb && !*rema && !*remb)
+    {
+      return ia < ib ? -1 : ia > ib;
+    }
+  return strcmp (na, nb);
+}
+
+static GList *
+backend_virtual_get_children (GHashTable *items, const gchar *dir)
+{
+  GHashTableIter iter;
+  gpointer key;
+  GList *children = NULL;
+
+  g_hash_table_iter_init (&iter, items);
+  while (g_hash_table_iter_next (&iter, &key, NULL))
+    {
+      gchar *parent = g_path_get_dirname (key);
+      if (strcmp (key, "/") && !strcmp (parent, dir))
+	{
+	  children = g_list_prepend (children, key);
+	}
+      g_free (parent);
+    }
+
+  return g_list_sort (children, backend_virtual_compare_names);
+}
+
+static GByteArray *
+backend_virtual_elektron_decode (const guint8 *src, guint len)
+{
+  GByteArray *dst = g_byte_array_sized_new (sysex_codec_get_decoded_len (len));
+
+  dst->len = sysex_codec_decode (src, len, dst->data, SYSEX_CODEC_MSB_FIRST);
+
+  return dst;
+}
+
+static GByteArray *
+backend_virtual_elektron_encode (const GByteArray *msg)
+{
+  guint len = sysex_codec_get_encoded_len (msg->len);
+  GByteArray *raw = g_byte_array_sized_new (sizeof
+					    (BE_VIRTUAL_ELEKTRON_HEADER) +
+					    len + 1);
+
+  g_byte_array_append (raw, BE_VIRTUAL_ELEKTRON_HEADER,
+		       sizeof (BE_VIRTUAL_ELEKTRON_HEADER));
+  g_byte_array_set_size (raw, raw->len + len);
+  sysex_codec_encode (msg->data, msg->len,
+		      &raw->data[sizeof (BE_VIRTUAL_ELEKTRON_HEADER)],
+		      SYSEX_CODEC_MSB_FIRST);
+  backend_virtual_append_u8 (raw, 0xf7);
+
+  return raw;
+}
+
+static GByteArray *
+backend_virtual_elektron_new_reply (GByteArray *req)
+{
+  GByteArray *reply = g_byte_array_sized_new (BE_VIRTUAL_ELEKTRON_BLOCK_LEN +
+					      64);
+  g_byte_array_append (reply, (guint8 *) "\0\0", 2);
+  g_byte_array_append (reply, req->data, 2);
+  backend_virtual_append_u8 (reply, req->data[4] | 0x80);
+  return reply;
+}
+
+static void
+backend_virtual_elektron_send (struct backend_virtual_device *device,
+			       GByteArray *reply)
+{
+  guint16 seq;
+  struct backend_virtual_elektron *elektron = device->data;
+
+  seq = g_htons (elektron->seq);
+  memcpy (reply->data, &seq, sizeof (guint16));
+  elektron->seq++;
+
+  debug_print_hex_msg (3, reply, "Virtual device message sent (%d): %s",
+		       reply->len);
+
+  backend_virtual_send (device, backend_virtual_elektron_encode (reply));
+  free_msg (reply);
+}
+
+static void
+backend_virtual_elektron_send_status (struct backend_virtual_device *device,
+				      GByteArray *req, guint8 status,
+				      const gchar *str)
+{
+  GByteArray *reply = backend_virtual_elektron_new_reply (req);
+  backend_virtual_append_u8 (reply, status);
+  backend_virtual_append_string (reply, str);
+  backend_virtual_elektron_send (device, reply);
+}
+
+static inline void
+backend_virtual_elektron_send_ok (struct backend_virtual_device *device,
+				  GByteArray *req)
+{
+  backend_virtual_elektron_send_status (device, req, 1, "");
+}
+
+static void
+backend_virtual_elektron_init (struct backend_virtual_device *device)
+{
+  gchar path[LABEL_MAX];
+  struct backend_virtual_elektron *elektron =
+    g_malloc (sizeof (struct backend_virtual_elektron));
+
+  elektron->seq = 0;
+  elektron->next_id = 1;
+  elektron->jobs = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+					  NULL, backend_virtual_job_free);
+  for (guint i = 0; i < BE_VIRTUAL_ELEKTRON_FS_MAX; i++)
+    {
+      elektron->items[i] = g_hash_table_new_full (g_str_hash, g_str_equal,
+						  g_free,
+						  backend_virtual_item_free);
+      g_hash_table_insert (elektron->items[i], g_strdup ("/"),
+			   backend_virtual_item_new (TRUE, NULL));
+    }
+
+  //Slots can only be written inside these directories.
+  g_hash_table_insert (elektron->items[BE_VIRTUAL_ELEKTRON_FS_DATA],
+		       g_strdup ("/projects"),
+		       backend_virtual_item_new (TRUE, NULL));
+  g_hash_table_insert (elektron->items[BE_VIRTUAL_ELEKTRON_FS_DATA],
+		       g_strdup ("/presets"),
+		       backend_virtual_item_new (TRUE, NULL));
+  g_hash_table_insert (elektron->items[BE_VIRTUAL_ELEKTRON_FS_DATA],
+		       g_strdup ("/samples"),
+		       backend_virtual_item_new (TRUE, NULL));
+  g_hash_table_insert (elektron->items[BE_VIRTUAL_ELEKTRON_FS_DATA],
+		       g_strdup ("/soundbanks"),
+		       backend_virtual_item_new (TRUE, NULL));
+  for (const gchar * b = BE_VIRTUAL_ELEKTRON_DATA_BANKS; *b; b++)
+    {
+      snprintf (path, LABEL_MAX, "/soundbanks/%c", *b);
+      g_hash_table_insert (elektron->items[BE_VIRTUAL_ELEKTRON_FS_DATA],
+			   g_strdup (path),
+			   backend_virtual_item_new (TRUE, NULL));
+    }
+
+  device->data = elektron;
+}
+
+static void
+backend_virtual_elektron_free (struct backend_virtual_device *device)
+{
+  struct backend_virtual_elektron *elektron = device->data;
+
+  for (guint i = 0; i < BE_VIRTUAL_ELEKTRON_FS_MAX; i++)
+    {
+      g_hash_table_destroy (elektron->items[i]);
+    }
+  g_hash_table_destroy (elektron->jobs);
+  g_free (elektron);
+}
+
+static guint64
+backend_virtual_elektron_get_used (GHashTable *items)
+{
+  GHashTableIter iter;
+  gpointer value;
+  guint64 used = 0;
+
+  g_hash_table_iter_init (&iter, items);
+  while (g_hash_table_iter_next (&iter, NULL, &value))
+    {
+      struct backend_virtual_item *item = value;
+      used += item->content ? item->content->len : 0;
+    }
+
+  return used;
+}
+
+static void
+backend_virtual_elektron_storage (struct backend_virtual_device *device,
+				  GByteArray *req)
+{
+  guint64 size, used;
+  GByteArray *reply;
+  struct backend_virtual_elektron *elektron = device->data;
+
+  if (req->data[5] == 1)
+    {
+      size = BE_VIRTUAL_ELEKTRON_DRIVE_SIZE;
+      used = backend_virtual_elektron_get_used (elektron->items
+						[BE_VIRTUAL_ELEKTRON_FS_SAMPLE])
+	+ backend_virtual_elektron_get_used (elektron->items
+					     [BE_VIRTUAL_ELEKTRON_FS_RAW]);
+    }
+  else
+    {
+      size = BE_VIRTUAL_ELEKTRON_RAM_SIZE;
+      used = 0;
+    }
+
+  reply = backend_virtual_elektron_new_reply (req);
+  backend_virtual_append_u8 (reply, 1);
+  backend_virtual_append_u64 (reply, size > used ? size - used : 0);
+  backend_virtual_append_u64 (reply, size);
+  backend_virtual_elektron_send (device, reply);
+}
+
+static void
+backend_virtual_elektron_read_dir (struct backend_virtual_device *device,
+				   GByteArray *req, guint fs)
+{
+  GList *children, *l;
+  GByteArray *reply;
+  const gchar *path = (gchar *) & req->data[5];
+  struct backend_virtual_elektron *elektron = device->data;
+  GHashTable *items = elektron->items[fs];
+
+  //There is no status and an empty response means that the path is not a directory.
+  reply = backend_virtual_elektron_new_reply (req);
+  if (backend_virtual_is_dir (items, path))
+    {
+      children = backend_virtual_get_children (items, path);
+      for (l = children; l; l = l->next)
+	{
+	  struct backend_virtual_item *item =
+	    g_hash_table_lookup (items, l->data);
+	  backend_virtual_append_u32 (reply,
+				      backend_virtual_get_hash
+				      (item->content));
+	  backend_virtual_append_u32 (reply,
+				      item->content ? item->content->len : 0);
+	  backend_virtual_append_u8 (reply, 0);
+	  backend_virtual_append_u8 (reply, item->dir ? 'D' : 'F');
+	  backend_virtual_append_string (reply, strrchr (l->data, '/') + 1);
+	}
+      g_list_free (children);
+    }
+  backend_virtual_elektron_send (device, reply);
+}
+
+static void
+backend_virtual_elektron_create_dir (struct backend_virtual_device *device,
+				     GByteArray *req, guint fs)
+{
+  const gchar *path = (gchar *) & req->data[5];
+  struct backend_virtual_elektron *elektron = device->data;
+  GHashTable *items = elektron->items[fs];
+
+  if (g_hash_table_contains (items, path) ||
+      !backend_virtual_is_parent_dir (items, path))
+    {
+      backend_virtual_elektron_send_status (device, req, 0,
+					    "Illegal path");
+      return;
+    }
+
+  g_hash_table_insert (items, g_strdup (path),
+		       backend_virtual_item_new (TRUE, NULL));
+  backend_virtual_elektron_send_ok (device, req);
+}
+
+static void
+backend_virtual_elektron_delete (struct backend_virtual_device *device,
+				 GByteArray *req, guint fs, gboolean dir)
+{
+  GList *children;
+  struct backend_virtual_item *item;
+  const gchar *path = (gchar *) & req->data[5];
+  struct backend_virtual_elektron *elektron = device->data;
+  GHashTable *items = elektron->items[fs];
+
+  item = g_hash_table_lookup (items, path);
+  if (!item || item->dir != dir || !strcmp (path, "/"))
+    {
+      backend_virtual_elektron_send_status (device, req, 0, "Not found");
+      return;
+    }
+
+  if (dir)
+    {
+      children = backend_virtual_get_children (items, path);
+      g_list_free (children);
+      if (children)
+	{
+	  backend_virtual_elektron_send_status (device, req, 0, "Not empty");
+	  return;
+	}
+    }
+
+  g_hash_table_remove (items, path);
+  backend_virtual_elektron_send_ok (device, req);
+}
+
+static void
+backend_virtual_elektron_rename (struct backend_virtual_device *device,
+				 GByteArray *req, guint fs)
+{
+  gpointer key, value;
+  const gchar *src = (gchar *) & req->data[5];
+  const gchar *dst = src + strlen (src) + 1;
+  struct backend_virtual_elektron *elektron = device->data;
+  GHashTable *items = elektron->items[fs];
+
+  if (!g_hash_table_lookup_extended (items, src, &key, &value) ||
+      ((struct backend_virtual_item *) value)->dir ||
+      g_hash_table_contains (items, dst) ||
+      !backend_virtual_is_parent_dir (items, dst))
+    {
+      backend_virtual_elektron_send_status (device, req, 0,
+					    "Illegal path");
+      return;
+    }
+
+  g_hash_table_steal (items, src);
+  g_free (key);
+  g_hash_table_insert (items, g_strdup (dst), value);
+  backend_virtual_elektron_send_ok (device, req);
+}
+
+static void
+backend_virtual_elektron_info (struct backend_virtual_device *device,
+			       GByteArray *req, guint fs)
+{
+  GByteArray *reply;
+  struct backend_virtual_item *item;
+  const gchar *path = (gchar *) & req->data[5];
+  struct backend_virtual_elektron *elektron = device->data;
+
+  item = g_hash_table_lookup (elektron->items[fs], path);
+  if (!item || item->dir)
+    {
+      backend_virtual_elektron_send_status (device, req, 0, "Not found");
+      return;
+    }
+
+  reply = backend_virtual_elektron_new_reply (req);
+  backend_virtual_append_u8 (reply, 1);
+  backend_virtual_append_u32 (reply,
+			      backend_virtual_get_hash (item->content));
+  backend_virtual_append_u32 (reply, item->content->len);
+  backend_virtual_elektron_send (device, reply);
+}
+
+static void
+backend_virtual_elektron_info_by_hash (struct backend_virtual_device *device,
+				       GByteArray *req)
+{
+  GHashTableIter iter;
+  gpointer key, value;
+  GByteArray *reply;
+  guint32 hash = backend_virtual_get_u32 (&req->data[5]);
+  guint32 size = backend_virtual_get_u32 (&req->data[9]);
+  struct backend_virtual_elektron *elektron = device->data;
+
+  g_hash_table_iter_init (&iter, elektron->items
+			  [BE_VIRTUAL_ELEKTRON_FS_SAMPLE]);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+      struct backend_virtual_item *item = value;
+      if (!item->dir && item->content->len == size &&
+	  backend_virtual_get_hash (item->content) == hash)
+	{
+	  reply = backend_virtual_elektron_new_reply (req);
+	  backend_virtual_append_u8 (reply, 1);
+	  backend_virtual_append_u32 (reply, hash);
+	  backend_virtual_append_u32 (reply, size);
+	  backend_virtual_append_string (reply, key);
+	  backend_virtual_elektron_send (device, reply);
+	  return;
+	}
+    }
+
+  backend_virtual_elektron_send_status (device, req, 0, "Not found");
+}
+
+static guint32
+backend_virtual_elektron_add_job (struct backend_virtual_device *device,
+				  guint fs, const gchar *path,
+				  GByteArray *content)
+{
+  struct backend_virtual_elektron *elektron = device->data;
+  struct backend_virtual_job *job =
+    g_malloc (sizeof (struct backend_virtual_job));
+  guint32 id = elektron->next_id++;
+
+  job->fs = fs;
+  job->path = g_strdup (path);
+  job->content = content;
+  g_hash_table_insert (elektron->jobs, GUINT_TO_POINTER (id), job);
+
+  return id;
+}
+
+static struct backend_virtual_job *
+backend_virtual_elektron_get_job (struct backend_virtual_device *device,
+				  GByteArray *req, guint pos)
+{
+  struct backend_virtual_elektron *elektron = device->data;
+  guint32 id = backend_virtual_get_u32 (&req->data[pos]);
+  return g_hash_table_lookup (elektron->jobs, GUINT_TO_POINTER (id));
+}
+
+static void
+backend_virtual_elektron_remove_job (struct backend_virtual_device *device,
+				     GByteArray *req, guint pos)
+{
+  struct backend_virtual_elektron *elektron = device->data;
+  guint32 id = backend_virtual_get_u32 (&req->data[pos]);
+  g_hash_table_remove (elektron->jobs, GUINT_TO_POINTER (id));
+}
+
+static void
+backend_virtual_elektron_open_reader (struct backend_virtual_device *device,
+				      GByteArray *req, guint fs)
+{
+  guint32 id;
+  GByteArray *reply, *content;
+  struct backend_virtual_item *item;
+  const gchar *path = (gchar *) & req->data[5];
+  struct backend_virtual_elektron *elektron = device->data;
+
+  item = g_hash_table_lookup (elektron->items[fs], path);
+  if (!item || item->dir)
+    {
+      backend_virtual_elektron_send_status (device, req, 0, "Not found");
+      return;
+    }
+
+  content = g_byte_array_sized_new (item->content->len);
+  g_byte_array_append (content, item->content->data, item->content->len);
+  id = backend_virtual_elektron_add_job (device, fs, path, content);
+
+  reply = backend_virtual_elektron_new_reply (req);
+  backend_virtual_append_u8 (reply, 1);
+  backend_virtual_append_u32 (reply, id);
+  backend_virtual_append_u32 (reply, content->len);
+  backend_virtual_elektron_send (device, reply);
+}
+
+static void
+backend_virtual_elektron_read (struct backend_virtual_device *device,
+			       GByteArray *req)
+{
+  GByteArray *reply;
+  struct backend_virtual_job *job;
+  guint32 size = backend_virtual_get_u32 (&req->data[9]);
+  guint32 start = backend_virtual_get_u32 (&req->data[13]);
+
+  job = backend_virtual_elektron_get_job (device, req, 5);
+  if (!job || start + size > job->content->len)
+    {
+      backend_virtual_elektron_send_status (device, req, 0, "Illegal read");
+      return;
+    }
+
+  reply = backend_virtual_elektron_new_reply (req);
+  backend_virtual_append_u8 (reply, 1);
+  g_byte_array_append (reply, &req->data[5], sizeof (guint32));
+  backend_virtual_append_u32 (reply, size);
+  backend_virtual_append_u32 (reply, start);
+  backend_virtual_append_u32 (reply, 0);
+  g_byte_array_append (reply, &job->content->data[start], size);
+  backend_virtual_elektron_send (device, reply);
+}
+
+static void
+backend_virtual_elektron_close_reader (struct backend_virtual_device *device,
+				       GByteArray *req)
+{
+  GByteArray *reply;
+  struct backend_virtual_job *job;
+
+  job = backend_virtual_elektron_get_job (device, req, 5);
+  if (!job)
+    {
+      backend_virtual_elektron_send_status (device, req, 0, "Illegal job");
+      return;
+    }
+
+  reply = backend_virtual_elektron_new_reply (req);
+  backend_virtual_append_u8 (reply, 1);
+  g_byte_array_append (reply, &req->data[5], sizeof (guint32));
+  backend_virtual_append_u32 (reply, job->content->len);
+  backend_virtual_elektron_remove_job (device, req, 5);
+  backend_virtual_elektron_send (device, reply);
+}
+
+static void
+backend_virtual_elektron_open_writer (struct backend_virtual_device *device,
+				      GByteArray *req, guint fs)
+{
+  guint32 id;
+  GByteArray *reply;
+  guint32 size = backend_virtual_get_u32 (&req->data[5]);
+  const gchar *path = (gchar *) & req->data[9];
+  struct backend_virtual_elektron *elektron = device->data;
+
+  if (backend_virtual_is_dir (elektron->items[fs], path) ||
+      !backend_virtual_is_parent_dir (elektron->items[fs], path))
+    {
+      backend_virtual_elektron_send_status (device, req, 0,
+					    "Illegal path");
+      return;
+    }
+
+  id = backend_virtual_elektron_add_job (device, fs, path,
+					 g_byte_array_sized_new (size));
+
+  reply = backend_virtual_elektron_new_reply (req);
+  backend_virtual_append_u8 (reply, 1);
+  backend_virtual_append_u32 (reply, id);
+  backend_virtual_append_u32 (reply, size);
+  backend_virtual_elektron_send (device, reply);
+}
+
+static void
+backend_virtual_elektron_write (struct backend_virtual_device *device,
+				GByteArray *req)
+{
+  struct backend_virtual_job *job;
+  guint32 size = backend_virtual_get_u32 (&req->data[9]);
+  guint32 offset = backend_virtual_get_u32 (&req->data[13]);
+
+  job = backend_virtual_elektron_get_job (device, req, 5);
+  if (!job || req->len < 17 + size)
+    {
+      backend_virtual_elektron_send_status (device, req, 0,
+					    "Illegal write");
+      return;
+    }
+
+  //Blocks are addressed by their offset so repeated blocks are harmless.
+  if (job->content->len < offset + size)
+    {
+      g_byte_array_set_size (job->content, offset + size);
+    }
+  memcpy (&job->content->data[offset], &req->data[17], size);
+
+  backend_virtual_elektron_send_ok (device, req);
+}
+
+static void
+backend_virtual_elektron_close_writer (struct backend_virtual_device *device,
+				       GByteArray *req)
+{
+  gchar *path;
+  GByteArray *reply;
+  struct backend_virtual_job *job;
+  struct backend_virtual_elektron *elektron = device->data;
+  guint32 size = backend_virtual_get_u32 (&req->data[9]);
+
+  job = backend_virtual_elektron_get_job (device, req, 5);
+  if (!job || job->content->len != size)
+    {
+      backend_virtual_elektron_send_status (device, req, 0,
+					    "Illegal close");
+      return;
+    }
+
+  //The raw filesystem adds the extension to the uploaded files.
+  if (job->fs == BE_VIRTUAL_ELEKTRON_FS_RAW &&
+      !g_str_has_suffix (job->path, BE_VIRTUAL_ELEKTRON_RAW_EXT))
+    {
+      path = g_strconcat (job->path, BE_VIRTUAL_ELEKTRON_RAW_EXT, NULL);
+    }
+  else
+    {
+      path = g_strdup (job->path);
+    }
+
+  g_hash_table_insert (elektron->items[job->fs], path,
+		       backend_virtual_item_new (FALSE, job->content));
+  job->content = NULL;
+
+  reply = backend_virtual_elektron_new_reply (req);
+  backend_virtual_append_u8 (reply, 1);
+  g_byte_array_append (reply, &req->data[5], sizeof (guint32));
+  backend_virtual_append_u32 (reply, size);
+  backend_virtual_elektron_remove_job (device, req, 5);
+  backend_virtual_elektron_send (device, reply);
+}
+
+static void
+backend_virtual_elektron_data_list (struct backend_virtual_device *device,
+				    GByteArray *req)
+{
+  GList *children, *l;
+  GByteArray *reply;
+  const gchar *path = (gchar *) & req->data[5];
+  const guint8 *next = &req->data[5 + strlen (path) + 1];
+  struct backend_virtual_elektron *elektron = device->data;
+  GHashTable *items = elektron->items[BE_VIRTUAL_ELEKTRON_FS_DATA];
+
+  if (!backend_virtual_is_dir (items, path))
+    {
+      backend_virtual_elektron_send_status (device, req, 0, "Not found");
+      return;
+    }
+
+  children = backend_virtual_get_children (items, path);
+
+  reply = backend_virtual_elektron_new_reply (req);
+  backend_virtual_append_u8 (reply, 1);
+  g_byte_array_append (reply, next, 2 * sizeof (guint32));
+  backend_virtual_append_u32 (reply, g_list_length (children));
+  for (l = children; l; l = l->next)
+    {
+      struct backend_virtual_item *item = g_hash_table_lookup (items,
+							       l->data);
+      const gchar *name = strrchr (l->data, '/') + 1;
+
+      backend_virtual_append_string (reply, name);
+      backend_virtual_append_u8 (reply, 0);
+      if (item->dir)
+	{
+	  GList *grandchildren = backend_virtual_get_children (items,
+							       l->data);
+	  backend_virtual_append_u8 (reply, 1);
+	  backend_virtual_append_u32 (reply, g_list_length (grandchildren));
+	  g_list_free (grandchildren);
+	}
+      else
+	{
+	  backend_virtual_append_u8 (reply, 2);
+	  backend_virtual_append_u32 (reply, atoi (name));
+	  backend_virtual_append_u32 (reply, item->content->len);
+	  backend_virtual_append_u16 (reply, 0xffff);
+	  backend_virtual_append_u8 (reply, 1);
+	  backend_virtual_append_u8 (reply, 0);
+	}
+    }
+  g_list_free (children);
+
+  backend_virtual_elektron_send (device, reply);
+}
+
+//The requested chunk size and compression are ignored.
+
+static void
+backend_virtual_elektron_data_read_open (struct backend_virtual_device
+					 *device, GByteArray *req)
+{
+  guint32 id;
+  GByteArray *reply, *content;
+  struct backend_virtual_item *item;
+  const gchar *path = (gchar *) & req->data[5];
+  struct backend_virtual_elektron *elektron = device->data;
+
+  item = g_hash_table_lookup (elektron->items[BE_VIRTUAL_ELEKTRON_FS_DATA],
+			      path);
+  if (!item || item->dir)
+    {
+      backend_virtual_elektron_send_status (device, req, 0, "Not found");
+      return;
+    }
+
+  content = g_byte_array_sized_new (item->content->len);
+  g_byte_array_append (content, item->content->data, item->content->len);
+  id = backend_virtual_elektron_add_job (device, BE_VIRTUAL_ELEKTRON_FS_DATA,
+					 path, content);
+
+  reply = backend_virtual_elektron_new_reply (req);
+  backend_virtual_append_u8 (reply, 1);
+  backend_virtual_append_u32 (reply, id);
+  backend_virtual_append_u32 (reply, BE_VIRTUAL_ELEKTRON_BLOCK_LEN);
+  backend_virtual_append_u8 (reply, 0);
+  backend_virtual_elektron_send (device, reply);
+}
+
+static void
+backend_virtual_elektron_data_read (struct backend_virtual_device *device,
+				    GByteArray *req)
+{
+  GByteArray *reply;
+  guint32 start, len;
+  struct backend_virtual_job *job;
+  guint32 seq = backend_virtual_get_u32 (&req->data[9]);
+
+  job = backend_virtual_elektron_get_job (device, req, 5);
+  start = seq * BE_VIRTUAL_ELEKTRON_BLOCK_LEN;
+  if (!job || start > job->content->len)
+    {
+      backend_virtual_elektron_send_status (device, req, 0, "Illegal read");
+      return;
+    }
+
+  len = MIN (BE_VIRTUAL_ELEKTRON_BLOCK_LEN, job->content->len - start);
+
+  reply = backend_virtual_elektron_new_reply (req);
+  backend_virtual_append_u8 (reply, 1);
+  g_byte_array_append (reply, &req->data[5], 2 * sizeof (guint32));
+  backend_virtual_append_u32 (reply, job->content->len ?
+			      (start + len) * 1000 / job->content->len :
+			      1000);
+  backend_virtual_append_u8 (reply, start + len == job->content->len);
+  backend_virtual_append_u32 (reply, crc32 (0xffffffff,
+					    &job->content->data[start],
+					    len));
+  backend_virtual_append_u32 (reply, len);
+  g_byte_array_append (reply, &job->content->data[start], len);
+  backend_virtual_elektron_send (device, reply);
+}
+
+static void
+backend_virtual_elektron_data_write (struct backend_virtual_device *device,
+				     GByteArray *req)
+{
+  GByteArray *reply;
+  struct backend_virtual_job *job;
+  guint32 crc = backend_virtual_get_u32 (&req->data[13]);
+  guint32 len = backend_virtual_get_u32 (&req->data[17]);
+
+  job = backend_virtual_elektron_get_job (device, req, 5);
+  if (!job || req->len < 21 + len ||
+      crc32 (0xffffffff, &req->data[21], len) != crc)
+    {
+      backend_virtual_elektron_send_status (device, req, 0,
+					    "Illegal write");
+      return;
+    }
+
+  g_byte_array_append (job->content, &req->data[21], len);
+
+  reply = backend_virtual_elektron_new_reply (req);
+  backend_virtual_append_u8 (reply, 1);
+  g_byte_array_append (reply, &req->data[5], 2 * sizeof (guint32));
+  backend_virtual_append_u32 (reply, job->content->len);
+  backend_virtual_elektron_send (device, reply);
+}
+
+static void
+backend_virtual_elektron_ping (struct backend_virtual_device *device,
+			       GByteArray *req)
+{
+  GByteArray *reply = backend_virtual_elektron_new_reply (req);
+  backend_virtual_append_u8 (reply, device->model->elektron_id);
+  backend_virtual_append_u8 (reply, 0);
+  backend_virtual_append_string (reply, device->model->name);
+  backend_virtual_elektron_send (device, reply);
+}
+
+static void
+backend_virtual_elektron_version (struct backend_virtual_device *device,
+				  GByteArray *req)
+{
+  GByteArray *reply = backend_virtual_elektron_new_reply (req);
+  g_byte_array_append (reply, (guint8 *) "\0\0\0\0\0", 5);
+  backend_virtual_append_string (reply, BE_VIRTUAL_ELEKTRON_VERSION);
+  backend_virtual_elektron_send (device, reply);
+}
+
+static void
+backend_virtual_elektron_uid (struct backend_virtual_device *device,
+			      GByteArray *req)
+{
+  GByteArray *reply = backend_virtual_elektron_new_reply (req);
+  backend_virtual_append_u32 (reply, 0x12345678);
+  backend_virtual_elektron_send (device, reply);
+}
+
+static guint
+backend_virtual_elektron_get_fs (guint8 op)
+{
+  switch (op)
+    {
+    case 0x14:
+    case 0x15:
+    case 0x16:
+    case 0x24:
+    case 0x25:
+    case 0x26:
+    case 0x33:
+    case 0x34:
+    case 0x35:
+    case 0x43:
+    case 0x44:
+    case 0x45:
+      return BE_VIRTUAL_ELEKTRON_FS_RAW;
+    default:
+      return BE_VIRTUAL_ELEKTRON_FS_SAMPLE;
+    }
+}
+
+static void
+backend_virtual_elektron_handler (struct backend_virtual_device *device,
+				  GByteArray *raw)
+{
+  GByteArray *req;
+  guint fs;
+
+  if (raw->len < BE_VIRTUAL_ELEKTRON_MIN_LEN ||
+      memcmp (raw->data, BE_VIRTUAL_ELEKTRON_HEADER,
+	      BE_VIRTUAL_ELEKTRON_HEADER_LEN))
+    {
+      return;
+    }
+
+  req = backend_virtual_elektron_decode (&raw->data
+					 [BE_VIRTUAL_ELEKTRON_HEADER_LEN],
+					 raw->len -
+					 BE_VIRTUAL_ELEKTRON_HEADER_LEN - 1);
+  //Paths are always terminated.
+  backend_virtual_append_u8 (req, 0);
+
+  debug_print_hex_msg (3, req, "Virtual device message decoded (%d): %s",
+		       req->len);
+
+  fs = backend_virtual_elektron_get_fs (req->data[4]);
+
+  switch (req->data[4])
+    {
+    case 0x01:
+      backend_virtual_elektron_ping (device, req);
+      break;
+    case 0x02:
+      backend_virtual_elektron_version (device, req);
+      break;
+    case 0x03:
+      backend_virtual_elektron_uid (device, req);
+      break;
+    case 0x05:
+      backend_virtual_elektron_storage (device, req);
+      break;
+    case 0x10:
+    case 0x14:
+      backend_virtual_elektron_read_dir (device, req, fs);
+      break;
+    case 0x11:
+    case 0x15:
+      backend_virtual_elektron_create_dir (device, req, fs);
+      break;
+    case 0x12:
+    case 0x16:
+      backend_virtual_elektron_delete (device, req, fs, TRUE);
+      break;
+    case 0x20:
+    case 0x24:
+      backend_virtual_elektron_delete (device, req, fs, FALSE);
+      break;
+    case 0x21:
+    case 0x25:
+      backend_virtual_elektron_rename (device, req, fs);
+      break;
+    case 0x22:
+    case 0x26:
+      backend_virtual_elektron_info (device, req, fs);
+      break;
+    case 0x23:
+      backend_virtual_elektron_info_by_hash (device, req);
+      break;
+    case 0x30:
+    case 0x33:
+      backend_virtual_elektron_open_reader (device, req, fs);
+      break;
+    case 0x31:
+    case 0x34:
+      backend_virtual_elektron_close_reader (device, req);
+      break;
+    case 0x32:
+    case 0x35:
+      backend_virtual_elektron_read (device, req);
+      break;
+    case 0x40:
+    case 0x43:
+      backend_virtual_elektron_open_writer (device, req, fs);
+      break;
+    case 0x41:
+    case 0x44:
+      backend_virtual_elektron_close_writer (device, req);
+      break;
+    case 0x42:
+    case 0x45:
+      backend_virtual_elektron_write (device, req);
+      break;
+    case 0x53:
+      backend_virtual_elektron_data_list (device, req);
+      break;
+    case 0x54:
+      backend_virtual_elektron_data_read_open (device, req);
+      break;
+    case 0x55:
+      backend_virtual_elektron_data_read (device, req);
+      break;
+    case 0x56:
+      backend_virtual_elektron_close_reader (device, req);
+      break;
+    case 0x57:
+      backend_virtual_elektron_open_writer (device, req,
+					    BE_VIRTUAL_ELEKTRON_FS_DATA);
+      break;
+    case 0x58:
+      backend_virtual_elektron_data_write (device, req);
+      break;
+    case 0x59:
+      backend_virtual_elektron_close_writer (device, req);
+      break;
+    default:
+      backend_virtual_elektron_send_status (device, req, 0,
+					    "Unsupported request");
+    }
+
+  free_msg (req);
+}
+
+static void
+backend_virtual_sds_sample_free (gpointer data)
+{
+  struct backend_virtual_sds_sample *sample = data;
+  if (sample->payload)
+    {
+      g_byte_array_free (sample->payload, TRUE);
+    }
+  g_free (sample->name);
+  g_free (sample);
+}
+
+static void
+backend_virtual_sds_init (struct backend_virtual_device *device)
+{
+  struct backend_virtual_sds *sds =
+    g_malloc0 (sizeof (struct backend_virtual_sds));
+  sds->samples = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL,
+					backend_virtual_sds_sample_free);
+  sds->status = BE_VIRTUAL_SDS_STATUS_IDLE;
+  device->data = sds;
+}
+
+static void
+backend_virtual_sds_reset (struct backend_virtual_sds *sds)
+{
+  if (sds->status == BE_VIRTUAL_SDS_STATUS_UPLOADING)
+    {
+      backend_virtual_sds_sample_free (sds->sample);
+    }
+  sds->sample = NULL;
+  sds->status = BE_VIRTUAL_SDS_STATUS_IDLE;
+}
+
+static void
+backend_virtual_sds_free (struct backend_virtual_device *device)
+{
+  struct backend_virtual_sds *sds = device->data;
+  backend_virtual_sds_reset (sds);
+  g_hash_table_destroy (sds->samples);
+  g_free (sds);
+}
+
+static void
+backend_virtual_sds_send_handshake (struct backend_virtual_device *device,
+				    guint8 type, guint8 packet)
+{
+  GByteArray *msg = g_byte_array_sized_new (6);
+  g_byte_array_append (msg, (guint8 *) "\xf0\x7e\x00", 3);
+  backend_virtual_append_u8 (msg, type);
+  backend_virtual_append_u8 (msg, packet);
+  backend_virtual_append_u8 (msg, 0xf7);
+  backend_virtual_send (device, msg);
+}
+
+static guint
+backend_virtual_sds_get_packets (const guint8 *header)
+{
+  guint bits = header[6];
+  guint bytes_per_word = (bits + 6) / 7;
+  guint words_per_packet = BE_VIRTUAL_SDS_PACKET_PAYLOAD_LEN /
+    bytes_per_word;
+  guint words = header[10] | (header[11] << 7) | (header[12] << 14);
+  return (words + words_per_packet - 1) / words_per_packet;
+}
+
+static guint8
+backend_virtual_sds_checksum (const guint8 *data)
+{
+  guint8 checksum = 0;
+  for (guint i = 1; i < BE_VIRTUAL_SDS_PACKET_CKSUM_POS; i++)
+    {
+      checksum ^= data[i];
+    }
+  return checksum & 0x7f;
+}
+
+static void
+backend_virtual_sds_send_packet (struct backend_virtual_device *device)
+{
+  GByteArray *msg;
+  struct backend_virtual_sds *sds = device->data;
+  guint8 *payload = &sds->sample->payload->data[sds->packet *
+						BE_VIRTUAL_SDS_PACKET_PAYLOAD_LEN];
+
+  msg = g_byte_array_sized_new (BE_VIRTUAL_SDS_PACKET_LEN);
+  g_byte_array_append (msg, (guint8 *) "\xf0\x7e\x00\x02", 4);
+  backend_virtual_append_u8 (msg, sds->packet % 0x80);
+  g_byte_array_append (msg, payload, BE_VIRTUAL_SDS_PACKET_PAYLOAD_LEN);
+  backend_virtual_append_u8 (msg, backend_virtual_sds_checksum (msg->data));
+  backend_virtual_append_u8 (msg, 0xf7);
+  backend_virtual_send (device, msg);
+}
+
+static void
+backend_virtual_sds_dump_header (struct backend_virtual_device *device,
+				 GByteArray *msg)
+{
+  struct backend_virtual_sds *sds = device->data;
+
+  backend_virtual_sds_reset (sds);
+
+  sds->id = msg->data[4] | (msg->data[5] << 7);
+  sds->packet = 0;
+  sds->packets = backend_virtual_sds_get_packets (msg->data);
+  sds->sample = g_malloc0 (sizeof (struct backend_virtual_sds_sample));
+  memcpy (sds->sample->header, msg->data, BE_VIRTUAL_SDS_HEADER_LEN);
+  sds->sample->payload = g_byte_array_new ();
+  sds->sample->name = g_strdup ("");
+  sds->status = BE_VIRTUAL_SDS_STATUS_UPLOADING;
+
+  backend_virtual_sds_send_handshake (device, BE_VIRTUAL_SDS_ACK, 0);
+}
+
+static void
+backend_virtual_sds_data_packet (struct backend_virtual_device *device,
+				 GByteArray *msg)
+{
+  guint8 packet = msg->data[4];
+  struct backend_virtual_sds *sds = device->data;
+
+  if (sds->status != BE_VIRTUAL_SDS_STATUS_UPLOADING ||
+      msg->len != BE_VIRTUAL_SDS_PACKET_LEN)
+    {
+      return;
+    }
+
+  if (backend_virtual_sds_checksum (msg->data) !=
+      msg->data[BE_VIRTUAL_SDS_PACKET_CKSUM_POS])
+    {
+      backend_virtual_sds_send_handshake (device, BE_VIRTUAL_SDS_NAK,
+					  packet);
+      return;
+    }
+
+  //A packet sent again because the ACK was lost is acknowledged but not stored.
+  if (packet == sds->packet % 0x80)
+    {
+      g_byte_array_append (sds->sample->payload, &msg->data[5],
+			   BE_VIRTUAL_SDS_PACKET_PAYLOAD_LEN);
+      sds->packet++;
+    }
+  else if (packet != (sds->packet + 0x7f) % 0x80)
+    {
+      backend_virtual_sds_send_handshake (device, BE_VIRTUAL_SDS_NAK,
+					  packet);
+      return;
+    }
+
+  backend_virtual_sds_send_handshake (device, BE_VIRTUAL_SDS_ACK, packet);
+
+  if (sds->packet == sds->packets)
+    {
+      struct backend_virtual_sds_sample *old =
+	g_hash_table_lookup (sds->samples, GUINT_TO_POINTER (sds->id));
+      if (old)
+	{
+	  g_free (sds->sample->name);
+	  sds->sample->name = g_strdup (old->name);
+	}
+      g_hash_table_insert (sds->samples, GUINT_TO_POINTER (sds->id),
+			   sds->sample);
+      debug_print (1, "Virtual SDS sample %d stored", sds->id);
+      sds->sample = NULL;
+      sds->status = BE_VIRTUAL_SDS_STATUS_IDLE;
+    }
+}
+
+static void
+backend_virtual_sds_request (struct backend_virtual_device *device,
+			     GByteArray *msg)
+{
+  GByteArray *header;
+  struct backend_virtual_sds *sds = device->data;
+  guint id = msg->data[4] | (msg->data[5] << 7);
+
+  backend_virtual_sds_reset (sds);
+
+  sds->sample = g_hash_table_lookup (sds->samples, GUINT_TO_POINTER (id));
+  if (!sds->sample)
+    {
+      backend_virtual_sds_send_handshake (device, BE_VIRTUAL_SDS_CANCEL, 0);
+      return;
+    }
+
+  sds->id = id;
+  sds->packet = 0;
+  sds->packets = backend_virtual_sds_get_packets (sds->sample->header);
+  sds->started = FALSE;
+  sds->status = BE_VIRTUAL_SDS_STATUS_DOWNLOADING;
+
+  header = g_byte_array_sized_new (BE_VIRTUAL_SDS_HEADER_LEN);
+  g_byte_array_append (header, sds->sample->header,
+		       BE_VIRTUAL_SDS_HEADER_LEN);
+  backend_virtual_send (device, header);
+}
+
+//The first ACK after the header requests the first packet and every other ACK requests the next one.
+
+static void
+backend_virtual_sds_ack (struct backend_virtual_device *device,
+			 GByteArray *msg, gboolean ack)
+{
+  struct backend_virtual_sds *sds = device->data;
+
+  if (sds->status != BE_VIRTUAL_SDS_STATUS_DOWNLOADING)
+    {
+      return;
+    }
+
+  if (!sds->started)
+    {
+      sds->started = TRUE;
+    }
+  else if (ack)
+    {
+      sds->packet++;
+    }
+
+  if (sds->packet == sds->packets)
+    {
+      sds->sample = NULL;
+      sds->status = BE_VIRTUAL_SDS_STATUS_IDLE;
+      return;
+    }
+
+  backend_virtual_sds_send_packet (device);
+}
+
+static void
+backend_virtual_sds_name_request (struct backend_virtual_device *device,
+				  GByteArray *msg)
+{
+  GByteArray *reply;
+  struct backend_virtual_sds *sds = device->data;
+  guint id = msg->data[5] | (msg->data[6] << 7);
+  struct backend_virtual_sds_sample *sample =
+    g_hash_table_lookup (sds->samples, GUINT_TO_POINTER (id));
+  const gchar *name = sample ? sample->name : "";
+
+  //This is the layout the SDS connector reads.
+  reply = g_byte_array_new ();
+  g_byte_array_append (reply, (guint8 *) "\xf0\x7e\x00\x05\x03", 5);
+  g_byte_array_append (reply, &msg->data[5], 2);
+  g_byte_array_append (reply, (guint8 *) "\0\0", 2);
+  backend_virtual_append_u8 (reply, strlen (name));
+  g_byte_array_append (reply, (guint8 *) name, strlen (name));
+  backend_virtual_append_u8 (reply, 0xf7);
+  backend_virtual_send (device, reply);
+}
+
+static void
+backend_virtual_sds_name_set (struct backend_virtual_device *device,
+			      GByteArray *msg)
+{
+  guint len;
+  struct backend_virtual_sds *sds = device->data;
+  guint id = msg->data[5] | (msg->data[6] << 7);
+  struct backend_virtual_sds_sample *sample =
+    g_hash_table_lookup (sds->samples, GUINT_TO_POINTER (id));
+
+  len = msg->data[8];
+  if (sample && msg->len >= 10 + len)
+    {
+      g_free (sample->name);
+      sample->name = g_strndup ((gchar *) & msg->data[9], len);
+    }
+
+  backend_virtual_sds_send_handshake (device, BE_VIRTUAL_SDS_ACK, 0);
+}
+
+static void
+backend_virtual_sds_handler (struct backend_virtual_device *device,
+			     GByteArray *msg)
+{
+  struct backend_virtual_sds *sds = device->data;
+
+  //Only non real time universal messages are handled.
+  if (msg->len < 6 || msg->data[1] != 0x7e)
+    {
+      return;
+    }
+
+  switch (msg->data[3])
+    {
+    case 0x01:
+      if (msg->len == BE_VIRTUAL_SDS_HEADER_LEN)
+	{
+	  backend_virtual_sds_dump_header (device, msg);
+	}
+      break;
+    case 0x02:
+      backend_virtual_sds_data_packet (device, msg);
+      break;
+    case 0x03:
+      backend_virtual_sds_request (device, msg);
+      break;
+    case 0x05:
+      if (msg->len >= 8 && msg->data[4] == 0x04)
+	{
+	  backend_virtual_sds_name_request (device, msg);
+	}
+      else if (msg->len >= 10 && msg->data[4] == 0x03)
+	{
+	  backend_virtual_sds_name_set (device, msg);
+	}
+      break;
+    case BE_VIRTUAL_SDS_ACK:
+      backend_virtual_sds_ack (device, msg, TRUE);
+      break;
+    case BE_VIRTUAL_SDS_NAK:
+      backend_virtual_sds_ack (device, msg, FALSE);
+      break;
+    case BE_VIRTUAL_SDS_CANCEL:
+      backend_virtual_sds_reset (sds);
+      break;
+    }
+}
+
+static void
+backend_virtual_microfreak_init (struct backend_virtual_device *device)
+{
+  struct backend_virtual_microfreak *microfreak =
+    g_malloc0 (sizeof (struct backend_virtual_microfreak));
+
+  for (guint i = 0; i < BE_VIRTUAL_MICROFREAK_PRESETS; i++)
+    {
+      guint8 *header = microfreak->presets[i].header;
+      header[0] = i >> 7;
+      header[1] = i & 0x7f;
+      header[3] = BE_VIRTUAL_MICROFREAK_PRESET_INIT;
+      header[8] = header[1];
+      memcpy (&header[12], BE_VIRTUAL_MICROFREAK_PRESET_NAME,
+	      strlen (BE_VIRTUAL_MICROFREAK_PRESET_NAME));
+    }
+
+  device->data = microfreak;
+}
+
+static void
+backend_virtual_microfreak_free (struct backend_virtual_device *device)
+{
+  g_free (device->data);
+}
+
+static void
+backend_virtual_microfreak_send (struct backend_virtual_device *device,
+				 GByteArray *req, guint8 op,
+				 const guint8 *payload, guint8 len)
+{
+  GByteArray *msg = g_byte_array_sized_new (len + 16);
+  g_byte_array_append (msg, BE_VIRTUAL_MICROFREAK_HEADER,
+		       sizeof (BE_VIRTUAL_MICROFREAK_HEADER));
+  backend_virtual_append_u8 (msg, req->data[6]);
+  backend_virtual_append_u8 (msg, len);
+  backend_virtual_append_u8 (msg, op);
+  g_byte_array_append (msg, payload, len);
+  backend_virtual_append_u8 (msg, 0xf7);
+  backend_virtual_send (device, msg);
+}
+
+//Only the presets are emulated.
+
+static void
+backend_virtual_microfreak_handler (struct backend_virtual_device *device,
+				    GByteArray *msg)
+{
+  guint8 op, len, *payload;
+  guint id;
+  struct backend_virtual_microfreak *microfreak = device->data;
+  struct backend_virtual_microfreak_preset *preset;
+
+  if (msg->len < 10 || memcmp (msg->data, BE_VIRTUAL_MICROFREAK_HEADER,
+			       BE_VIRTUAL_MICROFREAK_HEADER_LEN))
+    {
+      return;
+    }
+
+  len = msg->data[7];
+  op = msg->data[8];
+  payload = &msg->data[9];
+  if (msg->len != 10 + len)
+    {
+      return;
+    }
+
+  switch (op)
+    {
+    case 0x19:
+      if (len != 3)
+	{
+	  return;
+	}
+      id = (payload[0] << 7) | payload[1];
+      if (id >= BE_VIRTUAL_MICROFREAK_PRESETS)
+	{
+	  return;
+	}
+      if (payload[2])
+	{
+	  microfreak->id = id;
+	  microfreak->part = 0;
+	  backend_virtual_microfreak_send (device, msg, 0x15, NULL, 0);
+	}
+      else
+	{
+	  backend_virtual_microfreak_send (device, msg, 0x52,
+					   microfreak->presets[id].header,
+					   BE_VIRTUAL_MICROFREAK_PRESET_HEADER_LEN);
+	}
+      break;
+    case 0x18:
+      if (microfreak->part >= BE_VIRTUAL_MICROFREAK_PRESET_PARTS)
+	{
+	  return;
+	}
+      preset = &microfreak->presets[microfreak->id];
+      backend_virtual_microfreak_send (device, msg,
+				       microfreak->part ==
+				       BE_VIRTUAL_MICROFREAK_PRESET_PARTS -
+				       1 ? 0x17 : 0x16,
+				       &preset->data[microfreak->part *
+						     BE_VIRTUAL_MICROFREAK_PRESET_PART_LEN],
+				       BE_VIRTUAL_MICROFREAK_PRESET_PART_LEN);
+      microfreak->part++;
+      break;
+    case 0x52:
+      if (len == BE_VIRTUAL_MICROFREAK_PRESET_HEADER_LEN)
+	{
+	  id = (payload[0] << 7) | payload[1];
+	  if (id >= BE_VIRTUAL_MICROFREAK_PRESETS)
+	    {
+	      return;
+	    }
+	  microfreak->id = id;
+	  memcpy (microfreak->presets[id].header, payload, len);
+	}
+      backend_virtual_microfreak_send (device, msg, 0x18, NULL, 0);
+      break;
+    case 0x15:
+      microfreak->part = 0;
+      backend_virtual_microfreak_send (device, msg, 0x18, NULL, 0);
+      break;
+    case 0x16:
+    case 0x17:
+      if (len != BE_VIRTUAL_MICROFREAK_PRESET_PART_LEN ||
+	  microfreak->part >= BE_VIRTUAL_MICROFREAK_PRESET_PARTS)
+	{
+	  return;
+	}
+      preset = &microfreak->presets[microfreak->id];
+      memcpy (&preset->data[microfreak->part *
+			    BE_VIRTUAL_MICROFREAK_PRESET_PART_LEN], payload,
+	      len);
+      microfreak->part++;
+      backend_virtual_microfreak_send (device, msg, 0x18, NULL, 0);
+      break;
+    }
+}
+
+void
+backend_destroy_int (struct backend *backend)
+{
+  struct backend_virtual_device *device = backend->outputp;
+
+  if (!device)
+    {
+      return;
+    }
+
+  device->model->free (device);
+  g_queue_free_full (device->output, backend_virtual_free_msg);
+  g_byte_array_free (device->input, TRUE);
+  g_mutex_clear (&device->mutex);
+  g_free (device);
+
+  backend->inputp = NULL;
+  backend->outputp = NULL;
+}
+
+gint
+backend_init_int (struct backend *backend, const gchar *id)
+{
+  gint model;
+  gchar *rem;
+  const gchar *link;
+  struct backend_virtual_device *device;
+
+  backend->inputp = NULL;
+  backend->outputp = NULL;
+
+  if (!g_str_has_prefix (id, BE_DEVICE_NAME_PREFIX))
+    {
+      return -ENODEV;
+    }
+
+  errno = 0;
+  model = (gint) g_ascii_strtoll (&id[strlen (BE_DEVICE_NAME_PREFIX)], &rem,
+				  10);
+  if (errno || *rem || model < 0 || model >= BE_VIRTUAL_MODELS_LEN)
+    {
+      error_print ("Illegal virtual device '%s'", id);
+      return -ENODEV;
+    }
+
+  if (!backend_virtual_link_set)
+    {
+      link = g_getenv (BE_VIRTUAL_LINK_ENV);
+      if (link && backend_virtual_parse_link (&backend_virtual_link, link))
+	{
+	  memset (&backend_virtual_link, 0,
+		  sizeof (struct backend_virtual_link));
+	}
+    }
+
+  device = g_malloc0 (sizeof (struct backend_virtual_device));
+  device->model = &BE_VIRTUAL_MODELS[model];
+  device->link = backend_virtual_link;
+  g_mutex_init (&device->mutex);
+  device->input = g_byte_array_sized_new (BE_MAX_TX_LEN);
+  device->output = g_queue_new ();
+  device->model->init (device);
+
+  debug_print (1, "Virtual %s link: %d B/s; %d us; drop period %d; "
+	       "corrupt period %d", device->model->name,
+	       device->link.bandwidth, device->link.latency,
+	       device->link.drop_period, device->link.corrupt_period);
+
+  backend->inputp = device;
+  backend->outputp = device;
+
+  return 0;
+}
+
+static void
+backend_virtual_sleep_until (gint64 time)
+{
+  gint64 diff = time - g_get_monotonic_time ();
+  if (diff > 0)
+    {
+      g_usleep (diff);
+    }
+}
+
+//The host is blocked while the data is transmitted but not during the latency, which allows pipelining.
+
+ssize_t
+backend_tx_raw_int (struct backend *backend, guint8 *data, guint len)
+{
+  gint64 start;
+  struct backend_virtual_device *device = backend->outputp;
+
+  if (!device)
+    {
+      error_print ("Output port is NULL");
+      return -ENOTCONN;
+    }
+
+  g_mutex_lock (&device->mutex);
+
+  start = MAX (g_get_monotonic_time (), device->tx_busy);
+  device->tx_busy = start + backend_virtual_get_tx_time (device, len);
+
+  for (guint i = 0; i < len; i++)
+    {
+      if (data[i] == 0xf0)
+	{
+	  g_byte_array_set_size (device->input, 0);
+	}
+      else if (!device->input->len)
+	{
+	  continue;		//Only SysEx messages are handled.
+	}
+
+      g_byte_array_append (device->input, &data[i], 1);
+
+      if (data[i] == 0xf7)
+	{
+	  device->time = device->tx_busy + device->link.latency;
+	  backend_virtual_handle (device, device->input);
+	  g_byte_array_set_size (device->input, 0);
+	}
+    }
+
+  g_mutex_unlock (&device->mutex);
+
+  backend_virtual_sleep_until (device->tx_busy);
+
+  return len;
+}
+
+gint
+backend_tx_sysex_int (struct backend *backend,
+		      struct sysex_transfer *transfer,
+		      struct controllable *controllable)
+{
+  ssize_t tx_len;
+  guint total;
+  guint len;
+  guchar *b;
+
+  transfer->err = 0;
+  sysex_transfer_set_status (transfer, controllable,
+			     SYSEX_TRANSFER_STATUS_SENDING);
+
+  b = transfer->raw->data;
+  total = 0;
+  while (total < transfer->raw->len &&
+	 CONTROLLABLE_IS_NULL_OR_ACTIVE (controllable))
+    {
+      len = transfer->raw->len - total;
+      if (len > BE_MAX_TX_LEN)
+	{
+	  len = BE_MAX_TX_LEN;
+	}
+
+      tx_len = backend_tx_raw_int (backend, b, len);
+      if (tx_len < 0)
+	{
+	  transfer->err = tx_len;
+	  break;
+	}
+      b += len;
+      total += len;
+    }
+
+  if (!CONTROLLABLE_IS_NULL_OR_ACTIVE (controllable))
+    {
+      transfer->err = -ECANCELED;
+    }
+
+  if (!transfer->err)
+    {
+      debug_print_hex_msg (2, transfer->raw, "Raw message sent (%d): %s",
+			   transfer->raw->len);
+    }
+
+  sysex_transfer_set_status (transfer, controllable,
+			     SYSEX_TRANSFER_STATUS_FINISHED);
+
+  return transfer->err;
+}
+
+void
+backend_rx_drain_int (struct backend *backend)
+{
+  //Writes are synchronous so there is nothing to drain.
+}
+
+//If nothing is ready, this waits up to BE_POLL_TIMEOUT_MS as the other backends do.
+
+ssize_t
+backend_rx_raw_int (struct backend *backend, guint8 *buffer, guint len)
+{
+  gint64 now, wait;
+  guint total = 0;
+  struct backend_virtual_msg *msg;
+  struct backend_virtual_device *device = backend->inputp;
+
+  g_mutex_lock (&device->mutex);
+  msg = g_queue_peek_head (device->output);
+  now = g_get_monotonic_time ();
+  wait = msg ? msg->time - now : BE_POLL_TIMEOUT_MS * 1000;
+  g_mutex_unlock (&device->mutex);
+
+  if (wait > 0)
+    {
+      g_usleep (MIN (wait, BE_POLL_TIMEOUT_MS * 1000));
+      now = g_get_monotonic_time ();
+    }
+
+  g_mutex_lock (&device->mutex);
+  while (total < len)
+    {
+      guint n;
+
+      msg = g_queue_peek_head (device->output);
+      if (!msg || msg->time > now)
+	{
+	  break;
+	}
+
+      n = MIN (len - total, msg->data->len - msg->pos);
+      memcpy (&buffer[total], &msg->data->data[msg->pos], n);
+      msg->pos += n;
+      total += n;
+
+      if (msg->pos == msg->data->len)
+	{
+	  g_queue_pop_head (device->output);
+	  backend_virtual_free_msg (msg);
+	}
+    }
+  g_mutex_unlock (&device->mutex);
+
+  return total;
+}
+
+gboolean
+backend_check_int (struct backend *backend)
+{
+  return backend->inputp && backend->outputp;
+}
+
+void
+backend_fill_devices_array (GArray *devices)
+{
+  struct backend_device *backend_device;
+
+  for (gint i = 0; i < BE_VIRTUAL_MODELS_LEN; i++)
+    {
+      backend_device = g_malloc (sizeof (struct backend_device));
+      backend_device->type = BE_TYPE_MIDI;
+      snprintf (backend_device->id, LABEL_MAX, BE_DEVICE_NAME, i);
+      snprintf (backend_device->name, LABEL_MAX, BE_DEVICE_NAME ": %s", i,
+		BE_VIRTUAL_MODELS[i].name);
+      g_array_append_vals (devices, backend_device, 1);
+    }
+}
+
+const gchar *
+backend_strerror (struct backend *backend, gint err)
+{
+  return g_strerror (err < 0 ? -err : err);
+}
+
+const gchar *
+backend_name ()
+{
+  return "Virtual";
+}
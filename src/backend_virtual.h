@@ -0,0 +1,47 @@
+/*
+ *   backend_virtual.h
+ *   Copyright (C) 2024 David García Goñi <dagargo@gmail.com>
+ *
+ *   This file is part of Elektroid.
+ *
+ *   Elektroid is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Elektroid is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Elektroid. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BACKEND_VIRTUAL_H
+#define BACKEND_VIRTUAL_H
+
+#include "utils.h"
+
+#define BE_VIRTUAL_LINK_ENV "ELEKTROID_VIRTUAL_LINK"
+#define BE_VIRTUAL_MIDI_DIN_BANDWIDTH 3125	//31250 bauds with 10 bits per byte.
+#define BE_VIRTUAL_CORRUPT_MIN_LEN 64	//Shorter messages are never corrupted so that handshakes are not affected.
+
+//Emulated link between the host and a virtual device. Every error injection is periodic so runs are reproducible.
+//A 0 value disables the feature.
+struct backend_virtual_link
+{
+  guint bandwidth;		//Measured in B/s and applied to each direction.
+  guint latency;		//One way latency measured in us.
+  guint drop_period;		//Every n-th message sent by the device is lost.
+  guint corrupt_period;		//Every n-th message in any direction gets a wrong byte.
+};
+
+//Applies to the devices initialized afterwards. By default, the link is read from the BE_VIRTUAL_LINK_ENV environment variable.
+void backend_virtual_set_link (const struct backend_virtual_link *link);
+
+//Parses strings like "bandwidth=3125,latency=1000,drop=0,corrupt=0". Missing keys are set to 0.
+gint backend_virtual_parse_link (struct backend_virtual_link *link,
+				 const gchar * s);
+
+#endif
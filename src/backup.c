@@ -0,0 +1,403 @@
+/*
+ *   backup.c
+ *   Copyright (C) 2024 David García Goñi <dagargo@gmail.com>
+ *
+ *   This file is part of Elektroid.
+ *
+ *   Elektroid is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Elektroid is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Elektroid. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <inttypes.h>
+#include <unistd.h>
+#include <glib/gstdio.h>
+#include <json-glib/json-glib.h>
+#include "backup.h"
+
+static void
+backup_entry_free (gpointer data)
+{
+  struct backup_entry *entry = data;
+  g_free (entry->name);
+  g_free (entry->file);
+  g_free (entry->object);
+  g_free (entry);
+}
+
+static struct backup_entry *
+backup_entry_new (const gchar *name, gint64 size, gint64 hash,
+		  const gchar *file, const gchar *object)
+{
+  struct backup_entry *entry = g_malloc (sizeof (struct backup_entry));
+  entry->name = g_strdup (name);
+  entry->size = size;
+  entry->hash = hash;
+  entry->file = g_strdup (file);
+  entry->object = g_strdup (object);
+  return entry;
+}
+
+//Hard links are used if possible. Otherwise, e.g., the objects are in another filesystem, the file is copied.
+
+static gint
+backup_link (const gchar *src, const gchar *dst)
+{
+  gint err;
+  gchar *content;
+  gsize len;
+
+#if !defined(__MINGW32__) && !defined(__MINGW64__)
+  if (!link (src, dst))
+    {
+      return 0;
+    }
+#endif
+
+  if (!g_file_get_contents (src, &content, &len, NULL))
+    {
+      error_print ("Error while reading '%s'", src);
+      return -EIO;
+    }
+
+  err = file_save_data (dst, (guint8 *) content, len);
+  g_free (content);
+
+  return err;
+}
+
+static void
+backup_load_manifest (struct backup *backup)
+{
+  JsonNode *root;
+  JsonObject *items, *object;
+  JsonParser *parser = json_parser_new ();
+  GError *error = NULL;
+  GList *members, *member;
+  gchar *filename = path_chain (PATH_SYSTEM, backup->dir, BACKUP_MANIFEST);
+
+  if (!json_parser_load_from_file (parser, filename, &error))
+    {
+      debug_print (1, "No previous backup manifest in '%s': %s", filename,
+		   error->message);
+      g_error_free (error);
+      goto end;
+    }
+
+  root = json_parser_get_root (parser);
+  if (!JSON_NODE_HOLDS_OBJECT (root))
+    {
+      error_print ("Invalid backup manifest '%s'. Ignoring...", filename);
+      goto end;
+    }
+
+  items = json_object_get_object_member (json_node_get_object (root),
+					 "items");
+  if (!items)
+    {
+      error_print ("Invalid backup manifest '%s'. Ignoring...", filename);
+      goto end;
+    }
+
+  members = json_object_get_members (items);
+  for (member = members; member; member = member->next)
+    {
+      struct backup_entry *entry;
+      const gchar *path = member->data;
+
+      object = json_object_get_object_member (items, path);
+      entry = backup_entry_new (json_object_get_string_member (object,
+								"name"),
+				json_object_get_int_member (object, "size"),
+				json_object_get_int_member (object, "hash"),
+				json_object_get_string_member (object,
+							       "file"),
+				json_object_get_string_member (object,
+							       "object"));
+      g_hash_table_insert (backup->manifest, g_strdup (path), entry);
+    }
+  g_list_free (members);
+
+  debug_print (1, "Loaded %u items from backup manifest '%s'",
+	       g_hash_table_size (backup->manifest), filename);
+
+end:
+  g_free (filename);
+  g_object_unref (parser);
+}
+
+gint
+backup_init (struct backup *backup, const gchar *dir, const gchar *prefix)
+{
+  const gchar *objects_dir = g_getenv (BACKUP_ENV_OBJECTS_DIR);
+
+  backup->dir = g_strdup (dir);
+  backup->objects_dir = objects_dir ? g_strdup (objects_dir) :
+    path_chain (PATH_SYSTEM, dir, BACKUP_OBJECTS_DIR);
+  backup->prefix = g_strdup (prefix);
+  backup->manifest = g_hash_table_new_full (g_str_hash, g_str_equal,
+					    g_free, backup_entry_free);
+  backup->entries = g_hash_table_new_full (g_str_hash, g_str_equal,
+					   g_free, backup_entry_free);
+  backup->unchanged = 0;
+  backup->downloaded = 0;
+  backup->stored = 0;
+
+  if (g_mkdir_with_parents (backup->objects_dir, 0755))
+    {
+      error_print ("Error while creating directory '%s'",
+		   backup->objects_dir);
+      backup_free (backup);
+      return -EIO;
+    }
+
+  backup_load_manifest (backup);
+
+  return 0;
+}
+
+gboolean
+backup_keep_unchanged (struct backup *backup, const gchar *path,
+		       const struct item *item)
+{
+  gboolean unchanged = FALSE;
+  gchar *file, *object;
+  struct backup_entry *entry = g_hash_table_lookup (backup->manifest, path);
+
+  //Without a device hash, an item edited in place keeps its name and size.
+  if (!entry || item->hash < 0 || item->size < 0 ||
+      entry->size != item->size || entry->hash != item->hash ||
+      strcmp (entry->name, item->name))
+    {
+      return FALSE;
+    }
+
+  object = path_chain (PATH_SYSTEM, backup->objects_dir, entry->object);
+  file = path_chain (PATH_SYSTEM, backup->dir, entry->file);
+
+  if (!g_file_test (object, G_FILE_TEST_EXISTS))
+    {
+      debug_print (1, "Object '%s' is missing", object);
+      goto end;
+    }
+
+  if (!g_file_test (file, G_FILE_TEST_EXISTS) && backup_link (object, file))
+    {
+      goto end;
+    }
+
+  debug_print (1, "Item '%s' is unchanged", path);
+  g_hash_table_insert (backup->entries, g_strdup (path),
+		       backup_entry_new (entry->name, entry->size,
+					 entry->hash, entry->file,
+					 entry->object));
+  backup->unchanged++;
+  unchanged = TRUE;
+
+end:
+  g_free (object);
+  g_free (file);
+  return unchanged;
+}
+
+static gchar *
+backup_get_object_name (struct backup *backup, const struct item *item,
+			const gchar *file)
+{
+  gchar *key, *object, *content;
+  const gchar *ext;
+  gsize len;
+
+  if (item->hash >= 0)
+    {
+      key = g_strdup_printf ("%s-%08" PRIx64 "-%" PRId64, backup->prefix,
+			     item->hash, item->size);
+    }
+  else
+    {
+      if (!g_file_get_contents (file, &content, &len, NULL))
+	{
+	  error_print ("Error while reading '%s'", file);
+	  return NULL;
+	}
+      key = g_compute_checksum_for_data (G_CHECKSUM_SHA256,
+					 (guchar *) content, len);
+      g_free (content);
+    }
+
+  ext = strrchr (file, '.');
+  if (ext && strchr (ext, G_DIR_SEPARATOR))
+    {
+      ext = NULL;
+    }
+  object = g_strconcat (key, ext, NULL);
+  g_free (key);
+
+  return object;
+}
+
+gint
+backup_add (struct backup *backup, const gchar *path,
+	    const struct item *item, const gchar *file)
+{
+  gint err;
+  gchar *object, *object_path;
+  const gchar *rel_file;
+  guint dir_len = strlen (backup->dir);
+  struct backup_entry *entry = g_hash_table_lookup (backup->manifest, path);
+
+  object = backup_get_object_name (backup, item, file);
+  if (!object)
+    {
+      return -EIO;
+    }
+
+  object_path = path_chain (PATH_SYSTEM, backup->objects_dir, object);
+
+  if (g_file_test (object_path, G_FILE_TEST_EXISTS))
+    {
+      debug_print (1, "Object '%s' already stored", object);
+      g_unlink (file);
+      err = backup_link (object_path, file);
+    }
+  else
+    {
+      debug_print (1, "Storing object '%s'...", object);
+      err = backup_link (file, object_path);
+      if (!err)
+	{
+	  backup->stored++;
+	}
+    }
+
+  if (!err)
+    {
+      rel_file = file;
+      if (!strncmp (file, backup->dir, dir_len) &&
+	  file[dir_len] == G_DIR_SEPARATOR)
+	{
+	  rel_file = &file[dir_len + 1];
+	}
+
+      g_hash_table_insert (backup->entries, g_strdup (path),
+			   backup_entry_new (item->name, item->size,
+					     item->hash, rel_file, object));
+
+      if (item->hash < 0 && entry && !strcmp (entry->object, object))
+	{
+	  debug_print (1, "Item '%s' is unchanged", path);
+	  backup->unchanged++;
+	}
+      else
+	{
+	  backup->downloaded++;
+	}
+    }
+
+  g_free (object_path);
+  g_free (object);
+
+  return err;
+}
+
+//If the backup is not complete, the items not visited are kept so that they are not downloaded again.
+
+gint
+backup_save (struct backup *backup, gboolean complete)
+{
+  gint err = 0;
+  gchar *json, *filename;
+  JsonNode *root;
+  JsonBuilder *builder;
+  JsonGenerator *gen;
+  GHashTableIter iter;
+  gpointer key, value;
+  GError *error = NULL;
+
+  if (!complete)
+    {
+      g_hash_table_iter_init (&iter, backup->manifest);
+      while (g_hash_table_iter_next (&iter, &key, &value))
+	{
+	  struct backup_entry *entry = value;
+	  if (!g_hash_table_contains (backup->entries, key))
+	    {
+	      g_hash_table_insert (backup->entries, g_strdup (key),
+				   backup_entry_new (entry->name, entry->size,
+						     entry->hash, entry->file,
+						     entry->object));
+	    }
+	}
+    }
+
+  builder = json_builder_new ();
+  json_builder_begin_object (builder);
+  json_builder_set_member_name (builder, "items");
+  json_builder_begin_object (builder);
+
+  g_hash_table_iter_init (&iter, backup->entries);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+      struct backup_entry *entry = value;
+      json_builder_set_member_name (builder, key);
+      json_builder_begin_object (builder);
+      json_builder_set_member_name (builder, "name");
+      json_builder_add_string_value (builder, entry->name);
+      json_builder_set_member_name (builder, "size");
+      json_builder_add_int_value (builder, entry->size);
+      json_builder_set_member_name (builder, "hash");
+      json_builder_add_int_value (builder, entry->hash);
+      json_builder_set_member_name (builder, "file");
+      json_builder_add_string_value (builder, entry->file);
+      json_builder_set_member_name (builder, "object");
+      json_builder_add_string_value (builder, entry->object);
+      json_builder_end_object (builder);
+    }
+
+  json_builder_end_object (builder);
+  json_builder_end_object (builder);
+
+  gen = json_generator_new ();
+  root = json_builder_get_root (builder);
+  json_generator_set_root (gen, root);
+  json = json_generator_to_data (gen, NULL);
+
+  filename = path_chain (PATH_SYSTEM, backup->dir, BACKUP_MANIFEST);
+  debug_print (1, "Saving backup manifest to '%s'...", filename);
+
+  //This is atomic so an interrupted backup never leaves a broken manifest.
+  if (!g_file_set_contents (filename, json, -1, &error))
+    {
+      error_print ("Error while saving backup manifest to '%s': %s",
+		   filename, error->message);
+      g_error_free (error);
+      err = -EIO;
+    }
+
+  g_free (filename);
+  g_free (json);
+  json_node_free (root);
+  g_object_unref (gen);
+  g_object_unref (builder);
+
+  return err;
+}
+
+void
+backup_free (struct backup *backup)
+{
+  g_free (backup->dir);
+  g_free (backup->objects_dir);
+  g_free (backup->prefix);
+  g_hash_table_destroy (backup->manifest);
+  g_hash_table_destroy (backup->entries);
+}
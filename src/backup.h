@@ -0,0 +1,72 @@
+/*
+ *   backup.h
+ *   Copyright (C) 2024 David García Goñi <dagargo@gmail.com>
+ *
+ *   This file is part of Elektroid.
+ *
+ *   Elektroid is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Elektroid is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Elektroid. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BACKUP_H
+#define BACKUP_H
+
+#include "connector.h"
+
+#define BACKUP_MANIFEST ".elektroid-backup.json"
+#define BACKUP_OBJECTS_DIR ".objects"
+#define BACKUP_ENV_OBJECTS_DIR "ELEKTROID_BACKUP_OBJECTS"
+
+//Every backed up file is stored once in the objects directory and linked from the backup directory.
+//Objects are named after the device hash and the size if the filesystem provides the hash or after the SHA-256 of the file otherwise.
+struct backup_entry
+{
+  gchar *name;
+  gint64 size;
+  gint64 hash;
+  gchar *file;			//Relative to the backup directory.
+  gchar *object;		//Relative to the objects directory.
+};
+
+struct backup
+{
+  gchar *dir;
+  gchar *objects_dir;
+  gchar *prefix;		//Used in the names of the objects identified by device hashes.
+  GHashTable *manifest;		//Device path to struct backup_entry from the previous backup.
+  GHashTable *entries;		//Device path to struct backup_entry from this backup.
+  guint unchanged;
+  guint downloaded;
+  guint stored;
+};
+
+//The objects directory is shared among backups if set in the BACKUP_ENV_OBJECTS_DIR environment variable.
+gint backup_init (struct backup *backup, const gchar * dir,
+		  const gchar * prefix);
+
+//If the item is the same as in the previous backup, its file is restored if needed and TRUE is returned.
+//Items without device hash always return FALSE as only their content tells if they have changed.
+gboolean backup_keep_unchanged (struct backup *backup, const gchar * path,
+				const struct item *item);
+
+//Moves the already saved file to the objects directory or deduplicates it and links it back.
+//Items without device hash whose content is the same as in the previous backup are counted as unchanged.
+gint backup_add (struct backup *backup, const gchar * path,
+		 const struct item *item, const gchar * file);
+
+//Items removed from the device are only removed from the manifest if the backup is complete.
+gint backup_save (struct backup *backup, gboolean complete);
+
+void backup_free (struct backup *backup);
+
+#endif
@@ -30,6 +30,8 @@
 #include "preferences.h"
 #include "progress_window.h"
 #include "sample.h"
+#include "sample_index.h"
+#include "slot_cache.h"
 #include "maction.h"
 #include "utils.h"
 
@@ -49,6 +51,10 @@
 #define SEARCH_TEMPO_DIFF 10
 #define SEARCH_PARAM_UNSET -1
 #define SEARCH_PARAM_NOTE_NOT_FOUND -2
+#define BROWSER_SEARCH_DELAY_MS 250
+#define BROWSER_ROWS_CHUNK_LEN 256
+#define BROWSER_ROWS_STRINGS_LEN (BROWSER_ROWS_CHUNK_LEN * 32)
+#define BROWSER_ROWS_BUDGET_US 8000	//Half a frame at 60 Hz
 
 // ITEM_TYPE_DIR do not have an initialized sample_info.
 #define ITEM_HAS_SAMPLE_INFO(i,b) ((i)->type == ITEM_TYPE_FILE && \
@@ -107,12 +113,25 @@ static struct backend backend;
 
 static GtkListStore *notes_list_store;
 
-struct browser_add_dentry_item_data
+//Compact version of struct item used to insert the rows into the list store.
+//The strings are stored in the chunk the row belongs to.
+struct browser_row
+{
+  enum item_type type;
+  gint32 id;
+  gint64 size;
+  const gchar *rel_path;
+  const gchar *object_info;
+  const gchar *slot;
+  struct sample_info sample_info;	//Only initialized if ITEM_HAS_SAMPLE_INFO
+};
+
+struct browser_rows
 {
-  struct browser *browser;
-  struct item item;
   const gchar *icon;
-  gchar *rel_path;
+  GArray *rows;
+  GStringChunk *strings;
+  guint next;			//Next row to be inserted
 };
 
 static void
@@ -149,12 +168,16 @@ void
 browser_set_item (GtkTreeModel *model, GtkTreeIter *iter, struct item *item)
 {
   gchar *name;
+  item_init (item);
   gtk_tree_model_get (model, iter, BROWSER_LIST_STORE_TYPE_FIELD, &item->type,
 		      BROWSER_LIST_STORE_NAME_FIELD, &name,
 		      BROWSER_LIST_STORE_SIZE_FIELD, &item->size,
 		      BROWSER_LIST_STORE_ID_FIELD, &item->id, -1);
-  item_set_name (item, name);
-  g_free (name);
+  //The item takes the ownership of the name.
+  if (name)
+    {
+      item->name = name;
+    }
 }
 
 static gint
@@ -181,6 +204,9 @@ browser_sort_by_name (GtkTreeModel *model,
       ret = itema.type > itemb.type;
     }
 
+  item_clear (&itema);
+  item_clear (&itemb);
+
   return ret;
 }
 
@@ -188,23 +214,26 @@ static gint
 browser_sort_by_size (GtkTreeModel *model,
 		      GtkTreeIter *a, GtkTreeIter *b, gpointer data)
 {
-  struct item itema;
-  struct item itemb;
+  gint64 sizea, sizeb;
+  enum item_type typea, typeb;
 
-  browser_set_item (model, a, &itema);
-  browser_set_item (model, b, &itemb);
+  //Names are not needed.
+  gtk_tree_model_get (model, a, BROWSER_LIST_STORE_TYPE_FIELD, &typea,
+		      BROWSER_LIST_STORE_SIZE_FIELD, &sizea, -1);
+  gtk_tree_model_get (model, b, BROWSER_LIST_STORE_TYPE_FIELD, &typeb,
+		      BROWSER_LIST_STORE_SIZE_FIELD, &sizeb, -1);
 
-  if (itema.type == itemb.type)
+  if (typea == typeb)
     {
-      if (itema.size < itemb.size)
+      if (sizea < sizeb)
 	return -1;
-      if (itema.size > itemb.size)
+      if (sizea > sizeb)
 	return 1;
       return 0;
     }
   else
     {
-      return itema.type > itemb.type;
+      return typea > typeb;
     }
 }
 
@@ -279,12 +308,12 @@ browser_check_selection (gpointer data)
     {
       browser->last_selected_index = index;
       editor_reset (browser);
-      return;
+      goto end;
     }
 
   if (index == browser->last_selected_index)
     {
-      return;
+      goto end;
     }
 
   browser->last_selected_index = index;
@@ -299,12 +328,14 @@ browser_check_selection (gpointer data)
       editor_start_load_thread (sample_path);
     }
 
-  if (!sel_impl)
+  if (sel_impl)
     {
-      return;
+      remote_browser.fs_ops->select_item (browser->backend, browser->dir,
+					  &item);
     }
 
-  remote_browser.fs_ops->select_item (browser->backend, browser->dir, &item);
+end:
+  item_clear (&item);
 }
 
 static void
@@ -403,6 +434,7 @@ browser_set_popup_sensitivity (struct browser *browser)
       browser_set_selected_row_iter (browser, &iter);
       browser_set_item (model, &iter, &item);
       file = item.type == ITEM_TYPE_FILE;
+      item_clear (&item);
     }
 
   if (browser == &local_browser)
@@ -461,6 +493,8 @@ browser_refresh (GtkWidget *object, gpointer data)
 {
   struct browser *browser = data;
   g_hash_table_remove_all (browser->folder_size_cache);
+  //This is the only way to get the changes made directly on the device.
+  slot_cache_invalidate_dir (browser->backend, browser->fs_ops, browser->dir);
   browser_load_dir (browser);
 }
 
@@ -515,6 +549,8 @@ browser_remote_set_fs_operations (const struct fs_operations *fs_ops)
 {
   gboolean editor_visible;
 
+  browser_stop_info_loader (&remote_browser);
+
   if (fs_ops)
     {
       editor_visible =
@@ -687,6 +723,7 @@ browser_get_name_path (struct browser *browser, const gchar *name)
 static gchar *
 browser_get_selected_item_path (struct browser *browser)
 {
+  gchar *path;
   GtkTreeIter iter;
   struct item item;
   GtkTreeModel *model;
@@ -694,8 +731,10 @@ browser_get_selected_item_path (struct browser *browser)
   browser_set_selected_row_iter (browser, &iter);
   model = GTK_TREE_MODEL (gtk_tree_view_get_model (browser->view));
   browser_set_item (model, &iter, &item);
+  path = browser_get_item_path (browser, &item);
+  item_clear (&item);
 
-  return browser_get_item_path (browser, &item);
+  return path;
 }
 
 static void
@@ -709,6 +748,7 @@ browser_rename_accept (gpointer source, const gchar *name)
   new_path = browser_get_name_path (browser, name);
 
   err = browser->fs_ops->rename (browser->backend, old_path, new_path);
+  slot_cache_invalidate (browser->backend, browser->fs_ops, old_path);
   if (err)
     {
       elektroid_show_error_msg (_("Error while renaming to “%s”: %s."),
@@ -748,6 +788,8 @@ browser_rename_item (GtkWidget *object, gpointer data)
   name_window_edit_text (_("Rename"),
 			 browser->fs_ops->max_name_len, item.name, 0,
 			 sel_len, browser_rename_accept, browser);
+
+  item_clear (&item);
 }
 
 static void
@@ -772,6 +814,8 @@ browser_item_activated (GtkTreeView *view, GtkTreePath *path,
       browser_save_preferences_dir (browser);
       browser_close_search (NULL, browser);	//This triggers a refresh
     }
+
+  item_clear (&item);
 }
 
 static void
@@ -792,6 +836,15 @@ item_sample_info_clear (struct item *item, struct browser *browser)
     }
 }
 
+static void
+browser_row_clear (struct browser_row *row, struct browser *browser)
+{
+  if (ITEM_HAS_SAMPLE_INFO (row, browser))
+    {
+      sample_info_clear (&row->sample_info);
+    }
+}
+
 static gchar *
 browser_get_tags (const struct sample_info *sample_info)
 {
@@ -886,190 +939,773 @@ browser_get_note_num (const gchar *any)
   return num;
 }
 
-static gint
-browser_add_dentry_item (gpointer data)
+static void
+browser_set_row_sample_info (GtkListStore *list_store, GtkTreeIter *iter,
+			     const struct sample_info *sample_info)
 {
-  gchar *hsize;
   gdouble time;
-  gchar *name;
   gchar label[LABEL_MAX];
+  GValue v = G_VALUE_INIT;
+
+  snprintf (label, LABEL_MAX, "%u", sample_info->frames);
+  g_value_init (&v, G_TYPE_STRING);
+  g_value_set_string (&v, label);
+  gtk_list_store_set_value (list_store, iter,
+			    BROWSER_LIST_STORE_SAMPLE_FRAMES_FIELD, &v);
+  g_value_unset (&v);
+
+  snprintf (label, LABEL_MAX, "%.5g kHz", sample_info->rate / 1000.0);
+  g_value_init (&v, G_TYPE_STRING);
+  g_value_set_string (&v, label);
+  gtk_list_store_set_value (list_store, iter,
+			    BROWSER_LIST_STORE_SAMPLE_RATE_FIELD, &v);
+  g_value_unset (&v);
+
+  time = sample_info->frames / (gdouble) sample_info->rate;
+  if (time >= 60)
+    {
+      snprintf (label, LABEL_MAX, "%.4g %s", time / 60.0, _("min."));
+    }
+  else
+    {
+      snprintf (label, LABEL_MAX, "%.3g s", time);
+    }
+  g_value_init (&v, G_TYPE_STRING);
+  g_value_set_string (&v, label);
+  gtk_list_store_set_value (list_store, iter,
+			    BROWSER_LIST_STORE_SAMPLE_TIME_FIELD, &v);
+  g_value_unset (&v);
+
+  snprintf (label, LABEL_MAX, "%s, %s", sample_get_format (sample_info),
+	    sample_get_subtype (sample_info));
+  g_value_init (&v, G_TYPE_STRING);
+  g_value_set_string (&v, label);
+  gtk_list_store_set_value (list_store, iter,
+			    BROWSER_LIST_STORE_SAMPLE_FORMAT_FIELD, &v);
+  g_value_unset (&v);
+
+  snprintf (label, LABEL_MAX, "%u", sample_info->channels);
+  g_value_init (&v, G_TYPE_STRING);
+  g_value_set_string (&v, label);
+  gtk_list_store_set_value (list_store, iter,
+			    BROWSER_LIST_STORE_SAMPLE_CHANNELS_FIELD, &v);
+  g_value_unset (&v);
+
+  if (sample_info->midi_note <= 127)
+    {
+      browser_get_note_name (sample_info->midi_note, &v);
+    }
+  else
+    {
+      g_value_init (&v, G_TYPE_STRING);
+      g_value_set_string (&v, "-");
+    }
+  if (sample_info->midi_fraction)
+    {
+      gchar note[LABEL_MAX];
+      snprintf (note, LABEL_MAX, "%s +%d %s", g_value_get_string (&v),
+		midi_fraction_to_cents (sample_info->midi_fraction), _("cents"));
+      g_value_unset (&v);
+      g_value_init (&v, G_TYPE_STRING);
+      g_value_set_string (&v, note);
+    }
+  gtk_list_store_set_value (list_store, iter,
+			    BROWSER_LIST_STORE_SAMPLE_NOTE_FIELD, &v);
+  g_value_unset (&v);
+
+  gchar *tags = browser_get_tags (sample_info);
+  if (tags)
+    {
+      g_value_init (&v, G_TYPE_STRING);
+      g_value_set_string (&v, tags);
+      gtk_list_store_set_value (list_store, iter,
+				BROWSER_LIST_STORE_SAMPLE_TAGS_FIELD, &v);
+      g_value_unset (&v);
+      g_free (tags);
+    }
+}
+
+static void
+browser_add_row (struct browser *browser, GtkListStore *list_store,
+		 GtkTreeSelection *selection, const gchar *icon,
+		 struct browser_row *row)
+{
+  gchar *hsize;
+  gchar *name;
   GtkTreeIter iter;
-  struct browser_add_dentry_item_data *add_data = data;
-  struct browser *browser = add_data->browser;
-  struct item *item = &add_data->item;
   GValue v = G_VALUE_INIT;
+
+  hsize = get_human_size (row->size, TRUE);
+
+  gtk_list_store_insert_with_values (list_store, &iter, -1,
+				     BROWSER_LIST_STORE_ICON_FIELD,
+				     row->type ==
+				     ITEM_TYPE_DIR ? DIR_ICON : icon,
+				     BROWSER_LIST_STORE_NAME_FIELD,
+				     row->rel_path,
+				     BROWSER_LIST_STORE_SIZE_FIELD,
+				     row->size,
+				     BROWSER_LIST_STORE_SIZE_STR_FIELD,
+				     hsize,
+				     BROWSER_LIST_STORE_TYPE_FIELD,
+				     row->type,
+				     BROWSER_LIST_STORE_ID_FIELD,
+				     row->id, -1);
+  g_free (hsize);
+
+  if (row->slot)
+    {
+      g_value_init (&v, G_TYPE_STRING);
+      g_value_set_static_string (&v, row->slot);
+      gtk_list_store_set_value (list_store, &iter,
+				BROWSER_LIST_STORE_SLOT_FIELD, &v);
+      g_value_unset (&v);
+    }
+
+  if (ITEM_HAS_SAMPLE_INFO (row, browser) && row->sample_info.frames)
+    {
+      browser_set_row_sample_info (list_store, &iter, &row->sample_info);
+    }
+
+  if (row->object_info)
+    {
+      g_value_init (&v, G_TYPE_STRING);
+      g_value_set_static_string (&v, row->object_info);
+      gtk_list_store_set_value (list_store, &iter,
+				BROWSER_LIST_STORE_INFO_FIELD, &v);
+      g_value_unset (&v);
+    }
+
+  if (audio.path && editor_get_browser () == browser)
+    {
+      // The reload might be triggered from the GUI, some user action (i.e. saving) or by the notifier.
+      name = path_chain (PATH_SYSTEM, browser->dir, row->rel_path);
+      if (!strcmp (audio.path, name))
+	{
+	  if (!browser->reload_item_in_editor)
+	    {
+	      g_signal_handlers_block_by_func (selection,
+					       G_CALLBACK
+					       (browser_selection_changed),
+					       browser);
+	    }
+	  gtk_tree_selection_select_iter (selection, &iter);	// item selection and sample reload
+	  if (!browser->reload_item_in_editor)
+	    {
+	      g_signal_handlers_unblock_by_func (selection,
+						 G_CALLBACK
+						 (browser_selection_changed),
+						 browser);
+	    }
+	}
+      g_free (name);
+    }
+
+  browser_row_clear (row, browser);
+}
+
+static void
+browser_free_rows (struct browser_rows *rows, struct browser *browser)
+{
+  for (guint i = rows->next; i < rows->rows->len; i++)
+    {
+      browser_row_clear (&g_array_index (rows->rows, struct browser_row, i),
+			 browser);
+    }
+
+  g_array_free (rows->rows, TRUE);
+  g_string_chunk_free (rows->strings);
+  g_free (rows);
+}
+
+static void
+browser_clear_pending_rows (struct browser *browser)
+{
+  struct browser_rows *rows;
+
+  g_mutex_lock (&browser->mutex);
+  while ((rows = g_queue_pop_head (browser->pending_rows)))
+    {
+      browser_free_rows (rows, browser);
+    }
+  g_mutex_unlock (&browser->mutex);
+}
+
+//Sorting is disabled while the rows are being inserted as sorting after every insertion is too expensive.
+
+static void
+browser_disable_sorting (struct browser *browser)
+{
+  GtkTreeSortable *sortable =
+    GTK_TREE_SORTABLE (gtk_tree_view_get_model (browser->view));
+
+  if (browser->sort_disabled)
+    {
+      return;
+    }
+
+  if (gtk_tree_sortable_get_sort_column_id (sortable, &browser->sort_column,
+					    &browser->sort_order))
+    {
+      gtk_tree_sortable_set_sort_column_id (sortable,
+					    GTK_TREE_SORTABLE_UNSORTED_SORT_COLUMN_ID,
+					    browser->sort_order);
+      browser->sort_disabled = TRUE;
+    }
+}
+
+static void
+browser_enable_sorting (struct browser *browser)
+{
+  GtkTreeSortable *sortable =
+    GTK_TREE_SORTABLE (gtk_tree_view_get_model (browser->view));
+
+  if (browser->sort_disabled)
+    {
+      gtk_tree_sortable_set_sort_column_id (sortable, browser->sort_column,
+					    browser->sort_order);
+      browser->sort_disabled = FALSE;
+    }
+}
+
+//Rows are inserted in a single source that yields to the main loop once the frame budget is exhausted.
+
+static gboolean
+browser_add_pending_rows (gpointer data)
+{
+  gboolean loading;
+  struct browser_row *row;
+  struct browser_rows *rows;
+  struct browser *browser = data;
   GtkListStore *list_store =
     GTK_LIST_STORE (gtk_tree_view_get_model (browser->view));
   GtkTreeSelection *selection =
     gtk_tree_view_get_selection (GTK_TREE_VIEW (browser->view));
+  gint64 end = g_get_monotonic_time () + BROWSER_ROWS_BUDGET_US;
 
+  g_mutex_lock (&browser->mutex);
+  loading = browser->loading;
+  g_mutex_unlock (&browser->mutex);
+
+  //Rows from a cancelled load are never shown.
+  if (!loading)
+    {
+      browser_clear_pending_rows (browser);
+    }
+  else
+    {
+      browser_disable_sorting (browser);
+    }
+
+  while (1)
+    {
+      g_mutex_lock (&browser->mutex);
+      rows = g_queue_peek_head (browser->pending_rows);
+      if (!rows)
+	{
+	  browser->rows_source = 0;
+	  g_mutex_unlock (&browser->mutex);
+	  return G_SOURCE_REMOVE;
+	}
+      g_mutex_unlock (&browser->mutex);
+
+      while (rows->next < rows->rows->len)
+	{
+	  row = &g_array_index (rows->rows, struct browser_row, rows->next);
+	  browser_add_row (browser, list_store, selection, rows->icon, row);
+	  rows->next++;
+
+	  if (g_get_monotonic_time () >= end)
+	    {
+	      return G_SOURCE_CONTINUE;
+	    }
+	}
+
+      g_mutex_lock (&browser->mutex);
+      g_queue_pop_head (browser->pending_rows);
+      g_mutex_unlock (&browser->mutex);
+
+      browser_free_rows (rows, browser);
+    }
+}
+
+//Called from the loader thread.
+
+static void
+browser_flush_rows (struct browser *browser)
+{
+  struct browser_rows *rows = browser->rows;
+
+  if (!rows)
+    {
+      return;
+    }
+
+  browser->rows = NULL;
+
+  g_mutex_lock (&browser->mutex);
+  g_queue_push_tail (browser->pending_rows, rows);
+  if (!browser->rows_source)
+    {
+      browser->rows_source = g_idle_add (browser_add_pending_rows, browser);
+    }
+  g_mutex_unlock (&browser->mutex);
+}
+
+//The object info that filesystems can not provide quickly while listing is loaded in the background once the listing is shown.
+//The same applies to the placeholders listed with readdir_ids, which are completed with load_item.
+//The visible rows are loaded first and every row is updated as soon as its data is available.
+
+struct browser_info_job
+{
+  gchar *path;
+  struct item *item;
+  GtkTreeRowReference *row;
+  gboolean load_item;
+};
+
+//A stopped loader finishes its current job in the background and it is freed from the main loop.
+struct browser_info_loader
+{
+  struct browser *browser;
+  struct backend *backend;
+  const struct fs_operations *fs_ops;
+  GThread *thread;
+  struct controllable control;
+  GQueue *jobs;			//Jobs not taken by the thread yet. Accessed with the browser mutex.
+  GList *done;			//Jobs taken by the thread. Only freed when the thread has finished.
+};
+
+struct browser_info_update
+{
+  struct browser *browser;
+  GtkTreeRowReference *row;
+  struct item *item;
+  gboolean load_item;
+};
+
+static void
+browser_free_item (gpointer data)
+{
+  struct item *item = data;
+  item_clear (item);
+  g_free (item);
+}
+
+static void
+browser_info_job_free (gpointer data)
+{
+  struct browser_info_job *job = data;
+  g_free (job->path);
+  if (job->item)
+    {
+      browser_free_item (job->item);
+    }
+  if (job->row)
+    {
+      gtk_tree_row_reference_free (job->row);
+    }
+  g_free (job);
+}
+
+static gint
+browser_compare_item_ids (gconstpointer a, gconstpointer b)
+{
+  const struct item *itema = a;
+  const struct item *itemb = b;
+  return itema->id - itemb->id;
+}
+
+//Called once every placeholder has been completed.
+
+static void
+browser_save_loaded_items (struct browser *browser)
+{
+  GList *items = g_hash_table_get_values (browser->loaded_items);
+
+  debug_print (1, "All the %d placeholders loaded",
+	       g_hash_table_size (browser->loaded_items));
+
+  items = g_list_sort (items, browser_compare_item_ids);
+  slot_cache_set_dir (browser->backend, browser->fs_ops, browser->dir,
+		      items, browser->slot_cache_generation);
+  g_list_free (items);
+}
+
+static void
+browser_set_row_item (struct browser *browser, GtkListStore *list_store,
+		      GtkTreeIter *iter, struct item *item)
+{
+  gchar *hsize = get_human_size (item->size, TRUE);
+
+  gtk_list_store_set (list_store, iter, BROWSER_LIST_STORE_NAME_FIELD,
+		      item->name, BROWSER_LIST_STORE_SIZE_FIELD, item->size,
+		      BROWSER_LIST_STORE_SIZE_STR_FIELD, hsize, -1);
+  g_free (hsize);
+
+  if (ITEM_HAS_SAMPLE_INFO (item, browser) && item->sample_info.frames)
+    {
+      browser_set_row_sample_info (list_store, iter, &item->sample_info);
+    }
+}
+
+static gboolean
+browser_set_row_info (gpointer data)
+{
+  gint rows;
+  GtkTreeIter iter;
+  GtkTreePath *path;
+  GtkTreeModel *model;
+  struct browser_info_update *update = data;
+  struct browser *browser = update->browser;
+
+  //Rows from a previous listing are not valid anymore.
+  if (gtk_tree_row_reference_valid (update->row))
+    {
+      model = gtk_tree_row_reference_get_model (update->row);
+      path = gtk_tree_row_reference_get_path (update->row);
+      if (gtk_tree_model_get_iter (model, &iter, path))
+	{
+	  if (update->load_item)
+	    {
+	      browser_set_row_item (browser, GTK_LIST_STORE (model), &iter,
+				    update->item);
+	      //The item ownership is transferred to the table.
+	      g_hash_table_insert (browser->loaded_items,
+				   GINT_TO_POINTER (update->item->id),
+				   update->item);
+	      update->item = NULL;
+
+	      rows = gtk_tree_model_iter_n_children (model, NULL);
+	      if (g_hash_table_size (browser->loaded_items) == rows)
+		{
+		  browser_save_loaded_items (browser);
+		}
+	    }
+	  else
+	    {
+	      gtk_list_store_set (GTK_LIST_STORE (model), &iter,
+				  BROWSER_LIST_STORE_INFO_FIELD,
+				  update->item->object_info, -1);
+	    }
+	}
+      gtk_tree_path_free (path);
+    }
+
+  gtk_tree_row_reference_free (update->row);
+  if (update->item)
+    {
+      browser_free_item (update->item);
+    }
+  g_free (update);
+
+  return FALSE;
+}
+
+static gboolean
+browser_info_loader_free (gpointer data)
+{
+  struct browser_info_loader *loader = data;
+  struct browser *browser = loader->browser;
+
+  //The thread has already finished its last job so this does not block.
+  g_thread_join (loader->thread);
+
+  if (browser->info_loader == loader)
+    {
+      browser->info_loader = NULL;
+    }
+  browser->info_loaders--;
+
+  g_queue_free_full (loader->jobs, browser_info_job_free);
+  g_list_free_full (loader->done, browser_info_job_free);
+  controllable_clear (&loader->control);
+  g_free (loader);
+
+  return FALSE;
+}
+
+static gpointer
+browser_info_loader_runner (gpointer data)
+{
+  gint err;
+  struct browser_info_job *job;
+  struct browser_info_update *update;
+  struct browser_info_loader *loader = data;
+  struct browser *browser = loader->browser;
+
+  while (controllable_is_active (&loader->control))
+    {
+      //Taken jobs are freed by the main thread once this one has finished.
+      g_mutex_lock (&browser->mutex);
+      job = g_queue_pop_head (loader->jobs);
+      if (job)
+	{
+	  loader->done = g_list_prepend (loader->done, job);
+	}
+      g_mutex_unlock (&browser->mutex);
+
+      if (!job)
+	{
+	  break;
+	}
+
+      if (job->load_item)
+	{
+	  err = loader->fs_ops->load_item (loader->backend, job->path,
+					   job->item);
+	}
+      else
+	{
+	  err = loader->fs_ops->load_object_info (loader->backend,
+						  job->path, job->item);
+	}
+      if (err)
+	{
+	  continue;
+	}
+
+      //The row reference and the item are transferred to the update.
+      update = g_malloc (sizeof (struct browser_info_update));
+      update->browser = browser;
+      update->row = job->row;
+      update->item = job->item;
+      update->load_item = job->load_item;
+      job->row = NULL;
+      job->item = NULL;
+      g_idle_add (browser_set_row_info, update);
+    }
+
+  debug_print (1, "Object info loading stopped");
+
+  g_idle_add (browser_info_loader_free, loader);
+
+  return NULL;
+}
+
+static gboolean
+browser_get_visible_range (struct browser *browser, gint *first, gint *last)
+{
+  GtkTreePath *start, *end;
+
+  if (!gtk_tree_view_get_visible_range (browser->view, &start, &end))
+    {
+      return FALSE;
+    }
+
+  *first = gtk_tree_path_get_indices (start)[0];
+  *last = gtk_tree_path_get_indices (end)[0];
+  gtk_tree_path_free (start);
+  gtk_tree_path_free (end);
+
+  return TRUE;
+}
+
+static gint
+browser_info_job_get_index (struct browser_info_job *job)
+{
+  gint index;
+  GtkTreePath *path = gtk_tree_row_reference_get_path (job->row);
+
+  if (!path)
+    {
+      return -1;
+    }
+
+  index = gtk_tree_path_get_indices (path)[0];
+  gtk_tree_path_free (path);
+
+  return index;
+}
+
+//The rows that scroll into view are moved to the front of the queue so that they are loaded next.
+
+static void
+browser_info_loader_scroll (GtkAdjustment *adjustment, gpointer data)
+{
+  gint first, last, index;
+  GList *e, *next;
+  GQueue visible = G_QUEUE_INIT;
+  struct browser *browser = data;
+  struct browser_info_loader *loader = browser->info_loader;
 
-  hsize = get_human_size (item->size, TRUE);
+  if (!loader || !browser_get_visible_range (browser, &first, &last))
+    {
+      return;
+    }
 
-  gtk_list_store_insert_with_values (list_store, &iter, -1,
-				     BROWSER_LIST_STORE_ICON_FIELD,
-				     item->type ==
-				     ITEM_TYPE_DIR ? DIR_ICON :
-				     add_data->icon,
-				     BROWSER_LIST_STORE_NAME_FIELD,
-				     add_data->rel_path,
-				     BROWSER_LIST_STORE_SIZE_FIELD,
-				     item->size,
-				     BROWSER_LIST_STORE_SIZE_STR_FIELD,
-				     hsize,
-				     BROWSER_LIST_STORE_TYPE_FIELD,
-				     item->type,
-				     BROWSER_LIST_STORE_ID_FIELD,
-				     item->id, -1);
-  g_free (hsize);
+  g_mutex_lock (&browser->mutex);
 
-  if (browser->fs_ops->options & FS_OPTION_SHOW_SLOT_COLUMN)
+  for (e = loader->jobs->head; e; e = next)
     {
-      gchar *s;
-
-      if (browser->fs_ops->get_slot)
+      next = e->next;
+      index = browser_info_job_get_index (e->data);
+      if (index >= first && index <= last)
 	{
-	  s = browser->fs_ops->get_slot (item, browser->backend);
+	  g_queue_unlink (loader->jobs, e);
+	  g_queue_push_tail_link (&visible, e);
 	}
-      else
-	{
-	  s = common_get_id_as_slot (item, browser->backend);
-	}
-
-      g_value_init (&v, G_TYPE_STRING);
-      g_value_set_string (&v, s);
-      gtk_list_store_set_value (list_store, &iter,
-				BROWSER_LIST_STORE_SLOT_FIELD, &v);
-      g_free (s);
-      g_value_unset (&v);
     }
 
-  if (item->type == ITEM_TYPE_FILE &&
-      item->sample_info.frames &&
-      browser->fs_ops->options & FS_OPTION_SHOW_SAMPLE_COLUMNS)
+  while ((e = g_queue_pop_tail_link (&visible)))
     {
-      snprintf (label, LABEL_MAX, "%u", item->sample_info.frames);
-      g_value_init (&v, G_TYPE_STRING);
-      g_value_set_string (&v, label);
-      gtk_list_store_set_value (list_store, &iter,
-				BROWSER_LIST_STORE_SAMPLE_FRAMES_FIELD, &v);
-      g_value_unset (&v);
+      g_queue_push_head_link (loader->jobs, e);
+    }
 
-      snprintf (label, LABEL_MAX, "%.5g kHz",
-		item->sample_info.rate / 1000.0);
-      g_value_init (&v, G_TYPE_STRING);
-      g_value_set_string (&v, label);
-      gtk_list_store_set_value (list_store, &iter,
-				BROWSER_LIST_STORE_SAMPLE_RATE_FIELD, &v);
-      g_value_unset (&v);
+  g_mutex_unlock (&browser->mutex);
+}
 
-      time = item->sample_info.frames / (gdouble) item->sample_info.rate;
-      if (time >= 60)
-	{
-	  snprintf (label, LABEL_MAX, "%.4g %s", time / 60.0, _("min."));
-	}
-      else
-	{
-	  snprintf (label, LABEL_MAX, "%.3g s", time);
-	}
-      g_value_init (&v, G_TYPE_STRING);
-      g_value_set_string (&v, label);
-      gtk_list_store_set_value (list_store, &iter,
-				BROWSER_LIST_STORE_SAMPLE_TIME_FIELD, &v);
-      g_value_unset (&v);
+void
+browser_start_info_loader (struct browser *browser)
+{
+  gint index, first, last;
+  gboolean loading, placeholders, object_info, load;
+  GtkTreeIter iter;
+  GtkTreePath *path;
+  GList *below = NULL, *above = NULL;
+  struct browser_info_job *job;
+  struct browser_info_loader *loader;
+  GtkTreeModel *model = GTK_TREE_MODEL (gtk_tree_view_get_model
+					(browser->view));
 
-      snprintf (label, LABEL_MAX, "%s, %s",
-		sample_get_format (&item->sample_info),
-		sample_get_subtype (&item->sample_info));
-      g_value_init (&v, G_TYPE_STRING);
-      g_value_set_string (&v, label);
-      gtk_list_store_set_value (list_store, &iter,
-				BROWSER_LIST_STORE_SAMPLE_FORMAT_FIELD, &v);
-      g_value_unset (&v);
+  browser_stop_info_loader (browser);
 
-      snprintf (label, LABEL_MAX, "%u", item->sample_info.channels);
-      g_value_init (&v, G_TYPE_STRING);
-      g_value_set_string (&v, label);
-      gtk_list_store_set_value (list_store, &iter,
-				BROWSER_LIST_STORE_SAMPLE_CHANNELS_FIELD, &v);
-      g_value_unset (&v);
+  if (!browser->fs_ops)
+    {
+      return;
+    }
 
-      if (item->sample_info.midi_note <= 127)
-	{
-	  browser_get_note_name (item->sample_info.midi_note, &v);
-	}
-      else
-	{
-	  g_value_init (&v, G_TYPE_STRING);
-	  g_value_set_string (&v, "-");
-	}
-      if (item->sample_info.midi_fraction)
-	{
-	  gchar note[LABEL_MAX];
-	  snprintf (note, LABEL_MAX, "%s +%d %s", g_value_get_string (&v),
-		    midi_fraction_to_cents (item->sample_info.midi_fraction),
-		    _("cents"));
-	  g_value_unset (&v);
-	  g_value_init (&v, G_TYPE_STRING);
-	  g_value_set_string (&v, note);
-	}
-      gtk_list_store_set_value (list_store, &iter,
-				BROWSER_LIST_STORE_SAMPLE_NOTE_FIELD, &v);
-      g_value_unset (&v);
+  //It will be started again once the listing is loaded.
+  g_mutex_lock (&browser->mutex);
+  loading = browser->loading;
+  placeholders = browser->placeholders;
+  g_mutex_unlock (&browser->mutex);
+  if (loading)
+    {
+      return;
+    }
 
-      gchar *tags = browser_get_tags (&item->sample_info);
-      if (tags)
-	{
-	  g_value_init (&v, G_TYPE_STRING);
-	  g_value_set_string (&v, tags);
-	  gtk_list_store_set_value (list_store, &iter,
-				    BROWSER_LIST_STORE_SAMPLE_TAGS_FIELD, &v);
-	  g_value_unset (&v);
-	  g_free (tags);
-	}
+  placeholders = placeholders && browser->fs_ops->load_item;
+  object_info = browser->fs_ops->load_object_info &&
+    (browser->fs_ops->options & FS_OPTION_SHOW_INFO_COLUMN);
+  if (!placeholders && !object_info)
+    {
+      return;
     }
 
-  if (item->type == ITEM_TYPE_FILE &&
-      browser->fs_ops->options & FS_OPTION_SHOW_INFO_COLUMN)
+  if (!browser_get_visible_range (browser, &first, &last))
     {
-      g_value_init (&v, G_TYPE_STRING);
-      g_value_set_string (&v, item->object_info);
-      gtk_list_store_set_value (list_store, &iter,
-				BROWSER_LIST_STORE_INFO_FIELD, &v);
-      g_value_unset (&v);
+      first = 0;
     }
 
-  if (audio.path && editor_get_browser () == browser)
+  index = 0;
+  if (gtk_tree_model_get_iter_first (model, &iter))
     {
-      // The reload might be triggered from the GUI, some user action (i.e. saving) or by the notifier.
-      name = path_chain (PATH_SYSTEM, browser->dir, add_data->rel_path);
-      if (!strcmp (audio.path, name))
+      do
 	{
-	  if (!browser->reload_item_in_editor)
+	  job = g_malloc (sizeof (struct browser_info_job));
+	  job->item = g_malloc (sizeof (struct item));
+	  browser_set_item (model, &iter, job->item);
+	  sample_info_init (&job->item->sample_info);
+
+	  job->load_item = FALSE;
+	  if (job->item->type != ITEM_TYPE_FILE)
 	    {
-	      g_signal_handlers_block_by_func (selection,
-					       G_CALLBACK
-					       (browser_selection_changed),
-					       browser);
+	      load = FALSE;
 	    }
-	  gtk_tree_selection_select_iter (selection, &iter);	// item selection and sample reload
-	  if (!browser->reload_item_in_editor)
+	  else if (placeholders &&
+		   !g_hash_table_contains (browser->loaded_items,
+					   GINT_TO_POINTER (job->item->id)))
 	    {
-	      g_signal_handlers_unblock_by_func (selection,
-						 G_CALLBACK
-						 (browser_selection_changed),
-						 browser);
+	      job->load_item = TRUE;
+	      load = TRUE;
 	    }
+	  else
+	    {
+	      //The object info set while listing might come from a cache and need to be refreshed.
+	      load = object_info;
+	    }
+
+	  if (!load)
+	    {
+	      browser_free_item (job->item);
+	      g_free (job);
+	      index++;
+	      continue;
+	    }
+
+	  job->path = browser_get_item_path (browser, job->item);
+	  path = gtk_tree_model_get_path (model, &iter);
+	  job->row = gtk_tree_row_reference_new (model, path);
+	  gtk_tree_path_free (path);
+
+	  //The rows from the first visible one onwards go first. Lists are built reversed.
+	  if (index >= first)
+	    {
+	      below = g_list_prepend (below, job);
+	    }
+	  else
+	    {
+	      above = g_list_prepend (above, job);
+	    }
+	  index++;
 	}
-      g_free (name);
+      while (gtk_tree_model_iter_next (model, &iter));
     }
 
-  item_sample_info_clear (item, browser);
+  below = g_list_concat (g_list_reverse (below), g_list_reverse (above));
+  if (!below)
+    {
+      return;
+    }
 
-  g_free (add_data->rel_path);
-  g_free (add_data);
+  loader = g_malloc (sizeof (struct browser_info_loader));
+  loader->browser = browser;
+  loader->backend = browser->backend;
+  loader->fs_ops = browser->fs_ops;
+  loader->jobs = g_queue_new ();
+  loader->done = NULL;
+  controllable_init (&loader->control);
+  controllable_set_active (&loader->control, TRUE);
 
-  return G_SOURCE_REMOVE;
+  for (GList * e = below; e; e = e->next)
+    {
+      g_queue_push_tail (loader->jobs, e->data);
+    }
+  g_list_free (below);
+
+  debug_print (1, "Loading object info for %d items...",
+	       g_queue_get_length (loader->jobs));
+
+  browser->info_loader = loader;
+  browser->info_loaders++;
+  loader->thread = g_thread_new ("browser_info_thread",
+				 browser_info_loader_runner, loader);
+}
+
+//User operations take precedence over the object info loading so this must be called before any of them is started.
+//The loader is not joined here as a request in flight would block the main loop. The operations wait for the backend instead.
+
+void
+browser_stop_info_loader (struct browser *browser)
+{
+  if (browser->info_loader)
+    {
+      controllable_set_active (&browser->info_loader->control, FALSE);
+      browser->info_loader = NULL;
+    }
+}
+
+//This must be called before destroying the backend used by the loaders.
+
+void
+browser_wait_info_loaders (struct browser *browser)
+{
+  browser_stop_info_loader (browser);
+  while (browser->info_loaders)
+    {
+      gtk_main_iteration ();
+    }
 }
 
 static gboolean
@@ -1100,7 +1736,7 @@ browser_wait (struct browser *browser)
     {
       g_thread_join (browser->thread);
       browser->thread = NULL;
-      //Wait for every pending call to browser_add_dentry_item scheduled from the thread
+      //Wait for every pending row scheduled from the thread
       while (gtk_events_pending ())
 	{
 	  gtk_main_iteration ();
@@ -1118,6 +1754,7 @@ browser_load_dir_runner_update_ui (gpointer data)
   gboolean active = BROWSER_IS_SYSTEM (browser);
 
   browser_wait (browser);
+  browser_enable_sorting (browser);
 
   if (browser->check_callback)
     {
@@ -1181,6 +1818,10 @@ browser_load_dir_runner_update_ui (gpointer data)
       debug_print (1, "Processing pending requests...");
       browser_load_dir (browser);
     }
+  else
+    {
+      browser_start_info_loader (browser);
+    }
 
   return FALSE;
 }
@@ -1264,26 +1905,27 @@ browser_values_match_filter (struct browser_search_options *search_options,
   return matched;
 }
 
+//Called from the loader thread. The rows are accumulated and flushed to the main thread in chunks.
+
 static void
-browser_iterate_dir_add (struct browser *browser,
-			 struct item_iterator *iter,
-			 const gchar *icon, struct item *item,
-			 gchar *rel_path)
+browser_iterate_dir_add (struct browser *browser, const gchar *icon,
+			 struct item *item, gchar *rel_path)
 {
   const gchar *object_info;
   const struct sample_info *sample_info;
-  struct browser_add_dentry_item_data *data;
+  struct browser_row row;
+  gchar *slot;
 
   if (browser->search_options.ready)
     {
-      if (iter->item.type == ITEM_TYPE_FILE)
+      if (item->type == ITEM_TYPE_FILE)
 	{
 	  object_info =
 	    browser->fs_ops->options & FS_OPTION_SHOW_INFO_COLUMN ?
-	    iter->item.object_info : NULL;
+	    item->object_info : NULL;
 	  sample_info =
 	    browser->fs_ops->options & FS_OPTION_SAMPLE_EDITOR ?
-	    &iter->item.sample_info : NULL;
+	    &item->sample_info : NULL;
 	}
       else
 	{
@@ -1292,24 +1934,71 @@ browser_iterate_dir_add (struct browser *browser,
 	}
 
       if (!browser_values_match_filter (&browser->search_options,
-					iter->item.name, rel_path,
+					item->name, rel_path,
 					object_info, sample_info))
 	{
 	  goto cleanup;
 	}
     }
 
-  // Copy the whole item and increase the tags ref count.
-  data = g_malloc (sizeof (struct browser_add_dentry_item_data));
-  data->browser = browser;
-  memcpy (&data->item, &iter->item, sizeof (struct item));
-  item_sample_info_ref_tags (&iter->item, browser);
-  data->icon = icon;
-  data->rel_path = rel_path;
-  // Schedule the item addition.
-  g_idle_add (browser_add_dentry_item, data);
+  if (!browser->rows)
+    {
+      browser->rows = g_malloc (sizeof (struct browser_rows));
+      browser->rows->icon = icon;
+      browser->rows->rows = g_array_sized_new (FALSE, FALSE,
+					       sizeof (struct browser_row),
+					       BROWSER_ROWS_CHUNK_LEN);
+      browser->rows->strings = g_string_chunk_new (BROWSER_ROWS_STRINGS_LEN);
+      browser->rows->next = 0;
+    }
+
+  row.type = item->type;
+  row.id = item->id;
+  row.size = item->size;
+  row.rel_path = g_string_chunk_insert (browser->rows->strings, rel_path);
+
+  row.object_info = NULL;
+  if (item->type == ITEM_TYPE_FILE &&
+      browser->fs_ops->options & FS_OPTION_SHOW_INFO_COLUMN)
+    {
+      //Object info values are usually repeated.
+      row.object_info = g_string_chunk_insert_const (browser->rows->strings,
+						     item->object_info);
+    }
+
+  row.slot = NULL;
+  if (browser->fs_ops->options & FS_OPTION_SHOW_SLOT_COLUMN)
+    {
+      if (browser->fs_ops->get_slot)
+	{
+	  slot = browser->fs_ops->get_slot (item, browser->backend);
+	}
+      else
+	{
+	  slot = common_get_id_as_slot (item, browser->backend);
+	}
+      row.slot = g_string_chunk_insert (browser->rows->strings, slot);
+      g_free (slot);
+    }
+
+  // The tags ownership is transferred to the row.
+  if (ITEM_HAS_SAMPLE_INFO (item, browser))
+    {
+      memcpy (&row.sample_info, &item->sample_info,
+	      sizeof (struct sample_info));
+      item->sample_info.tags = NULL;
+    }
+
+  g_array_append_val (browser->rows->rows, row);
+
+  if (browser->rows->rows->len == BROWSER_ROWS_CHUNK_LEN)
+    {
+      browser_flush_rows (browser);
+    }
+
 cleanup:
-  item_sample_info_clear (&iter->item, browser);
+  item_sample_info_clear (item, browser);
+  g_free (rel_path);
 }
 
 static gint64
@@ -1321,8 +2010,8 @@ browser_sum_dir_size (struct browser *browser, const gchar *dir,
   struct item_iterator child_iter;
   enum path_type type = backend_get_path_type (browser->backend);
 
-  if (browser->fs_ops->readdir (browser->backend, &child_iter, dir,
-				extensions))
+  if (slot_cache_readdir (browser->backend, browser->fs_ops, &child_iter, dir,
+			  extensions))
     return 0;
 
   while (!item_iterator_next (&child_iter))
@@ -1397,7 +2086,7 @@ browser_iterate_dir (struct browser *browser, struct item_iterator *iter,
 	  browser_dir_set_item_dir_size (browser, NULL, &iter->item);
 	}
 
-      browser_iterate_dir_add (browser, iter, icon, &iter->item,
+      browser_iterate_dir_add (browser, icon, &iter->item,
 			       strdup (iter->item.name));
 
       g_mutex_lock (&browser->mutex);
@@ -1424,8 +2113,8 @@ browser_iterate_dir_recursive (struct browser *browser, const gchar *rel_dir,
       if (iter->item.type == ITEM_TYPE_DIR)
 	{
 	  child_dir = path_chain (type, browser->dir, child_rel_dir);
-	  err = browser->fs_ops->readdir (browser->backend, &child_iter,
-					  child_dir, extensions);
+	  err = slot_cache_readdir (browser->backend, browser->fs_ops,
+				    &child_iter, child_dir, extensions);
 	  if (!err)
 	    {
 	      browser_iterate_dir_recursive (browser, child_rel_dir,
@@ -1441,7 +2130,7 @@ browser_iterate_dir_recursive (struct browser *browser, const gchar *rel_dir,
 	    }
 	}
 
-      browser_iterate_dir_add (browser, iter, icon, &iter->item,
+      browser_iterate_dir_add (browser, icon, &iter->item,
 			       strdup (child_rel_dir));
 
       g_free (child_rel_dir);
@@ -1452,6 +2141,60 @@ browser_iterate_dir_recursive (struct browser *browser, const gchar *rel_dir,
     }
 }
 
+struct browser_search_index_data
+{
+  struct browser *browser;
+  const gchar *icon;
+};
+
+static gboolean
+browser_search_index_cb (struct item *item, gchar *rel_path, gpointer data)
+{
+  gboolean loading;
+  struct browser_search_index_data *search_data = data;
+  struct browser *browser = search_data->browser;
+
+  if (item->type == ITEM_TYPE_DIR
+      && preferences_get_boolean (PREF_KEY_SHOW_FOLDER_SIZES))
+    {
+      browser_dir_set_item_dir_size (browser, rel_path, item);
+    }
+
+  browser_iterate_dir_add (browser, search_data->icon, item, rel_path);
+
+  g_mutex_lock (&browser->mutex);
+  loading = browser->loading;
+  g_mutex_unlock (&browser->mutex);
+
+  return loading;
+}
+
+//Searches in the local browser use the sample index when the directory has already been indexed.
+//Otherwise, the directory is queued for indexing and the filesystem is traversed.
+
+static void
+browser_search (struct browser *browser, struct item_iterator *iter,
+		const gchar *icon, const gchar **exts)
+{
+  struct browser_search_index_data data;
+
+  if (browser == &local_browser)
+    {
+      data.browser = browser;
+      data.icon = icon;
+      if (!sample_index_search (browser->dir, exts,
+				browser->fs_ops->options &
+				FS_OPTION_SHOW_SAMPLE_COLUMNS,
+				browser_search_index_cb, &data))
+	{
+	  return;
+	}
+      sample_index_add_dir (browser->dir);
+    }
+
+  browser_iterate_dir_recursive (browser, "", iter, icon, exts);
+}
+
 const gchar *
 browser_get_icon (struct browser *browser)
 {
@@ -1519,30 +2262,52 @@ browser_load_dir_runner (gpointer data)
   struct item_iterator iter;
   const gchar **exts;
   const gchar *icon;
-  gboolean search_mode, search_ready;
+  gboolean search_mode, search_ready, placeholders;
+  guint generation;
 
   exts = browser_get_exts (browser);
   icon = browser_get_icon (browser);
 
+  g_mutex_lock (&browser->mutex);
+  search_mode = browser->search_mode;
+  search_ready = browser->search_options.ready;
+  g_mutex_unlock (&browser->mutex);
+
   g_idle_add (browser_load_dir_runner_show_spinner_and_lock_browser, browser);
-  err = browser->fs_ops->readdir (browser->backend, &iter, browser->dir,
-				  exts);
+  //Searching needs the names so placeholders are only used while browsing.
+  if (search_mode)
+    {
+      placeholders = FALSE;
+      err = slot_cache_readdir (browser->backend, browser->fs_ops, &iter,
+				browser->dir, exts);
+    }
+  else
+    {
+      generation = slot_cache_get_generation ();
+      err = slot_cache_readdir_ids (browser->backend, browser->fs_ops, &iter,
+				    browser->dir, exts, &placeholders);
+    }
   g_idle_add (browser_load_dir_runner_hide_spinner, browser);
+
+  g_mutex_lock (&browser->mutex);
+  browser->placeholders = placeholders && !err;
+  if (browser->placeholders)
+    {
+      browser->slot_cache_generation = generation;
+    }
+  g_mutex_unlock (&browser->mutex);
+
   if (err)
     {
       error_print ("Error while opening '%s' dir", browser->dir);
       goto end;
     }
 
-  g_mutex_lock (&browser->mutex);
-  search_mode = browser->search_mode;
-  search_ready = browser->search_options.ready;
-  g_mutex_unlock (&browser->mutex);
   if (search_mode)
     {
       if (search_ready)
 	{
-	  browser_iterate_dir_recursive (browser, "", &iter, icon, exts);
+	  browser_search (browser, &iter, icon, exts);
 	}
     }
   else
@@ -1550,6 +2315,8 @@ browser_load_dir_runner (gpointer data)
       browser_iterate_dir (browser, &iter, icon);
     }
 
+  browser_flush_rows (browser);
+
   item_iterator_free (&iter);
 
 end:
@@ -1580,6 +2347,8 @@ browser_load_dir (gpointer data)
     }
   g_mutex_unlock (&browser->mutex);
 
+  browser_stop_info_loader (browser);
+  g_hash_table_remove_all (browser->loaded_items);
   browser_clear (browser);
 
   if (!browser->fs_ops || !browser->fs_ops->readdir)
@@ -1612,6 +2381,8 @@ browser_update_fs_sorting_options (struct browser *browser)
   gboolean slot = browser->fs_ops &&
     browser->fs_ops->options & FS_OPTION_SLOT_STORAGE;
 
+  browser->sort_disabled = FALSE;
+
   if (browser->search_mode || !slot)
     {
       gtk_tree_sortable_set_sort_func (sortable,
@@ -1689,6 +2460,7 @@ browser_show_clicked (GtkWidget *object, gpointer data)
       model = GTK_TREE_MODEL (gtk_tree_view_get_model (browser->view));
       browser_set_item (model, &iter, &item);
       path = path_chain (type, browser->dir, item.name);
+      item_clear (&item);
     }
   else
     {
@@ -2038,6 +2810,7 @@ browser_drag_begin (GtkWidget *widget, GdkDragContext *context, gpointer data)
       gtk_tree_model_get_iter (model, &iter, list->data);
       browser_set_item (model, &iter, &item);
       path = browser_get_item_path (browser, &item);
+      item_clear (&item);
       uri = path_filename_to_uri (type, path);
       g_free (path);
       g_string_append (browser->dnd_data, uri);
@@ -2340,6 +3113,8 @@ browser_drag_motion_list (GtkWidget *widget,
 					browser_drag_scroll_down_timeout);
 	    }
 	}
+
+      item_clear (&item);
     }
   else
     {
@@ -2395,18 +3170,35 @@ browser_drag_leave_up (GtkWidget *widget,
   browser_clear_dnd_function (user_data);
 }
 
+static void
+browser_search_remove_timeout (struct browser *browser)
+{
+  if (browser->search_timeout)
+    {
+      g_source_remove (browser->search_timeout);
+      browser->search_timeout = 0;
+    }
+}
+
 static void
 browser_destroy (struct browser *browser)
 {
+  browser_search_remove_timeout (browser);
+
   while (browser->thread)
     {
       browser_reset (&remote_browser);	// This waits too.
       gtk_main_iteration_do (TRUE);
     }
 
+  browser_wait_info_loaders (browser);
+  g_hash_table_destroy (browser->loaded_items);
+
   notifier_destroy (browser->notifier);
   g_slist_free (browser->sensitive_widgets);
   g_hash_table_destroy (browser->folder_size_cache);
+  browser_clear_pending_rows (browser);
+  g_queue_free (browser->pending_rows);
 }
 
 void
@@ -2432,7 +3224,9 @@ browser_cancel (struct browser *browser)
   browser->search_mode = FALSE;
   g_mutex_unlock (&browser->mutex);
   browser_wait (browser);
+  browser_stop_info_loader (browser);
 
+  browser_search_remove_timeout (browser);
   gtk_entry_buffer_set_text (buf, "", -1);
 
   g_slist_free_full (browser->search_options.tokens, g_free);
@@ -2564,20 +3358,15 @@ browser_search_get_param (const gchar *word, const gchar *prefix)
   return param;
 }
 
-static void
-browser_search_changed (GtkSearchEntry *entry, gpointer data)
+static gboolean
+browser_search_start (gpointer data)
 {
   struct browser *browser = data;
-  GtkEntryBuffer *buf = gtk_entry_get_buffer (GTK_ENTRY (entry));
+  GtkEntryBuffer *buf =
+    gtk_entry_get_buffer (GTK_ENTRY (browser->search_entry));
   const gchar *filter = gtk_entry_buffer_get_text (buf);
 
-  g_mutex_lock (&browser->mutex);
-  browser->loading = FALSE;
-  g_mutex_unlock (&browser->mutex);
-  browser_wait (browser);
-  browser_clear (browser);
-
-  usleep (250000);
+  browser->search_timeout = 0;
 
   gchar *tempo_prefix = g_utf8_casefold (_("Tempo"), -1);
   gchar *note_prefix = g_utf8_casefold (_("Note"), -1);
@@ -2620,6 +3409,26 @@ browser_search_changed (GtkSearchEntry *entry, gpointer data)
   g_strfreev (words);
 
   browser_load_dir (browser);
+
+  return G_SOURCE_REMOVE;
+}
+
+//The search is delayed without blocking the main loop so that typing several characters only starts one search.
+
+static void
+browser_search_changed (GtkSearchEntry *entry, gpointer data)
+{
+  struct browser *browser = data;
+
+  g_mutex_lock (&browser->mutex);
+  browser->loading = FALSE;
+  g_mutex_unlock (&browser->mutex);
+  browser_wait (browser);
+  browser_clear (browser);
+
+  browser_search_remove_timeout (browser);
+  browser->search_timeout = g_timeout_add (BROWSER_SEARCH_DELAY_MS,
+					   browser_search_start, browser);
 }
 
 static void
@@ -2753,6 +3562,17 @@ browser_init (struct browser *browser)
 
   browser->selection_active = TRUE;
 
+  browser->info_loader = NULL;
+  browser->info_loaders = 0;
+  browser->placeholders = FALSE;
+  browser->slot_cache_generation = 0;
+  browser->loaded_items = g_hash_table_new_full (g_direct_hash,
+						 g_direct_equal, NULL,
+						 browser_free_item);
+  g_signal_connect (gtk_scrollable_get_vadjustment
+		    (GTK_SCROLLABLE (browser->view)), "value-changed",
+		    G_CALLBACK (browser_info_loader_scroll), browser);
+
   gtk_drag_dest_set ((GtkWidget *) browser->up_button,
 		     GTK_DEST_DEFAULT_MOTION | GTK_DEST_DEFAULT_HIGHLIGHT,
 		     TARGET_ENTRIES_UP_BUTTON_DST,
@@ -2762,6 +3582,7 @@ browser_init (struct browser *browser)
   browser->reload_item_in_editor = TRUE;
   browser->folder_size_cache =
     g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+  browser->pending_rows = g_queue_new ();
   notifier_init (&browser->notifier, browser);
 }
 
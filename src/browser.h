@@ -29,6 +29,8 @@
 
 #define SIZE_LABEL_LEN 16
 
+struct browser_info_loader;
+
 //Common columns
 #define BROWSER_LIST_STORE_ICON_FIELD 0
 #define BROWSER_LIST_STORE_NAME_FIELD 1	//This is the value returned by the funciton se in the get_item_key member in struct fs_operations. It's the filename.
@@ -100,7 +102,20 @@ struct browser
   gboolean dirty;
   gboolean search_mode;
   struct browser_search_options search_options;
+  guint search_timeout;		//Pending search source id or 0
+  struct browser_rows *rows;	//Only used by the loader thread
+  GQueue *pending_rows;		//Chunks of rows waiting to be inserted
+  guint rows_source;		//Source inserting the pending rows or 0
+  gboolean sort_disabled;
+  gint sort_column;
+  GtkSortType sort_order;
   gint64 last_selected_index;	//This needs space for gint and -1
+  //Object info and placeholders loading members
+  struct browser_info_loader *info_loader;	//Running loader or NULL
+  guint info_loaders;		//Loaders not freed yet, including the stopped ones. Only used in the main thread.
+  gboolean placeholders;	//The listing was made with readdir_ids.
+  guint slot_cache_generation;	//Taken before the listing made with readdir_ids.
+  GHashTable *loaded_items;	//Placeholders already completed by id. Only used in the main thread.
   gboolean selection_active;
   //Menu
   GtkWidget *popover_transfer_button;
@@ -161,6 +176,12 @@ gboolean browser_load_dir (gpointer);
 
 gboolean browser_load_dir_if_needed (gpointer);
 
+void browser_start_info_loader (struct browser *browser);
+
+void browser_stop_info_loader (struct browser *browser);
+
+void browser_wait_info_loaders (struct browser *browser);
+
 void browser_update_fs_options (struct browser *);
 
 void browser_reset (struct browser *);
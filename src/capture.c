@@ -0,0 +1,337 @@
+/*
+ *   capture.c
+ *   Copyright (C) 2024 David García Goñi <dagargo@gmail.com>
+ *
+ *   This file is part of Elektroid.
+ *
+ *   Elektroid is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Elektroid is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Elektroid. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <unistd.h>
+#include "capture.h"
+
+#define CAPTURE_MAGIC_LEN (sizeof (CAPTURE_MAGIC) - 1)
+#define CAPTURE_ULEB_MAX_LEN 10
+#define CAPTURE_NAME_MAX_LEN 255
+
+static guint
+capture_put_uleb (guint8 *b, guint64 v)
+{
+  guint len = 0;
+
+  do
+    {
+      b[len] = v & 0x7f;
+      v >>= 7;
+      if (v)
+	{
+	  b[len] |= 0x80;
+	}
+      len++;
+    }
+  while (v);
+
+  return len;
+}
+
+static gint
+capture_get_uleb (GByteArray *content, guint *pos, guint64 *v)
+{
+  guint8 b;
+
+  *v = 0;
+  for (guint i = 0; i < CAPTURE_ULEB_MAX_LEN; i++)
+    {
+      if (*pos >= content->len)
+	{
+	  return -EINVAL;
+	}
+      b = content->data[*pos];
+      (*pos)++;
+      *v |= ((guint64) (b & 0x7f)) << (7 * i);
+      if (!(b & 0x80))
+	{
+	  return 0;
+	}
+    }
+
+  return -EINVAL;
+}
+
+gint
+capture_open (struct capture *capture, const gchar *path, const gchar *name)
+{
+  guint8 header[CAPTURE_MAGIC_LEN + 2];
+  guint name_len = strlen (name);
+
+  capture->file = fopen (path, "wb");
+  if (!capture->file)
+    {
+      gint err = -errno;
+      error_print ("Error while opening capture file '%s': %s", path,
+		   g_strerror (errno));
+      return err;
+    }
+
+  if (name_len > CAPTURE_NAME_MAX_LEN)
+    {
+      name_len = CAPTURE_NAME_MAX_LEN;
+    }
+
+  memcpy (header, CAPTURE_MAGIC, CAPTURE_MAGIC_LEN);
+  header[CAPTURE_MAGIC_LEN] = CAPTURE_VERSION;
+  header[CAPTURE_MAGIC_LEN + 1] = name_len;
+  fwrite (header, 1, sizeof (header), capture->file);
+  fwrite (name, 1, name_len, capture->file);
+
+  g_mutex_init (&capture->mutex);
+  snprintf (capture->name, LABEL_MAX, "%.*s", (gint) name_len, name);
+  capture->replay = FALSE;
+  capture->fast = FALSE;
+  capture->last = g_get_monotonic_time ();
+  capture->content = NULL;
+  capture->pos = 0;
+  capture->offset = 0;
+
+  debug_print (1, "Capturing MIDI traffic to '%s'...", path);
+
+  return 0;
+}
+
+void
+capture_add (struct capture *capture, enum capture_dir dir,
+	     const guint8 *data, guint len)
+{
+  guint8 header[1 + 2 * CAPTURE_ULEB_MAX_LEN];
+  guint header_len;
+  gint64 now;
+
+  g_mutex_lock (&capture->mutex);
+
+  now = g_get_monotonic_time ();
+  header[0] = dir;
+  header_len = 1;
+  header_len += capture_put_uleb (&header[header_len], now - capture->last);
+  header_len += capture_put_uleb (&header[header_len], len);
+  capture->last = now;
+
+  fwrite (header, 1, header_len, capture->file);
+  fwrite (data, 1, len, capture->file);
+
+  g_mutex_unlock (&capture->mutex);
+}
+
+gint
+capture_load (struct capture *capture, const gchar *path, gboolean fast)
+{
+  gchar *content;
+  gsize len;
+  guint name_len;
+  GError *error = NULL;
+
+  if (!g_file_get_contents (path, &content, &len, &error))
+    {
+      error_print ("Error while loading capture file '%s': %s", path,
+		   error->message);
+      g_error_free (error);
+      return -ENOENT;
+    }
+
+  capture->content = g_byte_array_new_take ((guint8 *) content, len);
+
+  if (len < CAPTURE_MAGIC_LEN + 2 ||
+      memcmp (content, CAPTURE_MAGIC, CAPTURE_MAGIC_LEN) ||
+      content[CAPTURE_MAGIC_LEN] != CAPTURE_VERSION)
+    {
+      error_print ("Invalid capture file '%s'", path);
+      goto error;
+    }
+
+  name_len = (guint8) content[CAPTURE_MAGIC_LEN + 1];
+  capture->pos = CAPTURE_MAGIC_LEN + 2 + name_len;
+  if (capture->pos > len)
+    {
+      error_print ("Invalid capture file '%s'", path);
+      goto error;
+    }
+
+  g_mutex_init (&capture->mutex);
+  snprintf (capture->name, LABEL_MAX, "%.*s", (gint) name_len,
+	    &content[CAPTURE_MAGIC_LEN + 2]);
+  capture->replay = TRUE;
+  capture->fast = fast;
+  capture->last = g_get_monotonic_time ();
+  capture->file = NULL;
+  capture->offset = 0;
+
+  debug_print (1, "Replaying '%s' from '%s' at %s speed...", capture->name,
+	       path, fast ? "maximum" : "original");
+
+  return 0;
+
+error:
+  g_byte_array_free (capture->content, TRUE);
+  capture->content = NULL;
+  return -EINVAL;
+}
+
+gint
+capture_next (struct capture *capture, guint *pos,
+	      struct capture_record *record)
+{
+  guint64 len;
+  GByteArray *content = capture->content;
+
+  if (*pos >= content->len)
+    {
+      return -ENODATA;
+    }
+
+  record->dir = content->data[*pos];
+  (*pos)++;
+  if (record->dir != CAPTURE_DIR_TX && record->dir != CAPTURE_DIR_RX)
+    {
+      return -EINVAL;
+    }
+
+  if (capture_get_uleb (content, pos, &record->delta) ||
+      capture_get_uleb (content, pos, &len) || len > content->len - *pos)
+    {
+      return -EINVAL;
+    }
+
+  record->len = len;
+  record->data = &content->data[*pos];
+  *pos += len;
+
+  return 0;
+}
+
+ssize_t
+capture_replay_tx (struct capture *capture, const guint8 *data, guint len)
+{
+  gint err;
+  guint pos;
+  struct capture_record record;
+
+  g_mutex_lock (&capture->mutex);
+
+  pos = capture->pos;
+  err = capture_next (capture, &pos, &record);
+  if (err || record.dir != CAPTURE_DIR_TX || capture->offset ||
+      record.len != len || memcmp (record.data, data, len))
+    {
+      error_print ("Replay diverged from the capture at offset %u",
+		   capture->pos);
+      g_mutex_unlock (&capture->mutex);
+      return -EIO;
+    }
+
+  capture->pos = pos;
+  capture->last = g_get_monotonic_time ();
+
+  g_mutex_unlock (&capture->mutex);
+
+  return len;
+}
+
+ssize_t
+capture_replay_rx (struct capture *capture, guint8 *buffer, guint len,
+		   guint wait)
+{
+  gint err;
+  guint pos;
+  gint64 now, due;
+  struct capture_record record;
+
+  g_mutex_lock (&capture->mutex);
+
+  pos = capture->pos;
+  err = capture_next (capture, &pos, &record);
+  if (err == -EINVAL)
+    {
+      error_print ("Invalid record at offset %u", capture->pos);
+      g_mutex_unlock (&capture->mutex);
+      return err;
+    }
+
+  now = g_get_monotonic_time ();
+  if (err || record.dir != CAPTURE_DIR_RX)
+    {
+      //Nothing will arrive until the host sends something.
+      g_mutex_unlock (&capture->mutex);
+      if (!capture->fast)
+	{
+	  usleep (wait);
+	}
+      return 0;
+    }
+
+  if (capture->offset || capture->fast)
+    {
+      due = now;
+    }
+  else
+    {
+      due = capture->last + record.delta;
+    }
+  if (due > now)
+    {
+      g_mutex_unlock (&capture->mutex);
+      usleep (MIN (due - now, wait));
+      return 0;
+    }
+
+  if (len > record.len - capture->offset)
+    {
+      len = record.len - capture->offset;
+    }
+  memcpy (buffer, record.data + capture->offset, len);
+  capture->offset += len;
+
+  if (capture->offset == record.len)
+    {
+      capture->pos = pos;
+      capture->offset = 0;
+      //Keeping the recorded timeline avoids accumulating the wait delays.
+      capture->last = due;
+    }
+
+  g_mutex_unlock (&capture->mutex);
+
+  return len;
+}
+
+void
+capture_close (struct capture *capture)
+{
+  if (capture->file)
+    {
+      fclose (capture->file);
+      capture->file = NULL;
+    }
+  else if (capture->content)
+    {
+      g_byte_array_free (capture->content, TRUE);
+      capture->content = NULL;
+    }
+  else
+    {
+      return;
+    }
+
+  g_mutex_clear (&capture->mutex);
+}
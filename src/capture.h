@@ -0,0 +1,90 @@
+/*
+ *   capture.h
+ *   Copyright (C) 2024 David García Goñi <dagargo@gmail.com>
+ *
+ *   This file is part of Elektroid.
+ *
+ *   Elektroid is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Elektroid is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Elektroid. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include "utils.h"
+
+#define CAPTURE_ENV_FILE "ELEKTROID_CAPTURE_FILE"
+#define CAPTURE_ENV_REPLAY_FILE "ELEKTROID_REPLAY_FILE"
+#define CAPTURE_ENV_REPLAY_FAST "ELEKTROID_REPLAY_FAST"
+
+#define CAPTURE_REPLAY_ID_PREFIX "replay:"
+
+#define CAPTURE_MAGIC "ELKCAP"
+#define CAPTURE_VERSION 1
+
+//A capture file starts with the magic, the version, the device name length and the device name.
+//Then, every record is the direction, the time since the previous record in us, the length and the bytes.
+//Times and lengths are stored as unsigned LEB128 values so that most records only have a few bytes of overhead.
+
+enum capture_dir
+{
+  CAPTURE_DIR_TX,
+  CAPTURE_DIR_RX
+};
+
+struct capture_record
+{
+  enum capture_dir dir;
+  guint64 delta;		//Measured in us.
+  guint len;
+  const guint8 *data;
+};
+
+//When capturing, records are appended to the file. When replaying, the whole file is loaded and rx records are only delivered after every previous tx record has been matched by the host.
+struct capture
+{
+  GMutex mutex;
+  gchar name[LABEL_MAX];
+  gboolean replay;
+  gboolean fast;		//Replay ignoring the original times.
+  gint64 last;			//Monotonic time of the previous record in us.
+  FILE *file;
+  GByteArray *content;
+  guint pos;			//Next record in the content.
+  guint offset;			//Bytes of the next record already delivered.
+};
+
+gint capture_open (struct capture *capture, const gchar * path,
+		   const gchar * name);
+
+void capture_add (struct capture *capture, enum capture_dir dir,
+		  const guint8 * data, guint len);
+
+gint capture_load (struct capture *capture, const gchar * path,
+		   gboolean fast);
+
+//Returns the record at the given position and updates it to the next one or returns -ENODATA at the end of the capture.
+gint capture_next (struct capture *capture, guint * pos,
+		   struct capture_record *record);
+
+//Returns the given length if the data matches the next tx record.
+ssize_t capture_replay_tx (struct capture *capture, const guint8 * data,
+			   guint len);
+
+//Returns 0 if the next record is not an rx record or it is not due yet after waiting up to the given time in us.
+ssize_t capture_replay_rx (struct capture *capture, guint8 * buffer,
+			   guint len, guint wait);
+
+void capture_close (struct capture *capture);
+
+#endif
@@ -20,6 +20,12 @@
 
 #include "connector.h"
 
+#define ITEM_ITERATOR_STRINGS_LEN 4096
+#define ITEM_STRING_BUF_LEN 256
+
+//Writable so that a string can always be truncated in place.
+static gchar item_empty_string[1];
+
 void
 item_iterator_init (struct item_iterator *iter, const gchar *dir, void *data,
 		    iterator_next next, iterator_free free)
@@ -28,6 +34,9 @@ item_iterator_init (struct item_iterator *iter, const gchar *dir, void *data,
   iter->data = data;
   iter->next = next;
   iter->free = free;
+  iter->strings = g_string_chunk_new (ITEM_ITERATOR_STRINGS_LEN);
+  item_init (&iter->item);
+  iter->item.strings = iter->strings;
 }
 
 gint
@@ -44,6 +53,7 @@ item_iterator_free (struct item_iterator *iter)
     {
       iter->free (iter->data);
     }
+  g_string_chunk_free (iter->strings);
 }
 
 gboolean
@@ -71,12 +81,74 @@ item_get_filename (struct item *item, guint32 fs_options)
   return strdup (item->name);
 }
 
+static void
+item_free_string (gchar *s)
+{
+  if (s != item_empty_string)
+    {
+      g_free (s);
+    }
+}
+
+void
+item_init (struct item *item)
+{
+  item->name = item_empty_string;
+  item->object_info = item_empty_string;
+  item->strings = NULL;
+  item->hash = -1;
+}
+
+void
+item_clear (struct item *item)
+{
+  if (!item->strings)
+    {
+      item_free_string (item->name);
+      item_free_string (item->object_info);
+    }
+  item->name = item_empty_string;
+  item->object_info = item_empty_string;
+}
+
+static void
+item_set_string (struct item *item, gchar **dst, const gchar *format,
+		 va_list args)
+{
+  gint len;
+  va_list copy;
+  gchar buf[ITEM_STRING_BUF_LEN];
+
+  if (!item->strings)
+    {
+      item_free_string (*dst);
+      *dst = g_strdup_vprintf (format, args);
+      return;
+    }
+
+  //Most strings fit in the buffer so there is no need to allocate them before adding them to the arena.
+  va_copy (copy, args);
+  len = vsnprintf (buf, ITEM_STRING_BUF_LEN, format, copy);
+  va_end (copy);
+
+  if (len < ITEM_STRING_BUF_LEN)
+    {
+      *dst = g_string_chunk_insert_len (item->strings, buf, len);
+    }
+  else
+    {
+      gchar *s = g_strdup_vprintf (format, args);
+      *dst = g_string_chunk_insert_len (item->strings, s, len);
+      g_free (s);
+    }
+}
+
 void
 item_set_name (struct item *item, const gchar *format, ...)
 {
   va_list args;
   va_start (args, format);
-  vsnprintf (item->name, ITEM_NAME_MAX, format, args);
+  item_set_string (item, &item->name, format, args);
   va_end (args);
 }
 
@@ -85,6 +157,6 @@ item_set_object_info (struct item *item, const gchar *format, ...)
 {
   va_list args;
   va_start (args, format);
-  vsnprintf (item->object_info, ITEM_OBJECT_INFO_MAX, format, args);
+  item_set_string (item, &item->object_info, format, args);
   va_end (args);
 }
@@ -57,18 +57,22 @@ enum item_type
 //If the size column is not used at all, do not use FS_OPTION_SHOW_SIZE_COLUMN.
 
 #define ITEM_NAME_MAX PATH_MAX
-#define ITEM_OBJECT_INFO_MAX PATH_MAX
 
+//The strings are never NULL once the item has been initialized and must only be set with item_set_name and item_set_object_info.
+//Items used by iterators store their strings in an arena owned by the iterator so they are valid until the iterator is freed.
+//Any other item owns its strings and must be cleared with item_clear.
 struct item
 {
   enum item_type type;
-  gchar name[ITEM_NAME_MAX];
+  gchar *name;
   gint32 id;			// Used only by slot filesystems
   gint64 size;
+  gint64 hash;			// Content hash provided by the device or -1
   //Optionally filled up structs by filesystems.
   //Filesystem options must indicate if these are in use with FS_OPTION_SHOW_SAMPLE_COLUMNS and FS_OPTION_SHOW_INFO_COLUMN.
   struct sample_info sample_info;
-  gchar object_info[ITEM_OBJECT_INFO_MAX];
+  gchar *object_info;
+  GStringChunk *strings;	// Arena used for the strings or NULL
 };
 
 struct item_iterator;
@@ -84,6 +88,7 @@ struct item_iterator
   iterator_free free;
   void *data;
   struct item item;
+  GStringChunk *strings;	// Arena scoped to the directory listing
 };
 
 struct fs_operations;
@@ -121,6 +126,24 @@ typedef void (*fs_select_item) (struct backend *, const gchar *,
 
 typedef gboolean (*fs_file_exists) (struct backend *, const gchar *);
 
+typedef gint (*fs_load_object_info) (struct backend *, const gchar *,
+				     struct item *);
+
+typedef gint (*fs_load_item) (struct backend *, const gchar *,
+			      struct item *);
+
+//Items without content are deleted. The operation sets the error of every item.
+//Items with an error set by the caller, e.g. because they could not be loaded, are skipped and keep it.
+struct fs_batch_item
+{
+  gchar *path;
+  struct idata *idata;
+  gint err;
+};
+
+typedef gint (*fs_batch_op) (struct backend *, struct fs_batch_item *, guint,
+			     struct task_control *);
+
 // All the function members that return gint should return 0 if no error and a negative number in case of error.
 // errno values are recommended as will provide the user with a meaningful message. In particular,
 // ENOSYS could be used when a particular device does not support a feature that other devices implementing the same filesystem do.
@@ -155,6 +178,10 @@ struct fs_operations
   fs_get_path get_upload_path;
   fs_get_path get_download_path;
   fs_select_item select_item;
+  fs_load_object_info load_object_info;	//Optionally used to set the object info of the file items that readdir left empty, or set from a cache, because it is slow to get. It is called for every file item, runs on a background thread and must return -ENODATA if there is nothing to load.
+  fs_init_iter_func readdir_ids;	//Optionally used by slot filesystems that need a request per slot while listing. Same as readdir but it returns immediately placeholder items with only the type and the id set. These are completed later with load_item.
+  fs_load_item load_item;	//Fills up the name, the size and the sample info of a placeholder item returned by readdir_ids. It runs on a background thread.
+  fs_batch_op upload_batch;	//Optionally used to upload or delete several items at once when it is faster than doing it one by one. There is a control part per item, including the skipped and invalid ones, so that the progress is reported per item.
 };
 
 enum fs_options
@@ -180,7 +207,9 @@ enum fs_options
   //This requires the function readdir to be relatively fast because canceling the search will block the GUI. Requires item.sample_info to be initialized if used with FS_OPTION_SAMPLE_EDITOR.
   FS_OPTION_ALLOW_SEARCH = (1 << 10),
   //This blocks the editor as the transfers are done with audio.
-  FS_OPTION_AUDIO_LINK = (1 << 11)
+  FS_OPTION_AUDIO_LINK = (1 << 11),
+  //Cache the directory listings on disk. Useful for slot filesystems that need a request per slot. See slot_cache.h.
+  FS_OPTION_SLOT_CACHE = (1 << 12)
 };
 
 typedef gint (*connector_handshake) (struct backend * backend);
@@ -194,6 +223,9 @@ struct connector
   const gchar *device_name;	//Only used for non MIDI devices when a virtual device is created.
   //If the backend device name matches this regex, the handshake will be run before than the connectors that didn't match.
   const gchar *regex;
+  //If the device replies to the MIDI identity request, the handshake will only be run if these match. Zeroed values match any device.
+  guint8 midi_company[BE_COMPANY_LEN];
+  guint8 midi_family[BE_FAMILY_LEN];
 };
 
 enum connector_options
@@ -201,7 +233,9 @@ enum connector_options
   CONNECTOR_OPTION_CUSTOM_HANDSHAKE = 1,
   //This could be useful for non MIDI devices that use some other type of physical link,
   //such as old samplers with serial ports or the KORG Volca Sample (audio).
-  CONNECTOR_OPTION_NO_MIDI = (1 << 1)
+  CONNECTOR_OPTION_NO_MIDI = (1 << 1),
+  //The handshake always succeeds so the connector is not stored in the connector cache. Otherwise, a device that did not answer once would never be tested with its own connector again.
+  CONNECTOR_OPTION_FALLBACK = (1 << 2)
 };
 
 void item_iterator_init (struct item_iterator *iter, const gchar * dir,
@@ -224,6 +258,10 @@ gboolean item_iterator_is_dir_or_matches_exts (struct item_iterator
  */
 gchar *item_get_filename (struct item *item, guint32 options);
 
+void item_init (struct item *item);
+
+void item_clear (struct item *item);
+
 void item_set_name (struct item *item, const gchar * format, ...);
 
 void item_set_object_info (struct item *item, const gchar * format, ...);
@@ -0,0 +1,155 @@
+/*
+ *   connector_cache.c
+ *   Copyright (C) 2024 David García Goñi <dagargo@gmail.com>
+ *
+ *   This file is part of Elektroid.
+ *
+ *   Elektroid is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Elektroid is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Elektroid. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <json-glib/json-glib.h>
+#include <glib/gstdio.h>
+#include "connector_cache.h"
+
+#define CONNECTOR_CACHE_FILE CACHE_DIR "/connectors.json"
+
+static gchar *
+connector_cache_get_key (const gchar *device_name,
+			 const struct backend_midi_info *midi_info)
+{
+  gchar *key;
+  GChecksum *checksum = g_checksum_new (G_CHECKSUM_SHA1);
+
+  g_checksum_update (checksum, (guchar *) device_name, -1);
+  g_checksum_update (checksum, (guchar *) midi_info->company,
+		     BE_COMPANY_LEN);
+  g_checksum_update (checksum, (guchar *) midi_info->family, BE_FAMILY_LEN);
+  g_checksum_update (checksum, (guchar *) midi_info->model, BE_MODEL_LEN);
+
+  key = g_strdup (g_checksum_get_string (checksum));
+  g_checksum_free (checksum);
+
+  return key;
+}
+
+//Returns a new empty object if the file does not exist or is not valid.
+
+static JsonObject *
+connector_cache_load (const gchar *filename)
+{
+  JsonNode *root;
+  JsonObject *object = NULL;
+  JsonParser *parser = json_parser_new ();
+
+  if (json_parser_load_from_file (parser, filename, NULL))
+    {
+      root = json_parser_get_root (parser);
+      if (JSON_NODE_HOLDS_OBJECT (root))
+	{
+	  object = json_object_ref (json_node_get_object (root));
+	}
+      else
+	{
+	  error_print ("Invalid connector cache file '%s'", filename);
+	}
+    }
+
+  g_object_unref (parser);
+
+  return object ? object : json_object_new ();
+}
+
+gchar *
+connector_cache_get (const gchar *device_name,
+		     const struct backend_midi_info *midi_info)
+{
+  JsonObject *object;
+  gchar *conn_name = NULL;
+  gchar *filename = get_user_dir (CONNECTOR_CACHE_FILE);
+  gchar *key = connector_cache_get_key (device_name, midi_info);
+
+  object = connector_cache_load (filename);
+  if (json_object_has_member (object, key))
+    {
+      conn_name = g_strdup (json_object_get_string_member (object, key));
+      debug_print (1, "Connector cache hit for '%s': %s", device_name,
+		   conn_name);
+    }
+  else
+    {
+      debug_print (1, "Connector cache miss for '%s'", device_name);
+    }
+
+  json_object_unref (object);
+  g_free (key);
+  g_free (filename);
+
+  return conn_name;
+}
+
+void
+connector_cache_set (const gchar *device_name,
+		     const struct backend_midi_info *midi_info,
+		     const gchar *conn_name)
+{
+  gchar *json;
+  JsonNode *root;
+  JsonObject *object;
+  JsonGenerator *gen;
+  GError *error = NULL;
+  gchar *filename = get_user_dir (CONNECTOR_CACHE_FILE);
+  gchar *dir = g_path_get_dirname (filename);
+  gchar *key = connector_cache_get_key (device_name, midi_info);
+
+  object = connector_cache_load (filename);
+  if (json_object_has_member (object, key) &&
+      !strcmp (json_object_get_string_member (object, key), conn_name))
+    {
+      goto cleanup;
+    }
+
+  json_object_set_string_member (object, key, conn_name);
+
+  if (g_mkdir_with_parents (dir, S_IFDIR | S_IRWXU | S_IRGRP | S_IXGRP |
+			    S_IROTH | S_IXOTH))
+    {
+      error_print ("Error while creating directory `%s'", dir);
+      goto cleanup;
+    }
+
+  debug_print (1, "Saving connector cache to '%s'...", filename);
+
+  root = json_node_new (JSON_NODE_OBJECT);
+  json_node_set_object (root, object);
+  gen = json_generator_new ();
+  json_generator_set_root (gen, root);
+  json = json_generator_to_data (gen, NULL);
+
+  if (!g_file_set_contents (filename, json, -1, &error))
+    {
+      error_print ("Error while saving connector cache to '%s': %s",
+		   filename, error->message);
+      g_clear_error (&error);
+    }
+
+  g_free (json);
+  g_object_unref (gen);
+  json_node_free (root);
+
+cleanup:
+  json_object_unref (object);
+  g_free (key);
+  g_free (dir);
+  g_free (filename);
+}
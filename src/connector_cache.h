@@ -0,0 +1,37 @@
+/*
+ *   connector_cache.h
+ *   Copyright (C) 2024 David García Goñi <dagargo@gmail.com>
+ *
+ *   This file is part of Elektroid.
+ *
+ *   Elektroid is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Elektroid is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Elektroid. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CONNECTOR_CACHE_H
+#define CONNECTOR_CACHE_H
+
+#include "backend.h"
+
+//Stores on disk the connector that last succeeded with a device, identified by its port name and its MIDI identity, so that it can be tested first the next time.
+//The firmware version is not part of the fingerprint as an upgrade does not change the connector.
+
+//Returns NULL if the device is not in the cache.
+gchar *connector_cache_get (const gchar * device_name,
+			    const struct backend_midi_info *midi_info);
+
+void connector_cache_set (const gchar * device_name,
+			  const struct backend_midi_info *midi_info,
+			  const gchar * conn_name);
+
+#endif
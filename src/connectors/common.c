@@ -22,6 +22,7 @@
 #include "common.h"
 #include "scala.h"
 #include "sample.h"
+#include "sysex_codec.h"
 
 static const gchar *SYSEX_EXTS[] = { BE_SYSEX_EXT, NULL };
 
@@ -183,6 +184,26 @@ common_simple_next_dentry (struct item_iterator *iter)
   return 0;
 }
 
+gint
+common_slot_ids_next_dentry (struct item_iterator *iter)
+{
+  struct common_simple_read_dir_data *data = iter->data;
+
+  if (data->next > data->last)
+    {
+      return -ENOENT;
+    }
+
+  item_set_name (&iter->item, "%s", "");
+  iter->item.id = data->next;
+  iter->item.type = ITEM_TYPE_FILE;
+  iter->item.size = -1;
+  sample_info_init (&iter->item.sample_info);
+  data->next++;
+
+  return 0;
+}
+
 gint
 common_data_tx (struct backend *backend, GByteArray *msg,
 		struct task_control *control)
@@ -421,61 +442,26 @@ void
 common_midi_msg_to_8bit_msg (guint8 *msg_midi, guint8 *msg_8bit,
 			     guint input_size)
 {
-  guint8 *dst = msg_8bit;
-  guint8 *src = msg_midi;
-  for (guint i = 0; i < input_size; i++)
-    {
-      guint8 bits = *src;
-      src++;
-      for (guint j = 0; j < 7 && i < input_size; j++, i++, src++, dst++)
-	{
-	  *dst = *src | (bits & 0x1 ? 0x80 : 0);
-	  bits >>= 1;
-	}
-    }
+  sysex_codec_decode (msg_midi, input_size, msg_8bit, SYSEX_CODEC_LSB_FIRST);
 }
 
 void
 common_8bit_msg_to_midi_msg (guint8 *msg_8bit, guint8 *msg_midi,
 			     guint input_size)
 {
-  guint8 *dst = msg_midi;
-  guint8 *src = msg_8bit;
-  guint8 *bits = 0;
-  guint rem;
-  for (guint i = 0; i < input_size;)
-    {
-      bits = dst;
-      *bits = 0;
-      dst++;
-      for (guint j = 0; j < 7 && i < input_size; j++, i++, src++, dst++)
-	{
-	  *dst = *src & 0x7f;
-	  *bits |= *src & 0x80;
-	  *bits >>= 1;
-	}
-    }
-  rem = input_size % 7;
-  if (rem)
-    {
-      *bits >>= 7 - rem;
-    }
+  sysex_codec_encode (msg_8bit, input_size, msg_midi, SYSEX_CODEC_LSB_FIRST);
 }
 
 guint
 common_8bit_msg_to_midi_msg_size (guint size)
 {
-  guint packets = size / 7;
-  guint rem = size % 7;
-  return packets * 8 + (rem ? rem + 1 : 0);
+  return sysex_codec_get_encoded_len (size);
 }
 
 guint
 common_midi_msg_to_8bit_msg_size (guint size)
 {
-  guint packets = size / 8;
-  guint rem = size % 8;
-  return packets * 7 + (rem ? rem - 1 : 0);
+  return sysex_codec_get_decoded_len (size);
 }
 
 gint
@@ -71,6 +71,9 @@ common_midi_program_change_int (struct backend *backend, const gchar * dir,
 
 gint common_simple_next_dentry (struct item_iterator *iter);
 
+//Same as common_simple_next_dentry but the items are placeholders with an empty name. Intended for readdir_ids.
+gint common_slot_ids_next_dentry (struct item_iterator *iter);
+
 gint common_data_tx (struct backend *backend, GByteArray * msg,
 		     struct task_control *control);
 
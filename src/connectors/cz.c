@@ -301,7 +301,7 @@ cz_get_id_as_slot (struct item *item, struct backend *backend)
 static const struct fs_operations FS_PROGRAM_CZ_OPERATIONS = {
   .id = FS_PROGRAM_CZ,
   .options = FS_OPTION_SINGLE_OP | FS_OPTION_SLOT_STORAGE |
-    FS_OPTION_SHOW_SIZE_COLUMN,
+    FS_OPTION_SHOW_SIZE_COLUMN | FS_OPTION_SLOT_CACHE,
   .name = "program",
   .gui_name = "Programs",
   .gui_icon = FS_ICON_PRESET,
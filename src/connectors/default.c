@@ -89,6 +89,6 @@ default_handshake (struct backend *backend)
 const struct connector CONNECTOR_DEFAULT = {
   .name = "default",
   .handshake = default_handshake,
-  .options = CONNECTOR_OPTION_CUSTOM_HANDSHAKE,
+  .options = CONNECTOR_OPTION_CUSTOM_HANDSHAKE | CONNECTOR_OPTION_FALLBACK,
   .regex = NULL
 };
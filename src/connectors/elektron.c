@@ -20,15 +20,17 @@
 
 #include <glib/gi18n.h>
 #include <stdio.h>
-#include <math.h>
 #include <zlib.h>
 #include "common.h"
 #include "elektron.h"
 #include "package.h"
 #include "sample_ops.h"
+#include "slot_cache.h"
+#include "sysex_codec.h"
 #include "../config.h"
 
 #define DEVICES_FILE "/elektron/devices.json"
+#define METADATA_CACHE_FILE "sound-metadata.json"
 
 #define DEV_TAG_ID "id"
 #define DEV_TAG_NAME "name"
@@ -44,6 +46,8 @@ static const gchar *FS_DATA_ANY_EXTS[] = { "data", NULL };
 
 #define DATA_TRANSF_BLOCK_BYTES 0x2000
 #define OS_TRANSF_BLOCK_BYTES 0x800
+#define MAX_BLOCK_WINDOW 4
+#define MIN_BLOCK_REST_TIME_US 5000
 #define MAX_ZIP_SIZE (128 * 1024 * 1024)
 
 #define FS_DATA_PRJ_PREFIX "/projects"
@@ -159,7 +163,43 @@ typedef GByteArray *(*elektron_msg_read_blk_func) (guint, guint, guint);
 typedef GByteArray *(*elektron_msg_write_blk_func) (guint, GByteArray *,
 						    guint *, guint, void *);
 
-typedef void (*elektron_copy_array) (GByteArray *, GByteArray *);
+typedef void (*elektron_copy_array) (guint8 *, const guint8 *, guint);
+
+typedef GByteArray *(*elektron_next_blk_func) (void *, guint *);
+
+//It returns a positive value if the device rejected the block, which is then sent again.
+typedef gint (*elektron_blk_reply_func) (void *, GByteArray *);
+
+struct elektron_block
+{
+  GByteArray *msg;
+  guint16 seq;
+  gint64 time;
+  guint progress;		//Bytes or frames transferred once acknowledged
+};
+
+struct elektron_upload_blk_data
+{
+  guint32 id;
+  guint seq;
+  guint transferred;
+  struct idata *smplrw;
+  elektron_msg_write_blk_func new_msg_write_blk;
+};
+
+struct elektron_download_blk_data
+{
+  guint32 id;
+  guint frames;
+  guint next_block_start;
+  guint received;
+  guint offset;
+  GByteArray *output;		//Allocated from the size reported by the device.
+  guint pos;
+  struct sample_info *sample_info;
+  elektron_msg_read_blk_func new_msg_read_blk;
+  elektron_copy_array copy_array;
+};
 
 typedef gint (*elektron_path_func) (struct backend *, const gchar *);
 
@@ -402,6 +442,7 @@ elektron_next_smplrw_entry (struct item_iterator *iter)
       data->pos += strlen (name_cp1252) + 1;
 
       iter->item.id = -1;
+      iter->item.hash = iter->item.type == ITEM_TYPE_FILE ? data->hash : -1;
       sample_info_init (&iter->item.sample_info);
 
       return 0;
@@ -431,74 +472,19 @@ elektron_init_iterator (struct backend *backend, struct item_iterator *iter,
   return 0;
 }
 
-static GByteArray *
-elektron_decode_payload (const GByteArray *src)
-{
-  GByteArray *dst;
-  int i, j, k, dst_len;
-  unsigned int shift;
-
-  dst_len = src->len - ceill (src->len / 8.0);
-  dst = g_byte_array_sized_new (dst_len);
-  dst->len = dst_len;
-
-  for (i = 0, j = 0; i < src->len; i += 8, j += 7)
-    {
-      shift = 0x40;
-      for (k = 0; k < 7 && i + k + 1 < src->len; k++)
-	{
-	  dst->data[j + k] =
-	    src->data[i + k + 1] | (src->data[i] & shift ? 0x80 : 0);
-	  shift = shift >> 1;
-	}
-    }
-
-  return dst;
-}
-
-static GByteArray *
-elektron_encode_payload (const GByteArray *src)
-{
-  GByteArray *dst;
-  int i, j, k, dst_len;
-  unsigned int accum;
-
-  dst_len = src->len + ceill (src->len / 7.0);
-  dst = g_byte_array_sized_new (dst_len);
-  dst->len = dst_len;
-
-  for (i = 0, j = 0; j < src->len; i += 8, j += 7)
-    {
-      accum = 0;
-      for (k = 0; k < 7; k++)
-	{
-	  accum = accum << 1;
-	  if (j + k < src->len)
-	    {
-	      if (src->data[j + k] & 0x80)
-		{
-		  accum |= 1;
-		}
-	      dst->data[i + k + 1] = src->data[j + k] & 0x7f;
-	    }
-	}
-      dst->data[i] = accum;
-    }
-
-  return dst;
-}
+//The payload is encoded directly into the SysEx message.
 
 static GByteArray *
 elektron_msg_to_raw (const GByteArray *msg)
 {
-  GByteArray *encoded = elektron_encode_payload (msg);
-  guint total = sizeof (MSG_HEADER) + encoded->len + 1;
-  GByteArray *raw = g_byte_array_sized_new (total);
+  guint len = sysex_codec_get_encoded_len (msg->len);
+  GByteArray *raw = g_byte_array_sized_new (sizeof (MSG_HEADER) + len + 1);
 
   g_byte_array_append (raw, MSG_HEADER, sizeof (MSG_HEADER));
-  g_byte_array_append (raw, encoded->data, encoded->len);
-  g_byte_array_append (raw, (guint8 *) "\xf7", 1);
-  free_msg (encoded);
+  g_byte_array_set_size (raw, sizeof (MSG_HEADER) + len + 1);
+  sysex_codec_encode (msg->data, msg->len, &raw->data[sizeof (MSG_HEADER)],
+		      SYSEX_CODEC_MSB_FIRST);
+  raw->data[raw->len - 1] = 0xf7;
 
   return raw;
 }
@@ -644,13 +630,32 @@ elektron_new_msg_list (const gchar *path, int32_t start_index,
   return msg;
 }
 
+static void
+elektron_init_sample_header (struct elektron_sample_header *header,
+			     guint32 bytes, struct sample_info *sample_info)
+{
+  //See comment in elektron_sample_header struct.
+  guint8 loop_type = sample_info->loop_type ? ELEKTRON_LOOP_TYPE_NO :
+    ELEKTRON_LOOP_TYPE_FWD;
+  header->type = 0;
+  header->stereo = sample_info->channels - 1;
+  memset (&header->rsvd0, 0, 2);
+  header->size = g_htonl (bytes);
+  header->rate = g_htonl (ELEKTRON_SAMPLE_RATE);
+  header->loop_start = g_htonl (sample_info->loop_start);
+  header->loop_end = g_htonl (sample_info->loop_end);
+  header->loop_type = loop_type;
+  memset (&header->rsvd1, 0, 3);
+  memset (&header->padding, 0,
+	  sizeof (guint32) * ELEKTRON_SAMPLE_INFO_PAD_I32_LEN);
+}
+
 static GByteArray *
 elektron_new_msg_write_sample_blk (guint id, GByteArray *sample,
 				   guint *total, guint seq, void *data)
 {
   guint32 aux32;
-  guint16 aux16, *aux16p;
-  int i, consumed, bytes_blk;
+  guint consumed, bytes_blk, len, pos;
   struct sample_info *sample_info = data;
   struct elektron_sample_header elektron_sample_header;
   GByteArray *msg = elektron_new_msg (FS_SAMPLE_WRITE_FILE_REQUEST,
@@ -667,21 +672,8 @@ elektron_new_msg_write_sample_blk (guint id, GByteArray *sample,
 
   if (seq == 0)
     {
-      //See comment in elektron_sample_header struct.
-      guint8 loop_type = sample_info->loop_type ? ELEKTRON_LOOP_TYPE_NO :
-	ELEKTRON_LOOP_TYPE_FWD;
-      elektron_sample_header.type = 0;
-      elektron_sample_header.stereo = sample_info->channels - 1;
-      memset (&elektron_sample_header.rsvd0, 0, 2);
-      elektron_sample_header.size = g_htonl (sample->len);
-      elektron_sample_header.rate = g_htonl (ELEKTRON_SAMPLE_RATE);
-      elektron_sample_header.loop_start = g_htonl (sample_info->loop_start);
-      elektron_sample_header.loop_end = g_htonl (sample_info->loop_end);
-      elektron_sample_header.loop_type = loop_type;
-      memset (&elektron_sample_header.rsvd1, 0, 3);
-      memset (&elektron_sample_header.padding, 0,
-	      sizeof (guint32) * ELEKTRON_SAMPLE_INFO_PAD_I32_LEN);
-
+      elektron_init_sample_header (&elektron_sample_header, sample->len,
+				   sample_info);
       g_byte_array_append (msg, (guchar *) & elektron_sample_header,
 			   sizeof (struct elektron_sample_header));
 
@@ -689,17 +681,12 @@ elektron_new_msg_write_sample_blk (guint id, GByteArray *sample,
       bytes_blk -= consumed;
     }
 
-  i = 0;
-  aux16p = (guint16 *) & sample->data[*total];
-  while (i < bytes_blk && *total < sample->len)
-    {
-      aux16 = g_htons (*aux16p);
-      g_byte_array_append (msg, (guint8 *) & aux16, sizeof (guint16));
-      aux16p++;
-      (*total) += sizeof (guint16);
-      consumed += sizeof (guint16);
-      i += sizeof (guint16);
-    }
+  len = MIN (bytes_blk, sample->len - *total);
+  pos = msg->len;
+  g_byte_array_set_size (msg, pos + len);
+  sysex_codec_copy_be16 (&sample->data[*total], len, &msg->data[pos]);
+  (*total) += len;
+  consumed += len;
 
   aux32 = g_htonl (consumed);
   memcpy (&msg->data[9], &aux32, sizeof (guint32));
@@ -808,15 +795,13 @@ static GByteArray *
 elektron_raw_to_msg (GByteArray *sysex)
 {
   GByteArray *msg;
-  GByteArray *payload;
   guint len = sysex->len - sizeof (MSG_HEADER) - 1;
 
   if (len > 0)
     {
-      payload = g_byte_array_sized_new (len);
-      g_byte_array_append (payload, &sysex->data[sizeof (MSG_HEADER)], len);
-      msg = elektron_decode_payload (payload);
-      free_msg (payload);
+      msg = g_byte_array_sized_new (sysex_codec_get_decoded_len (len));
+      msg->len = sysex_codec_decode (&sysex->data[sizeof (MSG_HEADER)], len,
+				     msg->data, SYSEX_CODEC_MSB_FIRST);
     }
   else
     {
@@ -832,7 +817,6 @@ elektron_tx (struct backend *backend, const GByteArray *msg,
 {
   gint res;
   guint16 aux;
-  gchar *text;
   struct sysex_transfer transfer;
   struct elektron_data *data = backend->data;
 
@@ -845,9 +829,7 @@ elektron_tx (struct backend *backend, const GByteArray *msg,
   res = backend_tx_sysex (backend, &transfer, controllable);
   if (!res)
     {
-      text = debug_get_hex_msg (msg);
-      debug_print (1, "Message sent (%d): %s", msg->len, text);
-      g_free (text);
+      debug_print_hex_msg (1, msg, "Message sent (%d): %s", msg->len);
     }
 
   sysex_transfer_clear (&transfer);
@@ -859,7 +841,6 @@ static GByteArray *
 elektron_rx (struct backend *backend, gint timeout,
 	     struct controllable *controllable)
 {
-  gchar *text;
   GByteArray *msg;
   struct sysex_transfer transfer;
 
@@ -878,22 +859,15 @@ elektron_rx (struct backend *backend, gint timeout,
 	  break;
 	}
 
-      if (debug_level > 1)
-	{
-	  text = debug_get_hex_msg (transfer.raw);
-	  debug_print (2, "Message skipped (%d): %s", transfer.raw->len,
-		       text);
-	  g_free (text);
-	}
+      debug_print_hex_msg (2, transfer.raw, "Message skipped (%d): %s",
+			   transfer.raw->len);
       sysex_transfer_clear (&transfer);
     }
 
   msg = elektron_raw_to_msg (transfer.raw);
   if (msg)
     {
-      text = debug_get_hex_msg (msg);
-      debug_print (1, "Message received (%d): %s", msg->len, text);
-      g_free (text);
+      debug_print_hex_msg (1, msg, "Message received (%d): %s", msg->len);
     }
 
   sysex_transfer_clear (&transfer);
@@ -910,6 +884,7 @@ elektron_tx_and_rx_timeout (struct backend *backend,
 {
   ssize_t len;
   guint16 seq;
+  gint64 start;
   GByteArray *rx_msg;
   guint msg_type = tx_msg->data[4] | 0x80;
   struct elektron_data *data = backend->data;
@@ -918,6 +893,7 @@ elektron_tx_and_rx_timeout (struct backend *backend,
   g_mutex_lock (&backend->mutex);
 
   seq = data->seq;
+  start = g_get_monotonic_time ();
   len = elektron_tx (backend, tx_msg, controllable);
   if (len < 0)
     {
@@ -949,6 +925,8 @@ elektron_tx_and_rx_timeout (struct backend *backend,
 	  break;
 	}
 
+      telemetry_add_rtt (&backend->telemetry, msg_type & 0x7f,
+			 g_get_monotonic_time () - start);
       break;
     }
 
@@ -965,6 +943,261 @@ elektron_tx_and_rx (struct backend *backend, GByteArray *tx_msg,
   return elektron_tx_and_rx_timeout (backend, tx_msg, -1, controllable);
 }
 
+static void
+elektron_free_block (gpointer data)
+{
+  struct elektron_block *block = data;
+  free_msg (block->msg);
+  g_free (block);
+}
+
+static void
+elektron_adapt_block_window (struct elektron_data *data, gint64 rtt,
+			     gint64 *min_rtt, guint in_flight)
+{
+  if (*min_rtt < 0 || rtt < *min_rtt)
+    {
+      *min_rtt = rtt;
+    }
+
+  //When the device queues the requests, the replies are delayed. Polling backends add up to one polling period.
+  if (rtt > 2 * *min_rtt + BE_POLL_TIMEOUT_MS * 1000)
+    {
+      if (data->window > 1)
+	{
+	  data->window--;
+	  debug_print (2, "Block window decreased to %d (RTT %" PRId64
+		       " us)", data->window, rtt);
+	}
+      return;
+    }
+
+  if (data->window < MAX_BLOCK_WINDOW && in_flight >= data->window)
+    {
+      data->window++;
+      debug_print (2, "Block window increased to %d (RTT %" PRId64 " us)",
+		   data->window, rtt);
+    }
+}
+
+//The rest time is only shortened a little after every window without errors as a rejected block costs way more than the time saved.
+
+static void
+elektron_shorten_block_rest_time (struct elektron_data *data)
+{
+  data->rest_time -= data->rest_time / 8;
+  if (data->rest_time < MIN_BLOCK_REST_TIME_US)
+    {
+      data->rest_time = MIN_BLOCK_REST_TIME_US;
+    }
+  debug_print (2, "Block rest time shortened to %d us", data->rest_time);
+}
+
+static gboolean
+elektron_is_block_pending (GQueue *pending, guint16 seq)
+{
+  for (GList *l = pending->head; l; l = l->next)
+    {
+      struct elektron_block *block = l->data;
+      if (block->seq == seq)
+	{
+	  return TRUE;
+	}
+    }
+  return FALSE;
+}
+
+//Synchronized
+//Up to data->window block requests are sent at once and their replies must arrive in the same order.
+//The backend is only locked while there are requests in flight so that other backend users can take turns between windows.
+//As every block request is addressed by its offset, it is safe to send it again.
+//Therefore, any failed, out of order or rejected reply makes the remaining transfer fall back to stop-and-wait, starting from the oldest unacknowledged block.
+
+static gint
+elektron_tx_and_rx_blocks (struct backend *backend,
+			   struct task_control *control, guint total,
+			   elektron_next_blk_func next_blk,
+			   elektron_blk_reply_func blk_reply, void *blk_data)
+{
+  guint16 seq;
+  gint64 rtt, min_rtt = -1;
+  GByteArray *rx_msg;
+  struct elektron_block *block;
+  gint err = 0;
+  gboolean stop_and_wait = FALSE, last = FALSE, failed;
+  //The window depends on the measured times, which are different when replaying, so captures are made with the initial window.
+  gboolean adaptive = backend->capture == NULL;
+  GQueue *pending = g_queue_new ();
+  GQueue *retries = g_queue_new ();
+  struct elektron_data *data = backend->data;
+  struct controllable *controllable = &control->controllable;
+
+  debug_print (2, "Starting block transfer (window %d, rest time %d us)...",
+	       data->window, data->rest_time);
+
+  g_mutex_lock (&backend->mutex);
+
+  while (1)
+    {
+      if (g_queue_is_empty (pending))
+	{
+	  g_mutex_unlock (&backend->mutex);
+	  backend_rest (backend, data->rest_time);
+	  g_mutex_lock (&backend->mutex);
+
+	  while (g_queue_get_length (pending) < (stop_and_wait ? 1 :
+						 data->window)
+		 && controllable_is_active (controllable))
+	    {
+	      block = g_queue_pop_head (retries);
+	      if (block)
+		{
+		  telemetry_add_retry (&backend->telemetry);
+		}
+	      else
+		{
+		  if (last)
+		    {
+		      break;
+		    }
+
+		  block = g_malloc (sizeof (struct elektron_block));
+		  block->msg = next_blk (blk_data, &block->progress);
+		  if (!block->msg)
+		    {
+		      g_free (block);
+		      last = TRUE;
+		      break;
+		    }
+		}
+
+	      if (!g_queue_is_empty (pending))
+		{
+		  backend_rest (backend, data->rest_time);
+		}
+
+	      block->seq = data->seq;
+	      block->time = g_get_monotonic_time ();
+	      err = elektron_tx (backend, block->msg, controllable);
+	      if (err)
+		{
+		  elektron_free_block (block);
+		  goto end;
+		}
+	      g_queue_push_tail (pending, block);
+	    }
+	}
+
+      block = g_queue_pop_head (pending);
+      if (!block)
+	{
+	  if (!controllable_is_active (controllable))
+	    {
+	      err = -ECANCELED;
+	    }
+	  break;
+	}
+
+      rx_msg = elektron_rx (backend, BE_SYSEX_TIMEOUT_MS, controllable);
+      if (!rx_msg && !controllable_is_active (controllable))
+	{
+	  g_queue_push_head (pending, block);
+	  err = -ECANCELED;
+	  goto end;
+	}
+
+      if (rx_msg)
+	{
+	  seq = g_ntohs (*((guint16 *) & rx_msg->data[2]));
+	  if (seq != block->seq && !elektron_is_block_pending (pending, seq))
+	    {
+	      error_print ("Unexpected sequence in response. Skipping...");
+	      free_msg (rx_msg);
+	      g_queue_push_head (pending, block);
+	      continue;
+	    }
+
+	  if (seq != block->seq)
+	    {
+	      error_print ("Out of order response");
+	      free_msg (rx_msg);
+	      rx_msg = NULL;
+	    }
+	  else if (rx_msg->data[4] != (block->msg->data[4] | 0x80))
+	    {
+	      error_print ("Illegal message type in response");
+	      free_msg (rx_msg);
+	      rx_msg = NULL;
+	    }
+	}
+
+      failed = !rx_msg;
+      if (rx_msg)
+	{
+	  rtt = g_get_monotonic_time () - block->time;
+	  telemetry_add_rtt (&backend->telemetry, block->msg->data[4], rtt);
+	  if (!stop_and_wait && adaptive)
+	    {
+	      elektron_adapt_block_window (data, rtt, &min_rtt,
+					   g_queue_get_length (pending) + 1);
+	    }
+
+	  err = blk_reply (blk_data, rx_msg);
+	  free_msg (rx_msg);
+	  if (err < 0)
+	    {
+	      elektron_free_block (block);
+	      goto end;
+	    }
+	  failed = err > 0;
+	  err = 0;
+	}
+
+      if (failed)
+	{
+	  g_queue_push_head (pending, block);
+
+	  if (stop_and_wait)
+	    {
+	      err = -EIO;
+	      goto end;
+	    }
+
+	  debug_print (1, "Falling back to stop-and-wait...");
+	  while ((block = g_queue_pop_tail (pending)))
+	    {
+	      g_queue_push_head (retries, block);
+	    }
+	  backend_rx_drain (backend);
+	  data->window = 1;
+	  data->rest_time = BE_REST_TIME_US;
+	  stop_and_wait = TRUE;
+	  continue;
+	}
+
+      task_control_set_progress (control, block->progress / (gdouble) total);
+      elektron_free_block (block);
+
+      if (!stop_and_wait && g_queue_is_empty (pending))
+	{
+	  elektron_shorten_block_rest_time (data);
+	}
+    }
+
+end:
+  //Replies to the requests in flight must not reach other exchanges.
+  if (!g_queue_is_empty (pending))
+    {
+      backend_rx_drain (backend);
+    }
+  g_mutex_unlock (&backend->mutex);
+
+  g_queue_free_full (pending, elektron_free_block);
+  g_queue_free_full (retries, elektron_free_block);
+
+  return err;
+}
+
 static enum item_type
 elektron_get_path_type (struct backend *backend, const gchar *path,
 			fs_init_iter_func init_iter)
@@ -1010,7 +1243,7 @@ elektron_read_common_dir (struct backend *backend,
   GByteArray *tx_msg, *rx_msg = NULL;
   gboolean is_file = file_exists (backend, dir);
 
-  usleep (BE_REST_TIME_US);
+  backend_rest (backend, BE_REST_TIME_US);
 
   if (is_file)
     {
@@ -1370,6 +1603,39 @@ elektron_delete_raw_item (struct backend *backend, const gchar *path)
 				      elektron_delete_raw);
 }
 
+static GByteArray *
+elektron_next_upload_blk (void *data, guint *progress)
+{
+  GByteArray *msg;
+  struct elektron_upload_blk_data *blk_data = data;
+  struct idata *smplrw = blk_data->smplrw;
+
+  if (blk_data->transferred >= smplrw->content->len)
+    {
+      return NULL;
+    }
+
+  msg = blk_data->new_msg_write_blk (blk_data->id, smplrw->content,
+				     &blk_data->transferred, blk_data->seq,
+				     smplrw->info);
+  blk_data->seq++;
+  *progress = blk_data->transferred;
+
+  return msg;
+}
+
+static gint
+elektron_upload_blk_reply (void *data, GByteArray *rx_msg)
+{
+  //Response: x, x, x, x, 0xc2, [0 (error), 1 (success)]...
+  if (!elektron_get_msg_status (rx_msg))
+    {
+      error_print ("Unexpected status");
+      return 1;
+    }
+  return 0;
+}
+
 static gint
 elektron_upload_smplrw (struct backend *backend, const gchar *path,
 			struct idata *smplrw, struct task_control *control,
@@ -1379,12 +1645,10 @@ elektron_upload_smplrw (struct backend *backend, const gchar *path,
 {
   GByteArray *tx_msg;
   GByteArray *rx_msg;
-  guint transferred;
   guint32 id;
-  int i;
-  gboolean active;
   gint res = 0;
   GByteArray *input = smplrw->content;
+  struct elektron_upload_blk_data blk_data;
 
   //If the file already exists the device makes no difference between creating a new file and creating an already existent file.
   //Also, the new file would be discarded if an upload is not completed.
@@ -1407,39 +1671,25 @@ elektron_upload_smplrw (struct backend *backend, const gchar *path,
     }
   free_msg (rx_msg);
 
-  transferred = 0;
-  i = 0;
-
-  active = controllable_is_active (&control->controllable);
+  blk_data.id = id;
+  blk_data.seq = 0;
+  blk_data.transferred = 0;
+  blk_data.smplrw = smplrw;
+  blk_data.new_msg_write_blk = new_msg_write_blk;
 
-  while (transferred < input->len && active)
+  res = elektron_tx_and_rx_blocks (backend, control, input->len,
+				   elektron_next_upload_blk,
+				   elektron_upload_blk_reply, &blk_data);
+  if (res)
     {
-      tx_msg = new_msg_write_blk (id, input, &transferred, i, smplrw->info);
-      rx_msg = elektron_tx_and_rx (backend, tx_msg, &control->controllable);
-      if (!rx_msg)
-	{
-	  return -EIO;
-	}
-      //Response: x, x, x, x, 0xc2, [0 (error), 1 (success)]...
-      if (!elektron_get_msg_status (rx_msg))
-	{
-	  error_print ("Unexpected status");
-	}
-      free_msg (rx_msg);
-      i++;
-
-      task_control_set_progress (control, transferred / (double) input->len);
-
-      active = controllable_is_active (&control->controllable);
-
-      usleep (BE_REST_TIME_US);
+      return res == -ECANCELED ? 0 : res;
     }
 
-  debug_print (2, "%d bytes sent", transferred);
+  debug_print (2, "%d bytes sent", blk_data.transferred);
 
-  if (active)
+  if (controllable_is_active (&control->controllable))
     {
-      tx_msg = new_msg_close_write (id, transferred);
+      tx_msg = new_msg_close_write (id, blk_data.transferred);
       rx_msg = elektron_tx_and_rx (backend, tx_msg, &control->controllable);
       if (!rx_msg)
 	{
@@ -1503,24 +1753,88 @@ elektron_new_msg_open_raw_read (const gchar *path)
 }
 
 static void
-elektron_copy_sample_data (GByteArray *input, GByteArray *output)
+elektron_copy_sample_data (guint8 *dst, const guint8 *src, guint len)
+{
+  sysex_codec_copy_be16 (src, len, dst);
+}
+
+static void
+elektron_copy_raw_data (guint8 *dst, const guint8 *src, guint len)
+{
+  memcpy (dst, src, len);
+}
+
+static GByteArray *
+elektron_next_download_blk (void *data, guint *progress)
 {
-  gint i;
-  gint16 v;
-  gint16 *frame = (gint16 *) input->data;
+  guint req_size;
+  GByteArray *msg;
+  struct elektron_download_blk_data *blk_data = data;
 
-  for (i = 0; i < input->len; i += sizeof (gint16))
+  if (blk_data->next_block_start >= blk_data->frames)
     {
-      v = g_ntohs (*frame);
-      g_byte_array_append (output, (guint8 *) & v, sizeof (gint16));
-      frame++;
+      return NULL;
     }
+
+  req_size = blk_data->frames - blk_data->next_block_start >
+    DATA_TRANSF_BLOCK_BYTES ? DATA_TRANSF_BLOCK_BYTES :
+    blk_data->frames - blk_data->next_block_start;
+  msg = blk_data->new_msg_read_blk (blk_data->id, blk_data->next_block_start,
+				    req_size);
+  blk_data->next_block_start += req_size;
+  *progress = blk_data->next_block_start;
+
+  return msg;
 }
 
-static void
-elektron_copy_raw_data (GByteArray *input, GByteArray *output)
+static gint
+elektron_download_blk_reply (void *data, GByteArray *rx_msg)
 {
-  g_byte_array_append (output, input->data, input->len);
+  guint req_size, len;
+  struct elektron_sample_header *elektron_sample_header;
+  struct elektron_download_blk_data *blk_data = data;
+
+  //Replies arrive in order so the block is the one following the last received.
+  req_size = blk_data->frames - blk_data->received >
+    DATA_TRANSF_BLOCK_BYTES ? DATA_TRANSF_BLOCK_BYTES :
+    blk_data->frames - blk_data->received;
+
+  len = req_size - blk_data->offset;
+  if (rx_msg->len < FS_SAMPLES_PAD_RES + req_size ||
+      blk_data->pos + len > blk_data->output->len)
+    {
+      error_print ("Unexpected block length");
+      return -EIO;
+    }
+
+  blk_data->copy_array (&blk_data->output->data[blk_data->pos],
+			&rx_msg->data[FS_SAMPLES_PAD_RES + blk_data->offset],
+			len);
+  blk_data->pos += len;
+  blk_data->received += req_size;
+
+  //Only in the first iteration. It has no effect for the raw filesystem (M:C) as offset is 0.
+  if (blk_data->offset)
+    {
+      blk_data->offset = 0;
+      elektron_sample_header =
+	(struct elektron_sample_header *) &rx_msg->data[FS_SAMPLES_PAD_RES];
+      blk_data->sample_info = sample_info_new (FALSE);
+      blk_data->sample_info->frames = blk_data->frames;
+      blk_data->sample_info->loop_start =
+	g_ntohl (elektron_sample_header->loop_start);
+      blk_data->sample_info->loop_end =
+	g_ntohl (elektron_sample_header->loop_end);
+      blk_data->sample_info->loop_type = elektron_sample_header->loop_type;
+      blk_data->sample_info->rate = g_ntohl (elektron_sample_header->rate);	//In the case of the RAW filesystem is not used and it is harmless.
+      blk_data->sample_info->format = SF_FORMAT_WAV | SF_FORMAT_PCM_16;
+      blk_data->sample_info->channels = elektron_sample_header->stereo + 1;
+      debug_print (2, "Loop start at %d, loop end at %d",
+		   blk_data->sample_info->loop_start,
+		   blk_data->sample_info->loop_end);
+    }
+
+  return 0;
 }
 
 static gint
@@ -1532,17 +1846,12 @@ elektron_download_smplrw (struct backend *backend, const gchar *path,
 			  elektron_msg_id_func new_msg_close_read,
 			  elektron_copy_array copy_array)
 {
-  struct sample_info *sample_info = NULL;
-  struct elektron_sample_header *elektron_sample_header;
   GByteArray *tx_msg, *rx_msg;
-  GByteArray *array, *output;
+  GByteArray *output;
   guint32 id;
-  guint frames;
-  guint next_block_start;
-  guint req_size;
-  guint offset;
-  gboolean active;
+  guint frames, len;
   gint res;
+  struct elektron_download_blk_data blk_data;
 
   tx_msg = new_msg_open_read (path);
   rx_msg = elektron_tx_and_rx (backend, tx_msg, &control->controllable);
@@ -1562,68 +1871,42 @@ elektron_download_smplrw (struct backend *backend, const gchar *path,
 
   debug_print (2, "%d frames to download", frames);
 
-  active = controllable_is_active (&control->controllable);
-
-  output = g_byte_array_new ();
-  array = g_byte_array_new ();
-  res = 0;
-  next_block_start = 0;
-  offset = read_offset;
-  while (next_block_start < frames && active)
-    {
-      req_size =
-	frames - next_block_start >
-	DATA_TRANSF_BLOCK_BYTES ? DATA_TRANSF_BLOCK_BYTES : frames -
-	next_block_start;
-      tx_msg = new_msg_read_blk (id, next_block_start, req_size);
-      rx_msg = elektron_tx_and_rx (backend, tx_msg, &control->controllable);
-      if (!rx_msg)
-	{
-	  res = -EIO;
-	  goto cleanup;
-	}
-      g_byte_array_append (array, &rx_msg->data[FS_SAMPLES_PAD_RES + offset],
-			   req_size - offset);
-
-      next_block_start += req_size;
-      //Only in the first iteration. It has no effect for the raw filesystem (M:C) as offset is 0.
-      if (offset)
-	{
-	  offset = 0;
-	  elektron_sample_header =
-	    (struct elektron_sample_header *)
-	    &rx_msg->data[FS_SAMPLES_PAD_RES];
-	  sample_info = sample_info_new (FALSE);
-	  sample_info->frames = frames;
-	  sample_info->loop_start =
-	    g_ntohl (elektron_sample_header->loop_start);
-	  sample_info->loop_end = g_ntohl (elektron_sample_header->loop_end);
-	  sample_info->loop_type = elektron_sample_header->loop_type;
-	  sample_info->rate = g_ntohl (elektron_sample_header->rate);	//In the case of the RAW filesystem is not used and it is harmless.
-	  sample_info->format = SF_FORMAT_WAV | SF_FORMAT_PCM_16;
-	  sample_info->channels = elektron_sample_header->stereo + 1;
-	  debug_print (2, "Loop start at %d, loop end at %d",
-		       sample_info->loop_start, sample_info->loop_end);
-	}
-
-      free_msg (rx_msg);
-
-      task_control_set_progress (control, next_block_start / (double) frames);
-
-      active = controllable_is_active (&control->controllable);
-
-      usleep (BE_REST_TIME_US);
+  len = frames > read_offset ? frames - read_offset : 0;
+  output = g_byte_array_sized_new (len);
+  output->len = len;
+
+  blk_data.id = id;
+  blk_data.frames = frames;
+  blk_data.next_block_start = 0;
+  blk_data.received = 0;
+  blk_data.offset = read_offset;
+  blk_data.output = output;
+  blk_data.pos = 0;
+  blk_data.sample_info = NULL;
+  blk_data.new_msg_read_blk = new_msg_read_blk;
+  blk_data.copy_array = copy_array;
+
+  res = elektron_tx_and_rx_blocks (backend, control, frames,
+				   elektron_next_download_blk,
+				   elektron_download_blk_reply, &blk_data);
+  if (res && res != -ECANCELED)
+    {
+      res = -EIO;
+      goto cleanup;
     }
 
-  debug_print (2, "%d bytes received", next_block_start);
+  debug_print (2, "%d bytes received", blk_data.received);
 
-  if (active)
+  if (!controllable_is_active (&control->controllable))
     {
-      copy_array (array, output);
+      res = -1;
     }
-  else
+  else if (blk_data.pos != output->len)
     {
-      res = -1;
+      //The read is closed anyway.
+      error_print ("Unexpected download length (%d bytes instead of %d)",
+		   blk_data.pos, output->len);
+      res = -EIO;
     }
 
   tx_msg = new_msg_close_read (id);
@@ -1637,16 +1920,15 @@ elektron_download_smplrw (struct backend *backend, const gchar *path,
   free_msg (rx_msg);
 
 cleanup:
-  free_msg (array);
   if (res)
     {
       g_byte_array_free (output, TRUE);
-      g_free (sample_info);
+      g_free (blk_data.sample_info);
     }
   else
     {
-      idata_init (smplrw, output, g_path_get_basename (path), sample_info,
-		  sample_info_free);
+      idata_init (smplrw, output, g_path_get_basename (path),
+		  blk_data.sample_info, sample_info_free);
     }
   return res;
 }
@@ -1800,7 +2082,7 @@ elektron_upgrade_os (struct backend *backend, struct sysex_transfer *transfer,
 
       free_msg (rx_msg);
 
-      usleep (BE_REST_TIME_US);
+      backend_rest (backend, BE_REST_TIME_US);
 
       if (!controllable_is_active (controllable))
 	{
@@ -1860,6 +2142,155 @@ elektron_get_storage_stats (struct backend *backend, guint8 type,
   return res ? res : type << 1 < data->device_desc.storage;
 }
 
+static struct info_cache *
+elektron_get_metadata_cache (struct backend *backend)
+{
+  gchar *dir, *filename = NULL;
+  struct elektron_data *data = backend->data;
+
+  g_mutex_lock (&data->metadata_mutex);
+  if (!data->metadata_cache)
+    {
+      if (backend_uses_disk_caches (backend))
+	{
+	  dir = slot_cache_get_device_dir (backend);
+	  filename = path_chain (PATH_SYSTEM, dir, METADATA_CACHE_FILE);
+	  g_free (dir);
+	}
+      data->metadata_cache = g_malloc (sizeof (struct info_cache));
+      info_cache_init (data->metadata_cache, filename);
+      g_free (filename);
+    }
+  g_mutex_unlock (&data->metadata_mutex);
+
+  return data->metadata_cache;
+}
+
+static void
+elektron_invalidate_metadata (struct backend *backend, const gchar *path)
+{
+  struct elektron_data *data = backend->data;
+  struct info_cache *cache = elektron_get_metadata_cache (backend);
+
+  info_cache_invalidate (cache, path);
+
+  g_mutex_lock (&data->metadata_mutex);
+  g_hash_table_remove (data->metadata_pending, path);
+  g_hash_table_remove (data->metadata_validated, path);
+  g_mutex_unlock (&data->metadata_mutex);
+}
+
+//Downloading the metadata of every sound while listing a directory takes several seconds so only the cached tags are used here.
+//The rest are loaded later with elektron_load_data_snd_info.
+//As the device reports no change time and a sound can be saved again with other tags and the same size, the cached tags are shown but they are read again once per session.
+
+static void
+elektron_set_cached_metadata (struct backend *backend,
+			      struct item_iterator *iter)
+{
+  gchar *path, *info, id[LABEL_MAX];
+  struct elektron_data *data = backend->data;
+  struct info_cache *cache = elektron_get_metadata_cache (backend);
+
+  snprintf (id, LABEL_MAX, "%d", iter->item.id);
+  path = path_chain (PATH_INTERNAL, iter->dir, id);
+
+  info = info_cache_get (cache, path, iter->item.size);
+  if (info)
+    {
+      item_set_object_info (&iter->item, "%s", info);
+      g_free (info);
+    }
+
+  g_mutex_lock (&data->metadata_mutex);
+  if (info && g_hash_table_contains (data->metadata_validated, path))
+    {
+      g_free (path);
+    }
+  else
+    {
+      g_hash_table_add (data->metadata_pending, path);
+    }
+  g_mutex_unlock (&data->metadata_mutex);
+}
+
+static gchar *
+elektron_get_metadata_info (GByteArray *metadata)
+{
+  gchar *tags_str, *info;
+  GSList *tags = package_get_tags_from_snd_metadata (metadata);
+  GString *str = g_string_new (NULL);
+
+  for (GSList *e = tags; e; e = e->next)
+    {
+      g_string_append_printf (str, "%s%s", e == tags ? "" :
+			      ELEKTROID_TOKEN_SEPARATOR, (gchar *) e->data);
+    }
+
+  tags_str = g_string_free (str, FALSE);
+  info = g_strdup_printf ("tags=%s", tags_str);
+  g_free (tags_str);
+  g_slist_free_full (tags, g_free);
+
+  return info;
+}
+
+static gint
+elektron_load_data_snd_info (struct backend *backend, const gchar *path,
+			     struct item *item)
+{
+  gint err;
+  gboolean pending;
+  gchar *metadata_path, *info;
+  struct idata output;
+  struct task_control control;
+  struct elektron_data *data = backend->data;
+  struct info_cache *cache;
+
+  if (!preferences_get_boolean (PREF_KEY_ELEKTRON_LOAD_SOUND_TAGS))
+    {
+      return -ENODATA;
+    }
+
+  cache = elektron_get_metadata_cache (backend);
+
+  //Only the sounds listed with metadata are pending and they are tried once.
+  g_mutex_lock (&data->metadata_mutex);
+  pending = g_hash_table_remove (data->metadata_pending, path);
+  g_mutex_unlock (&data->metadata_mutex);
+  if (!pending)
+    {
+      return -ENODATA;
+    }
+
+  controllable_init (&control.controllable);
+  control.callback = NULL;
+
+  metadata_path = path_chain (PATH_INTERNAL, path, FS_DATA_METADATA_FILE);
+  debug_print (2, "Reading metadata from %s...", metadata_path);
+  err = elektron_download_data_snd (backend, metadata_path, &output,
+				    &control);
+  g_free (metadata_path);
+  controllable_clear (&control.controllable);
+  if (err)
+    {
+      return err;
+    }
+
+  info = elektron_get_metadata_info (output.content);
+  item_set_object_info (item, "%s", info);
+  info_cache_set (cache, path, item->size, info);
+  g_free (info);
+
+  g_mutex_lock (&data->metadata_mutex);
+  g_hash_table_add (data->metadata_validated, g_strdup (path));
+  g_mutex_unlock (&data->metadata_mutex);
+
+  idata_clear (&output);
+
+  return 0;
+}
+
 static gint
 elektron_next_data_entry (struct item_iterator *iter)
 {
@@ -1914,7 +2345,7 @@ elektron_next_data_entry (struct item_iterator *iter)
       data->operations = 0;
       data->has_valid_data = 0;
       data->has_metadata = 0;
-      iter->item.object_info[0] = 0;
+      item_set_object_info (&iter->item, "%s", "");
       break;
     case 2:
       iter->item.type = has_children ? ITEM_TYPE_DIR : ITEM_TYPE_FILE;
@@ -1937,50 +2368,12 @@ elektron_next_data_entry (struct item_iterator *iter)
       data->has_metadata = data->msg->data[data->pos];
       data->pos++;
 
-      iter->item.object_info[0] = 0;
+      item_set_object_info (&iter->item, "%s", "");
       if (data->load_metadata && data->has_metadata &&
 	  data->mode == ITER_MODE_DATA_SND &&
 	  preferences_get_boolean (PREF_KEY_ELEKTRON_LOAD_SOUND_TAGS))
 	{
-	  gchar metadata_path[PATH_MAX];
-	  struct idata output;
-	  struct task_control control;
-
-	  controllable_init (&control.controllable);
-	  control.callback = NULL;
-
-	  snprintf (metadata_path, PATH_MAX, "%s/%d/%s", iter->dir,
-		    iter->item.id, FS_DATA_METADATA_FILE);
-	  debug_print (2, "Reading metadata from %s...", metadata_path);
-	  if (!elektron_download_data_snd (data->backend, metadata_path,
-					   &output, &control))
-	    {
-	      gchar *s;
-	      gboolean first = TRUE;
-	      GString *info = g_string_new (NULL);
-	      GSList *tags =
-		package_get_tags_from_snd_metadata (output.content);
-	      GSList *e = tags;
-
-	      while (e)
-		{
-		  gchar *tag = (gchar *) e->data;
-		  const gchar *separator =
-		    first ? "" : ELEKTROID_TOKEN_SEPARATOR;
-		  g_string_append_printf (info, "%s%s", separator, tag);
-		  first = FALSE;
-		  e = e->next;
-		}
-
-	      s = g_string_free (info, FALSE);
-	      item_set_object_info (&iter->item, "tags=%s", s);
-	      g_free (s);
-	      g_slist_free_full (tags, g_free);
-
-	      idata_clear (&output);
-	    }
-
-	  controllable_clear (&control.controllable);
+	  elektron_set_cached_metadata (data->backend, iter);
 	}
 
       break;
@@ -1993,13 +2386,13 @@ elektron_next_data_entry (struct item_iterator *iter)
 
 not_found:
   iter->item.type = ITEM_TYPE_FILE;
-  iter->item.name[0] = 0;
+  item_set_name (&iter->item, "%s", "");
   iter->item.size = 0;
   iter->item.id++;
   data->operations = 0;
   data->has_valid_data = 0;
   data->has_metadata = 0;
-  iter->item.object_info[0] = 0;
+  item_set_object_info (&iter->item, "%s", "");
   return 0;
 }
 
@@ -2155,6 +2548,8 @@ static gint
 elektron_move_data_item_snd (struct backend *backend, const gchar *src,
 			     const gchar *dst)
 {
+  elektron_invalidate_metadata (backend, src);
+  elektron_invalidate_metadata (backend, dst);
   return elektron_move_data_item_prefix (backend, src, dst,
 					 FS_DATA_SND_PREFIX);
 }
@@ -2203,6 +2598,7 @@ static gint
 elektron_copy_data_item_snd (struct backend *backend, const gchar *src,
 			     const gchar *dst)
 {
+  elektron_invalidate_metadata (backend, dst);
   return elektron_copy_data_item_prefix (backend, src, dst,
 					 FS_DATA_SND_PREFIX);
 }
@@ -2261,6 +2657,7 @@ elektron_clear_data_item_prj (struct backend *backend, const gchar *path)
 static gint
 elektron_clear_data_item_snd (struct backend *backend, const gchar *path)
 {
+  elektron_invalidate_metadata (backend, path);
   return elektron_clear_data_item_prefix (backend, path, FS_DATA_SND_PREFIX);
 }
 
@@ -2305,6 +2702,8 @@ static gint
 elektron_swap_data_item_snd (struct backend *backend, const gchar *src,
 			     const gchar *dst)
 {
+  elektron_invalidate_metadata (backend, src);
+  elektron_invalidate_metadata (backend, dst);
   return elektron_swap_data_item_prefix (backend, src, dst,
 					 FS_DATA_SND_PREFIX);
 }
@@ -2540,7 +2939,7 @@ elektron_download_data_prefix (struct backend *backend, const gchar *path,
       return -EIO;
     }
 
-  usleep (BE_REST_TIME_US);
+  backend_rest (backend, BE_REST_TIME_US);
 
   content = g_byte_array_sized_new (4 * MI);
 
@@ -2615,7 +3014,7 @@ elektron_download_data_prefix (struct backend *backend, const gchar *path,
 
       active = controllable_is_active (&control->controllable);
 
-      usleep (BE_REST_TIME_US);
+      backend_rest (backend, BE_REST_TIME_US);
     }
 
   if (active)
@@ -2784,12 +3183,8 @@ elektron_set_data_sample_from_sample (struct idata *data_sample,
 		       sizeof (struct elektron_data_sample_slot_header));
 
   /* Convert sample data from host to big-endian byte order for CRC and storage */
-  const gint16 *src = (const gint16 *) sample->content->data;
-  gint16 *dest = (gint16 *) & sample_content->data[sample_content->len];
-  for (guint i = 0; i < frames; i++)
-    {
-      dest[i] = GINT16_TO_BE (src[i]);
-    }
+  sysex_codec_copy_be16 (sample->content->data, samples_size,
+			 &sample_content->data[sample_content->len]);
   sample_content->len += samples_size;
 
   /* CRC includes slot_header + big-endian sample data */
@@ -3032,7 +3427,7 @@ elektron_upload_data_list_prefix (struct backend *backend, const gchar *path,
       goto end;
     }
 
-  usleep (BE_REST_TIME_US);
+  backend_rest (backend, BE_REST_TIME_US);
 
   jidbe = g_htonl (jid);
 
@@ -3081,7 +3476,7 @@ elektron_upload_data_list_prefix (struct backend *backend, const gchar *path,
 	      goto end;
 	    }
 
-	  usleep (BE_REST_TIME_US);
+	  backend_rest (backend, BE_REST_TIME_US);
 
 	  if (!elektron_get_msg_status (rx_msg))
 	    {
@@ -3461,7 +3856,7 @@ elektron_ram_clear_sample (struct backend *backend, const gchar *path)
       return -EIO;
     }
 
-  usleep (BE_REST_TIME_US);
+  backend_rest (backend, BE_REST_TIME_US);
 
   return 0;
 }
@@ -3501,7 +3896,7 @@ elektron_ram_download_sample (struct backend *backend,
 
   item_iterator_free (&iter);
 
-  usleep (BE_REST_TIME_US);
+  backend_rest (backend, BE_REST_TIME_US);
 
   if (sample_path[0] == 0)
     {
@@ -3560,9 +3955,9 @@ elektron_ram_set_sample (struct backend *backend,
   free_msg (rx_msg);
 
   // It takes a while for the result to be available
-  usleep (500000);
+  backend_rest (backend, 500000);
   task_control_set_progress (control, 0.5);
-  usleep (500000);
+  backend_rest (backend, 500000);
   task_control_set_progress (control, 1.0);
 
   return 0;
@@ -4008,7 +4403,8 @@ static const struct fs_operations FS_DATA_SND_OPERATIONS = {
   .save = file_save,
   .get_exts = elektron_get_dev_exts,
   .get_upload_path = common_slot_get_upload_path,
-  .get_download_path = elektron_get_download_path
+  .get_download_path = elektron_get_download_path,
+  .load_object_info = elektron_load_data_snd_info
 };
 
 static const struct fs_operations FS_DATA_PST_OPERATIONS = {
@@ -4383,6 +4779,14 @@ elektron_ping (struct backend *backend)
   struct elektron_data *data = g_malloc (sizeof (struct elektron_data));
 
   data->seq = 0;
+  data->window = 1;
+  data->rest_time = BE_REST_TIME_US;
+  g_mutex_init (&data->metadata_mutex);
+  data->metadata_cache = NULL;
+  data->metadata_pending = g_hash_table_new_full (g_str_hash, g_str_equal,
+						  g_free, NULL);
+  data->metadata_validated = g_hash_table_new_full (g_str_hash, g_str_equal,
+						    g_free, NULL);
   backend->data = data;
 
   tx_msg = elektron_new_msg (PING_REQUEST, sizeof (PING_REQUEST));
@@ -4391,6 +4795,9 @@ elektron_ping (struct backend *backend)
   if (!rx_msg)
     {
       backend->data = NULL;
+      g_hash_table_destroy (data->metadata_pending);
+      g_hash_table_destroy (data->metadata_validated);
+      g_mutex_clear (&data->metadata_mutex);
       g_free (data);
     }
 
@@ -4423,6 +4830,15 @@ elektron_destroy_data (struct backend *backend)
       fs_desc++;
     }
 
+  if (data->metadata_cache)
+    {
+      info_cache_free (data->metadata_cache);
+      g_free (data->metadata_cache);
+    }
+  g_hash_table_destroy (data->metadata_pending);
+  g_hash_table_destroy (data->metadata_validated);
+  g_mutex_clear (&data->metadata_mutex);
+
   g_free (backend->data);
   backend->data = NULL;
 }
@@ -4455,7 +4871,7 @@ elektron_handshake (struct backend *backend)
       return -ENODEV;
     }
 
-  usleep (BE_REST_TIME_US);
+  backend_rest (backend, BE_REST_TIME_US);
 
   tx_msg = elektron_new_msg (SOFTWARE_VERSION_REQUEST,
 			     sizeof (SOFTWARE_VERSION_REQUEST));
@@ -4470,9 +4886,9 @@ elektron_handshake (struct backend *backend)
   snprintf (backend->version, LABEL_MAX, "%s", (gchar *) & rx_msg->data[10]);
   free_msg (rx_msg);
 
-  usleep (BE_REST_TIME_US);
+  backend_rest (backend, BE_REST_TIME_US);
 
-  if (debug_level > 1)
+  if (debug_enabled (2))
     {
       tx_msg = elektron_new_msg (DEVICEUID_REQUEST,
 				 sizeof (DEVICEUID_REQUEST));
@@ -4483,7 +4899,7 @@ elektron_handshake (struct backend *backend)
 	  free_msg (rx_msg);
 	}
 
-      usleep (BE_REST_TIME_US);
+      backend_rest (backend, BE_REST_TIME_US);
     }
 
   snprintf (backend->description, LABEL_MAX, "%s", overbridge_name);
@@ -4546,6 +4962,7 @@ static gint
 elektron_upload_data_snd_pkg (struct backend *backend, const gchar *path,
 			      struct idata *pkg, struct task_control *control)
 {
+  elektron_invalidate_metadata (backend, path);
   return elektron_upload_pkg (backend, path, pkg, control,
 			      PKG_FILE_TYPE_DATA_SOUND,
 			      &FS_DATA_SND_OPERATIONS,
@@ -620,5 +620,7 @@ const struct connector CONNECTOR_MICROBRUTE = {
   .name = MICROBRUTE_NAME,
   .handshake = microbrute_handshake,
   .options = 0,
-  .regex = ".*MicroBrute.*"
+  .regex = ".*MicroBrute.*",
+  .midi_company = { 0, 0x20, 0x6b },
+  .midi_family = { 0x4, 0x0 }
 };
@@ -21,6 +21,7 @@
 #include <glib.h>
 #include <zip.h>
 #include "connector.h"
+#include "info_cache.h"
 
 #ifndef PACKAGE_H
 #define PACKAGE_H
@@ -79,7 +80,13 @@ struct device_desc
 struct elektron_data
 {
   guint16 seq;
+  guint window;			//Block requests in flight learnt from previous transfers.
+  guint rest_time;		//Pause after every block request in us.
   struct device_desc device_desc;
+  GMutex metadata_mutex;
+  struct info_cache *metadata_cache;	//Sound tags. Created on first use.
+  GHashTable *metadata_pending;	//Sounds listed with metadata not in the cache or not validated yet.
+  GHashTable *metadata_validated;	//Sounds whose cached tags have been read from the device in this session.
 };
 
 struct package
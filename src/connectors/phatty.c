@@ -389,7 +389,7 @@ static const struct fs_operations FS_PHATTY_PRESET_OPERATIONS = {
   .id = FS_PHATTY_PRESET,
   .options = FS_OPTION_SINGLE_OP | FS_OPTION_SLOT_STORAGE |
     FS_OPTION_SHOW_SIZE_COLUMN | FS_OPTION_SHOW_SLOT_COLUMN |
-    FS_OPTION_ALLOW_SEARCH,
+    FS_OPTION_ALLOW_SEARCH | FS_OPTION_SLOT_CACHE,
   .name = "preset",
   .gui_name = "Presets",
   .gui_icon = FS_ICON_PRESET,
@@ -490,5 +490,7 @@ const struct connector CONNECTOR_PHATTY = {
   .name = "phatty",
   .handshake = phatty_handshake,
   .options = 0,
-  .regex = ".*Phatty.*"
+  .regex = ".*Phatty.*",
+  .midi_company = { 0x4, 0, 0 },
+  .midi_family = { 0x0, 0x5 }
 };
@@ -21,10 +21,13 @@
 #include <math.h>
 #include <string.h>
 #include <glib/gi18n.h>
+#include <glib/gstdio.h>
+#include <json-glib/json-glib.h>
 #include "elektron.h"
 #include "sds.h"
 #include "default.h"
 #include "common.h"
+#include "sysex_codec.h"
 
 #define SDS_SAMPLE_LIMIT 1000
 #define SDS_DATA_PACKET_LEN 127
@@ -42,10 +45,31 @@
 #define SDS_NO_SPEC_OPEN_LOOP_REST_TIME 200000
 #define SDS_SAMPLE_CHANNELS 1
 #define SDS_SAMPLE_NAME_MAX_LEN 127
+#define SDS_REST_TIME_MIN 2000	//Lower bound for the adaptive rest time and the calibration.
+#define SDS_PACER_STEP_PACKETS 8	//Packets acknowledged without errors before shortening the rest time.
+#define SDS_PROFILES_FILE CACHE_DIR "/sds.json"
+#define SDS_CALIBRATION_FRAMES 2400
+#define SDS_CALIBRATION_RATE 44100
+
+//Adapts the rest time between packets to the device.
+//The rest time is shortened while the device acknowledges the packets and it is made longer when there are errors.
+//The shortest rest time that has not caused errors is stored on disk for every device.
+struct sds_pacer
+{
+  gint rest_time;
+  gint floor;			//The rest time is never shortened below this.
+  gint safe_time;		//Shortest rest time used without errors
+  gint saved_time;		//Rest time stored on disk
+  guint acks;			//Packets acknowledged since the last change
+  guint errors;
+  gboolean fixed;		//Errors are counted but the rest time does not change.
+};
 
 struct sds_data
 {
-  gint rest_time;
+  struct sds_pacer pacer;
+  gchar *profile;		//Device identity used to store the pacer rest time. NULL if not stored.
+  gboolean open_loop;		//No response was received in the last upload.
   gboolean name_extension;
 };
 
@@ -115,44 +139,12 @@ sds_set_bytes_value_right_just (guint8 *data, gint length, guint value)
     }
 }
 
-static gint16
-sds_get_gint16_value_left_just (guint8 *data, gint length, guint bits)
-{
-  guint value = 0;
-  gint16 svalue;
-  for (gint i = length - 1, shift = 0; i >= 0; i--, shift += 7)
-    {
-      value |= (((guint) data[i]) << shift);
-    }
-  value >>= length * 7 - bits;
-  svalue = (gint16) (value - 0x8000);
-  return svalue;
-}
-
-static void
-sds_set_gint16_value_left_just (guint8 *data, gint length, guint bits,
-				gint16 svalue)
-{
-  gint value = svalue;
-  value += (guint) 0x8000;
-  value <<= length * 7 - bits;
-  for (gint i = length - 1, shift = 0; i >= 0; i--, shift += 7)
-    {
-      data[i] = (guint8) (0x7f & (value >> shift));
-    }
-}
-
 static guint8
 sds_checksum (guint8 *data)
 {
-  guint8 checksum = 0;
-  for (int i = SDS_DATA_PACKET_CKSUM_START; i < SDS_DATA_PACKET_CKSUM_POS;
-       i++)
-    {
-      checksum ^= data[i];
-    }
-  checksum &= 0x7F;
-  return checksum;
+  return sysex_codec_sds_checksum (&data[SDS_DATA_PACKET_CKSUM_START],
+				   SDS_DATA_PACKET_CKSUM_POS -
+				   SDS_DATA_PACKET_CKSUM_START);
 }
 
 static gint
@@ -186,6 +178,189 @@ sds_tx_handshake (struct backend *backend, const guint8 *msg, guint8 packet)
   return backend_tx (backend, tx_msg);
 }
 
+static void
+sds_pacer_init (struct sds_pacer *pacer, gint rest_time)
+{
+  pacer->rest_time = rest_time;
+  pacer->floor = SDS_REST_TIME_MIN;
+  pacer->safe_time = rest_time;
+  pacer->saved_time = rest_time;
+  pacer->acks = 0;
+  pacer->errors = 0;
+  pacer->fixed = FALSE;
+}
+
+static void
+sds_pacer_ack (struct sds_pacer *pacer)
+{
+  pacer->acks++;
+  if (pacer->acks < SDS_PACER_STEP_PACKETS)
+    {
+      return;
+    }
+
+  pacer->acks = 0;
+  pacer->safe_time = MIN (pacer->safe_time, pacer->rest_time);
+
+  if (pacer->fixed)
+    {
+      return;
+    }
+
+  pacer->rest_time = MAX (pacer->floor, pacer->rest_time * 3 / 4);
+  debug_print (2, "SDS rest time shortened to %d us", pacer->rest_time);
+}
+
+static void
+sds_pacer_error (struct sds_pacer *pacer)
+{
+  gint failing = pacer->rest_time;
+
+  pacer->acks = 0;
+  pacer->errors++;
+
+  if (pacer->fixed)
+    {
+      return;
+    }
+
+  //Anything at or below a failing value is never tried again during the session.
+  pacer->floor = MAX (pacer->floor, failing + failing / 4);
+  pacer->safe_time = MAX (pacer->safe_time, pacer->floor);
+  pacer->rest_time = MAX (pacer->floor,
+			  MIN (failing * 2, SDS_NO_SPEC_OPEN_LOOP_REST_TIME));
+  debug_print (2, "SDS rest time backed off to %d us", pacer->rest_time);
+}
+
+//Returns a new empty object if the file does not exist or is not valid.
+
+static JsonObject *
+sds_profiles_load (const gchar *filename)
+{
+  JsonNode *root;
+  JsonObject *object = NULL;
+  JsonParser *parser = json_parser_new ();
+
+  if (json_parser_load_from_file (parser, filename, NULL))
+    {
+      root = json_parser_get_root (parser);
+      if (JSON_NODE_HOLDS_OBJECT (root))
+	{
+	  object = json_object_ref (json_node_get_object (root));
+	}
+      else
+	{
+	  error_print ("Invalid SDS profiles file '%s'", filename);
+	}
+    }
+
+  g_object_unref (parser);
+
+  return object ? object : json_object_new ();
+}
+
+//The backend name is not used as it might be translated. The port name tells identical devices, and devices without identity, apart.
+
+static gchar *
+sds_profile_get_key (struct backend *backend, const gchar *probe)
+{
+  gchar *key;
+  GChecksum *checksum = g_checksum_new (G_CHECKSUM_SHA1);
+
+  g_checksum_update (checksum, (guchar *) & backend->midi_info,
+		     sizeof (struct backend_midi_info));
+  g_checksum_update (checksum, (guchar *) probe, -1);
+  g_checksum_update (checksum, (guchar *) backend->device_name, -1);
+
+  key = g_strdup (g_checksum_get_string (checksum));
+  g_checksum_free (checksum);
+
+  return key;
+}
+
+static gint
+sds_profile_get_rest_time (const gchar *profile)
+{
+  JsonObject *object;
+  gint rest_time = SDS_REST_TIME_DEFAULT;
+  gchar *filename = get_user_dir (SDS_PROFILES_FILE);
+
+  object = sds_profiles_load (filename);
+  if (json_object_has_member (object, profile))
+    {
+      rest_time = json_object_get_int_member (object, profile);
+      rest_time = CLAMP (rest_time, SDS_REST_TIME_MIN,
+			 SDS_NO_SPEC_OPEN_LOOP_REST_TIME);
+      debug_print (1, "SDS profile found. Rest time: %d us", rest_time);
+    }
+  else
+    {
+      debug_print (1, "SDS profile not found. Using default rest time...");
+    }
+
+  json_object_unref (object);
+  g_free (filename);
+
+  return rest_time;
+}
+
+static void
+sds_profile_save (struct sds_data *sds_data)
+{
+  gchar *json;
+  JsonNode *root;
+  JsonObject *object;
+  JsonGenerator *gen;
+  GError *error = NULL;
+  gchar *filename = get_user_dir (SDS_PROFILES_FILE);
+  gchar *dir = g_path_get_dirname (filename);
+  struct sds_pacer *pacer = &sds_data->pacer;
+
+  if (!sds_data->profile || pacer->safe_time == pacer->saved_time)
+    {
+      goto cleanup;
+    }
+
+  if (g_mkdir_with_parents (dir, S_IFDIR | S_IRWXU | S_IRGRP | S_IXGRP |
+			    S_IROTH | S_IXOTH))
+    {
+      error_print ("Error while creating directory `%s'", dir);
+      goto cleanup;
+    }
+
+  debug_print (1, "Saving SDS rest time %d us to '%s'...", pacer->safe_time,
+	       filename);
+
+  object = sds_profiles_load (filename);
+  json_object_set_int_member (object, sds_data->profile, pacer->safe_time);
+
+  root = json_node_new (JSON_NODE_OBJECT);
+  json_node_set_object (root, object);
+  gen = json_generator_new ();
+  json_generator_set_root (gen, root);
+  json = json_generator_to_data (gen, NULL);
+
+  if (g_file_set_contents (filename, json, -1, &error))
+    {
+      pacer->saved_time = pacer->safe_time;
+    }
+  else
+    {
+      error_print ("Error while saving SDS profiles to '%s': %s",
+		   filename, error->message);
+      g_clear_error (&error);
+    }
+
+  g_free (json);
+  g_object_unref (gen);
+  json_node_free (root);
+  json_object_unref (object);
+
+cleanup:
+  g_free (dir);
+  g_free (filename);
+}
+
 static guint
 sds_get_download_info (GByteArray *header, struct sample_info *sample_info,
 		       guint *bits, guint *words, guint *word_size,
@@ -325,12 +500,10 @@ static gint
 sds_download_try (struct backend *backend, const gchar *path,
 		  struct idata *sample, struct task_control *control)
 {
-  guint id, words, word_size, read_bytes, bytes_per_word, total_words, err,
-    retries, packets, packet, exp_packet, rx_packets, bits;
-  gint16 s;
+  guint id, words, word_size, packet_words, bytes_per_word, total_words, err,
+    retries, packets, packet, exp_packet, rx_packets, bits, len;
   GByteArray *tx_msg, *rx_msg;
   gchar *name, *basename;
-  guint8 *dataptr;
   gboolean active, first;
   gboolean last_packet_ack;
   struct sample_info *sample_info;
@@ -366,6 +539,7 @@ sds_download_try (struct backend *backend, const gchar *path,
 	  break;
 	}
       retries++;
+      telemetry_add_retry (&backend->telemetry);
       if (retries == SDS_MAX_RETRIES)
 	{
 	  err = -EIO;
@@ -457,9 +631,9 @@ sds_download_try (struct backend *backend, const gchar *path,
 	      rx_packets++;
 
 	      //We cancel the upload.
-	      usleep (sds_data->rest_time);
+	      backend_rest (backend, sds_data->pacer.rest_time);
 	      sds_tx_handshake (backend, SDS_CANCEL, packet % 0x80);
-	      usleep (sds_data->rest_time);
+	      backend_rest (backend, sds_data->pacer.rest_time);
 
 	      err = 0;
 	      goto end;
@@ -499,16 +673,14 @@ sds_download_try (struct backend *backend, const gchar *path,
       last_packet_ack = TRUE;
       retries = 0;
 
-      read_bytes = 0;
-      dataptr = &rx_msg->data[5];
-      while (read_bytes < SDS_DATA_PACKET_PAYLOAD_LEN && total_words < words)
-	{
-	  s = sds_get_gint16_value_left_just (dataptr, bytes_per_word, bits);
-	  g_byte_array_append (output, (guint8 *) & s, sizeof (gint16));
-	  dataptr += bytes_per_word;
-	  read_bytes += bytes_per_word;
-	  total_words++;
-	}
+      packet_words = MIN (SDS_DATA_PACKET_PAYLOAD_LEN / bytes_per_word,
+			  words - total_words);
+      len = output->len;
+      g_byte_array_set_size (output, len + packet_words * sizeof (gint16));
+      sysex_codec_sds_decode (&rx_msg->data[5], packet_words,
+			      (gint16 *) & output->data[len], bits,
+			      bytes_per_word);
+      total_words += packet_words;
 
       task_control_set_progress (control, rx_packets / (double) packets);
 
@@ -525,8 +697,10 @@ sds_download_try (struct backend *backend, const gchar *path,
 	  free_msg (rx_msg);
 	}
       last_packet_ack = FALSE;
-      usleep (sds_data->rest_time);
+      sds_pacer_error (&sds_data->pacer);
+      backend_rest (backend, sds_data->pacer.rest_time);
       retries++;
+      telemetry_add_retry (&backend->telemetry);
       continue;
     }
 
@@ -554,7 +728,7 @@ end:
       g_byte_array_free (output, TRUE);
     }
 
-  usleep (sds_data->rest_time);
+  backend_rest (backend, sds_data->pacer.rest_time);
 
   return err;
 }
@@ -653,6 +827,7 @@ sds_get_data_packet_msg (gint packet, guint words, guint *word,
 			 gint16 **frame, guint bits, guint bytes_per_word)
 {
   guint8 *data;
+  guint packet_words;
   GByteArray *tx_msg = g_byte_array_sized_new (SDS_DATA_PACKET_LEN);
   g_byte_array_append (tx_msg, SDS_DATA_PACKET_HEADER,
 		       sizeof (SDS_DATA_PACKET_HEADER));
@@ -662,17 +837,11 @@ sds_get_data_packet_msg (gint packet, guint words, guint *word,
 	  SDS_DATA_PACKET_PAYLOAD_LEN);
   tx_msg->data[SDS_DATA_PACKET_LEN - 1] = 0xf7;
   data = &tx_msg->data[sizeof (SDS_DATA_PACKET_HEADER)];
-  for (guint i = 0; i < SDS_DATA_PACKET_PAYLOAD_LEN; i += bytes_per_word)
-    {
-      if (*word < words)
-	{
-	  sds_set_gint16_value_left_just (data, bytes_per_word, bits,
-					  **frame);
-	  data += bytes_per_word;
-	  (*frame)++;
-	  (*word)++;
-	}
-    }
+  packet_words = MIN (SDS_DATA_PACKET_PAYLOAD_LEN / bytes_per_word,
+		      words - *word);
+  sysex_codec_sds_encode (*frame, packet_words, data, bits, bytes_per_word);
+  *frame += packet_words;
+  *word += packet_words;
   tx_msg->data[SDS_DATA_PACKET_CKSUM_POS] = sds_checksum (tx_msg->data);
   return tx_msg;
 }
@@ -793,7 +962,7 @@ sds_upload (struct backend *backend, const gchar *path, struct idata *sample,
     {
       if (retries)
 	{
-	  usleep (sds_data->rest_time);
+	  backend_rest (backend, sds_data->pacer.rest_time);
 	}
 
       if (retries == SDS_MAX_RETRIES)
@@ -809,7 +978,7 @@ sds_upload (struct backend *backend, const gchar *path, struct idata *sample,
       if (open_loop)
 	{
 	  err = backend_tx (backend, tx_msg);
-	  usleep (SDS_NO_SPEC_OPEN_LOOP_REST_TIME);
+	  backend_rest (backend, SDS_NO_SPEC_OPEN_LOOP_REST_TIME);
 	}
       else
 	{
@@ -823,7 +992,9 @@ sds_upload (struct backend *backend, const gchar *path, struct idata *sample,
       if (err == -EBADMSG)
 	{
 	  debug_print (2, "NAK received. Retrying...");
+	  sds_pacer_error (&sds_data->pacer);
 	  retries++;
+	  telemetry_add_retry (&backend->telemetry);
 	  continue;
 	}
       else if (err == -ENOMSG)
@@ -836,13 +1007,17 @@ sds_upload (struct backend *backend, const gchar *path, struct idata *sample,
       else if (err == -EINVAL)
 	{
 	  debug_print (2, "Unexpected packet number. Retrying...");
+	  sds_pacer_error (&sds_data->pacer);
 	  retries++;
+	  telemetry_add_retry (&backend->telemetry);
 	  continue;
 	}
       else if (err == -ETIMEDOUT)
 	{
 	  debug_print (2, "No response. Retrying...");
+	  sds_pacer_error (&sds_data->pacer);
 	  retries++;
+	  telemetry_add_retry (&backend->telemetry);
 	  continue;
 	}
       else if (err == -ECANCELED)
@@ -866,7 +1041,12 @@ sds_upload (struct backend *backend, const gchar *path, struct idata *sample,
       retries = 0;
       err = 0;
 
-      usleep (sds_data->rest_time);
+      //There is no feedback in open loop so the rest time is kept.
+      if (!open_loop)
+	{
+	  sds_pacer_ack (&sds_data->pacer);
+	}
+      backend_rest (backend, sds_data->pacer.rest_time);
     }
 
   if (active && sds_data->name_extension)
@@ -875,9 +1055,15 @@ sds_upload (struct backend *backend, const gchar *path, struct idata *sample,
     }
 
 end:
+  sds_data->open_loop = open_loop;
+
   if (active && packet == packets)
     {
       task_control_set_progress (control, 1.0);
+      if (!open_loop && !sds_data->pacer.fixed)
+	{
+	  sds_profile_save (sds_data);
+	}
     }
   else
     {
@@ -917,11 +1103,131 @@ sds_upload_16b (struct backend *backend, const gchar *path,
   return sds_upload (backend, path, sample, control, 16);
 }
 
+//The sample in the path is overwritten with noise.
+//Every step halves the rest time and it stops at the first step where the device reports an error.
+
+static gint
+sds_calibrate (struct backend *backend, const gchar *path,
+	       struct task_control *control, gint *rest_time)
+{
+  gint err, t, passed = -1;
+  gint16 *frame;
+  struct idata sample, download;
+  struct sample_info *sample_info;
+  struct sds_data *sds_data = backend->data;
+  struct sds_pacer *pacer = &sds_data->pacer;
+  gint prev_rest_time = pacer->rest_time;
+  GByteArray *content = g_byte_array_sized_new (SDS_CALIBRATION_FRAMES *
+						sizeof (gint16));
+
+  g_byte_array_set_size (content, SDS_CALIBRATION_FRAMES * sizeof (gint16));
+  frame = (gint16 *) content->data;
+  for (guint i = 0; i < SDS_CALIBRATION_FRAMES; i++, frame++)
+    {
+      *frame = g_random_int_range (G_MININT16, G_MAXINT16);
+    }
+
+  sample_info = sample_info_new (FALSE);
+  sample_info->frames = SDS_CALIBRATION_FRAMES;
+  sample_info->rate = SDS_CALIBRATION_RATE;
+  sample_info->channels = SDS_SAMPLE_CHANNELS;
+  sample_info->format = SF_FORMAT_WAV | SF_FORMAT_PCM_16;
+  sample_info->loop_start = SDS_CALIBRATION_FRAMES - 1;
+  sample_info->loop_end = SDS_CALIBRATION_FRAMES - 1;
+  idata_init (&sample, content, g_strdup ("calibration"), sample_info,
+	      sample_info_free);
+
+  pacer->fixed = TRUE;
+  err = 0;
+  for (t = SDS_REST_TIME_DEFAULT; t >= SDS_REST_TIME_MIN; t /= 2)
+    {
+      debug_print (1, "Calibrating with a rest time of %d us...", t);
+
+      pacer->rest_time = t;
+      pacer->errors = 0;
+
+      err = sds_upload (backend, path, &sample, control, 16);
+      if (!err && sds_data->open_loop)
+	{
+	  debug_print (1, "No feedback from the device. Stopping...");
+	  err = -ENOTSUP;
+	  break;
+	}
+
+      if (!err)
+	{
+	  err = sds_download (backend, path, &download, control);
+	  if (!err)
+	    {
+	      //Short rest times might corrupt the data without any error.
+	      if (download.content->len != content->len ||
+		  memcmp (download.content->data, content->data,
+			  content->len))
+		{
+		  debug_print (1, "Downloaded data differs");
+		  err = -EIO;
+		}
+	      idata_clear (&download);
+	    }
+	}
+
+      if (!controllable_is_active (&control->controllable))
+	{
+	  err = -ECANCELED;
+	  break;
+	}
+
+      if (err || pacer->errors)
+	{
+	  debug_print (1, "Rest time of %d us failed", t);
+	  err = passed < 0 ? -EIO : 0;
+	  break;
+	}
+
+      passed = t;
+    }
+
+  idata_clear (&sample);
+
+  if (err)
+    {
+      sds_pacer_init (pacer, prev_rest_time);
+      return err;
+    }
+
+  sds_pacer_init (pacer, passed);
+  pacer->floor = passed;
+  pacer->saved_time = -1;
+  sds_profile_save (sds_data);
+
+  *rest_time = passed;
+
+  return 0;
+}
+
+static gint
+sds_load_item (struct backend *backend, const gchar *path, struct item *item)
+{
+  gchar *name;
+  struct sds_data *data = backend->data;
+
+  if (!data->name_extension)
+    {
+      item_set_name (item, "%s", "");
+      return 0;
+    }
+
+  name = sds_get_sample_name (backend, item->id);
+  item_set_name (item, "%s", name ? name : "");
+  g_free (name);
+
+  return 0;
+}
+
 static gint
 sds_next_sample_dentry (struct item_iterator *iter)
 {
   struct sds_iterator_data *iterator_data = iter->data;
-  struct sds_data *data = iterator_data->backend->data;
 
   if (iterator_data->next >= SDS_SAMPLE_LIMIT)
     {
@@ -933,19 +1239,7 @@ sds_next_sample_dentry (struct item_iterator *iter)
   iter->item.size = -1;
   (iterator_data->next)++;
 
-  if (data->name_extension)
-    {
-      gchar *name = sds_get_sample_name (iterator_data->backend,
-					 iterator_data->next);
-      item_set_name (&iter->item, "%s", name ? name : "");
-      g_free (name);
-    }
-  else
-    {
-      iter->item.name[0] = 0;
-    }
-
-  return 0;
+  return sds_load_item (iterator_data->backend, NULL, &iter->item);
 }
 
 static gint
@@ -968,6 +1262,26 @@ sds_read_dir (struct backend *backend, struct item_iterator *iter,
   return 0;
 }
 
+static gint
+sds_read_dir_ids (struct backend *backend, struct item_iterator *iter,
+		  const gchar *dir, const gchar **extensions)
+{
+  struct common_simple_read_dir_data *data;
+
+  if (strcmp (dir, "/"))
+    {
+      return -ENOTDIR;
+    }
+
+  data = g_malloc (sizeof (struct common_simple_read_dir_data));
+  data->next = 0;
+  data->last = SDS_SAMPLE_LIMIT - 1;
+
+  item_iterator_init (iter, dir, data, common_slot_ids_next_dentry, g_free);
+
+  return 0;
+}
+
 static gint
 sds_sample_load_common (const gchar *path, struct idata *sample,
 			struct task_control *control, gint32 rate)
@@ -1034,13 +1348,15 @@ enum sds_fs
 static const struct fs_operations FS_SDS_SAMPLES_MONO_8B_OPERATIONS = {
   .id = FS_SDS_SAMPLES_MONO_8B,
   .options = FS_OPTION_SAMPLE_EDITOR | FS_OPTION_MONO | FS_OPTION_SINGLE_OP |
-    FS_OPTION_SLOT_STORAGE | FS_OPTION_SHOW_ID_COLUMN,
+    FS_OPTION_SLOT_STORAGE | FS_OPTION_SHOW_ID_COLUMN | FS_OPTION_SLOT_CACHE,
   .name = "mono-8b",
   .gui_name = "mono 8 bits",
   .gui_icon = FS_ICON_WAVE,
   .file_icon = FS_ICON_WAVE,
   .max_name_len = SDS_SAMPLE_NAME_MAX_LEN,
   .readdir = sds_read_dir,
+  .readdir_ids = sds_read_dir_ids,
+  .load_item = sds_load_item,
   .print_item = common_print_item,
   .rename = sds_rename,
   .download = sds_download,
@@ -1055,13 +1371,15 @@ static const struct fs_operations FS_SDS_SAMPLES_MONO_8B_OPERATIONS = {
 static const struct fs_operations FS_SDS_SAMPLES_MONO_12B_OPERATIONS = {
   .id = FS_SDS_SAMPLES_MONO_12B,
   .options = FS_OPTION_SAMPLE_EDITOR | FS_OPTION_MONO | FS_OPTION_SINGLE_OP |
-    FS_OPTION_SLOT_STORAGE | FS_OPTION_SHOW_ID_COLUMN,
+    FS_OPTION_SLOT_STORAGE | FS_OPTION_SHOW_ID_COLUMN | FS_OPTION_SLOT_CACHE,
   .name = "mono-12b",
   .gui_name = "mono 12 bits",
   .gui_icon = FS_ICON_WAVE,
   .file_icon = FS_ICON_WAVE,
   .max_name_len = SDS_SAMPLE_NAME_MAX_LEN,
   .readdir = sds_read_dir,
+  .readdir_ids = sds_read_dir_ids,
+  .load_item = sds_load_item,
   .print_item = common_print_item,
   .rename = sds_rename,
   .download = sds_download,
@@ -1076,13 +1394,15 @@ static const struct fs_operations FS_SDS_SAMPLES_MONO_12B_OPERATIONS = {
 static const struct fs_operations FS_SDS_SAMPLES_MONO_14B_OPERATIONS = {
   .id = FS_SDS_SAMPLES_MONO_14B,
   .options = FS_OPTION_SAMPLE_EDITOR | FS_OPTION_MONO | FS_OPTION_SINGLE_OP |
-    FS_OPTION_SLOT_STORAGE | FS_OPTION_SHOW_ID_COLUMN,
+    FS_OPTION_SLOT_STORAGE | FS_OPTION_SHOW_ID_COLUMN | FS_OPTION_SLOT_CACHE,
   .name = "mono-14b",
   .gui_name = "mono 14 bits",
   .gui_icon = FS_ICON_WAVE,
   .file_icon = FS_ICON_WAVE,
   .max_name_len = SDS_SAMPLE_NAME_MAX_LEN,
   .readdir = sds_read_dir,
+  .readdir_ids = sds_read_dir_ids,
+  .load_item = sds_load_item,
   .print_item = common_print_item,
   .rename = sds_rename,
   .download = sds_download,
@@ -1097,13 +1417,15 @@ static const struct fs_operations FS_SDS_SAMPLES_MONO_14B_OPERATIONS = {
 static const struct fs_operations FS_SDS_SAMPLES_MONO_16B_OPERATIONS = {
   .id = FS_SDS_SAMPLES_MONO_16B,
   .options = FS_OPTION_SAMPLE_EDITOR | FS_OPTION_MONO | FS_OPTION_SINGLE_OP |
-    FS_OPTION_SLOT_STORAGE | FS_OPTION_SHOW_ID_COLUMN,
+    FS_OPTION_SLOT_STORAGE | FS_OPTION_SHOW_ID_COLUMN | FS_OPTION_SLOT_CACHE,
   .name = "mono-16b",
   .gui_name = "mono 16 bits",
   .gui_icon = FS_ICON_WAVE,
   .file_icon = FS_ICON_WAVE,
   .max_name_len = SDS_SAMPLE_NAME_MAX_LEN,
   .readdir = sds_read_dir,
+  .readdir_ids = sds_read_dir_ids,
+  .load_item = sds_load_item,
   .print_item = common_print_item,
   .rename = sds_rename,
   .download = sds_download,
@@ -1118,13 +1440,15 @@ static const struct fs_operations FS_SDS_SAMPLES_MONO_16B_OPERATIONS = {
 static const struct fs_operations FS_SDS_SAMPLES_MONO_44K1_16B_OPERATIONS = {
   .id = FS_SDS_SAMPLES_MONO_44K1_16B,
   .options = FS_OPTION_SAMPLE_EDITOR | FS_OPTION_MONO | FS_OPTION_SINGLE_OP |
-    FS_OPTION_SLOT_STORAGE | FS_OPTION_SHOW_ID_COLUMN,
+    FS_OPTION_SLOT_STORAGE | FS_OPTION_SHOW_ID_COLUMN | FS_OPTION_SLOT_CACHE,
   .name = "mono-44k1-16b",
   .gui_name = "mono 44.1 kHz 16 bits",
   .gui_icon = FS_ICON_WAVE,
   .file_icon = FS_ICON_WAVE,
   .max_name_len = SDS_SAMPLE_NAME_MAX_LEN,
   .readdir = sds_read_dir,
+  .readdir_ids = sds_read_dir_ids,
+  .load_item = sds_load_item,
   .print_item = common_print_item,
   .rename = sds_rename,
   .download = sds_download,
@@ -1139,13 +1463,15 @@ static const struct fs_operations FS_SDS_SAMPLES_MONO_44K1_16B_OPERATIONS = {
 static const struct fs_operations FS_SDS_SAMPLES_MONO_32K_16B_OPERATIONS = {
   .id = FS_SDS_SAMPLES_MONO_32K_16B,
   .options = FS_OPTION_SAMPLE_EDITOR | FS_OPTION_MONO | FS_OPTION_SINGLE_OP |
-    FS_OPTION_SLOT_STORAGE | FS_OPTION_SHOW_ID_COLUMN,
+    FS_OPTION_SLOT_STORAGE | FS_OPTION_SHOW_ID_COLUMN | FS_OPTION_SLOT_CACHE,
   .name = "mono-32k-16b",
   .gui_name = "mono 32 kHz 16 bits",
   .gui_icon = FS_ICON_WAVE,
   .file_icon = FS_ICON_WAVE,
   .max_name_len = SDS_SAMPLE_NAME_MAX_LEN,
   .readdir = sds_read_dir,
+  .readdir_ids = sds_read_dir_ids,
+  .load_item = sds_load_item,
   .print_item = common_print_item,
   .rename = sds_rename,
   .download = sds_download,
@@ -1160,13 +1486,15 @@ static const struct fs_operations FS_SDS_SAMPLES_MONO_32K_16B_OPERATIONS = {
 static const struct fs_operations FS_SDS_SAMPLES_MONO_16K_16B_OPERATIONS = {
   .id = FS_SDS_SAMPLES_MONO_16K_16B,
   .options = FS_OPTION_SAMPLE_EDITOR | FS_OPTION_MONO | FS_OPTION_SINGLE_OP |
-    FS_OPTION_SLOT_STORAGE | FS_OPTION_SHOW_ID_COLUMN,
+    FS_OPTION_SLOT_STORAGE | FS_OPTION_SHOW_ID_COLUMN | FS_OPTION_SLOT_CACHE,
   .name = "mono-16k-16b",
   .gui_name = "mono 16 kHz 16 bits",
   .gui_icon = FS_ICON_WAVE,
   .file_icon = FS_ICON_WAVE,
   .max_name_len = SDS_SAMPLE_NAME_MAX_LEN,
   .readdir = sds_read_dir,
+  .readdir_ids = sds_read_dir_ids,
+  .load_item = sds_load_item,
   .print_item = common_print_item,
   .rename = sds_rename,
   .download = sds_download,
@@ -1181,13 +1509,15 @@ static const struct fs_operations FS_SDS_SAMPLES_MONO_16K_16B_OPERATIONS = {
 static const struct fs_operations FS_SDS_SAMPLES_MONO_8K_16B_OPERATIONS = {
   .id = FS_SDS_SAMPLES_MONO_8K_16B,
   .options = FS_OPTION_SAMPLE_EDITOR | FS_OPTION_MONO | FS_OPTION_SINGLE_OP |
-    FS_OPTION_SLOT_STORAGE | FS_OPTION_SHOW_ID_COLUMN,
+    FS_OPTION_SLOT_STORAGE | FS_OPTION_SHOW_ID_COLUMN | FS_OPTION_SLOT_CACHE,
   .name = "mono-8k-16b",
   .gui_name = "mono 8 kHz 16 bits",
   .gui_icon = FS_ICON_WAVE,
   .file_icon = FS_ICON_WAVE,
   .max_name_len = SDS_SAMPLE_NAME_MAX_LEN,
   .readdir = sds_read_dir,
+  .readdir_ids = sds_read_dir_ids,
+  .load_item = sds_load_item,
   .print_item = common_print_item,
   .rename = sds_rename,
   .download = sds_download,
@@ -1277,24 +1607,37 @@ sds_handshake_esi_2000 (struct backend *backend)
     }
 
   //We cancel the upload.
-  usleep (SDS_REST_TIME_DEFAULT);
+  backend_rest (backend, SDS_REST_TIME_DEFAULT);
   sds_tx_handshake (backend, SDS_CANCEL, 0);
-  usleep (SDS_REST_TIME_DEFAULT);
+  backend_rest (backend, SDS_REST_TIME_DEFAULT);
 
   return 0;
 }
 
+static void
+sds_destroy_data (struct backend *backend)
+{
+  struct sds_data *sds_data = backend->data;
+
+  debug_print (1, "Destroying backend data...");
+
+  g_free (sds_data->profile);
+  g_free (sds_data);
+  backend->data = NULL;
+}
+
 gint
 sds_handshake (struct backend *backend)
 {
   gint err;
   gboolean name_extension;
+  const gchar *probe;
   struct sds_data *sds_data;
 
   //We cancel anything that might be running.
-  usleep (SDS_REST_TIME_DEFAULT);
+  backend_rest (backend, SDS_REST_TIME_DEFAULT);
   sds_tx_handshake (backend, SDS_CANCEL, 0);
-  usleep (SDS_REST_TIME_DEFAULT);
+  backend_rest (backend, SDS_REST_TIME_DEFAULT);
 
   err = sds_handshake_elektron (backend);
   if (err)
@@ -1310,12 +1653,14 @@ sds_handshake (struct backend *backend)
   else
     {
       name_extension = TRUE;
+      probe = "name";
       goto end;
     }
 
   err = sds_handshake_loop_point (backend);
   if (!err)
     {
+      probe = "loop_point";
       goto end;
     }
 
@@ -1324,15 +1669,32 @@ sds_handshake (struct backend *backend)
     {
       return err;
     }
+  probe = "esi_2000";
 
 end:
   debug_print (1, "Name extension: %s", name_extension ? "yes" : "no");
 
   //The remaining code is meant to set up different devices. These are the default values.
 
+  if (!strlen (backend->name))
+    {
+      snprintf (backend->name, LABEL_MAX, "%s", _("SDS sampler"));
+    }
+
   sds_data = g_malloc (sizeof (struct sds_data));
-  sds_data->rest_time = SDS_REST_TIME_DEFAULT;
   sds_data->name_extension = name_extension;
+  sds_data->open_loop = FALSE;
+  if (backend_uses_disk_caches (backend))
+    {
+      sds_data->profile = sds_profile_get_key (backend, probe);
+      sds_pacer_init (&sds_data->pacer,
+		      sds_profile_get_rest_time (sds_data->profile));
+    }
+  else
+    {
+      sds_data->profile = NULL;
+      sds_pacer_init (&sds_data->pacer, SDS_REST_TIME_DEFAULT);
+    }
 
   gslist_fill (&backend->fs_ops, &FS_PROGRAM_DEFAULT_OPERATIONS,
 	       &FS_SDS_SAMPLES_MONO_8B_OPERATIONS,
@@ -1343,13 +1705,9 @@ end:
 	       &FS_SDS_SAMPLES_MONO_32K_16B_OPERATIONS,
 	       &FS_SDS_SAMPLES_MONO_16K_16B_OPERATIONS,
 	       &FS_SDS_SAMPLES_MONO_8K_16B_OPERATIONS, NULL);
-  backend->destroy_data = backend_destroy_data;
+  backend->destroy_data = sds_destroy_data;
   backend->data = sds_data;
-
-  if (!strlen (backend->name))
-    {
-      snprintf (backend->name, LABEL_MAX, "%s", _("SDS sampler"));
-    }
+  backend->calibrate = sds_calibrate;
 
   return 0;
 }
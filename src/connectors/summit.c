@@ -163,6 +163,7 @@ static gint
 summit_patch_next_dentry (struct item_iterator *iter)
 {
   GByteArray *tx_msg, *rx_msg;
+  gchar name[SUMMIT_PATCH_NAME_LEN + 1];
   struct summit_bank_iterator_data *data = iter->data;
 
   if (data->next >= SUMMIT_PATCHES_PER_BANK)
@@ -177,11 +178,11 @@ summit_patch_next_dentry (struct item_iterator *iter)
       return -EIO;
     }
 
-  memcpy (iter->item.name, SUMMIT_GET_NAME_FROM_MSG (rx_msg, data->fs),
+  memcpy (name, SUMMIT_GET_NAME_FROM_MSG (rx_msg, data->fs),
 	  SUMMIT_PATCH_NAME_LEN);
-  iter->item.name[SUMMIT_PATCH_NAME_LEN] = 0;
-  gchar *c = &iter->item.name[SUMMIT_PATCH_NAME_LEN - 1];
-  summit_truncate_name (c);
+  name[SUMMIT_PATCH_NAME_LEN] = 0;
+  summit_truncate_name (&name[SUMMIT_PATCH_NAME_LEN - 1]);
+  item_set_name (&iter->item, "%s", name);
   if (data->fs == FS_SUMMIT_SINGLE_PATCH)
     {
       const gchar *category = summit_get_category_name (rx_msg);
@@ -195,7 +196,7 @@ summit_patch_next_dentry (struct item_iterator *iter)
     data->fs == FS_SUMMIT_SINGLE_PATCH ? SUMMIT_SINGLE_LEN : SUMMIT_MULTI_LEN;
   data->next++;
 
-  usleep (SUMMIT_REST_TIME_US);
+  backend_rest (data->backend, SUMMIT_REST_TIME_US);
 
   return 0;
 }
@@ -211,7 +212,7 @@ summit_patch_next_dentry_root (struct item_iterator *iter)
       item_set_name (&iter->item, "%c", 0x41 + iter->item.id);
       iter->item.type = ITEM_TYPE_DIR;
       iter->item.size = -1;
-      iter->item.object_info[0] = 0;
+      item_set_object_info (&iter->item, "%s", "");
       (*next)++;
       return 0;
     }
@@ -322,7 +323,7 @@ summit_patch_download (struct backend *backend, const gchar *path,
 cleanup:
   free_msg (rx_msg);
 end:
-  usleep (SUMMIT_REST_TIME_US);
+  backend_rest (backend, SUMMIT_REST_TIME_US);
   return err;
 }
 
@@ -370,7 +371,7 @@ summit_patch_upload (struct backend *backend, const gchar *path,
 cleanup:
   free_msg (msg);
 end:
-  usleep (SUMMIT_REST_TIME_US);
+  backend_rest (backend, SUMMIT_REST_TIME_US);
   return err;
 }
 
@@ -419,7 +420,7 @@ summit_patch_rename (struct backend *backend, const gchar *src,
       goto end;
     }
 
-  usleep (SUMMIT_REST_TIME_US);
+  backend_rest (backend, SUMMIT_REST_TIME_US);
 
   name = SUMMIT_GET_NAME_FROM_MSG (preset.content, fs);
   sanitized = common_get_sanitized_name (dst, SUMMIT_ALPHABET,
@@ -437,7 +438,7 @@ summit_patch_rename (struct backend *backend, const gchar *src,
       free_msg (rx_msg);
     }
 
-  usleep (SUMMIT_REST_TIME_US);
+  backend_rest (backend, SUMMIT_REST_TIME_US);
 
 end:
   controllable_clear (&control.controllable);
@@ -524,7 +525,7 @@ static const struct fs_operations FS_SUMMIT_SINGLE_OPERATIONS = {
   .id = FS_SUMMIT_SINGLE_PATCH,
   .options = FS_OPTION_SINGLE_OP | FS_OPTION_SLOT_STORAGE |
     FS_OPTION_SHOW_SIZE_COLUMN | FS_OPTION_SHOW_SLOT_COLUMN |
-    FS_OPTION_SHOW_INFO_COLUMN | FS_OPTION_ALLOW_SEARCH,
+    FS_OPTION_SHOW_INFO_COLUMN | FS_OPTION_ALLOW_SEARCH | FS_OPTION_SLOT_CACHE,
   .name = "single",
   .gui_name = "Single",
   .gui_icon = FS_ICON_PRESET,
@@ -548,7 +549,7 @@ static const struct fs_operations FS_SUMMIT_MULTI_OPERATIONS = {
   .id = FS_SUMMIT_MULTI_PATCH,
   .options = FS_OPTION_SINGLE_OP | FS_OPTION_SLOT_STORAGE |
     FS_OPTION_SHOW_SIZE_COLUMN | FS_OPTION_SHOW_SLOT_COLUMN |
-    FS_OPTION_ALLOW_SEARCH,
+    FS_OPTION_ALLOW_SEARCH | FS_OPTION_SLOT_CACHE,
   .name = "multi",
   .gui_name = "Multi",
   .gui_icon = FS_ICON_PRESET,
@@ -653,7 +654,7 @@ summit_tuning_download (struct backend *backend, const gchar *path,
 cleanup:
   free_msg (rx_msg);
 end:
-  usleep (SUMMIT_REST_TIME_US);
+  backend_rest (backend, SUMMIT_REST_TIME_US);
   return err;
 }
 
@@ -727,6 +728,7 @@ static gint
 summit_wavetable_next_dentry (struct item_iterator *iter)
 {
   GByteArray *tx_msg, *rx_msg;
+  gchar name[SUMMIT_WAVETABLE_NAME_LEN + 1];
   struct summit_bank_iterator_data *data = iter->data;
 
   if (data->next >= SUMMIT_MAX_WAVETABLES)
@@ -741,10 +743,10 @@ summit_wavetable_next_dentry (struct item_iterator *iter)
       return -EIO;
     }
 
-  memcpy (iter->item.name, &rx_msg->data[15], SUMMIT_WAVETABLE_NAME_LEN);
-  iter->item.name[SUMMIT_WAVETABLE_NAME_LEN] = 0;
-  gchar *c = &iter->item.name[SUMMIT_WAVETABLE_NAME_LEN - 1];
-  summit_truncate_name (c);
+  memcpy (name, &rx_msg->data[15], SUMMIT_WAVETABLE_NAME_LEN);
+  name[SUMMIT_WAVETABLE_NAME_LEN] = 0;
+  summit_truncate_name (&name[SUMMIT_WAVETABLE_NAME_LEN - 1]);
+  item_set_name (&iter->item, "%s", name);
   free_msg (rx_msg);
 
   iter->item.id = data->next;
@@ -752,7 +754,7 @@ summit_wavetable_next_dentry (struct item_iterator *iter)
   iter->item.size = 2678;
   data->next++;
 
-  usleep (SUMMIT_REST_TIME_US * 10);
+  backend_rest (data->backend, SUMMIT_REST_TIME_US * 10);
 
   return 0;
 }
@@ -816,7 +818,7 @@ summit_wavetable_download (struct backend *backend, const gchar *path,
   g_byte_array_append (output, rx_msg->data, rx_msg->len);
   free_msg (rx_msg);
 
-  usleep (SUMMIT_REST_TIME_US);
+  backend_rest (backend, SUMMIT_REST_TIME_US);
 
   //Waves
   for (gint8 i = 0; i < SUMMIT_WAVETABLE_WAVES; i++)
@@ -836,7 +838,7 @@ summit_wavetable_download (struct backend *backend, const gchar *path,
       g_byte_array_append (output, rx_msg->data, rx_msg->len);
       free_msg (rx_msg);
 
-      usleep (SUMMIT_REST_TIME_US);
+      backend_rest (backend, SUMMIT_REST_TIME_US);
     }
 
   memcpy (name, &output->data[15], SUMMIT_WAVETABLE_NAME_LEN);
@@ -850,7 +852,7 @@ err:
   g_byte_array_free (output, TRUE);
   free_msg (rx_msg);
 end:
-  usleep (SUMMIT_REST_TIME_US);
+  backend_rest (backend, SUMMIT_REST_TIME_US);
   return err;
 }
 
@@ -926,7 +928,8 @@ summit_wavetable_rename (struct backend *backend, const gchar *src,
 static const struct fs_operations FS_SUMMIT_WAVETABLE_OPERATIONS = {
   .id = FS_SUMMIT_WAVETABLE,
   .options = FS_OPTION_SINGLE_OP | FS_OPTION_SLOT_STORAGE |
-    FS_OPTION_SHOW_ID_COLUMN | FS_OPTION_SHOW_SIZE_COLUMN,
+    FS_OPTION_SHOW_ID_COLUMN | FS_OPTION_SHOW_SIZE_COLUMN |
+    FS_OPTION_SLOT_CACHE,
   .name = "wavetable",
   .gui_name = "Wavetables",
   .gui_icon = FS_ICON_WAVETABLE,
@@ -966,5 +969,7 @@ const struct connector CONNECTOR_SUMMIT = {
   .handshake = summit_handshake,
   .name = "summit",
   .options = 0,
-  .regex = ".*(Peak|Summit).*"
+  .regex = ".*(Peak|Summit).*",
+  .midi_company = { 0, 0x20, 0x29 },
+  .midi_family = { 0x33, 0x1 }
 };
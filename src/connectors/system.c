@@ -28,6 +28,7 @@
 #endif
 #include "local.h"
 #include "sample.h"
+#include "sample_index.h"
 #include "connectors/common.h"
 
 struct system_iterator_data
@@ -115,6 +116,35 @@ system_free_iterator_data (void *iter_data)
   g_free (data);
 }
 
+//The sample index avoids parsing the headers of the unchanged files again.
+
+static void
+system_load_sample_info (const gchar *path, struct sample_info *sample_info)
+{
+  GStatBuf sb;
+  gint64 mtime;
+
+  sample_info_init (sample_info);
+
+  //GFileInfo only provides the nanoseconds since GLib 2.74.
+  if (g_stat (path, &sb))
+    {
+      sample_load_sample_info (path, sample_info);
+      return;
+    }
+
+  mtime = sample_index_get_mtime (&sb);
+  if (sample_index_get_sample_info (path, sb.st_size, mtime, sample_info))
+    {
+      return;
+    }
+
+  if (!sample_load_sample_info (path, sample_info))
+    {
+      sample_index_set_sample_info (path, sb.st_size, mtime, sample_info);
+    }
+}
+
 static gint
 system_next_dentry (struct item_iterator *iter, gboolean sample_info)
 {
@@ -163,7 +193,7 @@ system_next_dentry (struct item_iterator *iter, gboolean sample_info)
 	    {
 	      if (iter->item.type == ITEM_TYPE_FILE && sample_info)
 		{
-		  sample_load_sample_info (full_path,
+		  system_load_sample_info (full_path,
 					   &iter->item.sample_info);
 		}
 	      err = 0;
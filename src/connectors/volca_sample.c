@@ -18,12 +18,14 @@
  *   along with Elektroid. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <math.h>
+#include <samplerate.h>
 #include "audio.h"
 #include "sample.h"
 #include "common.h"
+#include "volca_sample.h"
 #include "volca_sample_sdk/korg_syro_volcasample.h"
-
-#define VOLCA_SAMPLE_MAX_SAMPLES 100
+#include "volca_sample_sdk/korg_syro_comp.h"
 
 #define VOLCA_SAMPLE_RATE 31250
 #define VOLCA_SAMPLE_SYRO_RATE 44100
@@ -35,7 +37,19 @@
 
 #define VOLCA_SAMPLE_SLEEP_US 200000
 
-#define VOLCA_SAMPLE_UPLOAD_STAGES 4
+//Loading and streaming
+#define VOLCA_SAMPLE_UPLOAD_STAGES 2
+//Loading, Syro conversion and saving
+#define VOLCA_SAMPLE_DUMP_STAGES 4
+
+#define VOLCA_SAMPLE_STREAM_BLOCK_FRAMES 4096
+//Needed as libsamplerate might generate a few additional frames per call.
+#define VOLCA_SAMPLE_STREAM_BLOCK_MARGIN 16
+
+//The SDK allows up to 109 entries per stream so that a full kit fits in one.
+#define VOLCA_SAMPLE_BATCH_MAX_ENTRIES VOLCA_SAMPLE_MAX_SAMPLES
+//Longer streams are split so that an error does not ruin a long transfer. This is a bit more than 2 minutes of sample data and more than the device can store.
+#define VOLCA_SAMPLE_BATCH_MAX_BYTES (8 * 1024 * 1024)
 
 enum volca_sample_fs
 {
@@ -67,106 +81,403 @@ volca_sample_read_dir (struct backend *backend, struct item_iterator *iter,
   return 0;
 }
 
+struct volca_sample_syro
+{
+  SyroHandle handle;
+  guint entries;
+  guint32 frames;
+  guint32 pos;
+};
+
 static gint
-volca_sample_send_syro (struct idata *syro, struct task_control *control)
+volca_sample_syro_start (struct volca_sample_syro *syro, SyroData *data,
+			 guint entries)
+{
+  SyroStatus status;
+
+  //Compression blocks are independent so they are spread across all the cores.
+  SyroComp_SetParallelFor (parallel_for);
+
+  status = SyroVolcaSample_Start (&syro->handle, data, entries, 0,
+				  &syro->frames);
+  if (status != Status_Success)
+    {
+      return -EIO;
+    }
+
+  debug_print (1, "Reported %d SYRO frames for %d entries", syro->frames,
+	       entries);
+
+  syro->entries = entries;
+
+  syro->pos = 0;
+
+  return 0;
+}
+
+//Frames are interleaved. Less frames than requested are only read at the end.
+
+static guint32
+volca_sample_syro_read (struct volca_sample_syro *syro, gint16 *buffer,
+			guint32 frames)
+{
+  frames = MIN (frames, syro->frames - syro->pos);
+
+  for (guint32 i = 0; i < frames; i++, buffer += VOLCA_SAMPLE_SYRO_CHANNELS)
+    {
+      // The returning value is ignored in korg_syro_volcasample_example.c so it's done here too.
+      // It returns errors on long samples without compression but...
+      SyroVolcaSample_GetSample (syro->handle, &buffer[0], &buffer[1]);
+    }
+
+  syro->pos += frames;
+
+  return frames;
+}
+
+//Returns the amount of entries completely read.
+
+static guint
+volca_sample_syro_get_read_entries (struct volca_sample_syro *syro)
+{
+  gint entries;
+
+  if (SyroVolcaSample_GetCurrentData (syro->handle, &entries) !=
+      Status_Success)
+    {
+      return 0;
+    }
+
+  return entries;
+}
+
+static gint
+volca_sample_syro_end (struct volca_sample_syro *syro)
+{
+  SyroStatus status = SyroVolcaSample_End (syro->handle);
+  return status == Status_Success ? 0 : -EIO;
+}
+
+struct volca_sample_stream
+{
+  struct audio_stream stream;
+  gboolean float_mode;
+  SRC_STATE *src_state;		//NULL if no resampling is needed
+  gdouble ratio;
+  guint32 output_frames;	//Capacity of the output buffers
+  gfloat *input_f;
+  gfloat *output_f;
+  gint16 *output_s16;
+  //Progress is reported per entry.
+  gint part;			//Part of the first entry
+  guint entries;
+  guint rendered;
+  guint32 *ends;		//Output frames where the rendered entries end
+};
+
+//The Syro signal is played while it is generated so the memory used does not depend on the sample length.
+
+//Entries still not rendered are estimated to share the remaining frames equally.
+
+static void
+volca_sample_stream_progress (guint32 played, struct task_control *control,
+			      gpointer data)
+{
+  guint entry;
+  guint32 start, end;
+  gdouble progress;
+  struct volca_sample_stream *vs = data;
+
+  entry = 0;
+  while (entry < vs->rendered && played >= vs->ends[entry])
+    {
+      entry++;
+    }
+
+  if (entry == vs->entries)
+    {
+      control->part = vs->part + vs->entries - 1;
+      task_control_set_progress (control, 1.0);
+      return;
+    }
+
+  start = entry ? vs->ends[entry - 1] : 0;
+  if (entry < vs->rendered)
+    {
+      end = vs->ends[entry];
+    }
+  else
+    {
+      end = start + (vs->stream.total - start) / (vs->entries - entry);
+    }
+
+  progress = end > start ? (played - start) / (gdouble) (end - start) : 1.0;
+  control->part = vs->part + entry;
+  task_control_set_progress (control, MIN (progress, 1.0));
+}
+
+static gint
+volca_sample_stream_init (struct volca_sample_stream *vs, guint32 frames,
+			  guint entries, struct task_control *control)
 {
   gint err;
-  struct idata sample;
-  struct sample_load_opts opts;
 
-  //Native samplerate and sample type conversion
+  vs->float_mode = sample_get_internal_format () == SF_FORMAT_FLOAT;
+  vs->ratio = audio.rate / (gdouble) VOLCA_SAMPLE_SYRO_RATE;
+  vs->output_frames = ceil (VOLCA_SAMPLE_STREAM_BLOCK_FRAMES * vs->ratio) +
+    VOLCA_SAMPLE_STREAM_BLOCK_MARGIN;
+  vs->src_state = NULL;
+  vs->input_f = NULL;
+  vs->output_f = NULL;
+  vs->output_s16 = NULL;
 
-  sample_load_opts_init (&opts, VOLCA_SAMPLE_SYRO_CHANNELS, audio.rate,
-			 sample_get_internal_format (), FALSE);
+  if (audio.rate != VOLCA_SAMPLE_SYRO_RATE)
+    {
+      //The resampling is done while playing so a faster converter makes underruns less likely.
+      vs->src_state = src_new (SRC_SINC_MEDIUM_QUALITY,
+			       VOLCA_SAMPLE_SYRO_CHANNELS, &err);
+      if (!vs->src_state)
+	{
+	  error_print ("Error while creating the resampler: %s",
+		       src_strerror (err));
+	  return -EIO;
+	}
+
+      vs->output_f = g_malloc (vs->output_frames *
+			       VOLCA_SAMPLE_SYRO_CHANNELS * sizeof (gfloat));
+      if (!vs->float_mode)
+	{
+	  vs->output_s16 = g_malloc (vs->output_frames *
+				     VOLCA_SAMPLE_SYRO_CHANNELS *
+				     sizeof (gint16));
+	}
+    }
+
+  if (vs->src_state || vs->float_mode)
+    {
+      vs->input_f = g_malloc (VOLCA_SAMPLE_STREAM_BLOCK_FRAMES *
+			      VOLCA_SAMPLE_SYRO_CHANNELS * sizeof (gfloat));
+    }
+
+  audio_stream_init (&vs->stream, ceil (frames * vs->ratio));
+
+  vs->part = control ? control->part : 0;
+  vs->entries = entries;
+  vs->rendered = 0;
+  vs->ends = g_malloc (entries * sizeof (guint32));
+  vs->stream.progress = volca_sample_stream_progress;
+  vs->stream.progress_data = vs;
+
+  return 0;
+}
+
+static gint
+volca_sample_stream_resample (struct volca_sample_stream *vs, guint32 frames,
+			      gboolean last, struct task_control *control)
+{
+  gint err;
+  SRC_DATA src_data;
+
+  src_data.data_in = vs->input_f;
+  src_data.input_frames = frames;
+  src_data.src_ratio = vs->ratio;
+  src_data.end_of_input = last;
+
+  //At the end, the resampler is called until no more frames are generated.
+  do
+    {
+      src_data.data_out = vs->output_f;
+      src_data.output_frames = vs->output_frames;
+
+      err = src_process (vs->src_state, &src_data);
+      if (err)
+	{
+	  error_print ("Error while resampling: %s", src_strerror (err));
+	  return -EIO;
+	}
+
+      src_data.data_in += src_data.input_frames_used *
+	VOLCA_SAMPLE_SYRO_CHANNELS;
+      src_data.input_frames -= src_data.input_frames_used;
+
+      if (vs->float_mode)
+	{
+	  err = audio_stream_write (&vs->stream, vs->output_f,
+				    src_data.output_frames_gen, control);
+	}
+      else
+	{
+	  src_float_to_short_array (vs->output_f, vs->output_s16,
+				    src_data.output_frames_gen *
+				    VOLCA_SAMPLE_SYRO_CHANNELS);
+	  err = audio_stream_write (&vs->stream, vs->output_s16,
+				    src_data.output_frames_gen, control);
+	}
+    }
+  while (!err && (src_data.input_frames ||
+		  (last && src_data.output_frames_gen)));
+
+  return err;
+}
+
+static gint
+volca_sample_stream_write (struct volca_sample_stream *vs, gint16 *input,
+			   guint32 frames, gboolean last,
+			   struct task_control *control)
+{
+  if (!vs->src_state && !vs->float_mode)
+    {
+      return audio_stream_write (&vs->stream, input, frames, control);
+    }
+
+  src_short_to_float_array (input, vs->input_f,
+			    frames * VOLCA_SAMPLE_SYRO_CHANNELS);
+
+  if (vs->src_state)
+    {
+      return volca_sample_stream_resample (vs, frames, last, control);
+    }
+  else
+    {
+      return audio_stream_write (&vs->stream, vs->input_f, frames, control);
+    }
+}
+
+static gint
+volca_sample_stream_end (struct volca_sample_stream *vs,
+			 struct task_control *control)
+{
+  gint err = audio_stream_end (&vs->stream, control);
+
+  if (vs->src_state)
+    {
+      src_delete (vs->src_state);
+    }
+  g_free (vs->input_f);
+  g_free (vs->output_f);
+  g_free (vs->output_s16);
+  g_free (vs->ends);
+
+  return err;
+}
+
+//Every entry uses a part of the control.
+
+static gint
+volca_sample_send_syro (SyroData *data, guint entries,
+			struct task_control *control)
+{
+  gint err, end_err;
+  guint32 frames;
+  gint16 *buffer;
+  struct volca_sample_syro syro;
+  struct volca_sample_stream vs;
 
-  err = sample_reload (syro, &sample, control, &opts,
-		       task_control_set_sample_progress);
+  err = volca_sample_syro_start (&syro, data, entries);
   if (err)
     {
       return err;
     }
 
-  if (control)
+  err = volca_sample_stream_init (&vs, syro.frames, entries, control);
+  if (err)
     {
-      control->part++;
+      volca_sample_syro_end (&syro);
+      return err;
     }
 
-  //Playback
+  buffer = g_malloc (VOLCA_SAMPLE_STREAM_BLOCK_FRAMES *
+		     VOLCA_SAMPLE_SYRO_CHANNELS * sizeof (gint16));
 
-  audio_set_play_and_wait (&sample, control);
+  while (!err && syro.pos < syro.frames)
+    {
+      frames = volca_sample_syro_read (&syro, buffer,
+				       VOLCA_SAMPLE_STREAM_BLOCK_FRAMES);
+      err = volca_sample_stream_write (&vs, buffer, frames,
+				       syro.pos == syro.frames, control);
+
+      for (guint e = volca_sample_syro_get_read_entries (&syro);
+	   vs.rendered < e; vs.rendered++)
+	{
+	  vs.ends[vs.rendered] = ceil (syro.pos * vs.ratio);
+	}
+    }
+
+  g_free (buffer);
+
+  end_err = volca_sample_stream_end (&vs, control);
+  err = err ? err : end_err;
+
+  end_err = volca_sample_syro_end (&syro);
+  err = err ? err : end_err;
+
+  if (err)
+    {
+      return err;
+    }
 
   usleep (VOLCA_SAMPLE_SLEEP_US);
 
   if (control)
     {
-      control->part++;
+      control->part = vs.part + entries;
     }
 
-  idata_clear (syro);
-
   return 0;
 }
 
 gint
-volca_sample_get_syro_op (SyroData *data, struct idata *syro_op,
-			  struct task_control *control)
+volca_sample_get_syro_op (SyroData *data, guint entries,
+			  struct idata *syro_op, struct task_control *control)
 {
-  guint32 i, j, update_frames, frames;
-  gint16 left, right;
-  SyroHandle handle;
-  SyroStatus status;
+  gint err;
+  gint16 *buffer;
   GByteArray *content;
   struct sample_info *syro_si;
+  struct volca_sample_syro syro;
 
-  status = SyroVolcaSample_Start (&handle, data, 1, 0, &frames);
-  if (status != Status_Success)
+  err = volca_sample_syro_start (&syro, data, entries);
+  if (err)
     {
-      return -EIO;
+      return err;
     }
 
-  debug_print (1, "Reported %d SYRO frames", frames);
-
   syro_si = sample_info_new (FALSE);
-  syro_si->frames = frames;
-  syro_si->loop_start = frames - 1;
+  syro_si->frames = syro.frames;
+  syro_si->loop_start = syro.frames - 1;
   syro_si->loop_end = syro_si->loop_start;
   syro_si->rate = VOLCA_SAMPLE_SYRO_RATE;
   syro_si->format = SF_FORMAT_PCM_16;
   syro_si->channels = VOLCA_SAMPLE_SYRO_CHANNELS;
 
-  content = g_byte_array_sized_new (frames * VOLCA_SAMPLE_SYRO_CHANNELS *
+  content = g_byte_array_sized_new (syro.frames * VOLCA_SAMPLE_SYRO_CHANNELS *
 				    sizeof (gint16));
+  g_byte_array_set_size (content, syro.frames * VOLCA_SAMPLE_SYRO_CHANNELS *
+			 sizeof (gint16));
 
   idata_init (syro_op, content, NULL, syro_si, sample_info_free);
 
-  i = 0;
-  j = 0;
-  update_frames = frames / (100 / VOLCA_SAMPLE_UPLOAD_STAGES);
-  while (i < frames)
+  buffer = (gint16 *) content->data;
+  while (syro.pos < syro.frames)
     {
-      // The returning value is ignored in korg_syro_volcasample_example.c so it's done here too.
-      // It returns errors on long samples without compression but...
-      SyroVolcaSample_GetSample (handle, &left, &right);
-      g_byte_array_append (content, (guint8 *) & left, sizeof (gint16));
-      g_byte_array_append (content, (guint8 *) & right, sizeof (gint16));
-
-      i++;
-      j++;
+      buffer += volca_sample_syro_read (&syro, buffer,
+					VOLCA_SAMPLE_STREAM_BLOCK_FRAMES) *
+	VOLCA_SAMPLE_SYRO_CHANNELS;
 
-      if (control && j == update_frames)
+      if (control)
 	{
-	  task_control_set_progress (control, i / (gdouble) frames);
-	  update_frames = 0;
+	  task_control_set_progress (control,
+				     syro.pos / (gdouble) syro.frames);
 	}
     }
 
   debug_print (1, "Read %d SYRO frames", syro_si->frames);
 
-  status = SyroVolcaSample_End (handle);
-  if (status != Status_Success)
+  err = volca_sample_syro_end (&syro);
+  if (err)
     {
       idata_clear (syro_op);
-      return -EIO;
+      return err;
     }
 
   if (control)
@@ -177,23 +488,31 @@ volca_sample_get_syro_op (SyroData *data, struct idata *syro_op,
   return 0;
 }
 
+static void
+volca_sample_init_upload_data (SyroData *data, guint id, struct idata *input,
+			       guint32 quality)
+{
+  struct sample_info *sample_info = input->info;
+
+  // DataType_Sample_Compress uses quality between 8 and 16. DataType_Sample_Liner uses 0.
+  data->DataType = quality ? DataType_Sample_Compress : DataType_Sample_Liner;
+  data->pData = input->content->data;
+  data->Number = id;
+  data->Size = input->content->len;
+  data->Quality = quality;
+  data->Fs = sample_info->rate;
+  data->SampleEndian = LittleEndian;
+}
+
 gint
 volca_sample_get_upload (guint id, struct idata *input, struct idata *syro_op,
 			 guint32 quality, struct task_control *control)
 {
   SyroData data;
-  struct sample_info *sample_info = input->info;
 
-  // DataType_Sample_Compress uses quality between 8 and 16. DataType_Sample_Liner uses 0.
-  data.DataType = quality ? DataType_Sample_Compress : DataType_Sample_Liner;
-  data.pData = input->content->data;
-  data.Number = id;
-  data.Size = input->content->len;
-  data.Quality = quality;
-  data.Fs = sample_info->rate;
-  data.SampleEndian = LittleEndian;
+  volca_sample_init_upload_data (&data, id, input, quality);
 
-  return volca_sample_get_syro_op (&data, syro_op, control);
+  return volca_sample_get_syro_op (&data, 1, syro_op, control);
 }
 
 static gint
@@ -222,6 +541,7 @@ volca_sample_upload_quality (const gchar *path, struct idata *sample,
 {
   guint id;
   gint err;
+  SyroData data;
   struct idata syro_op;
 
   err = common_slot_get_id_from_path (path, &id);
@@ -235,6 +555,12 @@ volca_sample_upload_quality (const gchar *path, struct idata *sample,
       return -EINVAL;
     }
 
+  if (upload)
+    {
+      volca_sample_init_upload_data (&data, id, sample, quality);
+      return volca_sample_send_syro (&data, 1, control);
+    }
+
   //Syro conversion
 
   err = volca_sample_get_upload (id, sample, &syro_op, quality, control);
@@ -243,14 +569,7 @@ volca_sample_upload_quality (const gchar *path, struct idata *sample,
       return err;
     }
 
-  if (upload)
-    {
-      return volca_sample_send_syro (&syro_op, control);
-    }
-  else
-    {
-      return volca_sample_dump_syro (&syro_op, id, control);
-    }
+  return volca_sample_dump_syro (&syro_op, id, control);
 }
 
 static gint
@@ -296,12 +615,12 @@ volca_sample_dump_8b (struct backend *backend, const gchar *path,
 }
 
 static gint
-volca_sample_load (struct backend *backend, const gchar *path,
-		   struct idata *sample, struct task_control *control)
+volca_sample_load_stages (const gchar *path, struct idata *sample,
+			  struct task_control *control, gint stages)
 {
   gint err;
 
-  task_control_reset (control, VOLCA_SAMPLE_UPLOAD_STAGES);
+  task_control_reset (control, stages);
 
   // Resampling is not needed but doing it here makes results repeatable and testable as the syro resampler is avoided.
   // 16 bits is required.
@@ -317,17 +636,40 @@ volca_sample_load (struct backend *backend, const gchar *path,
   return 0;
 }
 
+static gint
+volca_sample_load (struct backend *backend, const gchar *path,
+		   struct idata *sample, struct task_control *control)
+{
+  return volca_sample_load_stages (path, sample, control,
+				   VOLCA_SAMPLE_UPLOAD_STAGES);
+}
+
+static gint
+volca_sample_dump_load (struct backend *backend, const gchar *path,
+			struct idata *sample, struct task_control *control)
+{
+  return volca_sample_load_stages (path, sample, control,
+				   VOLCA_SAMPLE_DUMP_STAGES);
+}
+
+static void
+volca_sample_init_delete_data (SyroData *data, guint id)
+{
+  data->DataType = DataType_Sample_Erase;
+  data->pData = NULL;
+  data->Number = id;
+  data->Size = 0;
+  data->SampleEndian = LittleEndian;
+}
+
 gint
 volca_sample_get_delete (guint id, struct idata *syro_op)
 {
   SyroData data;
 
-  data.DataType = DataType_Sample_Erase;
-  data.pData = NULL;
-  data.Number = id;
-  data.SampleEndian = LittleEndian;
+  volca_sample_init_delete_data (&data, id);
 
-  return volca_sample_get_syro_op (&data, syro_op, NULL);
+  return volca_sample_get_syro_op (&data, 1, syro_op, NULL);
 }
 
 static gint
@@ -335,7 +677,7 @@ volca_sample_delete (struct backend *backend, const gchar *path)
 {
   guint id;
   gint err;
-  struct idata syro_op;
+  SyroData data;
 
   err = common_slot_get_id_from_path (path, &id);
   if (err)
@@ -348,13 +690,160 @@ volca_sample_delete (struct backend *backend, const gchar *path)
       return -EINVAL;
     }
 
-  err = volca_sample_get_delete (id, &syro_op);
-  if (err)
+  volca_sample_init_delete_data (&data, id);
+
+  return volca_sample_send_syro (&data, 1, NULL);
+}
+
+//Returns how many of the first entries fit in a single stream. This is at least 1.
+
+guint
+volca_sample_get_batch_len (SyroData *data, guint entries)
+{
+  guint i;
+  guint64 size = 0;
+
+  for (i = 0; i < entries && i < VOLCA_SAMPLE_BATCH_MAX_ENTRIES; i++)
     {
-      return err;
+      size += data[i].Size;
+      if (i && size > VOLCA_SAMPLE_BATCH_MAX_BYTES)
+	{
+	  break;
+	}
+    }
+
+  return i;
+}
+
+//Items with an error already set are skipped. Items with an invalid path get their error and are not sent either. Returns how many entries were initialized.
+
+guint
+volca_sample_init_batch_data (struct fs_batch_item *items, guint len,
+			      guint32 quality, SyroData *data,
+			      struct fs_batch_item **entry_items)
+{
+  guint id, entries = 0;
+
+  for (guint i = 0; i < len; i++)
+    {
+      if (items[i].err)
+	{
+	  continue;
+	}
+
+      items[i].err = common_slot_get_id_from_path (items[i].path, &id);
+      if (!items[i].err && id >= VOLCA_SAMPLE_MAX_SAMPLES)
+	{
+	  items[i].err = -EINVAL;
+	}
+      if (items[i].err)
+	{
+	  error_print ("Invalid path '%s'", items[i].path);
+	  continue;
+	}
+
+      if (items[i].idata)
+	{
+	  volca_sample_init_upload_data (&data[entries], id, items[i].idata,
+					 quality);
+	}
+      else
+	{
+	  volca_sample_init_delete_data (&data[entries], id);
+	}
+      entry_items[entries] = &items[i];
+      entries++;
+    }
+
+  return entries;
+}
+
+//The control parts are the items. As a stream only contains consecutive items, the parts of the ones not sent are skipped.
+
+static gint
+volca_sample_upload_batch_quality (struct fs_batch_item *items, guint len,
+				   guint32 quality,
+				   struct task_control *control)
+{
+  gint err = 0;
+  guint entries, next, first, batch_len = 0;
+  SyroData *data = g_malloc (len * sizeof (SyroData));
+  struct fs_batch_item **entry_items =
+    g_malloc (len * sizeof (struct fs_batch_item *));
+
+  entries = volca_sample_init_batch_data (items, len, quality, data,
+					  entry_items);
+
+  task_control_reset (control, len);
+
+  for (next = 0; next < entries; next += batch_len)
+    {
+      batch_len = volca_sample_get_batch_len (&data[next], entries - next);
+      first = entry_items[next] - items;
+      for (guint i = 1; i < batch_len; i++)
+	{
+	  if (entry_items[next + i] - items != first + i)
+	    {
+	      batch_len = i;
+	      break;
+	    }
+	}
+      control->part = first;
+
+      debug_print (1, "Sending %d entries from %d in one stream...",
+		   batch_len, next);
+
+      err = volca_sample_send_syro (&data[next], batch_len, control);
+      for (guint i = next; i < next + batch_len; i++)
+	{
+	  entry_items[i]->err = err;
+	}
+
+      if (err)
+	{
+	  break;
+	}
+    }
+
+  //The entries not sent after an error fail with it too.
+  for (guint i = next + batch_len; i < entries && err; i++)
+    {
+      entry_items[i]->err = err;
+    }
+
+  for (guint i = 0; i < len && !err; i++)
+    {
+      err = items[i].err;
     }
 
-  return volca_sample_send_syro (&syro_op, NULL);
+  g_free (data);
+  g_free (entry_items);
+
+  return err;
+}
+
+static gint
+volca_sample_upload_batch (struct backend *backend,
+			   struct fs_batch_item *items, guint len,
+			   struct task_control *control)
+{
+  return volca_sample_upload_batch_quality (items, len, 0, control);
+}
+
+static gint
+volca_sample_upload_batch_16b (struct backend *backend,
+			       struct fs_batch_item *items, guint len,
+			       struct task_control *control)
+{
+  return volca_sample_upload_batch_quality (items, len, 16, control);
+}
+
+static gint
+volca_sample_upload_batch_8b (struct backend *backend,
+			      struct fs_batch_item *items, guint len,
+			      struct task_control *control)
+{
+  return volca_sample_upload_batch_quality (items, len, 8, control);
 }
 
 static const struct fs_operations FS_VOLCA_SAMPLE_OPERATIONS = {
@@ -370,6 +859,7 @@ static const struct fs_operations FS_VOLCA_SAMPLE_OPERATIONS = {
   .print_item = common_print_item,
   .upload = volca_sample_upload,
   .load = volca_sample_load,
+  .upload_batch = volca_sample_upload_batch,
   .get_exts = sample_get_sample_extensions,
   .get_upload_path = common_slot_get_upload_path
 };
@@ -387,6 +877,7 @@ static const struct fs_operations FS_VOLCA_SAMPLE_COMP_16B_OPERATIONS = {
   .print_item = common_print_item,
   .upload = volca_sample_upload_16b,
   .load = volca_sample_load,
+  .upload_batch = volca_sample_upload_batch_16b,
   .get_exts = sample_get_sample_extensions,
   .get_upload_path = common_slot_get_upload_path
 };
@@ -404,6 +895,7 @@ static const struct fs_operations FS_VOLCA_SAMPLE_COMP_8B_OPERATIONS = {
   .print_item = common_print_item,
   .upload = volca_sample_upload_8b,
   .load = volca_sample_load,
+  .upload_batch = volca_sample_upload_batch_8b,
   .get_exts = sample_get_sample_extensions,
   .get_upload_path = common_slot_get_upload_path
 };
@@ -416,7 +908,7 @@ static const struct fs_operations FS_VOLCA_SAMPLE_DUMP_OPERATIONS = {
   .delete = volca_sample_delete,
   .print_item = common_print_item,
   .upload = volca_sample_dump,
-  .load = volca_sample_load,
+  .load = volca_sample_dump_load,
   .get_exts = sample_get_sample_extensions,
   .get_upload_path = common_slot_get_upload_path
 };
@@ -429,7 +921,7 @@ static const struct fs_operations FS_VOLCA_SAMPLE_COMP_16B_DUMP_OPERATIONS = {
   .delete = volca_sample_delete,
   .print_item = common_print_item,
   .upload = volca_sample_dump_16b,
-  .load = volca_sample_load,
+  .load = volca_sample_dump_load,
   .get_exts = sample_get_sample_extensions,
   .get_upload_path = common_slot_get_upload_path
 };
@@ -442,7 +934,7 @@ static const struct fs_operations FS_VOLCA_SAMPLE_COMP_8B_DUMP_OPERATIONS = {
   .delete = volca_sample_delete,
   .print_item = common_print_item,
   .upload = volca_sample_dump_8b,
-  .load = volca_sample_load,
+  .load = volca_sample_dump_load,
   .get_exts = sample_get_sample_extensions,
   .get_upload_path = common_slot_get_upload_path
 };
@@ -23,6 +23,8 @@
 
 #include "connector.h"
 
+#define VOLCA_SAMPLE_MAX_SAMPLES 100
+
 extern const struct connector CONNECTOR_VOLCA_SAMPLE;
 
 #endif
@@ -112,19 +112,13 @@ volca_sample_2_sample_get_header (struct backend *backend, guint id,
 
   common_midi_msg_to_8bit_msg (&rx_msg->data[9], (guint8 *) header, 37);
 
-  if (debug_level > 1)
-    {
-      gchar *text = debug_get_hex_data (debug_level, (guint8 *) header,
-					sizeof (struct
-						volca_sample_2_sample_header));
-      debug_print (1, "Message received (%zu): %s",
-		   sizeof (struct volca_sample_2_sample_header), text);
-      g_free (text);
-    }
+  debug_print_hex (2, header, sizeof (struct volca_sample_2_sample_header),
+		   "Message received (%zu): %s",
+		   sizeof (struct volca_sample_2_sample_header));
 
   free_msg (rx_msg);
 
-  usleep (VOLCA_SAMPLE_2_REST_TIME_US);
+  backend_rest (backend, VOLCA_SAMPLE_2_REST_TIME_US);
 
   return 0;
 }
@@ -164,16 +158,35 @@ volca_sample_2_sample_get_data (struct backend *backend, guint id,
   common_midi_msg_to_8bit_msg (&rx_msg->data[9], data->data, dump_size);
   free_msg (rx_msg);
 
-  usleep (VOLCA_SAMPLE_2_REST_TIME_US);
+  backend_rest (backend, VOLCA_SAMPLE_2_REST_TIME_US);
 
   return data;
 }
 
 static gint
-volca_sample_2_sample_next_dentry (struct item_iterator *iter)
+volca_sample_2_sample_load_item (struct backend *backend, const gchar *path,
+				 struct item *item)
 {
   gint err;
   struct volca_sample_2_sample_header header;
+
+  err = volca_sample_2_sample_get_header (backend, item->id, &header);
+  if (err)
+    {
+      return err;
+    }
+
+  item_set_name (item, "%.*s", VOLCA_SAMPLE_2_SAMPLE_NAME_LEN, header.name);
+  item->size = GUINT32_FROM_LE (header.frames) * sizeof (gint16);
+  sample_info_init (&item->sample_info);
+
+  return 0;
+}
+
+static gint
+volca_sample_2_sample_next_dentry (struct item_iterator *iter)
+{
+  gint err;
   struct volca_sample_2_iter_data *data = iter->data;
 
   if (data->next >= VOLCA_SAMPLE_2_SAMPLE_MAX)
@@ -181,19 +194,14 @@ volca_sample_2_sample_next_dentry (struct item_iterator *iter)
       return -ENOENT;
     }
 
-  err = volca_sample_2_sample_get_header (data->backend, data->next, &header);
+  iter->item.id = data->next;
+  iter->item.type = ITEM_TYPE_FILE;
+  err = volca_sample_2_sample_load_item (data->backend, NULL, &iter->item);
   if (err)
     {
       return err;
     }
 
-  item_set_name (&iter->item, "%.*s", VOLCA_SAMPLE_2_SAMPLE_NAME_LEN,
-		 header.name);
-  iter->item.id = data->next;
-  iter->item.type = ITEM_TYPE_FILE;
-  iter->item.size = GUINT32_FROM_LE (header.frames) * sizeof (gint16);
-  sample_info_init (&iter->item.sample_info);
-
   (data->next)++;
 
   return 0;
@@ -221,6 +229,28 @@ volca_sample_2_sample_read_dir (struct backend *backend,
   return 0;
 }
 
+static gint
+volca_sample_2_sample_read_dir_ids (struct backend *backend,
+				    struct item_iterator *iter,
+				    const gchar *dir,
+				    const gchar **extensions)
+{
+  struct common_simple_read_dir_data *data;
+
+  if (strcmp (dir, "/"))
+    {
+      return -ENOTDIR;
+    }
+
+  data = g_malloc (sizeof (struct common_simple_read_dir_data));
+  data->next = 0;
+  data->last = VOLCA_SAMPLE_2_SAMPLE_MAX - 1;
+
+  item_iterator_init (iter, dir, data, common_slot_ids_next_dentry, g_free);
+
+  return 0;
+}
+
 static struct sample_info *
 volca_sample_2_sample_info_init (guint32 frames)
 {
@@ -412,7 +442,7 @@ volca_sample_2_sample_upload_params (struct backend *backend,
       control->part++;
     }
 
-  usleep (VOLCA_SAMPLE_2_REST_TIME_US);
+  backend_rest (backend, VOLCA_SAMPLE_2_REST_TIME_US);
 
   buff_size = 2 + common_8bit_msg_to_midi_msg_size (size_truncated);
   buff = g_malloc (buff_size);
@@ -439,7 +469,7 @@ volca_sample_2_sample_upload_params (struct backend *backend,
       control->part++;
     }
 
-  usleep (VOLCA_SAMPLE_2_REST_TIME_US);
+  backend_rest (backend, VOLCA_SAMPLE_2_REST_TIME_US);
 
   return 0;
 }
@@ -468,12 +498,14 @@ static const struct fs_operations FS_VOLCA_SAMPLE_2_SAMPLE_OPERATIONS = {
   .id = FS_VOLCA_SAMPLE_2_SAMPLE,
   .options = FS_OPTION_SAMPLE_EDITOR | FS_OPTION_MONO | FS_OPTION_SINGLE_OP |
     FS_OPTION_SLOT_STORAGE | FS_OPTION_SHOW_SLOT_COLUMN |
-    FS_OPTION_SHOW_SIZE_COLUMN | FS_OPTION_ALLOW_SEARCH,
+    FS_OPTION_SHOW_SIZE_COLUMN | FS_OPTION_ALLOW_SEARCH | FS_OPTION_SLOT_CACHE,
   .name = "sample",
   .gui_name = "Samples",
   .gui_icon = FS_ICON_WAVE,
   .file_icon = FS_ICON_WAVE,
   .readdir = volca_sample_2_sample_read_dir,
+  .readdir_ids = volca_sample_2_sample_read_dir_ids,
+  .load_item = volca_sample_2_sample_load_item,
   .print_item = common_print_item,
   .get_slot = volca_sample_2_get_sample_id_as_slot,
   .delete = volca_sample_2_sample_clear,
@@ -553,12 +585,14 @@ static const struct fs_operations FS_VOLCA_SAMPLE_2_SAMPLE_LOOP_OPERATIONS = {
   .id = FS_VOLCA_SAMPLE_2_SAMPLE_LOOP,
   .options = FS_OPTION_SAMPLE_EDITOR | FS_OPTION_MONO | FS_OPTION_SINGLE_OP |
     FS_OPTION_SLOT_STORAGE | FS_OPTION_SHOW_SLOT_COLUMN |
-    FS_OPTION_SHOW_SIZE_COLUMN | FS_OPTION_ALLOW_SEARCH,
+    FS_OPTION_SHOW_SIZE_COLUMN | FS_OPTION_ALLOW_SEARCH | FS_OPTION_SLOT_CACHE,
   .name = "sample-loop",
   .gui_name = "Sample (loop)",
   .gui_icon = FS_ICON_WAVE_LOOP,
   .file_icon = FS_ICON_WAVE,
   .readdir = volca_sample_2_sample_read_dir,
+  .readdir_ids = volca_sample_2_sample_read_dir_ids,
+  .load_item = volca_sample_2_sample_load_item,
   .print_item = common_print_item,
   .get_slot = volca_sample_2_get_sample_id_as_slot,
   .delete = volca_sample_2_sample_clear,
@@ -651,12 +685,8 @@ volca_sample_2_pattern_download_by_id (struct backend *backend, guint8 id,
   common_midi_msg_to_8bit_msg (&rx_msg->data[8], content->data,
 			       rx_msg->len - 9);
 
-  if (debug_level > 1)
-    {
-      gchar *text = debug_get_hex_msg (content);
-      debug_print (1, "Message received (%u): %s", content->len, text);
-      g_free (text);
-    }
+  debug_print_hex_msg (2, content, "Message received (%u): %s",
+		       content->len);
 
   if (panel)
     {
@@ -894,7 +924,8 @@ static const struct fs_operations FS_VOLCA_SAMPLE_2_PATTERN_OPERATIONS = {
   .id = FS_VOLCA_SAMPLE_2_PATTERN,
   .options =
     FS_OPTION_SINGLE_OP | FS_OPTION_SLOT_STORAGE | FS_OPTION_SHOW_SLOT_COLUMN
-    | FS_OPTION_SHOW_SIZE_COLUMN | FS_OPTION_ALLOW_SEARCH,
+    | FS_OPTION_SHOW_SIZE_COLUMN | FS_OPTION_ALLOW_SEARCH |
+    FS_OPTION_SLOT_CACHE,
   .name = "pattern",
   .gui_name = "Patterns",
   .gui_icon = FS_ICON_SEQUENCE,
@@ -951,7 +982,7 @@ volca_sample_2_get_storage_stats (struct backend *backend, guint8 type,
 
 err:
   free_msg (rx_msg);
-  usleep (VOLCA_SAMPLE_2_REST_TIME_US);
+  backend_rest (backend, VOLCA_SAMPLE_2_REST_TIME_US);
   return err;
 }
 
@@ -979,5 +1010,7 @@ const struct connector CONNECTOR_VOLCA_SAMPLE_2 = {
   .name = "volca-sample-2",
   .handshake = volca_sample_2_handshake,
   .options = 0,
-  .regex = ".*volca sample.*"
+  .regex = ".*volca sample.*",
+  .midi_company = { 0x42, 0, 0 },
+  .midi_family = { 0x2d, 0x1 }
 };
@@ -456,54 +456,204 @@ static int SyroComp_CompBlock(uint8_t *map_buffer, uint8_t *dest, ReadSample *pr
 }
 
 
+/*-----------------------------------------------------------------------------
+	Blocks are independent of each other, so they can be processed in any
+	order and in parallel. Each one is written to its own buffer and the
+	buffers are concatenated in order afterwards.
+ -----------------------------------------------------------------------------*/
+#define VOLCASAMPLE_COMP_BLOCK_MAX	(VOLCASAMPLE_COMP_BLOCK_LEN * 2 + 16)
+#define VOLCASAMPLE_COMP_GROUP_LEN	256
+
+typedef struct {
+	const uint8_t *psrc;
+	uint32_t num_of_sample;
+	int quality;
+	Endian sample_endian;
+	int first_block;
+	uint8_t *pblock;		/* VOLCASAMPLE_COMP_BLOCK_MAX bytes per block */
+	uint32_t *psize;		/* 0 on error */
+} CompJob;
+
+static SyroComp_ParallelFor ParallelFor = NULL;
+
+void SyroComp_SetParallelFor(SyroComp_ParallelFor pfor)
+{
+	ParallelFor = pfor;
+}
+
+static void SyroComp_ForEachBlock(SyroComp_BlockFunc func, void *arg, int num_of_block)
+{
+	int i;
+	
+	if (ParallelFor && (num_of_block > 1)) {
+		ParallelFor(func, arg, num_of_block);
+	} else {
+		for (i=0; i<num_of_block; i++) {
+			func(arg, i);
+		}
+	}
+}
+
+static int SyroComp_GetNumOfBlock(uint32_t num_of_sample)
+{
+	//-- an empty sample still has one block --
+	if (!num_of_sample) {
+		return 1;
+	}
+	return (int)((num_of_sample + VOLCASAMPLE_COMP_BLOCK_LEN - 1) / VOLCASAMPLE_COMP_BLOCK_LEN);
+}
+
+static void SyroComp_InitBlock(CompJob *job, int block, ReadSample *prp)
+{
+	uint32_t start;
+	uint32_t num_of_thissample;
+	
+	start = (uint32_t)(job->first_block + block) * VOLCASAMPLE_COMP_BLOCK_LEN;
+	num_of_thissample = VOLCASAMPLE_COMP_BLOCK_LEN;
+	if (num_of_thissample > (job->num_of_sample - start)) {
+		num_of_thissample = job->num_of_sample - start;
+	}
+	
+	prp->ptr = job->psrc + (start * 2);
+	prp->NumOfSample = num_of_thissample;
+	prp->bitlen_eff = job->quality;
+	prp->SampleEndian = job->sample_endian;
+	prp->sum = 0;
+}
+
+static void SyroComp_GetBlockCompSize(void *arg, int block)
+{
+	CompJob *job = (CompJob *)arg;
+	ReadSample rp;
+	uint32_t thissize_bit;
+	uint32_t linersize_bit;
+	uint8_t *map_buffer;
+	
+	job->psize[block] = 0;
+	
+	map_buffer = malloc(VOLCASAMPLE_COMP_BLOCK_LEN);
+	if (!map_buffer) {
+		return;
+	}
+	
+	SyroComp_InitBlock(job, block, &rp);
+	thissize_bit = (uint32_t)SyroComp_MakeMap(map_buffer, &rp, NULL, NULL);
+	
+	linersize_bit = (uint32_t)job->quality * rp.NumOfSample;
+	if ((!thissize_bit) || (thissize_bit >= linersize_bit)) {
+		//----- use liner ----
+		thissize_bit = linersize_bit;
+	}
+	job->psize[block] = ((thissize_bit + 7) / 8) + 6;	//--- 6 for Header & CRC -----
+	
+	free(map_buffer);
+}
+
+static void SyroComp_CompOneBlock(void *arg, int block)
+{
+	CompJob *job = (CompJob *)arg;
+	ReadSample rp;
+	int BitBase[4];
+	int i;
+	int num_of_thissample;
+	int quality;
+	int prlen;
+	int type;
+	int32_t dat;
+	uint8_t *pdest;
+	uint8_t *map_buffer;
+	
+	job->psize[block] = 0;
+	
+	map_buffer = malloc(VOLCASAMPLE_COMP_BLOCK_LEN);
+	if (!map_buffer) {
+		return;
+	}
+	
+	SyroComp_InitBlock(job, block, &rp);
+	num_of_thissample = (int)rp.NumOfSample;
+	quality = job->quality;
+	pdest = job->pblock + (block * VOLCASAMPLE_COMP_BLOCK_MAX);
+	memset(pdest, 0, VOLCASAMPLE_COMP_BLOCK_MAX);
+	
+	prlen = SyroComp_MakeMap(map_buffer, &rp, BitBase, &type);
+	
+	if (prlen && (prlen < (num_of_thissample*quality))) {
+		/*----- compressible ------*/
+		*pdest++ = (uint8_t)(num_of_thissample>>8) | (uint8_t)(type<<5);
+		*pdest++ = (uint8_t)num_of_thissample;
+		prlen = SyroComp_CompBlock(map_buffer, pdest+4, &rp, BitBase, type);
+		*pdest++ = (uint8_t)(prlen>>8);
+		*pdest++ = (uint8_t)prlen;			
+		*pdest++ = (uint8_t)(rp.sum >> 8);
+		*pdest++ = (uint8_t)rp.sum;
+	} else {
+		/*----- copy without compression ------*/
+		*pdest++ = (uint8_t)(0xe0 | (num_of_thissample>>8));
+		*pdest++ = (uint8_t)num_of_thissample;
+		*pdest++ = (uint8_t)(num_of_thissample>>7);
+		*pdest++ = (uint8_t)(num_of_thissample<<1);
+		{
+			WriteBit wb;
+			wb.ptr = (pdest+2);
+			wb.BitCount = 0;
+			wb.ByteCount = 0;
+			
+			for (i=0; i<num_of_thissample; i++) {
+				dat = SyroComp_GetPcm(&rp);
+				SyroComp_WriteBit(&wb, (uint32_t)dat, quality);
+			}
+			if (wb.BitCount) {
+				SyroComp_WriteBit(&wb, 0, (8-wb.BitCount));
+			}
+			*pdest++ = (uint8_t)(rp.sum >> 8);
+			*pdest++ = (uint8_t)rp.sum;
+			
+			prlen = wb.ByteCount;
+		}
+	}
+	job->psize[block] = (uint32_t)(prlen + 6);
+	
+	free(map_buffer);
+}
+
+
 /*======================================================================
 	Syro Get Sample
  ======================================================================*/
 uint32_t SyroComp_GetCompSize(const uint8_t *psrc, uint32_t num_of_sample,
 	uint32_t quality, Endian sample_endian)
 {
-	ReadSample rp;
-	uint32_t num_of_thissample;
+	CompJob job;
+	int i;
+	int num_of_block;
 	uint32_t allsize_byte;
-	uint32_t thissize_bit;
-	uint8_t *map_buffer;
 	
-	map_buffer = malloc(VOLCASAMPLE_COMP_BLOCK_LEN);
-	if (!map_buffer) {
+	num_of_block = SyroComp_GetNumOfBlock(num_of_sample);
+	
+	job.psrc = psrc;
+	job.num_of_sample = num_of_sample;
+	job.quality = (int)quality;
+	job.sample_endian = sample_endian;
+	job.first_block = 0;
+	job.pblock = NULL;
+	job.psize = malloc(num_of_block * sizeof(uint32_t));
+	if (!job.psize) {
 		return 0;
 	}
 	
-	rp.ptr = psrc;
-	rp.bitlen_eff = (int)quality;
-	rp.SampleEndian = sample_endian;
+	SyroComp_ForEachBlock(SyroComp_GetBlockCompSize, &job, num_of_block);
 	
 	allsize_byte = 0;
-	
-	for (;;) {
-		num_of_thissample = VOLCASAMPLE_COMP_BLOCK_LEN;
-		if (num_of_thissample > num_of_sample) {
-			num_of_thissample = num_of_sample;
-		}
-		rp.NumOfSample = num_of_thissample;
-		thissize_bit = (uint32_t)SyroComp_MakeMap(map_buffer, &rp, NULL, NULL);
-		
-		if ((!thissize_bit) || (thissize_bit >= (quality * num_of_thissample))) {
-			//----- use liner ----
-			thissize_bit = (quality * num_of_thissample);
-		}
-		allsize_byte += ((thissize_bit + 7) / 8);
-		
-		allsize_byte += 6;		//--- for Header & CRC -----
-		
-		rp.ptr += (num_of_thissample * 2);
-		num_of_sample -= num_of_thissample;
-		
-		if (!num_of_sample) {
+	for (i=0; i<num_of_block; i++) {
+		if (!job.psize[i]) {
+			allsize_byte = 0;
 			break;
 		}
+		allsize_byte += job.psize[i];
 	}
 	
-	free(map_buffer);
+	free(job.psize);
 	
 	return allsize_byte;
 }
@@ -516,94 +666,59 @@ uint32_t SyroComp_GetCompSize(const uint8_t *psrc, uint32_t num_of_sample,
 	  num_of_sample = number of sample.
 	  quality = number of effective bit(8~16).
 	  sample_endian = specific endian of source sample(LittleEndian or BigEndian).
+	Blocks are compressed in groups so that the intermediate buffers are
+	bounded regardless of the sample length.
  =============================================================================*/
 uint32_t SyroComp_Comp(const uint8_t *psrc, uint8_t *pdest, int num_of_sample, 
 	int quality, Endian sample_endian) 
 {
-	ReadSample rp;
-	int BitBase[4];
+	CompJob job;
 	int i;
-	int srccount, count;
-	int num_of_thissample;
-	int prlen;
-	int type;
-	int32_t dat;
-	uint8_t *map_buffer;
-
-	map_buffer = malloc(VOLCASAMPLE_COMP_BLOCK_LEN);
-	if (!map_buffer) {
+	int num_of_block, num_of_group_block, group_len;
+	uint32_t count;
+	
+	num_of_block = SyroComp_GetNumOfBlock((uint32_t)num_of_sample);
+	group_len = num_of_block;
+	if (group_len > VOLCASAMPLE_COMP_GROUP_LEN) {
+		group_len = VOLCASAMPLE_COMP_GROUP_LEN;
+	}
+	
+	job.psrc = psrc;
+	job.num_of_sample = (uint32_t)num_of_sample;
+	job.quality = quality;
+	job.sample_endian = sample_endian;
+	job.pblock = malloc(group_len * VOLCASAMPLE_COMP_BLOCK_MAX);
+	job.psize = malloc(group_len * sizeof(uint32_t));
+	if (!job.pblock || !job.psize) {
+		free(job.pblock);
+		free(job.psize);
 		return 0;
-	}	
-
-	rp.bitlen_eff = quality;
-	rp.SampleEndian = sample_endian;
-	rp.ptr = psrc;
-
+	}
+	
 	count = 0;
-	srccount = 0;
 	
-	for (;;) {
-		/*------- decide block length ------*/
-		num_of_thissample = VOLCASAMPLE_COMP_BLOCK_LEN;
-		if (num_of_thissample > num_of_sample) {
-			num_of_thissample = num_of_sample;
+	for (job.first_block=0; job.first_block<num_of_block; job.first_block+=group_len) {
+		num_of_group_block = num_of_block - job.first_block;
+		if (num_of_group_block > group_len) {
+			num_of_group_block = group_len;
 		}
-		rp.NumOfSample = (uint32_t)num_of_thissample;
-		rp.sum = 0;
 		
-		prlen = SyroComp_MakeMap(map_buffer, &rp, BitBase, &type);
+		SyroComp_ForEachBlock(SyroComp_CompOneBlock, &job, num_of_group_block);
 		
-		if (prlen && (prlen < (num_of_thissample*quality))) {
-			/*----- compressible ------*/
-			*pdest++ = (uint8_t)(num_of_thissample>>8) | (uint8_t)(type<<5);
-			*pdest++ = (uint8_t)num_of_thissample;
-			prlen = SyroComp_CompBlock(map_buffer, pdest+4, &rp, BitBase, type);
-			*pdest++ = (uint8_t)(prlen>>8);
-			*pdest++ = (uint8_t)prlen;			
-			*pdest++ = (uint8_t)(rp.sum >> 8);
-			*pdest++ = (uint8_t)rp.sum;
-			count += (prlen+6);
-			pdest += prlen;
-		} else {
-			/*----- copy without compression ------*/
-			*pdest++ = (uint8_t)(0xe0 | (num_of_thissample>>8));
-			*pdest++ = (uint8_t)num_of_thissample;
-			*pdest++ = (uint8_t)(num_of_thissample>>7);
-			*pdest++ = (uint8_t)(num_of_thissample<<1);
-			{
-				WriteBit wb;
-				wb.ptr = (pdest+2);
-				wb.BitCount = 0;
-				wb.ByteCount = 0;
-				
-				for (i=0; i<num_of_thissample; i++) {
-					dat = SyroComp_GetPcm(&rp);
-					SyroComp_WriteBit(&wb, (uint32_t)dat, quality);
-				}
-				if (wb.BitCount) {
-					SyroComp_WriteBit(&wb, 0, (8-wb.BitCount));
-				}
-				*pdest++ = (uint8_t)(rp.sum >> 8);
-				*pdest++ = (uint8_t)rp.sum;
-
-				prlen = wb.ByteCount;
-				pdest += prlen;
-				count += (prlen+6);
+		for (i=0; i<num_of_group_block; i++) {
+			if (!job.psize[i]) {
+				count = 0;
+				goto end;
 			}
-		}
-		num_of_sample -= num_of_thissample;
-		srccount += num_of_thissample;
-		if (!num_of_sample) {
-			break;
+			memcpy(pdest, job.pblock + (i * VOLCASAMPLE_COMP_BLOCK_MAX), job.psize[i]);
+			pdest += job.psize[i];
+			count += job.psize[i];
 		}
 	}
 
-	free(map_buffer);
+end:
+	free(job.pblock);
+	free(job.psize);
 	
-	return (uint32_t)count;
+	return count;
 }
-
-
-
-
-
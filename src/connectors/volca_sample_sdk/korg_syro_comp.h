@@ -10,6 +10,14 @@ extern "C"
 {
 #endif
 
+typedef void (*SyroComp_BlockFunc)(void *arg, int block);
+
+/*-- must call func for every block in [0, num_of_block) and return when all of them have finished --*/
+typedef void (*SyroComp_ParallelFor)(SyroComp_BlockFunc func, void *arg, int num_of_block);
+
+/*-- NULL (default) processes the blocks sequentially --*/
+void SyroComp_SetParallelFor(SyroComp_ParallelFor pfor);
+
 uint32_t SyroComp_GetCompSize(const uint8_t *psrc, uint32_t num_of_sample,
 	uint32_t quality, Endian sample_endian);
 
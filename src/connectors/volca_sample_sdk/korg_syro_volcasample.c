@@ -770,6 +770,24 @@ SyroStatus SyroVolcaSample_GetSample(SyroHandle Handle, int16_t *pLeft, int16_t
 	return Status_Success;
 }
 
+/*======================================================================
+	Syro Get Current Data
+	(Number of entries whose frames have already been generated)
+ ======================================================================*/
+SyroStatus SyroVolcaSample_GetCurrentData(SyroHandle Handle, int *pCurData)
+{
+	SyroManage *psm;
+	
+	psm = (SyroManage *)Handle;
+	if (psm->Header != SYRO_MANAGE_HEADER) {
+		return Status_InvalidHandle;
+	}
+
+	*pCurData = psm->CurData;
+	
+	return Status_Success;
+}
+
 /*======================================================================
 	Syro End
  ======================================================================*/	
@@ -69,6 +69,8 @@ SyroStatus SyroVolcaSample_Start(SyroHandle *pHandle, SyroData *pData, int NumOf
 
 SyroStatus SyroVolcaSample_GetSample(SyroHandle Handle, int16_t *pLeft, int16_t *pRight);
 
+SyroStatus SyroVolcaSample_GetCurrentData(SyroHandle Handle, int *pCurData);
+
 SyroStatus SyroVolcaSample_End(SyroHandle Handle);
 
 #ifdef __cplusplus
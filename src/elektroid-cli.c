@@ -31,9 +31,12 @@
 #include <glib.h>
 #include <glib/gstdio.h>
 #include "backend.h"
+#include "backup.h"
 #include "regconn.h"
 #include "regpref.h"
 #include "sample.h"
+#include "session.h"
+#include "slot_cache.h"
 #include "utils.h"
 
 #define CLI_SLEEP_US 200000
@@ -48,6 +51,8 @@ static struct backend backend;
 static struct task_control task_control;
 static struct controllable controllable;	//Used for CLI control for operations that do not use task_control or sysex_transfer.
 static gchar *connector, *fs, *op;
+static gint64 connect_time;	//In microseconds.
+static struct backup *backup;	//Only used by incremental backups.
 
 const struct fs_operations *fs_ops;
 const gchar *current_path_progress;
@@ -138,6 +143,13 @@ cli_connect (const gchar *device_path)
       goto end;
     }
 
+  if (*rem == SESSION_DEVICE_SEPARATOR)
+    {
+      error_print ("Device groups are only allowed when uploading");
+      err = -EINVAL;
+      goto end;
+    }
+
   if (id >= devices->len)
     {
       error_print ("Invalid device '%d'", id);
@@ -146,7 +158,9 @@ cli_connect (const gchar *device_path)
     }
 
   device = g_array_index (devices, struct backend_device, id);
+  connect_time = g_get_monotonic_time ();
   err = backend_init_connector (&backend, &device, connector, NULL);
+  connect_time = g_get_monotonic_time () - connect_time;
 
   if (!err && fs)
     {
@@ -164,7 +178,7 @@ end:
 }
 
 static gint
-cli_list (int argc, gchar *argv[], int *optind)
+cli_list (int argc, gchar *argv[], int *optind, gboolean refresh)
 {
   gint err;
   const gchar *path;
@@ -193,8 +207,12 @@ cli_list (int argc, gchar *argv[], int *optind)
   RETURN_IF_NULL (fs_ops->get_exts);
 
   path = cli_get_path (device_path);
-  err = fs_ops->readdir (&backend, &iter, path,
-			 fs_ops->get_exts (&backend, fs_ops));
+  if (refresh)
+    {
+      slot_cache_invalidate_dir (&backend, fs_ops, path);
+    }
+  err = slot_cache_readdir (&backend, fs_ops, &iter, path,
+			    fs_ops->get_exts (&backend, fs_ops));
   if (err)
     {
       return err;
@@ -203,6 +221,16 @@ cli_list (int argc, gchar *argv[], int *optind)
   while (!item_iterator_next (&iter) &&
 	 controllable_is_active (&controllable))
     {
+      //There is no background loading here so the object info that readdir left empty or took from a cache is loaded before printing.
+      if (fs_ops->load_object_info && iter.item.type == ITEM_TYPE_FILE)
+	{
+	  gchar *filename = item_get_filename (&iter.item, fs_ops->options);
+	  gchar *item_path = path_chain (PATH_INTERNAL, path, filename);
+	  fs_ops->load_object_info (&backend, item_path, &iter.item);
+	  g_free (item_path);
+	  g_free (filename);
+	}
+
       fs_ops->print_item (&iter, &backend, fs_ops);
     }
 
@@ -240,7 +268,9 @@ cli_command_path (int argc, gchar *argv[], int *optind, ssize_t member_offset)
   RETURN_IF_NULL (f);
 
   path = cli_get_path (device_path);
-  return f (&backend, path);
+  err = f (&backend, path);
+  slot_cache_invalidate (&backend, fs_ops, path);
+  return err;
 }
 
 static gint
@@ -293,7 +323,10 @@ cli_command_src_dst (int argc, gchar *argv[], int *optind,
 
   src_path = cli_get_path (device_src_path);
   dst_path = cli_get_path (device_dst_path);
-  return f (&backend, src_path, dst_path);
+  err = f (&backend, src_path, dst_path);
+  slot_cache_invalidate (&backend, fs_ops, src_path);
+  slot_cache_invalidate (&backend, fs_ops, dst_path);
+  return err;
 }
 
 static gint
@@ -355,7 +388,13 @@ cli_command_mv_rename (int argc, gchar *argv[], int *optind)
       dst_path = device_dst_path;
     }
 
-  return f (&backend, src_path, dst_path);
+  err = f (&backend, src_path, dst_path);
+  slot_cache_invalidate (&backend, fs_ops, src_path);
+  if (fs_ops->move)
+    {
+      slot_cache_invalidate (&backend, fs_ops, dst_path);
+    }
+  return err;
 }
 
 static const gchar *
@@ -412,6 +451,7 @@ cli_info (int argc, gchar *argv[], int *optind)
   printf ("Device version: %s\n", backend.version);
   printf ("Device description: %s\n", backend.description);
   printf ("Connector name: %s\n", backend.conn_name);
+  printf ("Connection time: %.3f ms\n", connect_time / 1000.0);
   printf ("Filesystems: ");
 
   sorted = g_slist_copy (backend.fs_ops);
@@ -563,7 +603,58 @@ cli_upgrade_os (int argc, gchar *argv[], int *optind)
 }
 
 static gint
-cli_download_item (const gchar *src_path, const gchar *dst_path)
+cli_calibrate (int argc, gchar *argv[], int *optind)
+{
+  gint err, rest_time;
+  const gchar *path;
+  const gchar *device_path;
+
+  if (*optind == argc)
+    {
+      error_print ("Remote path missing");
+      return EXIT_FAILURE;
+    }
+  else
+    {
+      device_path = argv[*optind];
+      (*optind)++;
+    }
+
+  err = cli_connect (device_path);
+  if (err)
+    {
+      return err;
+    }
+  if (backend.type == BE_TYPE_SYSTEM)
+    {
+      error_print (COMMAND_NOT_IN_SYSTEM_FS);
+      return EXIT_FAILURE;
+    }
+
+  RETURN_IF_NULL (backend.calibrate);
+
+  path = cli_get_path (device_path);
+  if (!strlen (path))
+    {
+      return -EINVAL;
+    }
+
+  controllable_set_active (&task_control.controllable, TRUE);
+  task_control.callback = print_progress;
+  current_path_progress = path;
+
+  err = backend.calibrate (&backend, path, &task_control, &rest_time);
+  if (!err)
+    {
+      printf ("Rest time: %d us\n", rest_time);
+    }
+
+  return err;
+}
+
+static gint
+cli_download_item (const gchar *src_path, const gchar *dst_path,
+		   const struct item *item)
 {
   gint err;
   gchar *download_path;
@@ -591,7 +682,17 @@ cli_download_item (const gchar *src_path, const gchar *dst_path)
       goto cleanup;
     }
 
+  if (backup)
+    {
+      //The previous file might be linked to an object that must not change.
+      g_unlink (download_path);
+    }
+
   err = fs_ops->save (download_path, &idata, &task_control);
+  if (!err && backup)
+    {
+      err = backup_add (backup, src_path, item, download_path);
+    }
   g_free (download_path);
 
 cleanup:
@@ -610,7 +711,7 @@ cli_download_dir (const gchar *src_path, const gchar *dst_path)
 
   RETURN_IF_NULL (fs_ops->readdir);
 
-  err = fs_ops->readdir (&backend, &iter, src_path, NULL);
+  err = slot_cache_readdir (&backend, fs_ops, &iter, src_path, NULL);
   if (err)
     {
       return err;
@@ -626,14 +727,20 @@ cli_download_dir (const gchar *src_path, const gchar *dst_path)
 
       if (iter.item.type == ITEM_TYPE_FILE && iter.item.size != 0)	//File and non empty slot
 	{
-	  err = cli_download_item (rsrc_path, dst_path);
+	  if (!backup || !backup_keep_unchanged (backup, rsrc_path,
+						 &iter.item))
+	    {
+	      err = cli_download_item (rsrc_path, dst_path, &iter.item);
+	    }
 	}
       else if (iter.item.type == ITEM_TYPE_DIR)
 	{
 	  gchar *rdst_path = path_chain (PATH_SYSTEM, dst_path,
 					 iter.item.name);
 
-	  err = g_mkdir (rdst_path, 0755);
+	  //Incremental backups reuse the directories of the previous ones.
+	  err = backup ? g_mkdir_with_parents (rdst_path, 0755) :
+	    g_mkdir (rdst_path, 0755);
 	  if (err)
 	    {
 	      error_print
@@ -657,7 +764,69 @@ cli_download_dir (const gchar *src_path, const gchar *dst_path)
 }
 
 static gint
-cli_download (int argc, gchar *argv[], int *optind, gint recursive)
+cli_download_tree (const gchar *src_path, const gchar *dst_path)
+{
+  gint err;
+
+  if (strcmp (src_path, "/"))
+    {
+      gchar *new_dir = g_path_get_basename (src_path);
+      gchar *full_dst_path = path_chain (PATH_SYSTEM, dst_path, new_dir);
+      debug_print (1, "Creating directory '%s'...", full_dst_path);
+      err = backup ? g_mkdir_with_parents (full_dst_path, 0755) :
+	g_mkdir (full_dst_path, 0755);
+      if (err)
+	{
+	  error_print ("Error while creating directory '%s'", full_dst_path);
+	}
+      else
+	{
+	  err = cli_download_dir (src_path, full_dst_path);
+	}
+
+      g_free (full_dst_path);
+      g_free (new_dir);
+      return err;
+    }
+  else
+    {
+      return cli_download_dir (src_path, dst_path);
+    }
+}
+
+static gint
+cli_backup (const gchar *src_path, const gchar *dst_path)
+{
+  gint err;
+  gchar *prefix;
+  struct backup incremental;
+
+  prefix = g_strdup_printf ("%s-%s", backend.conn_name, fs_ops->name);
+  err = backup_init (&incremental, dst_path, prefix);
+  g_free (prefix);
+  if (err)
+    {
+      return err;
+    }
+
+  backup = &incremental;
+  err = cli_download_tree (src_path, dst_path);
+  backup = NULL;
+
+  if (!backup_save (&incremental, !err))
+    {
+      printf ("%u unchanged, %u downloaded, %u new objects\n",
+	      incremental.unchanged, incremental.downloaded,
+	      incremental.stored);
+    }
+  backup_free (&incremental);
+
+  return err;
+}
+
+static gint
+cli_download (int argc, gchar *argv[], int *optind, gint recursive,
+	      gboolean incremental)
 {
   const gchar *src_path;
   const gchar *dst_path;
@@ -700,36 +869,18 @@ cli_download (int argc, gchar *argv[], int *optind, gint recursive)
 	}
     }
 
-  if (recursive)
+  if (incremental)
     {
-      if (strcmp (src_path, "/"))
-	{
-	  gchar *new_dir = g_path_get_basename (src_path);
-	  gchar *full_dst_path = path_chain (PATH_SYSTEM, dst_path, new_dir);
-	  debug_print (1, "Creating directory '%s'...", full_dst_path);
-	  err = g_mkdir (full_dst_path, 0755);
-	  if (err)
-	    {
-	      error_print ("Error while creating directory '%s'",
-			   full_dst_path);
-	    }
-	  else
-	    {
-	      err = cli_download_dir (src_path, full_dst_path);
-	    }
-
-	  g_free (full_dst_path);
-	  g_free (new_dir);
-	  return err;
-	}
-      else
-	{
-	  return cli_download_dir (src_path, dst_path);
-	}
+      RETURN_IF_NULL (fs_ops->readdir);
+      return cli_backup (src_path, dst_path);
+    }
+  else if (recursive)
+    {
+      return cli_download_tree (src_path, dst_path);
     }
   else
     {
-      return cli_download_item (src_path, dst_path);
+      return cli_download_item (src_path, dst_path, NULL);
     }
 }
 
@@ -758,6 +909,7 @@ cli_upload_item (const gchar *src_path, const gchar *dst_path)
 					 src_path, &idata);
 
   err = fs_ops->upload (&backend, upload_path, &idata, &task_control);
+  slot_cache_invalidate (&backend, fs_ops, upload_path);
   idata_clear (&idata);
 
   g_free (upload_path);
@@ -767,12 +919,167 @@ cli_upload_item (const gchar *src_path, const gchar *dst_path)
   return err;
 }
 
+static gchar **batch_src_paths;
+static guint batch_len;
+
+static void
+print_batch_progress (struct task_control *task_control)
+{
+  current_path_progress = batch_src_paths[MIN (task_control->part,
+					       batch_len - 1)];
+  print_progress (task_control);
+}
+
+//In slot storage, the items go to the following slots. Otherwise, dst_path is a directory.
+
+static gint
+cli_upload_batch (gchar **src_paths, guint len, const gchar *dst_path)
+{
+  guint id;
+  gint err = 0;
+  gchar *dir, *path;
+  struct idata *idata;
+  struct fs_batch_item *batch_items;
+
+  RETURN_IF_NULL (fs_ops->load);
+  RETURN_IF_NULL (fs_ops->get_upload_path);
+  RETURN_IF_NULL (fs_ops->upload_batch);
+
+  if (fs_ops->options & FS_OPTION_SLOT_STORAGE)
+    {
+      path = g_path_get_basename (dst_path);
+      id = atoi (path);
+      g_free (path);
+      dir = g_path_get_dirname (dst_path);
+    }
+  else
+    {
+      id = 0;
+      dir = g_strdup (dst_path);
+    }
+
+  controllable_set_active (&task_control.controllable, TRUE);
+
+  batch_items = g_new0 (struct fs_batch_item, len);
+  batch_src_paths = src_paths;
+  batch_len = len;
+  idata = g_new0 (struct idata, len);
+
+  for (guint i = 0; i < len; i++)
+    {
+      task_control.callback = print_progress;
+      current_path_progress = src_paths[i];
+
+      err = fs_ops->load (&backend, src_paths[i], &idata[i], &task_control);
+      complete_progress (err);
+      if (err)
+	{
+	  error_print ("Error while loading '%s'", src_paths[i]);
+	  len = i;
+	  goto cleanup;
+	}
+
+      if (fs_ops->options & FS_OPTION_SLOT_STORAGE)
+	{
+	  path = g_strdup_printf ("%s%s%d", dir, strcmp (dir, "/") ? "/" : "",
+				  id + i);
+	}
+      else
+	{
+	  path = g_strdup (dir);
+	}
+
+      batch_items[i].path = fs_ops->get_upload_path (&backend, fs_ops, path,
+						     src_paths[i],
+						     &idata[i]);
+      batch_items[i].idata = &idata[i];
+      g_free (path);
+    }
+
+  task_control.callback = print_batch_progress;
+
+  err = fs_ops->upload_batch (&backend, batch_items, len, &task_control);
+  complete_progress (err);
+
+  for (guint i = 0; i < len; i++)
+    {
+      slot_cache_invalidate (&backend, fs_ops, batch_items[i].path);
+      if (batch_items[i].err)
+	{
+	  error_print ("Error while uploading '%s' to '%s': %s",
+		       src_paths[i], batch_items[i].path,
+		       g_strerror (-batch_items[i].err));
+	}
+    }
+
+cleanup:
+  for (guint i = 0; i < len; i++)
+    {
+      g_free (batch_items[i].path);
+      idata_clear (&idata[i]);
+    }
+  g_free (idata);
+  g_free (batch_items);
+  batch_src_paths = NULL;
+  g_free (dir);
+
+  return err;
+}
+
+//The devices are the part of device_path before the path separator.
+
+static gboolean
+cli_is_group (const gchar *device_path)
+{
+  const gchar *path = cli_get_path (device_path);
+
+  for (const gchar *c = device_path; c < path; c++)
+    {
+      if (*c == SESSION_DEVICE_SEPARATOR)
+	{
+	  return TRUE;
+	}
+    }
+
+  return FALSE;
+}
+
+static gint
+cli_upload_group (const gchar *src_path, const gchar *device_dst_path)
+{
+  gint err;
+  gchar *devices;
+  struct session session;
+  const gchar *dst_path = cli_get_path (device_dst_path);
+
+  devices = g_strndup (device_dst_path, dst_path - device_dst_path - 1);
+  err = session_open (&session, devices, connector, fs);
+  g_free (devices);
+  if (err)
+    {
+      return err;
+    }
+
+  controllable_set_active (&task_control.controllable, TRUE);
+  task_control.callback = print_progress;
+  current_path_progress = src_path;
+
+  err = session_upload (&session, src_path, dst_path, &task_control);
+
+  complete_progress (err);
+
+  session_close (&session);
+
+  return err;
+}
+
 static gint
 cli_upload (int argc, gchar *argv[], int *optind)
 {
   gint err;
+  guint srcs;
   const gchar *dst_path;
-  gchar *src_path, *device_dst_path;
+  gchar *src_path, *device_dst_path, **src_paths;
 
   if (*optind == argc)
     {
@@ -781,6 +1088,7 @@ cli_upload (int argc, gchar *argv[], int *optind)
     }
   else
     {
+      src_paths = &argv[*optind];
       src_path = argv[*optind];
       (*optind)++;
     }
@@ -790,10 +1098,34 @@ cli_upload (int argc, gchar *argv[], int *optind)
       error_print ("Remote path missing");
       return EXIT_FAILURE;
     }
-  else
+
+  //The last argument is the destination.
+  srcs = argc - *optind;
+  *optind = argc;
+  device_dst_path = argv[argc - 1];
+
+  if (srcs > 1)
     {
-      device_dst_path = argv[*optind];
-      (*optind)++;
+      if (cli_is_group (device_dst_path))
+	{
+	  error_print ("Several files can not be uploaded to several devices");
+	  return -EINVAL;
+	}
+
+      err = cli_connect (device_dst_path);
+      if (err)
+	{
+	  return err;
+	}
+
+      dst_path = cli_get_path (device_dst_path);
+
+      return cli_upload_batch (src_paths, srcs, dst_path);
+    }
+
+  if (cli_is_group (device_dst_path))
+    {
+      return cli_upload_group (src_path, device_dst_path);
     }
 
   err = cli_connect (device_dst_path);
@@ -1005,6 +1337,21 @@ cli_record (int argc, gchar *argv[], int *optind)
   return 0;
 }
 
+static void
+cli_print_stats ()
+{
+  gchar *text;
+
+  if (backend.type != BE_TYPE_MIDI)
+    {
+      return;
+    }
+
+  text = telemetry_to_string (&backend.telemetry);
+  fprintf (stderr, "%s", text);
+  g_free (text);
+}
+
 #if defined(__linux__)
 static void
 cli_end (int sig)
@@ -1023,6 +1370,7 @@ main (int argc, gchar *argv[])
   gint err;
   gchar *command;
   gint vflg = 0, errflg = 0;
+  gboolean stats = FALSE;
 
   controllable_init (&controllable);
   controllable_init (&task_control.controllable);
@@ -1039,13 +1387,22 @@ main (int argc, gchar *argv[])
   sigaction (SIGHUP, &action, NULL);
 #endif
 
-  while ((c = getopt (argc, argv, "v")) != -1)
+  while ((c = getopt (argc, argv, "vc:r:f")) != -1)
     {
       switch (c)
 	{
 	case 'v':
 	  vflg++;
 	  break;
+	case 'c':
+	  g_setenv (CAPTURE_ENV_FILE, optarg, TRUE);
+	  break;
+	case 'r':
+	  g_setenv (CAPTURE_ENV_REPLAY_FILE, optarg, TRUE);
+	  break;
+	case 'f':
+	  g_setenv (CAPTURE_ENV_REPLAY_FAST, "1", TRUE);
+	  break;
 	case '?':
 	  errflg++;
 	}
@@ -1059,6 +1416,20 @@ main (int argc, gchar *argv[])
     {
       command = argv[optind];
       optind++;
+
+      if (!strcmp (command, "stats"))
+	{
+	  stats = TRUE;
+	  if (optind == argc)
+	    {
+	      errflg = 1;
+	    }
+	  else
+	    {
+	      command = argv[optind];
+	      optind++;
+	    }
+	}
     }
 
   if (vflg)
@@ -1107,6 +1478,10 @@ main (int argc, gchar *argv[])
     {
       err = cli_upgrade_os (argc, argv, &optind);
     }
+  else if (!strcmp (command, "calibrate"))
+    {
+      err = cli_calibrate (argc, argv, &optind);
+    }
   else if (!strcmp (command, "play"))
     {
       err = cli_play (argc, argv, &optind);
@@ -1129,7 +1504,11 @@ main (int argc, gchar *argv[])
 
       if (!strcmp (op, "ls") || !strcmp (op, "list"))
 	{
-	  err = cli_list (argc, argv, &optind);
+	  err = cli_list (argc, argv, &optind, FALSE);
+	}
+      else if (!strcmp (op, "refresh"))
+	{
+	  err = cli_list (argc, argv, &optind, TRUE);
 	}
       else if (!strcmp (op, "mkdir"))
 	{
@@ -1143,12 +1522,16 @@ main (int argc, gchar *argv[])
 	}
       else if (!strcmp (op, "download") || !strcmp (op, "dl"))
 	{
-	  err = cli_download (argc, argv, &optind, 0);
+	  err = cli_download (argc, argv, &optind, 0, FALSE);
 	}
       else if (!strcmp (op, "rdownload") || !strcmp (op, "rdl") ||
 	       !strcmp (op, "backup"))
 	{
-	  err = cli_download (argc, argv, &optind, 1);
+	  err = cli_download (argc, argv, &optind, 1, FALSE);
+	}
+      else if (!strcmp (op, "ibackup"))
+	{
+	  err = cli_download (argc, argv, &optind, 1, TRUE);
 	}
       else if (!strcmp (op, "upload") || !strcmp (op, "ul"))
 	{
@@ -1179,16 +1562,20 @@ main (int argc, gchar *argv[])
 	  err = EXIT_FAILURE;
 	}
 
-      if (backend_check (&backend))
-	{
-	  backend_destroy (&backend);
-	}
-
       g_free (connector);
       g_free (fs);
       g_free (op);
     }
 
+  if (backend_check (&backend))
+    {
+      if (stats)
+	{
+	  cli_print_stats ();
+	}
+      backend_destroy (&backend);
+    }
+
 end:
   if (err && err != EXIT_FAILURE)
     {
@@ -34,16 +34,22 @@
 #include "notifier.h"
 #include "preferences.h"
 #include "preferences_window.h"
+#include "preloader.h"
 #include "progress_window.h"
 #include "regconn.h"
 #include "regma.h"
 #include "regpref.h"
 #include "sample.h"
+#include "sample_index.h"
+#include "slot_cache.h"
 #include "tasks.h"
 
 #define BACKEND_PLAYING "\u23f5"
 #define BACKEND_STOPPED "\u23f9"
 
+#define PRELOAD_MAX_TASKS 8
+#define PRELOAD_MAX_BYTES (64 * 1024 * 1024)
+
 enum device_list_store_columns
 {
   DEVICES_LIST_STORE_TYPE_FIELD,
@@ -67,6 +73,8 @@ struct elektroid_set_device_data
 
 static gpointer elektroid_upload_task_runner (gpointer);
 static gpointer elektroid_download_task_runner (gpointer);
+static gpointer elektroid_group_task_runner (gpointer);
+static gboolean elektroid_run_next (gpointer);
 static void elektroid_update_progress (struct task_control *);
 
 void autosampler_destroy ();
@@ -76,6 +84,7 @@ void microbrute_init ();
 
 static gchar *local_dir;
 static guint batch_id;
+static struct preloader preloader;
 
 extern struct maction_context maction_context;
 
@@ -87,6 +96,7 @@ static GtkPopover *main_popover;
 static GtkWidget *show_remote_button;
 static GtkWidget *preferences_button;
 static GtkWidget *about_button;
+static GtkWidget *stats_button;
 static GtkWidget *local_name_entry;
 static GtkWidget *local_box;
 static GtkWidget *remote_devices_box;
@@ -353,6 +363,7 @@ elektroid_cancel_all_tasks_and_wait ()
     {
       usleep (50000);
     }
+  preloader_clear (&preloader);
 }
 
 static void
@@ -361,6 +372,7 @@ elektroid_refresh_devices_int (gboolean startup)
   if (backend_check (BACKEND))
     {
       elektroid_cancel_all_tasks_and_wait ();
+      browser_wait_info_loaders (&remote_browser);
       backend_destroy (BACKEND);
       maction_menu_clear (&maction_context);
       browser_reset (&remote_browser);
@@ -418,6 +430,49 @@ elektroid_show_about (GtkWidget *object, gpointer data)
   gtk_widget_hide (GTK_WIDGET (about_dialog));
 }
 
+static void
+elektroid_show_stats (GtkWidget *object, gpointer data)
+{
+  gchar *text;
+  GtkWidget *dialog;
+
+  if (BACKEND->type == BE_TYPE_MIDI)
+    {
+      text = telemetry_to_string (&BACKEND->telemetry);
+    }
+  else
+    {
+      text = g_strdup (_("No MIDI device connected."));
+    }
+
+  dialog = gtk_message_dialog_new (main_window, GTK_DIALOG_MODAL,
+				   GTK_MESSAGE_INFO, GTK_BUTTONS_CLOSE,
+				   "%s", _("Transport Statistics"));
+  gtk_message_dialog_format_secondary_text (GTK_MESSAGE_DIALOG (dialog),
+					    "%s", text);
+  g_signal_connect (dialog, "response",
+		    G_CALLBACK (elektroid_show_error_msg_response), NULL);
+  gtk_widget_set_visible (dialog, TRUE);
+
+  g_free (text);
+}
+
+//Uploads and deletes in filesystems implementing upload_batch are run in groups of consecutive tasks.
+//As all the items are sent at once, filesystems where the user might be asked before replacing a file are excluded.
+
+static gboolean
+elektroid_runs_groups (const struct fs_operations *ops)
+{
+  return ops->upload_batch && !ops->file_exists;
+}
+
+static gboolean
+elektroid_group_filter (struct task *task, gpointer data)
+{
+  struct task *first = data;
+  return task->fs == first->fs && task->type != TASK_TYPE_DOWNLOAD;
+}
+
 static gint
 elektroid_delete_file (struct browser *browser, gchar *dir, struct item *item,
 		       gboolean has_progress_window)
@@ -435,7 +490,18 @@ elektroid_delete_file (struct browser *browser, gchar *dir, struct item *item,
       gchar *filename = item_get_filename (item, browser->fs_ops->options);
       gchar *id_path = path_chain (type, dir, filename);
       g_free (filename);
+
+      if (browser == &remote_browser &&
+	  elektroid_runs_groups (browser->fs_ops))
+	{
+	  tasks_add (TASK_TYPE_DELETE, id_path, NULL, browser->fs_ops->id,
+		     browser->backend);
+	  g_free (id_path);
+	  goto end;
+	}
+
       err = browser->fs_ops->delete (browser->backend, id_path);
+      slot_cache_invalidate (browser->backend, browser->fs_ops, id_path);
       if (err)
 	{
 	  error_print ("Error while deleting “%s”: %s.", path,
@@ -446,7 +512,8 @@ elektroid_delete_file (struct browser *browser, gchar *dir, struct item *item,
   else if (item->type == ITEM_TYPE_DIR)
     {
       struct item_iterator iter;
-      if (browser->fs_ops->readdir (browser->backend, &iter, path, NULL))
+      if (slot_cache_readdir (browser->backend, browser->fs_ops, &iter, path,
+			      NULL))
 	{
 	  err = -ENOTDIR;
 	  goto end;
@@ -466,6 +533,8 @@ elektroid_delete_file (struct browser *browser, gchar *dir, struct item *item,
 	}
 
       browser->fs_ops->delete (browser->backend, path);
+      slot_cache_invalidate (browser->backend, browser->fs_ops, path);
+      slot_cache_invalidate_dir (browser->backend, browser->fs_ops, path);
       item_iterator_free (&iter);
     }
 
@@ -480,9 +549,12 @@ elektroid_delete_items_runner (gpointer data)
   GList *list, *tree_path_list, *ref_list;
   GtkTreeSelection *selection;
   GtkTreeModel *model;
+  gboolean queued_before, queued_after;
   struct browser_delete_items_data *delete_data = data;
   struct browser *browser = delete_data->browser;
 
+  queued_before = tasks_has_queued ();
+
   selection = gtk_tree_view_get_selection (GTK_TREE_VIEW (browser->view));
   model = GTK_TREE_MODEL (gtk_tree_view_get_model (browser->view));
   tree_path_list = gtk_tree_selection_get_selected_rows (selection, &model);
@@ -516,6 +588,7 @@ elektroid_delete_items_runner (gpointer data)
 	{
 	  error_print ("Error while deleting file");
 	}
+      item_clear (&item);
 
       if (delete_data->has_progress_window && !progress_window_is_active ())
 	{
@@ -529,31 +602,66 @@ elektroid_delete_items_runner (gpointer data)
 
   g_free (delete_data);
 
+  //Some deletes might have been queued.
+  queued_after = tasks_has_queued ();
+  if (!queued_before && queued_after)
+    {
+      g_idle_add (elektroid_run_next, NULL);
+    }
+
   g_idle_add (browser_load_dir_if_needed, browser);
 }
 
+static void
+elektroid_preload_task (struct task *task, gpointer data)
+{
+  const struct fs_operations *ops;
+
+  if (task->type != TASK_TYPE_UPLOAD)
+    {
+      return;
+    }
+
+  ops = backend_get_fs_operations_by_id (BACKEND, task->fs);
+  if (ops && ops->load)
+    {
+      preloader_add (&preloader, BACKEND, ops, task->src);
+    }
+}
+
+//The payloads of the tasks that are no longer pending, like the canceled or removed ones, are discarded here.
+static void
+elektroid_preload_tasks ()
+{
+  preloader_mark (&preloader);
+  tasks_visit_pending (PRELOAD_MAX_TASKS, elektroid_preload_task, NULL);
+  preloader_sweep (&preloader);
+}
+
 static gboolean
 elektroid_run_next (gpointer data)
 {
-  GtkTreeIter iter;
-  enum task_type type;
-  gchar *src;
-  gchar *dst;
-  gint fs;
-  guint batch_id, mode;
-  GtkTreePath *path;
+  struct task *task = NULL;
+  guint group_len;
   gboolean transfer_active, mono_mix = FALSE;
-  gboolean found = tasks_get_next_queued (&iter, &type, &src, &dst,
-					  &fs, &batch_id, &mode);
-  const gchar *status_human = tasks_get_human_status (TASK_STATUS_RUNNING);
 
   transfer_active =
     controllable_is_active (&tasks.transfer.control.controllable);
 
-  if (!transfer_active && found)
+  if (!transfer_active)
+    {
+      //The task about to start is preloaded too so that its payload is kept.
+      elektroid_preload_tasks ();
+      task = tasks_start_next ();
+    }
+
+  if (task)
     {
       const struct fs_operations *ops =
-	backend_get_fs_operations_by_id (BACKEND, fs);
+	backend_get_fs_operations_by_id (BACKEND, task->fs);
+
+      //Transfers do not compete with the background loading for the device.
+      browser_stop_info_loader (&remote_browser);
 
       if (ops->options & FS_OPTION_SINGLE_OP)
 	{
@@ -576,39 +684,49 @@ elektroid_run_next (gpointer data)
 
       gtk_widget_set_sensitive (maction_context.box, FALSE);
 
-      gtk_list_store_set (tasks.list_store, &iter,
-			  TASK_LIST_STORE_STATUS_FIELD, TASK_STATUS_RUNNING,
-			  TASK_LIST_STORE_STATUS_HUMAN_FIELD, status_human,
-			  -1);
-      path = gtk_tree_model_get_path (GTK_TREE_MODEL (tasks.list_store),
-				      &iter);
-      gtk_tree_view_set_cursor (GTK_TREE_VIEW (tasks.tree_view), path, NULL,
-				FALSE);
-      gtk_tree_path_free (path);
       tasks.transfer.status = TASK_STATUS_RUNNING;
       tasks.transfer.control.controllable.active = TRUE;
       tasks.transfer.control.callback = elektroid_update_progress;
       tasks.transfer.control.parts = 0;
       tasks.transfer.control.part = 0;
       tasks.transfer.control.progress = 0.0;
-      tasks.transfer.src = src;
-      tasks.transfer.dst = dst;
+      tasks.transfer.src = g_strdup (task->src);
+      tasks.transfer.dst = g_strdup (task->dst);
       tasks.transfer.fs_ops = ops;
-      tasks.transfer.batch_id = batch_id;
-      tasks.transfer.mode = mode;
+      tasks.transfer.batch_id = task->batch_id;
+      tasks.transfer.mode = task->mode;
       debug_print (1, "Running task type %d from %s to %s (filesystem %s)...",
-		   type, tasks.transfer.src, tasks.transfer.dst,
+		   task->type, tasks.transfer.src, tasks.transfer.dst,
 		   tasks.transfer.fs_ops->name);
 
+      if (task->type != TASK_TYPE_DOWNLOAD && elektroid_runs_groups (ops))
+	{
+	  group_len = 1;
+	  while (tasks_start_next_if (elektroid_group_filter, task))
+	    {
+	      group_len++;
+	    }
+	  debug_print (1, "Running %d tasks as a single operation...",
+		       group_len);
+	  tasks.transfer.group_len = group_len;
+	  tasks.transfer.group_status = g_new (enum task_status, group_len);
+	}
+
       tasks_update_current_progress (NULL);
 
-      if (type == TASK_TYPE_UPLOAD)
+      if (tasks.transfer.group_len)
+	{
+	  tasks.thread = g_thread_new ("group_task",
+				       elektroid_group_task_runner, NULL);
+	  remote_browser.dirty = TRUE;
+	}
+      else if (task->type == TASK_TYPE_UPLOAD)
 	{
 	  tasks.thread = g_thread_new ("upload_task",
 				       elektroid_upload_task_runner, NULL);
 	  remote_browser.dirty = TRUE;
 	}
-      else if (type == TASK_TYPE_DOWNLOAD)
+      else if (task->type == TASK_TYPE_DOWNLOAD)
 	{
 	  tasks.thread = g_thread_new ("download_task",
 				       elektroid_download_task_runner, NULL);
@@ -631,6 +749,11 @@ elektroid_run_next (gpointer data)
 	    }
 	}
 
+      if (!transfer_active)
+	{
+	  browser_start_info_loader (&remote_browser);
+	}
+
       if (remote_browser.fs_ops->options & FS_OPTION_AUDIO_LINK)
 	{
 	  g_mutex_lock (&audio.control.controllable.mutex);
@@ -663,7 +786,7 @@ elektroid_show_task_overwrite_dialog_response (GtkDialog *dialog,
       //Cancel current task.
       tasks.transfer.status = TASK_STATUS_CANCELED;
       //Cancel all tasks belonging to the same batch.
-      tasks_visit_pending (tasks_visitor_set_batch_canceled);
+      tasks_cancel_batch (tasks.transfer.batch_id);
       break;
     case GTK_RESPONSE_REJECT:
       //Cancel current task.
@@ -671,14 +794,14 @@ elektroid_show_task_overwrite_dialog_response (GtkDialog *dialog,
       if (apply_to_all)
 	{
 	  //Mark pending tasks as SKIP.
-	  tasks_visit_pending (tasks_batch_visitor_set_skip);
+	  tasks_set_batch_mode (tasks.transfer.batch_id, TASK_MODE_SKIP);
 	}
       break;
     case GTK_RESPONSE_ACCEPT:
       if (apply_to_all)
 	{
 	  //Mark pending tasks as REPLACE.
-	  tasks_visit_pending (tasks_batch_visitor_set_replace);
+	  tasks_set_batch_mode (tasks.transfer.batch_id, TASK_MODE_REPLACE);
 	}
       break;
     }
@@ -771,8 +894,8 @@ elektroid_upload_task_runner (gpointer data)
       return NULL;
     }
 
-  res = tasks.transfer.fs_ops->load (BACKEND, tasks.transfer.src, &idata,
-				     &tasks.transfer.control);
+  res = preloader_load (&preloader, BACKEND, tasks.transfer.fs_ops,
+			tasks.transfer.src, &idata, &tasks.transfer.control);
   if (res)
     {
       error_print ("Error while loading file");
@@ -799,6 +922,7 @@ elektroid_upload_task_runner (gpointer data)
   res = tasks.transfer.fs_ops->upload (BACKEND,
 				       upload_path, &idata,
 				       &tasks.transfer.control);
+  slot_cache_invalidate (BACKEND, tasks.transfer.fs_ops, upload_path);
 
   active = controllable_is_active (&tasks.transfer.control.controllable);
   if (res && active)
@@ -832,6 +956,110 @@ end:
   return NULL;
 }
 
+//The current tasks do not change until the group is completed.
+//Items that can not be loaded fail without stopping the rest.
+
+static gpointer
+elektroid_group_task_runner (gpointer data)
+{
+  gint err;
+  guint i = 0;
+  gboolean active;
+  struct task *task;
+  struct idata *idata;
+  struct fs_batch_item *items;
+  guint len = tasks.transfer.group_len;
+  const struct fs_operations *ops = tasks.transfer.fs_ops;
+
+  items = g_new0 (struct fs_batch_item, len);
+  idata = g_new0 (struct idata, len);
+
+  //Every task has its item, even if it can not be loaded, so that the control parts are the task rows.
+  for (GList *l = tasks.queue.current.head; l; l = l->next, i++)
+    {
+      task = l->data;
+
+      if (task->type == TASK_TYPE_DELETE)
+	{
+	  debug_print (1, "Deleting %s (filesystem %s)...", task->src,
+		       ops->name);
+	  items[i].path = g_strdup (task->src);
+	  items[i].idata = NULL;
+	}
+      else
+	{
+	  debug_print (1, "Writing from file %s (filesystem %s)...",
+		       task->src, ops->name);
+	  items[i].err = preloader_load (&preloader, BACKEND, ops, task->src,
+					 &idata[i], &tasks.transfer.control);
+	  if (items[i].err)
+	    {
+	      error_print ("Error while loading file %s", task->src);
+	      continue;
+	    }
+	  items[i].path = ops->get_upload_path (BACKEND, ops, task->dst,
+						task->src, &idata[i]);
+	  items[i].idata = &idata[i];
+	}
+    }
+
+  //Nothing is sent if the tasks were cancelled while loading.
+  if (controllable_is_active (&tasks.transfer.control.controllable))
+    {
+      err = ops->upload_batch (BACKEND, items, len, &tasks.transfer.control);
+    }
+  else
+    {
+      err = -ECANCELED;
+      for (i = 0; i < len; i++)
+	{
+	  items[i].err = items[i].err ? items[i].err : -ECANCELED;
+	}
+    }
+  active = controllable_is_active (&tasks.transfer.control.controllable);
+  if (err && active)
+    {
+      error_print ("Error while running tasks");
+    }
+
+  for (i = 0; i < len; i++)
+    {
+      if (items[i].path)
+	{
+	  slot_cache_invalidate (BACKEND, ops, items[i].path);
+	}
+      if (items[i].err)
+	{
+	  tasks.transfer.group_status[i] = active ?
+	    TASK_STATUS_COMPLETED_ERROR : TASK_STATUS_CANCELED;
+	}
+      else
+	{
+	  tasks.transfer.group_status[i] = TASK_STATUS_COMPLETED_OK;
+	}
+      g_free (items[i].path);
+      if (items[i].idata)
+	{
+	  idata_clear (items[i].idata);
+	}
+    }
+
+  tasks.transfer.status = err ? TASK_STATUS_COMPLETED_ERROR :
+    TASK_STATUS_COMPLETED_OK;
+
+  if (!(ops->options & FS_OPTION_SINGLE_OP))
+    {
+      g_idle_add (browser_load_dir_if_needed, &remote_browser);
+    }
+
+  g_free (items);
+  g_free (idata);
+
+  g_idle_add (tasks_complete_current, &tasks);
+  g_idle_add (elektroid_run_next, NULL);
+  return NULL;
+}
+
 static void
 elektroid_add_upload_task_path (const gchar *rel_path,
 				const gchar *src_dir, const gchar *dst_dir,
@@ -886,15 +1114,13 @@ cleanup:
 static void
 elektroid_add_upload_tasks_runner (gpointer data)
 {
-  GtkTreeIter iter;
   GList *selected_rows;
   gboolean queued_before, queued_after;
   gboolean *has_progress_window = data;
   GtkTreeModel *model = gtk_tree_view_get_model (local_browser.view);
   GtkTreeSelection *sel = gtk_tree_view_get_selection (local_browser.view);
 
-  queued_before = tasks_get_next_queued (&iter, NULL, NULL, NULL,
-					 NULL, NULL, NULL);
+  queued_before = tasks_has_queued ();
 
   selected_rows = gtk_tree_selection_get_selected_rows (sel, NULL);
   while (selected_rows)
@@ -908,6 +1134,7 @@ elektroid_add_upload_tasks_runner (gpointer data)
       elektroid_add_upload_task_path (item.name, local_browser.dir,
 				      remote_browser.dir,
 				      *has_progress_window);
+      item_clear (&item);
 
       if (*has_progress_window && !progress_window_is_active ())
 	{
@@ -918,8 +1145,7 @@ elektroid_add_upload_tasks_runner (gpointer data)
     }
   g_list_free_full (selected_rows, (GDestroyNotify) gtk_tree_path_free);
 
-  queued_after = tasks_get_next_queued (&iter, NULL, NULL, NULL,
-					NULL, NULL, NULL);
+  queued_after = tasks_has_queued ();
   if (!queued_before && queued_after)
     {
       g_idle_add (elektroid_run_next, NULL);
@@ -1041,7 +1267,8 @@ elektroid_add_download_task_path (const gchar *rel_path,
   g_free (rel_path_trans);
 
   //Check if the item is a dir. If error, it's not.
-  if (remote_browser.fs_ops->readdir (BACKEND, &iter, src_abs_path, NULL))
+  if (slot_cache_readdir (BACKEND, remote_browser.fs_ops, &iter, src_abs_path,
+			  NULL))
     {
       rel_path_trans = path_translate (PATH_SYSTEM, rel_path);
       gchar *dst_abs_path = path_chain (PATH_SYSTEM, dst_dir, rel_path_trans);
@@ -1076,15 +1303,13 @@ cleanup:
 static void
 elektroid_add_download_tasks_runner (gpointer data)
 {
-  GtkTreeIter iter;
   GList *selected_rows;
   gboolean queued_before, queued_after;
   gboolean *has_progress_window = data;
   GtkTreeModel *model = gtk_tree_view_get_model (remote_browser.view);
   GtkTreeSelection *sel = gtk_tree_view_get_selection (remote_browser.view);
 
-  queued_before = tasks_get_next_queued (&iter, NULL, NULL, NULL,
-					 NULL, NULL, NULL);
+  queued_before = tasks_has_queued ();
 
   selected_rows = gtk_tree_selection_get_selected_rows (sel, NULL);
   while (selected_rows)
@@ -1097,6 +1322,7 @@ elektroid_add_download_tasks_runner (gpointer data)
       gtk_tree_model_get_iter (model, &path_iter, path);
       browser_set_item (model, &path_iter, &item);
       filename = item_get_filename (&item, remote_browser.fs_ops->options);
+      item_clear (&item);
       elektroid_add_download_task_path (filename, remote_browser.dir,
 					local_browser.dir,
 					*has_progress_window);
@@ -1111,8 +1337,7 @@ elektroid_add_download_tasks_runner (gpointer data)
     }
   g_list_free_full (selected_rows, (GDestroyNotify) gtk_tree_path_free);
 
-  queued_after = tasks_get_next_queued (&iter, NULL, NULL, NULL,
-					NULL, NULL, NULL);
+  queued_after = tasks_has_queued ();
   if (!queued_before && queued_after)
     {
       g_idle_add (elektroid_run_next, NULL);
@@ -1291,6 +1516,7 @@ elektroid_set_device (GtkWidget *object, gpointer data)
 
   if (backend_check (BACKEND))
     {
+      browser_wait_info_loaders (&remote_browser);
       backend_destroy (BACKEND);
     }
 
@@ -1342,6 +1568,8 @@ elektroid_dnd_received_browser (const gchar *dir, const gchar *name,
     {
       dst_path = path_chain (type, browser->dir, name);
       res = browser->fs_ops->move (browser->backend, filename, dst_path);
+      slot_cache_invalidate (browser->backend, browser->fs_ops, filename);
+      slot_cache_invalidate (browser->backend, browser->fs_ops, dst_path);
       if (res)
 	{
 	  error_print ("Error while moving from “%s” to “%s”: %s.",
@@ -1377,8 +1605,9 @@ elektroid_add_upload_task_slot (const gchar *name,
 	}
 
       browser_set_item (model, &iter, &item);
-
       filename = item_get_filename (&item, remote_browser.fs_ops->options);
+      item_clear (&item);
+
       str = g_string_new (NULL);
       g_string_append_printf (str, "%s%s%s", remote_browser.dir,
 			      strcmp (remote_browser.dir, "/") ?
@@ -1394,14 +1623,12 @@ elektroid_add_upload_task_slot (const gchar *name,
 void
 elektroid_browser_drag_data_received_runner (gpointer user_data)
 {
-  GtkTreeIter iter;
   gboolean queued_before, queued_after;
   struct browser_drag_data_received_data *data = user_data;
   gboolean has_progress_window = data->has_progress_window;
   GtkWidget *widget = data->widget;
 
-  queued_before = tasks_get_next_queued (&iter, NULL, NULL, NULL,
-					 NULL, NULL, NULL);
+  queued_before = tasks_has_queued ();
 
   for (gint i = 0; data->uris[i] != NULL; i++)
     {
@@ -1456,8 +1683,7 @@ elektroid_browser_drag_data_received_runner (gpointer user_data)
     }
 
 end:
-  queued_after = tasks_get_next_queued (&iter, NULL, NULL, NULL,
-					NULL, NULL, NULL);
+  queued_after = tasks_has_queued ();
   if (!queued_before && queued_after)
     {
       g_idle_add (elektroid_run_next, NULL);
@@ -1474,6 +1700,7 @@ static void
 elektroid_exit ()
 {
   tasks_stop_thread ();
+  preloader_clear (&preloader);
 
   progress_window_destroy ();
   microbrute_destroy ();
@@ -1611,6 +1838,8 @@ elektroid_startup (GApplication *gapp, gpointer *user_data)
     GTK_WIDGET (gtk_builder_get_object (builder, "preferences_button"));
   about_button =
     GTK_WIDGET (gtk_builder_get_object (builder, "about_button"));
+  stats_button =
+    GTK_WIDGET (gtk_builder_get_object (builder, "stats_button"));
 
   local_name_entry =
     GTK_WIDGET (gtk_builder_get_object (builder, "local_name_entry"));
@@ -1640,6 +1869,9 @@ elektroid_startup (GApplication *gapp, gpointer *user_data)
   g_signal_connect (about_button, "clicked",
 		    G_CALLBACK (elektroid_show_about), NULL);
 
+  g_signal_connect (stats_button, "clicked",
+		    G_CALLBACK (elektroid_show_stats), NULL);
+
   devices_list_store =
     GTK_LIST_STORE (gtk_builder_get_object (builder, "devices_list_store"));
   devices_combo =
@@ -1782,6 +2014,9 @@ main (int argc, char *argv[])
 
   preferences_load ();
 
+  sample_index_init ();
+  preloader_init (&preloader, PRELOAD_MAX_BYTES);
+
   app = gtk_application_new ("io.github.dagargo.Elektroid",
 			     G_APPLICATION_NON_UNIQUE);
 
@@ -1794,6 +2029,9 @@ main (int argc, char *argv[])
 
   g_object_unref (app);
 
+  preloader_destroy (&preloader);
+  sample_index_destroy ();
+
   preferences_save ();
   preferences_free ();
 
@@ -0,0 +1,227 @@
+/*
+ *   info_cache.c
+ *   Copyright (C) 2024 David García Goñi <dagargo@gmail.com>
+ *
+ *   This file is part of Elektroid.
+ *
+ *   Elektroid is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Elektroid is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Elektroid. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib/gstdio.h>
+#include "info_cache.h"
+
+//Loading the info of a whole directory only writes the file a few times.
+#define INFO_CACHE_SAVE_CHANGES 32
+
+//Called with the mutex locked.
+
+static void
+info_cache_load (struct info_cache *cache)
+{
+  JsonNode *root;
+  GError *error = NULL;
+  JsonParser *parser;
+
+  if (cache->entries)
+    {
+      return;
+    }
+
+  if (!cache->filename)
+    {
+      cache->entries = json_object_new ();
+      return;
+    }
+
+  parser = json_parser_new ();
+  if (json_parser_load_from_file (parser, cache->filename, &error))
+    {
+      root = json_parser_get_root (parser);
+      if (JSON_NODE_HOLDS_OBJECT (root))
+	{
+	  cache->entries = json_object_ref (json_node_get_object (root));
+	}
+      else
+	{
+	  error_print ("Invalid info cache file '%s'", cache->filename);
+	}
+    }
+  else
+    {
+      debug_print (1, "Info cache '%s' not loaded: %s", cache->filename,
+		   error->message);
+      g_error_free (error);
+    }
+
+  g_object_unref (parser);
+
+  if (!cache->entries)
+    {
+      cache->entries = json_object_new ();
+    }
+}
+
+//Called with the mutex locked.
+
+static gint
+info_cache_save_unlocked (struct info_cache *cache)
+{
+  gint err = 0;
+  gchar *json, *dir;
+  JsonNode *root;
+  JsonGenerator *gen;
+  GError *error = NULL;
+
+  if (!cache->filename || !cache->entries || !cache->changes)
+    {
+      return 0;
+    }
+
+  dir = g_path_get_dirname (cache->filename);
+  if (g_mkdir_with_parents (dir, S_IFDIR | S_IRWXU | S_IRGRP | S_IXGRP |
+			    S_IROTH | S_IXOTH))
+    {
+      error_print ("Error while creating directory `%s'", dir);
+      g_free (dir);
+      return -errno;
+    }
+  g_free (dir);
+
+  debug_print (1, "Saving info cache to '%s'...", cache->filename);
+
+  root = json_node_new (JSON_NODE_OBJECT);
+  json_node_set_object (root, cache->entries);
+  gen = json_generator_new ();
+  json_generator_set_root (gen, root);
+  json = json_generator_to_data (gen, NULL);
+
+  if (g_file_set_contents (cache->filename, json, -1, &error))
+    {
+      cache->changes = 0;
+    }
+  else
+    {
+      error_print ("Error while saving info cache to '%s': %s",
+		   cache->filename, error->message);
+      g_clear_error (&error);
+      err = -EIO;
+    }
+
+  g_free (json);
+  g_object_unref (gen);
+  json_node_free (root);
+
+  return err;
+}
+
+void
+info_cache_init (struct info_cache *cache, const gchar *filename)
+{
+  g_mutex_init (&cache->mutex);
+  cache->filename = g_strdup (filename);
+  cache->entries = NULL;
+  cache->changes = 0;
+}
+
+gchar *
+info_cache_get (struct info_cache *cache, const gchar *path, gint64 size)
+{
+  JsonObject *entry;
+  gchar *info = NULL;
+
+  g_mutex_lock (&cache->mutex);
+
+  info_cache_load (cache);
+
+  if (json_object_has_member (cache->entries, path))
+    {
+      entry = json_object_get_object_member (cache->entries, path);
+      if (entry && json_object_get_int_member (entry, "size") == size)
+	{
+	  info = g_strdup (json_object_get_string_member (entry, "info"));
+	}
+    }
+
+  g_mutex_unlock (&cache->mutex);
+
+  debug_print (2, "Info cache %s for '%s'", info ? "hit" : "miss", path);
+
+  return info;
+}
+
+void
+info_cache_set (struct info_cache *cache, const gchar *path, gint64 size,
+		const gchar *info)
+{
+  JsonObject *entry = json_object_new ();
+
+  json_object_set_int_member (entry, "size", size);
+  json_object_set_string_member (entry, "info", info);
+
+  g_mutex_lock (&cache->mutex);
+
+  info_cache_load (cache);
+  json_object_set_object_member (cache->entries, path, entry);
+  cache->changes++;
+  if (cache->changes >= INFO_CACHE_SAVE_CHANGES)
+    {
+      info_cache_save_unlocked (cache);
+    }
+
+  g_mutex_unlock (&cache->mutex);
+}
+
+void
+info_cache_invalidate (struct info_cache *cache, const gchar *path)
+{
+  g_mutex_lock (&cache->mutex);
+
+  info_cache_load (cache);
+  if (json_object_has_member (cache->entries, path))
+    {
+      debug_print (1, "Invalidating info cache for '%s'...", path);
+      json_object_remove_member (cache->entries, path);
+      cache->changes++;
+      info_cache_save_unlocked (cache);
+    }
+
+  g_mutex_unlock (&cache->mutex);
+}
+
+gint
+info_cache_save (struct info_cache *cache)
+{
+  gint err;
+
+  g_mutex_lock (&cache->mutex);
+  err = info_cache_save_unlocked (cache);
+  g_mutex_unlock (&cache->mutex);
+
+  return err;
+}
+
+void
+info_cache_free (struct info_cache *cache)
+{
+  info_cache_save (cache);
+
+  if (cache->entries)
+    {
+      json_object_unref (cache->entries);
+      cache->entries = NULL;
+    }
+  g_free (cache->filename);
+  cache->filename = NULL;
+  g_mutex_clear (&cache->mutex);
+}
@@ -0,0 +1,56 @@
+/*
+ *   info_cache.h
+ *   Copyright (C) 2024 David García Goñi <dagargo@gmail.com>
+ *
+ *   This file is part of Elektroid.
+ *
+ *   Elektroid is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Elektroid is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Elektroid. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INFO_CACHE_H
+#define INFO_CACHE_H
+
+#include "utils.h"
+
+//Stores on disk the object info that filesystems load with load_object_info so that it is only loaded from the device once per change.
+//Entries are addressed by path and are only valid while the item keeps the same size.
+//All the functions are thread safe.
+struct info_cache
+{
+  GMutex mutex;
+  gchar *filename;
+  JsonObject *entries;		//Loaded on first use
+  guint changes;		//Changes not saved yet
+};
+
+//Nothing is read from disk until the cache is used. If filename is NULL, the entries are only kept in memory.
+void info_cache_init (struct info_cache *cache, const gchar * filename);
+
+//Returns NULL if there is no entry for the path or if the size does not match.
+gchar *info_cache_get (struct info_cache *cache, const gchar * path,
+		       gint64 size);
+
+//Changes are saved in batches. See info_cache_save.
+void info_cache_set (struct info_cache *cache, const gchar * path,
+		     gint64 size, const gchar * info);
+
+//It must be called after every operation that modifies the item in the device. This is saved immediately.
+void info_cache_invalidate (struct info_cache *cache, const gchar * path);
+
+gint info_cache_save (struct info_cache *cache);
+
+//Pending changes are saved.
+void info_cache_free (struct info_cache *cache);
+
+#endif
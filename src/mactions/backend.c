@@ -314,7 +314,6 @@ static void
 backend_rx_sysex_runner (gpointer user_data)
 {
   gint err;
-  gchar *text;
   struct backend_rx_sysex_data *data = user_data;
 
   //This doesn't need to be synchronized because the GUI doesn't allow concurrent access when receiving SysEx in batch mode.
@@ -328,10 +327,9 @@ backend_rx_sysex_runner (gpointer user_data)
     }
   else
     {
-      text = debug_get_hex_msg (data->sysex_transfer.raw);
-      debug_print (1, "SysEx message received (%d): %s",
-		   data->sysex_transfer.raw->len, text);
-      g_free (text);
+      debug_print_hex_msg (1, data->sysex_transfer.raw,
+			   "SysEx message received (%d): %s",
+			   data->sysex_transfer.raw->len);
     }
 }
 
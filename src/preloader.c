@@ -0,0 +1,325 @@
+/*
+ *   preloader.c
+ *   Copyright (C) 2024 David García Goñi <dagargo@gmail.com>
+ *
+ *   This file is part of Elektroid.
+ *
+ *   Elektroid is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Elektroid is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Elektroid. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <glib/gstdio.h>
+#include "preloader.h"
+
+#define PRELOADER_WAIT_US 100000
+
+struct preloader_job
+{
+  gchar *key;
+  gchar *path;
+  struct backend *backend;
+  const struct fs_operations *fs_ops;
+  struct task_control control;
+  struct idata idata;
+  gint64 bytes;
+  gint err;
+  guint generation;
+  gboolean started;
+  gboolean done;
+  gboolean discarded;
+};
+
+//The payload only depends on the path and the filesystem as the backend does not change while there are tasks.
+
+static gchar *
+preloader_get_key (const struct fs_operations *fs_ops, const gchar *path)
+{
+  return g_strdup_printf ("%d:%s", fs_ops->id, path);
+}
+
+static void
+preloader_job_free (struct preloader_job *job)
+{
+  idata_clear (&job->idata);
+  controllable_clear (&job->control.controllable);
+  g_free (job->key);
+  g_free (job->path);
+  g_free (job);
+}
+
+//The job must have been removed from the table before calling this. A job that has not finished yet is freed by the worker.
+
+static void
+preloader_discard (struct preloader *preloader, struct preloader_job *job)
+{
+  debug_print (1, "Discarding preloaded %s...", job->path);
+
+  preloader->bytes -= job->bytes;
+
+  if (job->done)
+    {
+      preloader_job_free (job);
+    }
+  else
+    {
+      job->discarded = TRUE;
+      controllable_set_active (&job->control.controllable, FALSE);
+    }
+}
+
+static void
+preloader_run (gpointer data, gpointer user_data)
+{
+  gint err;
+  struct idata idata;
+  struct preloader_job *job = data;
+  struct preloader *preloader = user_data;
+
+  g_mutex_lock (&preloader->mutex);
+  if (job->discarded)
+    {
+      preloader_job_free (job);
+      g_mutex_unlock (&preloader->mutex);
+      return;
+    }
+  job->started = TRUE;
+  preloader->running++;
+  g_mutex_unlock (&preloader->mutex);
+
+  debug_print (1, "Preloading %s (filesystem %s)...", job->path,
+	       job->fs_ops->name);
+
+  err = job->fs_ops->load (job->backend, job->path, &idata, &job->control);
+
+  g_mutex_lock (&preloader->mutex);
+
+  preloader->running--;
+  job->err = err;
+  job->done = TRUE;
+  if (!err)
+    {
+      job->idata = idata;
+    }
+
+  if (job->discarded)
+    {
+      preloader_job_free (job);
+    }
+  else
+    {
+      //The estimation is replaced by the actual size.
+      preloader->bytes -= job->bytes;
+      job->bytes = job->idata.content ? job->idata.content->len : 0;
+      preloader->bytes += job->bytes;
+    }
+
+  g_cond_broadcast (&preloader->cond);
+  g_mutex_unlock (&preloader->mutex);
+}
+
+void
+preloader_init (struct preloader *preloader, gint64 max_bytes)
+{
+  guint threads = MAX (1, g_get_num_processors () - 1);
+
+  g_mutex_init (&preloader->mutex);
+  g_cond_init (&preloader->cond);
+  preloader->jobs = g_hash_table_new (g_str_hash, g_str_equal);
+  preloader->bytes = 0;
+  preloader->max_bytes = max_bytes;
+  preloader->generation = 0;
+  preloader->running = 0;
+  preloader->pool = g_thread_pool_new (preloader_run, preloader, threads,
+				       FALSE, NULL);
+
+  debug_print (1, "Preloading with %d threads and %" G_GINT64_FORMAT
+	       " B...", threads, max_bytes);
+}
+
+void
+preloader_destroy (struct preloader *preloader)
+{
+  preloader_clear (preloader);
+
+  //The discarded jobs still in the pool are freed by the workers.
+  g_thread_pool_free (preloader->pool, FALSE, TRUE);
+  preloader->pool = NULL;
+
+  g_hash_table_destroy (preloader->jobs);
+  preloader->jobs = NULL;
+  g_mutex_clear (&preloader->mutex);
+  g_cond_clear (&preloader->cond);
+}
+
+gboolean
+preloader_add (struct preloader *preloader, struct backend *backend,
+	       const struct fs_operations *fs_ops, const gchar *path)
+{
+  GStatBuf sb;
+  gboolean added = TRUE;
+  struct preloader_job *job;
+  gchar *key = preloader_get_key (fs_ops, path);
+  gint64 bytes = g_stat (path, &sb) ? 0 : sb.st_size;
+
+  g_mutex_lock (&preloader->mutex);
+
+  job = g_hash_table_lookup (preloader->jobs, key);
+  if (job)
+    {
+      job->generation = preloader->generation;
+      g_free (key);
+      goto end;
+    }
+
+  //A single payload is always allowed.
+  if (g_hash_table_size (preloader->jobs) &&
+      preloader->bytes + bytes > preloader->max_bytes)
+    {
+      debug_print (2, "Preloading cap reached. Skipping %s...", path);
+      added = FALSE;
+      g_free (key);
+      goto end;
+    }
+
+  job = g_new0 (struct preloader_job, 1);
+  job->key = key;
+  job->path = g_strdup (path);
+  job->backend = backend;
+  job->fs_ops = fs_ops;
+  job->bytes = bytes;
+  job->generation = preloader->generation;
+  controllable_init (&job->control.controllable);
+
+  preloader->bytes += bytes;
+  g_hash_table_insert (preloader->jobs, job->key, job);
+  g_thread_pool_push (preloader->pool, job, NULL);
+
+end:
+  g_mutex_unlock (&preloader->mutex);
+  return added;
+}
+
+gint
+preloader_load (struct preloader *preloader, struct backend *backend,
+		const struct fs_operations *fs_ops, const gchar *path,
+		struct idata *idata, struct task_control *control)
+{
+  gint err;
+  struct preloader_job *job;
+  gchar *key = preloader_get_key (fs_ops, path);
+
+  g_mutex_lock (&preloader->mutex);
+
+  job = g_hash_table_lookup (preloader->jobs, key);
+  g_free (key);
+  if (job)
+    {
+      g_hash_table_remove (preloader->jobs, job->key);
+      //Loading here is faster than waiting for a worker to be available.
+      if (!job->started)
+	{
+	  preloader_discard (preloader, job);
+	  job = NULL;
+	}
+    }
+
+  if (!job)
+    {
+      g_mutex_unlock (&preloader->mutex);
+      return fs_ops->load (backend, path, idata, control);
+    }
+
+  while (!job->done)
+    {
+      if (!controllable_is_active (&control->controllable))
+	{
+	  preloader_discard (preloader, job);
+	  g_mutex_unlock (&preloader->mutex);
+	  return -ECANCELED;
+	}
+
+      g_cond_wait_until (&preloader->cond, &preloader->mutex,
+			 g_get_monotonic_time () + PRELOADER_WAIT_US);
+    }
+
+  preloader->bytes -= job->bytes;
+
+  g_mutex_unlock (&preloader->mutex);
+
+  debug_print (1, "Using preloaded %s...", path);
+
+  err = job->err;
+  if (!err)
+    {
+      *idata = job->idata;
+      job->idata.content = NULL;
+    }
+
+  g_mutex_lock (&control->controllable.mutex);
+  control->parts = job->control.parts;
+  control->part = job->control.part;
+  control->progress = job->control.progress;
+  g_mutex_unlock (&control->controllable.mutex);
+
+  preloader_job_free (job);
+
+  return err;
+}
+
+void
+preloader_mark (struct preloader *preloader)
+{
+  g_mutex_lock (&preloader->mutex);
+  preloader->generation++;
+  g_mutex_unlock (&preloader->mutex);
+}
+
+static void
+preloader_remove_if (struct preloader *preloader, gboolean stale_only,
+		     gboolean wait)
+{
+  GHashTableIter iter;
+  struct preloader_job *job;
+
+  g_mutex_lock (&preloader->mutex);
+
+  g_hash_table_iter_init (&iter, preloader->jobs);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) & job))
+    {
+      if (!stale_only || job->generation != preloader->generation)
+	{
+	  g_hash_table_iter_remove (&iter);
+	  preloader_discard (preloader, job);
+	}
+    }
+
+  while (wait && preloader->running)
+    {
+      g_cond_wait (&preloader->cond, &preloader->mutex);
+    }
+
+  g_mutex_unlock (&preloader->mutex);
+}
+
+void
+preloader_sweep (struct preloader *preloader)
+{
+  preloader_remove_if (preloader, TRUE, FALSE);
+}
+
+void
+preloader_clear (struct preloader *preloader)
+{
+  preloader_remove_if (preloader, FALSE, TRUE);
+}
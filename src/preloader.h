@@ -0,0 +1,64 @@
+/*
+ *   preloader.h
+ *   Copyright (C) 2024 David García Goñi <dagargo@gmail.com>
+ *
+ *   This file is part of Elektroid.
+ *
+ *   Elektroid is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Elektroid is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Elektroid. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PRELOADER_H
+#define PRELOADER_H
+
+#include "connector.h"
+
+//Runs the load operation of the upcoming uploads in a pool of worker threads so that decoding, resampling and encoding overlap with the current transfer.
+//The bytes of the preloaded payloads are capped. Until a payload is loaded, the size of the file is used as an estimation.
+
+struct preloader
+{
+  GMutex mutex;
+  GCond cond;
+  GThreadPool *pool;
+  GHashTable *jobs;
+  gint64 bytes;
+  gint64 max_bytes;
+  guint generation;
+  guint running;
+};
+
+void preloader_init (struct preloader *preloader, gint64 max_bytes);
+
+void preloader_destroy (struct preloader *preloader);
+
+//Returns FALSE if the memory cap has been reached. Adding a path that is already preloaded or being preloaded just keeps it.
+gboolean preloader_add (struct preloader *preloader, struct backend *backend,
+			const struct fs_operations *fs_ops,
+			const gchar * path);
+
+//Moves the payload of a preloaded path to idata, waiting for it if needed, or loads it if it was not preloaded.
+//The parts of the control are set as if the load had been run with it.
+gint preloader_load (struct preloader *preloader, struct backend *backend,
+		     const struct fs_operations *fs_ops, const gchar * path,
+		     struct idata *idata, struct task_control *control);
+
+//Every path not added between these calls is discarded by preloader_sweep.
+void preloader_mark (struct preloader *preloader);
+
+void preloader_sweep (struct preloader *preloader);
+
+//Discards every path and waits for the running loads to finish so that the backend can be destroyed afterwards.
+void preloader_clear (struct preloader *preloader);
+
+#endif
@@ -0,0 +1,993 @@
+/*
+ *   sample_index.c
+ *   Copyright (C) 2024 David García Goñi <dagargo@gmail.com>
+ *
+ *   This file is part of Elektroid.
+ *
+ *   Elektroid is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Elektroid is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Elektroid. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <gio/gio.h>
+#include <glib/gstdio.h>
+#include "sample.h"
+#include "sample_index.h"
+
+#define SAMPLE_INDEX_FILE CACHE_DIR "/sample_index"
+#define SAMPLE_INDEX_VERSION 2
+#define SAMPLE_INDEX_SAMPLE_INFO_TYPE "(uutuuuuuuuuqqd)"
+#define SAMPLE_INDEX_ENTRY_TYPE "(sbxx" SAMPLE_INDEX_SAMPLE_INFO_TYPE "a{ss})"
+#define SAMPLE_INDEX_TYPE "(uas" "a" SAMPLE_INDEX_ENTRY_TYPE ")"
+#define SAMPLE_INDEX_BATCH_LEN 256
+#define SAMPLE_INDEX_MAX_MONITORS 4096
+
+struct sample_index_entry
+{
+  gboolean dir;
+  gint64 size;
+  gint64 mtime;			//Nanoseconds
+  struct sample_info sample_info;	//Tags are owned by the entry.
+};
+
+struct sample_index_job
+{
+  gchar *path;
+  gboolean root;
+};
+
+struct sample_index_result
+{
+  gchar *path;
+  struct sample_index_entry entry;
+};
+
+//Every member but the monitors is protected by the mutex. The monitors are only accessed from the main thread.
+
+struct sample_index
+{
+  GTree *entries;		//Sorted by path so that every directory tree is a contiguous range.
+  GHashTable *roots;		//Path to a boolean telling if the first scan is complete.
+  GMutex mutex;
+  GAsyncQueue *queue;
+  GThread *thread;
+  gboolean running;
+  gboolean dirty;
+  GHashTable *monitors;
+};
+
+static struct sample_index *sample_index = NULL;
+
+static GHashTable *
+sample_index_copy_tags (GHashTable *tags)
+{
+  GHashTableIter iter;
+  gpointer k, v;
+  GHashTable *copy;
+
+  if (!tags)
+    {
+      return NULL;
+    }
+
+  copy = sample_info_tags_new ();
+  g_hash_table_iter_init (&iter, tags);
+  while (g_hash_table_iter_next (&iter, &k, &v))
+    {
+      g_hash_table_insert (copy, g_strdup (k), g_strdup (v));
+    }
+
+  return copy;
+}
+
+static void
+sample_index_copy_sample_info (struct sample_info *dst,
+			       const struct sample_info *src)
+{
+  memcpy (dst, src, sizeof (struct sample_info));
+  dst->tags = sample_index_copy_tags (src->tags);
+}
+
+static void
+sample_index_free_entry (gpointer data)
+{
+  struct sample_index_entry *entry = data;
+  sample_info_clear (&entry->sample_info);
+  g_free (entry);
+}
+
+static gchar *
+sample_index_get_prefix (const gchar *dir)
+{
+  if (g_str_has_suffix (dir, G_DIR_SEPARATOR_S))
+    {
+      return g_strdup (dir);
+    }
+  return g_strconcat (dir, G_DIR_SEPARATOR_S, NULL);
+}
+
+static gboolean
+sample_index_is_under (const gchar *path, const gchar *dir)
+{
+  gboolean under;
+  gchar *prefix;
+
+  if (!strcmp (path, dir))
+    {
+      return TRUE;
+    }
+
+  prefix = sample_index_get_prefix (dir);
+  under = g_str_has_prefix (path, prefix);
+  g_free (prefix);
+
+  return under;
+}
+
+//The mutex must be held.
+
+static gboolean
+sample_index_is_indexed (const gchar *dir, gboolean complete)
+{
+  GHashTableIter iter;
+  gpointer k, v;
+
+  g_hash_table_iter_init (&iter, sample_index->roots);
+  while (g_hash_table_iter_next (&iter, &k, &v))
+    {
+      if ((!complete || GPOINTER_TO_INT (v)) && sample_index_is_under (dir, k))
+	{
+	  return TRUE;
+	}
+    }
+
+  return FALSE;
+}
+
+//The mutex must be held.
+
+static void
+sample_index_remove_tree (const gchar *path, GHashTable *keep)
+{
+  GTreeNode *node;
+  GSList *keys = NULL;
+  gchar *prefix = sample_index_get_prefix (path);
+
+  g_tree_remove (sample_index->entries, path);
+
+  node = g_tree_lower_bound (sample_index->entries, prefix);
+  while (node && g_str_has_prefix (g_tree_node_key (node), prefix))
+    {
+      const gchar *key = g_tree_node_key (node);
+      if (!keep || !g_hash_table_contains (keep, key))
+	{
+	  keys = g_slist_prepend (keys, g_strdup (key));
+	}
+      node = g_tree_node_next (node);
+    }
+
+  for (GSList * l = keys; l; l = l->next)
+    {
+      g_tree_remove (sample_index->entries, l->data);
+      sample_index->dirty = TRUE;
+    }
+
+  g_slist_free_full (keys, g_free);
+  g_free (prefix);
+}
+
+//The mutex must be held.
+
+static void
+sample_index_insert (const gchar *path, gboolean dir, gint64 size,
+		     gint64 mtime, const struct sample_info *sample_info)
+{
+  struct sample_index_entry *entry =
+    g_malloc (sizeof (struct sample_index_entry));
+
+  entry->dir = dir;
+  entry->size = size;
+  entry->mtime = mtime;
+  if (sample_info)
+    {
+      sample_index_copy_sample_info (&entry->sample_info, sample_info);
+    }
+  else
+    {
+      sample_info_init (&entry->sample_info);
+    }
+
+  g_tree_replace (sample_index->entries, g_strdup (path), entry);
+  sample_index->dirty = TRUE;
+}
+
+gboolean
+sample_index_get_sample_info (const gchar *path, gint64 size, gint64 mtime,
+			      struct sample_info *sample_info)
+{
+  gboolean found = FALSE;
+  struct sample_index_entry *entry;
+
+  if (!sample_index)
+    {
+      return FALSE;
+    }
+
+  g_mutex_lock (&sample_index->mutex);
+  entry = g_tree_lookup (sample_index->entries, path);
+  if (entry && !entry->dir && entry->size == size && entry->mtime == mtime)
+    {
+      sample_index_copy_sample_info (sample_info, &entry->sample_info);
+      found = TRUE;
+    }
+  g_mutex_unlock (&sample_index->mutex);
+
+  return found;
+}
+
+void
+sample_index_set_sample_info (const gchar *path, gint64 size, gint64 mtime,
+			      const struct sample_info *sample_info)
+{
+  if (!sample_index)
+    {
+      return;
+    }
+
+  g_mutex_lock (&sample_index->mutex);
+  //Files outside the indexed directories would never be removed.
+  if (sample_index_is_indexed (path, FALSE))
+    {
+      sample_index_insert (path, FALSE, size, mtime, sample_info);
+    }
+  g_mutex_unlock (&sample_index->mutex);
+}
+
+gint64
+sample_index_get_mtime (GStatBuf *sb)
+{
+#if defined(__MINGW32__) | defined(__MINGW64__)
+  return sb->st_mtime * G_GINT64_CONSTANT (1000000000);
+#elif defined(__APPLE__)
+  return sb->st_mtimespec.tv_sec * G_GINT64_CONSTANT (1000000000) +
+    sb->st_mtimespec.tv_nsec;
+#else
+  return sb->st_mtim.tv_sec * G_GINT64_CONSTANT (1000000000) +
+    sb->st_mtim.tv_nsec;
+#endif
+}
+
+//Symbolic links to directories are not followed as they might create loops.
+
+static gint
+sample_index_stat (const gchar *path, GStatBuf *sb)
+{
+  if (g_lstat (path, sb))
+    {
+      return -errno;
+    }
+
+  if (S_ISLNK (sb->st_mode))
+    {
+      if (g_stat (path, sb))
+	{
+	  return -errno;
+	}
+      if (S_ISDIR (sb->st_mode))
+	{
+	  return -ELOOP;
+	}
+    }
+
+  return 0;
+}
+
+static void
+sample_index_update_file (const gchar *path, GStatBuf *sb)
+{
+  struct sample_info sample_info;
+  gint64 mtime = sample_index_get_mtime (sb);
+
+  if (sample_index_get_sample_info (path, sb->st_size, mtime, &sample_info))
+    {
+      sample_info_clear (&sample_info);
+      return;
+    }
+
+  debug_print (2, "Indexing '%s'...", path);
+
+  sample_info_init (&sample_info);
+  if (filename_matches_exts (path, sample_get_sample_extensions (NULL, NULL)))
+    {
+      sample_load_sample_info (path, &sample_info);
+    }
+
+  sample_index_set_sample_info (path, sb->st_size, mtime, &sample_info);
+  sample_info_clear (&sample_info);
+}
+
+static gboolean
+sample_index_is_running ()
+{
+  gboolean running;
+  g_mutex_lock (&sample_index->mutex);
+  running = sample_index->running;
+  g_mutex_unlock (&sample_index->mutex);
+  return running;
+}
+
+static void
+sample_index_scan_dir (const gchar *dir, GHashTable *seen, GSList **dirs)
+{
+  GDir *gdir;
+  GStatBuf sb;
+  gchar *path;
+  const gchar *name;
+
+  if (!(gdir = g_dir_open (dir, 0, NULL)))
+    {
+      return;
+    }
+
+  *dirs = g_slist_prepend (*dirs, g_strdup (dir));
+
+  while ((name = g_dir_read_name (gdir)) && sample_index_is_running ())
+    {
+      if (name[0] == '.')
+	{
+	  continue;
+	}
+
+      path = path_chain (PATH_SYSTEM, dir, name);
+
+      if (sample_index_stat (path, &sb))
+	{
+	  g_free (path);
+	  continue;
+	}
+
+      if (S_ISDIR (sb.st_mode))
+	{
+	  g_mutex_lock (&sample_index->mutex);
+	  if (!g_tree_lookup (sample_index->entries, path))
+	    {
+	      sample_index_insert (path, TRUE, -1, 0, NULL);
+	    }
+	  g_mutex_unlock (&sample_index->mutex);
+
+	  sample_index_scan_dir (path, seen, dirs);
+	}
+      else if (S_ISREG (sb.st_mode))
+	{
+	  sample_index_update_file (path, &sb);
+	}
+      else
+	{
+	  g_free (path);
+	  continue;
+	}
+
+      if (seen)
+	{
+	  g_hash_table_add (seen, path);
+	}
+      else
+	{
+	  g_free (path);
+	}
+    }
+
+  g_dir_close (gdir);
+}
+
+static void
+sample_index_monitor_changed (GFileMonitor *monitor, GFile *file,
+			      GFile *other, GFileMonitorEvent event,
+			      gpointer data)
+{
+  struct sample_index_job *job;
+
+  switch (event)
+    {
+    case G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT:
+    case G_FILE_MONITOR_EVENT_DELETED:
+    case G_FILE_MONITOR_EVENT_CREATED:
+    case G_FILE_MONITOR_EVENT_MOVED_IN:
+    case G_FILE_MONITOR_EVENT_MOVED_OUT:
+    case G_FILE_MONITOR_EVENT_RENAMED:
+      break;
+    default:
+      return;
+    }
+
+  job = g_malloc (sizeof (struct sample_index_job));
+  job->path = g_file_get_path (file);
+  job->root = FALSE;
+  g_async_queue_push (sample_index->queue, job);
+
+  if (other)
+    {
+      job = g_malloc (sizeof (struct sample_index_job));
+      job->path = g_file_get_path (other);
+      job->root = FALSE;
+      g_async_queue_push (sample_index->queue, job);
+    }
+}
+
+//Monitors need to be created in the main thread to have their signals emitted in the main loop.
+
+static gboolean
+sample_index_add_monitors (gpointer data)
+{
+  GSList *dirs = data;
+  GFile *file;
+  GFileMonitor *monitor;
+
+  for (GSList * l = dirs; l && sample_index; l = l->next)
+    {
+      if (g_hash_table_contains (sample_index->monitors, l->data))
+	{
+	  continue;
+	}
+
+      if (g_hash_table_size (sample_index->monitors) >=
+	  SAMPLE_INDEX_MAX_MONITORS)
+	{
+	  debug_print (1,
+		       "Too many monitors. Changes will be detected on the next scan.");
+	  break;
+	}
+
+      file = g_file_new_for_path (l->data);
+      monitor = g_file_monitor_directory (file, G_FILE_MONITOR_WATCH_MOVES,
+					  NULL, NULL);
+      g_object_unref (file);
+      if (monitor)
+	{
+	  g_signal_connect (monitor, "changed",
+			    G_CALLBACK (sample_index_monitor_changed), NULL);
+	  g_hash_table_insert (sample_index->monitors, g_strdup (l->data),
+			       monitor);
+	}
+    }
+
+  g_slist_free_full (dirs, g_free);
+
+  return G_SOURCE_REMOVE;
+}
+
+static gboolean
+sample_index_is_monitor_under (gpointer key, gpointer value, gpointer data)
+{
+  return sample_index_is_under (key, data);
+}
+
+static gboolean
+sample_index_remove_monitors (gpointer data)
+{
+  gchar *dir = data;
+
+  if (sample_index)
+    {
+      g_hash_table_foreach_remove (sample_index->monitors,
+				   sample_index_is_monitor_under, dir);
+    }
+
+  g_free (dir);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+sample_index_scan_root (const gchar *root)
+{
+  GSList *dirs = NULL;
+  GHashTable *seen = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+					    NULL);
+
+  debug_print (1, "Scanning '%s'...", root);
+
+  sample_index_scan_dir (root, seen, &dirs);
+
+  g_mutex_lock (&sample_index->mutex);
+  if (sample_index->running)
+    {
+      sample_index_remove_tree (root, seen);
+      //The root might have been replaced by a parent one while scanning.
+      if (g_hash_table_contains (sample_index->roots, root))
+	{
+	  g_hash_table_insert (sample_index->roots, g_strdup (root),
+			       GINT_TO_POINTER (TRUE));
+	}
+    }
+  g_mutex_unlock (&sample_index->mutex);
+
+  debug_print (1, "'%s' scanned (%d files)", root, g_hash_table_size (seen));
+
+  g_hash_table_destroy (seen);
+
+  g_idle_add (sample_index_add_monitors, dirs);
+}
+
+static void
+sample_index_scan_path (const gchar *path)
+{
+  GStatBuf sb;
+  GSList *dirs = NULL;
+
+  if (sample_index_stat (path, &sb))
+    {
+      debug_print (2, "Removing '%s' from index...", path);
+      g_mutex_lock (&sample_index->mutex);
+      sample_index_remove_tree (path, NULL);
+      g_mutex_unlock (&sample_index->mutex);
+      g_idle_add (sample_index_remove_monitors, g_strdup (path));
+    }
+  else if (S_ISDIR (sb.st_mode))
+    {
+      g_mutex_lock (&sample_index->mutex);
+      sample_index_insert (path, TRUE, -1, 0, NULL);
+      g_mutex_unlock (&sample_index->mutex);
+
+      sample_index_scan_dir (path, NULL, &dirs);
+      g_idle_add (sample_index_add_monitors, dirs);
+    }
+  else if (S_ISREG (sb.st_mode))
+    {
+      sample_index_update_file (path, &sb);
+    }
+}
+
+static void
+sample_index_load ()
+{
+  GVariant *v, *roots, *entries, *sample_info, *tags;
+  GVariantIter iter, tags_iter;
+  gchar *path, *tag, *value, *root;
+  gboolean dir;
+  gint64 size, mtime;
+  guint32 version;
+  gdouble tempo;
+  gsize len;
+  gchar *contents;
+  struct sample_info si;
+  struct sample_index_entry *entry;
+  gchar *filename = get_user_dir (SAMPLE_INDEX_FILE);
+
+  if (!g_file_get_contents (filename, &contents, &len, NULL))
+    {
+      debug_print (1, "No sample index found at '%s'", filename);
+      g_free (filename);
+      return;
+    }
+
+  v = g_variant_new_from_data (G_VARIANT_TYPE (SAMPLE_INDEX_TYPE), contents,
+			       len, FALSE, g_free, contents);
+
+  g_variant_get_child (v, 0, "u", &version);
+  if (version != SAMPLE_INDEX_VERSION)
+    {
+      debug_print (1, "Ignoring sample index with version %d", version);
+      goto end;
+    }
+
+  g_mutex_lock (&sample_index->mutex);
+
+  roots = g_variant_get_child_value (v, 1);
+  g_variant_iter_init (&iter, roots);
+  while (g_variant_iter_next (&iter, "s", &root))
+    {
+      g_hash_table_insert (sample_index->roots, root, GINT_TO_POINTER (TRUE));
+    }
+  g_variant_unref (roots);
+
+  entries = g_variant_get_child_value (v, 2);
+  g_variant_iter_init (&iter, entries);
+  while (g_variant_iter_next (&iter, "(sbxx@" SAMPLE_INDEX_SAMPLE_INFO_TYPE
+			      "@a{ss})", &path, &dir, &size, &mtime,
+			      &sample_info, &tags))
+    {
+      sample_info_init (&si);
+      g_variant_get (sample_info, SAMPLE_INDEX_SAMPLE_INFO_TYPE, &si.frames,
+		     &si.rate, &si.format, &si.channels, &si.loop_start,
+		     &si.loop_end, &si.loop_type, &si.midi_note,
+		     &si.midi_fraction, &si.acid_type, &si.beats,
+		     &si.metre_num, &si.metre_den, &tempo);
+      si.tempo = tempo;
+
+      if (g_variant_n_children (tags))
+	{
+	  si.tags = sample_info_tags_new ();
+	  g_variant_iter_init (&tags_iter, tags);
+	  while (g_variant_iter_next (&tags_iter, "{ss}", &tag, &value))
+	    {
+	      g_hash_table_insert (si.tags, tag, value);
+	    }
+	}
+
+      entry = g_malloc (sizeof (struct sample_index_entry));
+      entry->dir = dir;
+      entry->size = size;
+      entry->mtime = mtime;
+      memcpy (&entry->sample_info, &si, sizeof (struct sample_info));
+      g_tree_replace (sample_index->entries, path, entry);
+
+      g_variant_unref (sample_info);
+      g_variant_unref (tags);
+    }
+  g_variant_unref (entries);
+
+  debug_print (1, "Sample index loaded from '%s' (%d entries)", filename,
+	       g_tree_nnodes (sample_index->entries));
+
+  g_mutex_unlock (&sample_index->mutex);
+
+end:
+  g_variant_unref (v);
+  g_free (filename);
+}
+
+static gboolean
+sample_index_add_entry_to_builder (gpointer key, gpointer value,
+				   gpointer data)
+{
+  GHashTableIter iter;
+  gpointer k, v;
+  GVariantBuilder tags;
+  GVariantBuilder *builder = data;
+  struct sample_index_entry *entry = value;
+  struct sample_info *si = &entry->sample_info;
+
+  g_variant_builder_init (&tags, G_VARIANT_TYPE ("a{ss}"));
+  if (si->tags)
+    {
+      g_hash_table_iter_init (&iter, si->tags);
+      while (g_hash_table_iter_next (&iter, &k, &v))
+	{
+	  g_variant_builder_add (&tags, "{ss}", k, v);
+	}
+    }
+
+  g_variant_builder_add (builder, SAMPLE_INDEX_ENTRY_TYPE, key, entry->dir,
+			 entry->size, entry->mtime, si->frames, si->rate,
+			 si->format, si->channels, si->loop_start,
+			 si->loop_end, si->loop_type, si->midi_note,
+			 si->midi_fraction, si->acid_type, si->beats,
+			 si->metre_num, si->metre_den, (gdouble) si->tempo,
+			 &tags);
+
+  return FALSE;
+}
+
+static void
+sample_index_save ()
+{
+  GVariant *v;
+  GHashTableIter iter;
+  gpointer k, value;
+  GVariantBuilder roots, entries;
+  GError *error = NULL;
+  gchar *dir = get_user_dir (CACHE_DIR);
+  gchar *filename = get_user_dir (SAMPLE_INDEX_FILE);
+
+  if (g_mkdir_with_parents (dir, S_IFDIR | S_IRWXU | S_IRGRP | S_IXGRP |
+			    S_IROTH | S_IXOTH))
+    {
+      error_print ("Error wile creating directory `%s'", dir);
+      goto end;
+    }
+
+  g_variant_builder_init (&roots, G_VARIANT_TYPE ("as"));
+  g_hash_table_iter_init (&iter, sample_index->roots);
+  while (g_hash_table_iter_next (&iter, &k, &value))
+    {
+      //Incomplete roots are scanned again on the next run only if they are saved.
+      g_variant_builder_add (&roots, "s", k);
+    }
+
+  g_variant_builder_init (&entries,
+			  G_VARIANT_TYPE ("a" SAMPLE_INDEX_ENTRY_TYPE));
+  g_tree_foreach (sample_index->entries, sample_index_add_entry_to_builder,
+		  &entries);
+
+  v = g_variant_new ("(u@as@a" SAMPLE_INDEX_ENTRY_TYPE ")",
+		     SAMPLE_INDEX_VERSION, g_variant_builder_end (&roots),
+		     g_variant_builder_end (&entries));
+  g_variant_ref_sink (v);
+
+  debug_print (1, "Saving sample index to '%s' (%d entries)...", filename,
+	       g_tree_nnodes (sample_index->entries));
+
+  if (!g_file_set_contents (filename, g_variant_get_data (v),
+			    g_variant_get_size (v), &error))
+    {
+      error_print ("Error while saving sample index to '%s': %s", filename,
+		   error->message);
+      g_error_free (error);
+    }
+
+  g_variant_unref (v);
+
+end:
+  g_free (dir);
+  g_free (filename);
+}
+
+static gpointer
+sample_index_run (gpointer data)
+{
+  struct sample_index_job *job;
+  GHashTableIter iter;
+  gpointer k, v;
+
+  sample_index_load ();
+
+  //Every root is checked again as changes might have happened while the application was not running.
+  g_mutex_lock (&sample_index->mutex);
+  g_hash_table_iter_init (&iter, sample_index->roots);
+  while (g_hash_table_iter_next (&iter, &k, &v))
+    {
+      job = g_malloc (sizeof (struct sample_index_job));
+      job->path = g_strdup (k);
+      job->root = TRUE;
+      g_async_queue_push (sample_index->queue, job);
+    }
+  g_mutex_unlock (&sample_index->mutex);
+
+  while (1)
+    {
+      job = g_async_queue_pop (sample_index->queue);
+
+      if (!job->path)
+	{
+	  g_free (job);
+	  break;
+	}
+
+      if (sample_index_is_running ())
+	{
+	  if (job->root)
+	    {
+	      sample_index_scan_root (job->path);
+	    }
+	  else
+	    {
+	      sample_index_scan_path (job->path);
+	    }
+	}
+
+      g_free (job->path);
+      g_free (job);
+    }
+
+  return NULL;
+}
+
+void
+sample_index_init ()
+{
+  sample_index = g_malloc (sizeof (struct sample_index));
+  sample_index->entries = g_tree_new_full ((GCompareDataFunc) strcmp, NULL,
+					   g_free, sample_index_free_entry);
+  sample_index->roots = g_hash_table_new_full (g_str_hash, g_str_equal,
+					       g_free, NULL);
+  sample_index->monitors = g_hash_table_new_full (g_str_hash, g_str_equal,
+						  g_free, g_object_unref);
+  g_mutex_init (&sample_index->mutex);
+  sample_index->queue = g_async_queue_new ();
+  sample_index->running = TRUE;
+  sample_index->dirty = FALSE;
+  sample_index->thread = g_thread_new ("sample_index_thread",
+				       sample_index_run, NULL);
+}
+
+void
+sample_index_destroy ()
+{
+  struct sample_index_job *job;
+
+  if (!sample_index)
+    {
+      return;
+    }
+
+  g_mutex_lock (&sample_index->mutex);
+  sample_index->running = FALSE;
+  g_mutex_unlock (&sample_index->mutex);
+
+  job = g_malloc (sizeof (struct sample_index_job));
+  job->path = NULL;
+  g_async_queue_push_front (sample_index->queue, job);
+  g_thread_join (sample_index->thread);
+
+  if (sample_index->dirty)
+    {
+      sample_index_save ();
+    }
+
+  while ((job = g_async_queue_try_pop (sample_index->queue)))
+    {
+      g_free (job->path);
+      g_free (job);
+    }
+  g_async_queue_unref (sample_index->queue);
+
+  g_hash_table_destroy (sample_index->monitors);
+  g_hash_table_destroy (sample_index->roots);
+  g_tree_destroy (sample_index->entries);
+  g_mutex_clear (&sample_index->mutex);
+  g_free (sample_index);
+  sample_index = NULL;
+}
+
+void
+sample_index_add_dir (const gchar *dir)
+{
+  GSList *children = NULL;
+  GHashTableIter iter;
+  gpointer k, v;
+  struct sample_index_job *job;
+
+  if (!sample_index)
+    {
+      return;
+    }
+
+  g_mutex_lock (&sample_index->mutex);
+
+  if (sample_index_is_indexed (dir, FALSE))
+    {
+      g_mutex_unlock (&sample_index->mutex);
+      return;
+    }
+
+  //Roots under the new one are not needed anymore.
+  g_hash_table_iter_init (&iter, sample_index->roots);
+  while (g_hash_table_iter_next (&iter, &k, &v))
+    {
+      if (sample_index_is_under (k, dir))
+	{
+	  children = g_slist_prepend (children, k);
+	}
+    }
+  for (GSList * l = children; l; l = l->next)
+    {
+      g_hash_table_remove (sample_index->roots, l->data);
+    }
+  g_slist_free (children);
+
+  g_hash_table_insert (sample_index->roots, g_strdup (dir),
+		       GINT_TO_POINTER (FALSE));
+  sample_index->dirty = TRUE;
+
+  g_mutex_unlock (&sample_index->mutex);
+
+  job = g_malloc (sizeof (struct sample_index_job));
+  job->path = g_strdup (dir);
+  job->root = TRUE;
+  g_async_queue_push (sample_index->queue, job);
+}
+
+static gboolean
+sample_index_matches (const gchar *path, struct sample_index_entry *entry,
+		      const gchar **exts)
+{
+  return entry->dir || !exts || filename_matches_exts (path, exts);
+}
+
+gint
+sample_index_search (const gchar *dir, const gchar **exts,
+		     gboolean sample_info, sample_index_search_cb cb,
+		     gpointer data)
+{
+  guint i, len;
+  gchar *prefix, *last;
+  GTreeNode *node;
+  struct item item;
+  gboolean active = TRUE;
+  struct sample_index_result *results;
+
+  if (!sample_index)
+    {
+      return -ENOENT;
+    }
+
+  g_mutex_lock (&sample_index->mutex);
+  if (!sample_index_is_indexed (dir, TRUE))
+    {
+      g_mutex_unlock (&sample_index->mutex);
+      return -ENOENT;
+    }
+  g_mutex_unlock (&sample_index->mutex);
+
+  item_init (&item);
+  prefix = sample_index_get_prefix (dir);
+  last = NULL;
+  results = g_malloc (sizeof (struct sample_index_result) *
+		      SAMPLE_INDEX_BATCH_LEN);
+
+  //The lock is released after every batch so that the index can be updated while the search is running.
+  while (active)
+    {
+      len = 0;
+
+      g_mutex_lock (&sample_index->mutex);
+      node = last ? g_tree_upper_bound (sample_index->entries, last) :
+	g_tree_lower_bound (sample_index->entries, prefix);
+      while (node && len < SAMPLE_INDEX_BATCH_LEN &&
+	     g_str_has_prefix (g_tree_node_key (node), prefix))
+	{
+	  const gchar *path = g_tree_node_key (node);
+	  struct sample_index_entry *entry = g_tree_node_value (node);
+
+	  if (sample_index_matches (path, entry, exts))
+	    {
+	      results[len].path = g_strdup (path);
+	      memcpy (&results[len].entry, entry,
+		      sizeof (struct sample_index_entry));
+	      if (sample_info && !entry->dir)
+		{
+		  sample_index_copy_sample_info (&results[len].entry.
+						 sample_info,
+						 &entry->sample_info);
+		}
+	      else
+		{
+		  results[len].entry.sample_info.tags = NULL;
+		}
+	      len++;
+	    }
+
+	  g_free (last);
+	  last = g_strdup (path);
+	  node = g_tree_node_next (node);
+	}
+      g_mutex_unlock (&sample_index->mutex);
+
+      if (!len)
+	{
+	  break;
+	}
+
+      for (i = 0; i < len; i++)
+	{
+	  struct sample_index_entry *entry = &results[i].entry;
+
+	  if (active)
+	    {
+	      item_set_name (&item, "%s", strrchr (results[i].path,
+						   G_DIR_SEPARATOR) + 1);
+	      item.type = entry->dir ? ITEM_TYPE_DIR : ITEM_TYPE_FILE;
+	      item.size = entry->size;
+	      item.id = -1;
+	      memcpy (&item.sample_info, &entry->sample_info,
+		      sizeof (struct sample_info));
+	      active = cb (&item, g_strdup (&results[i].path[strlen (prefix)]),
+			   data);
+	    }
+	  else
+	    {
+	      sample_info_clear (&entry->sample_info);
+	    }
+
+	  g_free (results[i].path);
+	}
+    }
+
+  item_clear (&item);
+  g_free (results);
+  g_free (last);
+  g_free (prefix);
+
+  return 0;
+}
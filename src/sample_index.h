@@ -0,0 +1,61 @@
+/*
+ *   sample_index.h
+ *   Copyright (C) 2024 David García Goñi <dagargo@gmail.com>
+ *
+ *   This file is part of Elektroid.
+ *
+ *   Elektroid is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Elektroid is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Elektroid. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SAMPLE_INDEX_H
+#define SAMPLE_INDEX_H
+
+#include <glib/gstdio.h>
+#include "connector.h"
+
+//Persistent index of the local files and their sample info.
+//Indexed directory trees are scanned in the background, checking the size and the modification time of every file, and kept up to date with file monitors.
+//If the index has not been initialized, every function behaves as if the index were empty.
+
+//The callback owns rel_path and the sample_info tags. Returning FALSE stops the search.
+typedef gboolean (*sample_index_search_cb) (struct item * item,
+					    gchar * rel_path, gpointer data);
+
+void sample_index_init ();
+
+void sample_index_destroy ();
+
+//Returns the modification time in nanoseconds as used by the index.
+gint64 sample_index_get_mtime (GStatBuf * sb);
+
+//Returns TRUE and fills sample_info if the file is indexed with the same size and modification time.
+gboolean sample_index_get_sample_info (const gchar * path, gint64 size,
+				       gint64 mtime,
+				       struct sample_info *sample_info);
+
+//Stores the sample info of a file. Files outside the indexed directories are ignored.
+void sample_index_set_sample_info (const gchar * path, gint64 size,
+				   gint64 mtime,
+				   const struct sample_info *sample_info);
+
+//Queues a directory tree for indexing. Its files can be searched once the scan has finished.
+void sample_index_add_dir (const gchar * dir);
+
+//Calls cb for every indexed item under dir in batches. Only the files matching exts are passed.
+//Returns -ENOENT if dir has not been indexed yet.
+gint sample_index_search (const gchar * dir, const gchar ** exts,
+			  gboolean sample_info, sample_index_search_cb cb,
+			  gpointer data);
+
+#endif
@@ -0,0 +1,297 @@
+/*
+ *   session.c
+ *   Copyright (C) 2024 David García Goñi <dagargo@gmail.com>
+ *
+ *   This file is part of Elektroid.
+ *
+ *   Elektroid is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Elektroid is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Elektroid. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include "session.h"
+#include "slot_cache.h"
+
+#define SESSION_PROGRESS_US 200000
+
+static void
+session_device_free (gpointer data)
+{
+  struct session_device *device = data;
+
+  if (backend_check (&device->backend))
+    {
+      backend_destroy (&device->backend);
+    }
+  idata_clear (&device->idata);
+  controllable_clear (&device->control.controllable);
+  g_free (device->dst_path);
+  g_free (device);
+}
+
+static gint
+session_open_device (struct session *session, GArray *backend_devices,
+		     gint id, const gchar *conn_name, const gchar *fs_name)
+{
+  gint err;
+  struct session_device *device, *first;
+  struct backend_device backend_device;
+
+  if (id < 0 || id >= backend_devices->len)
+    {
+      error_print ("Invalid device '%d'", id);
+      return -ENODEV;
+    }
+
+  for (guint i = 0; i < session->devices->len; i++)
+    {
+      device = g_ptr_array_index (session->devices, i);
+      if (device->id == id)
+	{
+	  error_print ("Device '%d' used more than once", id);
+	  return -EINVAL;
+	}
+    }
+
+  device = g_new0 (struct session_device, 1);
+  device->id = id;
+  controllable_init (&device->control.controllable);
+  g_ptr_array_add (session->devices, device);
+
+  backend_device = g_array_index (backend_devices, struct backend_device, id);
+  err = backend_init_connector (&device->backend, &backend_device,
+				conn_name, NULL);
+  if (err)
+    {
+      error_print ("Device %d: %s", id, g_strerror (-err));
+      return err;
+    }
+
+  device->fs_ops = backend_get_fs_operations_by_name (&device->backend,
+						      fs_name);
+  if (!device->fs_ops)
+    {
+      error_print ("Device %d: invalid filesystem '%s'", id, fs_name);
+      return -EINVAL;
+    }
+
+  //Audio link filesystems use the only audio device available.
+  if (device->fs_ops->options & FS_OPTION_AUDIO_LINK)
+    {
+      error_print ("Device %d: filesystem '%s' can not be used in groups",
+		   id, fs_name);
+      return -EINVAL;
+    }
+
+  first = g_ptr_array_index (session->devices, 0);
+  if (device->fs_ops != first->fs_ops)
+    {
+      error_print ("Device %d: connector '%s' differs from '%s' in device %d",
+		   id, device->backend.conn_name, first->backend.conn_name,
+		   first->id);
+      return -EINVAL;
+    }
+
+  return 0;
+}
+
+gint
+session_open (struct session *session, const gchar *devices,
+	      const gchar *conn_name, const gchar *fs_name)
+{
+  gint v, err = 0;
+  gchar *rem;
+  gchar **ids, **id;
+  GArray *backend_devices = backend_get_devices ();
+  const gchar separator[] = { SESSION_DEVICE_SEPARATOR, 0 };
+
+  session->devices = g_ptr_array_new_with_free_func (session_device_free);
+
+  ids = g_strsplit (devices, separator, -1);
+  for (id = ids; *id && !err; id++)
+    {
+      errno = 0;
+      v = (gint) g_ascii_strtoll (*id, &rem, 10);
+      if (errno || *id == rem || *rem)
+	{
+	  error_print ("Device not provided properly in '%s'", *id);
+	  err = -ENODEV;
+	}
+      else
+	{
+	  err = session_open_device (session, backend_devices, v, conn_name,
+				     fs_name);
+	}
+    }
+
+  g_strfreev (ids);
+  g_array_free (backend_devices, TRUE);
+
+  if (err)
+    {
+      session_close (session);
+    }
+
+  return err;
+}
+
+void
+session_close (struct session *session)
+{
+  g_ptr_array_free (session->devices, TRUE);
+  session->devices = NULL;
+}
+
+static gpointer
+session_device_upload (gpointer data)
+{
+  struct session_device *device = data;
+
+  debug_print (1, "Uploading to %s in device %d...", device->dst_path,
+	       device->id);
+
+  device->err = device->fs_ops->upload (&device->backend, device->dst_path,
+					&device->idata, &device->control);
+  slot_cache_invalidate (&device->backend, device->fs_ops, device->dst_path);
+
+  g_atomic_int_set (&device->running, FALSE);
+
+  return NULL;
+}
+
+//Returns TRUE while there are devices uploading.
+
+static gboolean
+session_update_progress (struct session *session,
+			 struct task_control *control)
+{
+  gdouble progress = 0;
+  gboolean running = FALSE;
+  gboolean active = controllable_is_active (&control->controllable);
+
+  for (guint i = 0; i < session->devices->len; i++)
+    {
+      struct session_device *device = g_ptr_array_index (session->devices,
+							 i);
+
+      if (!active)
+	{
+	  controllable_set_active (&device->control.controllable, FALSE);
+	}
+
+      g_mutex_lock (&device->control.controllable.mutex);
+      progress += device->control.progress;
+      g_mutex_unlock (&device->control.controllable.mutex);
+
+      running |= g_atomic_int_get (&device->running);
+    }
+
+  task_control_set_progress (control, progress / session->devices->len);
+
+  return running;
+}
+
+gint
+session_upload (struct session *session, const gchar *src_path,
+		const gchar *dst_dir, struct task_control *control)
+{
+  gint err;
+  struct idata idata;
+  struct session_device *first = g_ptr_array_index (session->devices, 0);
+  const struct fs_operations *fs_ops = first->fs_ops;
+
+  if (!fs_ops->load || !fs_ops->get_upload_path || !fs_ops->upload)
+    {
+      return -ENOSYS;
+    }
+
+  //All the devices are identical so the payload is loaded only once.
+  err = fs_ops->load (&first->backend, src_path, &idata, &first->control);
+  if (err)
+    {
+      return err;
+    }
+
+  task_control_reset (control, 1);
+
+  for (guint i = 0; i < session->devices->len; i++)
+    {
+      struct session_device *device = g_ptr_array_index (session->devices,
+							 i);
+      GByteArray *content = g_byte_array_sized_new (idata.content->len);
+
+      //The uploads might modify the content but the info is only read so it is shared and owned by idata.
+      g_byte_array_append (content, idata.content->data, idata.content->len);
+      device->idata.content = content;
+      device->idata.name = g_strdup (idata.name);
+      device->idata.info = idata.info;
+      device->idata.free_info = NULL;
+
+      device->dst_path = fs_ops->get_upload_path (&device->backend, fs_ops,
+						  dst_dir, src_path,
+						  &device->idata);
+      device->err = 0;
+      task_control_reset (&device->control, 1);
+      controllable_set_active (&device->control.controllable, TRUE);
+    }
+
+  for (guint i = 0; i < session->devices->len; i++)
+    {
+      struct session_device *device = g_ptr_array_index (session->devices,
+							 i);
+      device->running = TRUE;
+      device->thread = g_thread_new ("upload", session_device_upload, device);
+    }
+
+  while (session_update_progress (session, control))
+    {
+      g_usleep (SESSION_PROGRESS_US);
+    }
+
+  err = 0;
+  for (guint i = 0; i < session->devices->len; i++)
+    {
+      struct session_device *device = g_ptr_array_index (session->devices,
+							 i);
+      g_thread_join (device->thread);
+      device->thread = NULL;
+      idata_clear (&device->idata);
+
+      if (device->err)
+	{
+	  error_print ("Device %d: error while uploading to '%s': %s",
+		       device->id, device->dst_path,
+		       g_strerror (-device->err));
+	  err = err ? err : device->err;
+	}
+      else
+	{
+	  debug_print (1, "Device %d: uploaded to '%s'", device->id,
+		       device->dst_path);
+	}
+
+      g_free (device->dst_path);
+      device->dst_path = NULL;
+    }
+
+  idata_clear (&idata);
+
+  //The progress is only completed if every device succeeded.
+  if (!err)
+    {
+      control->part++;
+      task_control_set_progress (control, 1.0);
+    }
+
+  return err;
+}
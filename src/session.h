@@ -0,0 +1,62 @@
+/*
+ *   session.h
+ *   Copyright (C) 2024 David García Goñi <dagargo@gmail.com>
+ *
+ *   This file is part of Elektroid.
+ *
+ *   Elektroid is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Elektroid is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Elektroid. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SESSION_H
+#define SESSION_H
+
+#include "connector.h"
+
+#define SESSION_DEVICE_SEPARATOR ','
+
+//A session is a group of devices, each one with its own backend, that are used at the same time.
+//All the devices must use the same connector and filesystem so that a payload loaded once can be uploaded to all of them.
+
+struct session_device
+{
+  gint id;
+  struct backend backend;
+  const struct fs_operations *fs_ops;
+  struct task_control control;
+  struct idata idata;
+  gchar *dst_path;
+  GThread *thread;
+  gint running;
+  gint err;
+};
+
+struct session
+{
+  GPtrArray *devices;
+};
+
+//Devices are given by their index in the list returned by backend_get_devices separated by SESSION_DEVICE_SEPARATOR as in "1,2,3".
+//If conn_name is NULL, the connector is guessed for every device.
+gint session_open (struct session *session, const gchar * devices,
+		   const gchar * conn_name, const gchar * fs_name);
+
+void session_close (struct session *session);
+
+//Loads src_path once and uploads it to every device in parallel.
+//The progress of control is the average progress of the devices and canceling it cancels all of them.
+//Errors are reported per device and the first one is returned.
+gint session_upload (struct session *session, const gchar * src_path,
+		     const gchar * dst_dir, struct task_control *control);
+
+#endif
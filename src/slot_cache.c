@@ -0,0 +1,489 @@
+/*
+ *   slot_cache.c
+ *   Copyright (C) 2024 David García Goñi <dagargo@gmail.com>
+ *
+ *   This file is part of Elektroid.
+ *
+ *   Elektroid is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Elektroid is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Elektroid. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib/gstdio.h>
+#include "slot_cache.h"
+
+#define SLOT_CACHE_DIR CACHE_DIR "/slots"
+#define SLOT_CACHE_EXT ".json"
+
+struct slot_cache_cached_iter_data
+{
+  JsonParser *parser;
+  JsonArray *items;
+  guint next;
+};
+
+struct slot_cache_device_iter_data
+{
+  struct item_iterator iter;
+  JsonBuilder *builder;
+  gchar *device_dir;
+  gchar *filename;
+  guint generation;
+};
+
+//Incremented on every invalidation so that the listings made while the device was being modified are not stored.
+static guint slot_cache_generation;
+
+static gboolean
+slot_cache_is_enabled (struct backend *backend,
+		       const struct fs_operations *ops)
+{
+  return backend && backend->type == BE_TYPE_MIDI &&
+    (ops->options & FS_OPTION_SLOT_CACHE) &&
+    backend_uses_disk_caches (backend);
+}
+
+//Every device has its own directory so that the filesystems sharing the same slots can be invalidated together.
+//The port name is part of the key as identical devices, or SDS samplers without identity, have the same MIDI info and name.
+
+gchar *
+slot_cache_get_device_dir (struct backend *backend)
+{
+  gchar *rel_dir, *dir;
+  GChecksum *checksum = g_checksum_new (G_CHECKSUM_SHA1);
+
+  g_checksum_update (checksum, (guchar *) & backend->midi_info,
+		     sizeof (struct backend_midi_info));
+  g_checksum_update (checksum, (guchar *) backend->conn_name, -1);
+  g_checksum_update (checksum, (guchar *) backend->name, -1);
+  g_checksum_update (checksum, (guchar *) backend->device_name, -1);
+
+  rel_dir = g_strconcat (SLOT_CACHE_DIR "/", g_checksum_get_string (checksum),
+			 NULL);
+  dir = get_user_dir (rel_dir);
+
+  g_free (rel_dir);
+  g_checksum_free (checksum);
+
+  return dir;
+}
+
+static gchar *
+slot_cache_get_dir_prefix (const gchar *dir)
+{
+  gchar *sum = g_compute_checksum_for_string (G_CHECKSUM_SHA1, dir, -1);
+  gchar *prefix = g_strconcat (sum, "-", NULL);
+  g_free (sum);
+  return prefix;
+}
+
+static gchar *
+slot_cache_get_filename (const gchar *device_dir,
+			 const struct fs_operations *ops, const gchar *dir)
+{
+  gchar *prefix = slot_cache_get_dir_prefix (dir);
+  gchar *name = g_strconcat (prefix, ops->name, SLOT_CACHE_EXT, NULL);
+  gchar *filename = path_chain (PATH_SYSTEM, device_dir, name);
+  g_free (prefix);
+  g_free (name);
+  return filename;
+}
+
+static gint
+slot_cache_next_cached_dentry (struct item_iterator *iter)
+{
+  JsonObject *object;
+  struct slot_cache_cached_iter_data *data = iter->data;
+
+  if (data->next >= json_array_get_length (data->items))
+    {
+      return -ENOENT;
+    }
+
+  object = json_array_get_object_element (data->items, data->next);
+
+  iter->item.type = json_object_get_int_member (object, "type");
+  item_set_name (&iter->item, "%s",
+		 json_object_get_string_member (object, "name"));
+  iter->item.id = json_object_get_int_member (object, "id");
+  iter->item.size = json_object_get_int_member (object, "size");
+  item_set_object_info (&iter->item, "%s",
+			json_object_get_string_member (object,
+						       "object_info"));
+
+  sample_info_init (&iter->item.sample_info);
+  iter->item.sample_info.frames =
+    json_object_get_int_member (object, "frames");
+  iter->item.sample_info.rate = json_object_get_int_member (object, "rate");
+  iter->item.sample_info.format =
+    json_object_get_int_member (object, "format");
+  iter->item.sample_info.channels =
+    json_object_get_int_member (object, "channels");
+  iter->item.sample_info.loop_start =
+    json_object_get_int_member (object, "loop_start");
+  iter->item.sample_info.loop_end =
+    json_object_get_int_member (object, "loop_end");
+  iter->item.sample_info.loop_type =
+    json_object_get_int_member (object, "loop_type");
+  iter->item.sample_info.midi_note =
+    json_object_get_int_member (object, "midi_note");
+
+  data->next++;
+
+  return 0;
+}
+
+static void
+slot_cache_free_cached_iter_data (void *iter_data)
+{
+  struct slot_cache_cached_iter_data *data = iter_data;
+  g_object_unref (data->parser);
+  g_free (data);
+}
+
+static void
+slot_cache_add_item (JsonBuilder *builder, struct item *item)
+{
+  json_builder_begin_object (builder);
+  json_builder_set_member_name (builder, "type");
+  json_builder_add_int_value (builder, item->type);
+  json_builder_set_member_name (builder, "name");
+  json_builder_add_string_value (builder, item->name);
+  json_builder_set_member_name (builder, "id");
+  json_builder_add_int_value (builder, item->id);
+  json_builder_set_member_name (builder, "size");
+  json_builder_add_int_value (builder, item->size);
+  json_builder_set_member_name (builder, "object_info");
+  json_builder_add_string_value (builder, item->object_info);
+  json_builder_set_member_name (builder, "frames");
+  json_builder_add_int_value (builder, item->sample_info.frames);
+  json_builder_set_member_name (builder, "rate");
+  json_builder_add_int_value (builder, item->sample_info.rate);
+  json_builder_set_member_name (builder, "format");
+  json_builder_add_int_value (builder, item->sample_info.format);
+  json_builder_set_member_name (builder, "channels");
+  json_builder_add_int_value (builder, item->sample_info.channels);
+  json_builder_set_member_name (builder, "loop_start");
+  json_builder_add_int_value (builder, item->sample_info.loop_start);
+  json_builder_set_member_name (builder, "loop_end");
+  json_builder_add_int_value (builder, item->sample_info.loop_end);
+  json_builder_set_member_name (builder, "loop_type");
+  json_builder_add_int_value (builder, item->sample_info.loop_type);
+  json_builder_set_member_name (builder, "midi_note");
+  json_builder_add_int_value (builder, item->sample_info.midi_note);
+  json_builder_end_object (builder);
+}
+
+static void
+slot_cache_save (const gchar *device_dir, const gchar *filename,
+		 JsonBuilder *builder)
+{
+  gchar *json;
+  JsonNode *root;
+  JsonGenerator *gen;
+  GError *error = NULL;
+
+  if (g_mkdir_with_parents (device_dir,
+			    S_IFDIR | S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH |
+			    S_IXOTH))
+    {
+      error_print ("Error wile creating directory `%s'", device_dir);
+      return;
+    }
+
+  json_builder_end_array (builder);
+
+  gen = json_generator_new ();
+  root = json_builder_get_root (builder);
+  json_generator_set_root (gen, root);
+  json = json_generator_to_data (gen, NULL);
+
+  debug_print (1, "Saving slot cache to '%s'...", filename);
+
+  //This is atomic so a concurrent reader never gets an incomplete listing.
+  if (!g_file_set_contents (filename, json, -1, &error))
+    {
+      error_print ("Error while saving slot cache to '%s': %s",
+		   filename, error->message);
+      g_error_free (error);
+    }
+
+  g_free (json);
+  json_node_free (root);
+  g_object_unref (gen);
+}
+
+static gint
+slot_cache_next_device_dentry (struct item_iterator *iter)
+{
+  struct slot_cache_device_iter_data *data = iter->data;
+  gint err = item_iterator_next (&data->iter);
+
+  if (err)
+    {
+      //Only complete listings are stored.
+      if (err == -ENOENT && data->builder)
+	{
+	  if (data->generation == slot_cache_get_generation ())
+	    {
+	      slot_cache_save (data->device_dir, data->filename,
+			       data->builder);
+	    }
+	  else
+	    {
+	      debug_print (1, "Slot cache invalidated. Not saving '%s'...",
+			   data->filename);
+	    }
+	}
+      g_clear_object (&data->builder);
+      return err;
+    }
+
+  memcpy (&iter->item, &data->iter.item, sizeof (struct item));
+  if (data->builder)
+    {
+      slot_cache_add_item (data->builder, &iter->item);
+    }
+
+  return 0;
+}
+
+static void
+slot_cache_free_device_iter_data (void *iter_data)
+{
+  struct slot_cache_device_iter_data *data = iter_data;
+  item_iterator_free (&data->iter);
+  g_clear_object (&data->builder);
+  g_free (data->device_dir);
+  g_free (data->filename);
+  g_free (data);
+}
+
+static gint
+slot_cache_readdir_cached (struct item_iterator *iter, const gchar *dir,
+			   const gchar *filename)
+{
+  JsonNode *root;
+  GError *error = NULL;
+  struct slot_cache_cached_iter_data *data;
+  JsonParser *parser = json_parser_new ();
+
+  if (!json_parser_load_from_file (parser, filename, &error))
+    {
+      debug_print (1, "Slot cache miss for '%s': %s", filename,
+		   error->message);
+      g_error_free (error);
+      g_object_unref (parser);
+      return -ENOENT;
+    }
+
+  root = json_parser_get_root (parser);
+  if (!JSON_NODE_HOLDS_ARRAY (root))
+    {
+      error_print ("Invalid slot cache file '%s'", filename);
+      g_object_unref (parser);
+      return -EINVAL;
+    }
+
+  debug_print (1, "Slot cache hit for '%s'", filename);
+
+  data = g_malloc (sizeof (struct slot_cache_cached_iter_data));
+  data->parser = parser;
+  data->items = json_node_get_array (root);
+  data->next = 0;
+
+  item_iterator_init (iter, dir, data, slot_cache_next_cached_dentry,
+		      slot_cache_free_cached_iter_data);
+
+  return 0;
+}
+
+gint
+slot_cache_readdir (struct backend *backend, const struct fs_operations *ops,
+		    struct item_iterator *iter, const gchar *dir,
+		    const gchar **exts)
+{
+  gint err;
+  gchar *device_dir, *filename;
+  struct slot_cache_device_iter_data *data;
+
+  if (!slot_cache_is_enabled (backend, ops))
+    {
+      return ops->readdir (backend, iter, dir, exts);
+    }
+
+  device_dir = slot_cache_get_device_dir (backend);
+  filename = slot_cache_get_filename (device_dir, ops, dir);
+
+  if (!slot_cache_readdir_cached (iter, dir, filename))
+    {
+      g_free (device_dir);
+      g_free (filename);
+      return 0;
+    }
+
+  data = g_malloc (sizeof (struct slot_cache_device_iter_data));
+  data->generation = slot_cache_get_generation ();
+  err = ops->readdir (backend, &data->iter, dir, exts);
+  if (err)
+    {
+      g_free (data);
+      g_free (device_dir);
+      g_free (filename);
+      return err;
+    }
+
+  data->builder = json_builder_new ();
+  json_builder_begin_array (data->builder);
+  data->device_dir = device_dir;
+  data->filename = filename;
+
+  item_iterator_init (iter, dir, data, slot_cache_next_device_dentry,
+		      slot_cache_free_device_iter_data);
+
+  return 0;
+}
+
+gint
+slot_cache_readdir_ids (struct backend *backend,
+			const struct fs_operations *ops,
+			struct item_iterator *iter, const gchar *dir,
+			const gchar **exts, gboolean *placeholders)
+{
+  gint err;
+  gchar *device_dir, *filename;
+
+  *placeholders = FALSE;
+
+  if (!ops->readdir_ids)
+    {
+      return slot_cache_readdir (backend, ops, iter, dir, exts);
+    }
+
+  if (slot_cache_is_enabled (backend, ops))
+    {
+      device_dir = slot_cache_get_device_dir (backend);
+      filename = slot_cache_get_filename (device_dir, ops, dir);
+      err = slot_cache_readdir_cached (iter, dir, filename);
+      g_free (device_dir);
+      g_free (filename);
+      if (!err)
+	{
+	  return 0;
+	}
+    }
+
+  err = ops->readdir_ids (backend, iter, dir, exts);
+  if (!err)
+    {
+      *placeholders = TRUE;
+    }
+
+  return err;
+}
+
+void
+slot_cache_set_dir (struct backend *backend, const struct fs_operations *ops,
+		    const gchar *dir, GList *items, guint generation)
+{
+  gchar *device_dir, *filename;
+  JsonBuilder *builder;
+
+  if (!slot_cache_is_enabled (backend, ops))
+    {
+      return;
+    }
+
+  if (generation != slot_cache_get_generation ())
+    {
+      debug_print (1, "Slot cache invalidated. Not saving '%s'...", dir);
+      return;
+    }
+
+  device_dir = slot_cache_get_device_dir (backend);
+  filename = slot_cache_get_filename (device_dir, ops, dir);
+
+  builder = json_builder_new ();
+  json_builder_begin_array (builder);
+  for (GList * e = items; e; e = e->next)
+    {
+      slot_cache_add_item (builder, e->data);
+    }
+  slot_cache_save (device_dir, filename, builder);
+
+  g_object_unref (builder);
+  g_free (device_dir);
+  g_free (filename);
+}
+
+void
+slot_cache_invalidate_dir (struct backend *backend,
+			   const struct fs_operations *ops, const gchar *dir)
+{
+  GDir *gdir;
+  gchar *device_dir, *prefix, *filename;
+  const gchar *name;
+
+  if (!slot_cache_is_enabled (backend, ops))
+    {
+      return;
+    }
+
+  g_atomic_int_inc (&slot_cache_generation);
+
+  device_dir = slot_cache_get_device_dir (backend);
+  gdir = g_dir_open (device_dir, 0, NULL);
+  if (!gdir)
+    {
+      g_free (device_dir);
+      return;
+    }
+
+  //Filesystems sharing the same slots (e.g. preset and zpreset) are invalidated too.
+  prefix = slot_cache_get_dir_prefix (dir);
+  while ((name = g_dir_read_name (gdir)))
+    {
+      if (g_str_has_prefix (name, prefix))
+	{
+	  filename = path_chain (PATH_SYSTEM, device_dir, name);
+	  debug_print (1, "Invalidating slot cache '%s'...", filename);
+	  g_unlink (filename);
+	  g_free (filename);
+	}
+    }
+
+  g_dir_close (gdir);
+  g_free (prefix);
+  g_free (device_dir);
+}
+
+void
+slot_cache_invalidate (struct backend *backend,
+		       const struct fs_operations *ops, const gchar *path)
+{
+  gchar *dir;
+
+  if (!slot_cache_is_enabled (backend, ops))
+    {
+      return;
+    }
+
+  dir = g_path_get_dirname (path);
+  slot_cache_invalidate_dir (backend, ops, dir);
+  g_free (dir);
+}
+
+guint
+slot_cache_get_generation ()
+{
+  return g_atomic_int_get (&slot_cache_generation);
+}
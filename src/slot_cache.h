@@ -0,0 +1,65 @@
+/*
+ *   slot_cache.h
+ *   Copyright (C) 2024 David García Goñi <dagargo@gmail.com>
+ *
+ *   This file is part of Elektroid.
+ *
+ *   Elektroid is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Elektroid is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Elektroid. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SLOT_CACHE_H
+#define SLOT_CACHE_H
+
+#include "connector.h"
+
+//Directory listings of filesystems using FS_OPTION_SLOT_CACHE are stored on disk per device and filesystem.
+//For any other filesystem, or while capturing or replaying, these functions just call the filesystem functions or do nothing.
+
+//Same as calling readdir but the items are served from the cache if there is a complete listing.
+//Otherwise, the items are read from the device and stored once the iteration has finished unless there has been any invalidation in the meantime.
+gint slot_cache_readdir (struct backend *backend,
+			 const struct fs_operations *ops,
+			 struct item_iterator *iter, const gchar * dir,
+			 const gchar ** exts);
+
+//Same as slot_cache_readdir but, if there is no complete listing stored and the filesystem implements readdir_ids, only the slot ids are listed.
+//In that case, placeholders is set to TRUE and the items need to be completed with load_item.
+gint slot_cache_readdir_ids (struct backend *backend,
+			     const struct fs_operations *ops,
+			     struct item_iterator *iter, const gchar * dir,
+			     const gchar ** exts, gboolean * placeholders);
+
+//Stores a complete listing of a directory made of struct item elements. Intended for the placeholders completed with load_item.
+//Nothing is stored if there has been any invalidation since generation was taken with slot_cache_get_generation before listing the directory.
+void slot_cache_set_dir (struct backend *backend,
+			 const struct fs_operations *ops, const gchar * dir,
+			 GList * items, guint generation);
+
+//Invalidates the directory containing the path. It must be called after every operation that modifies the device.
+void slot_cache_invalidate (struct backend *backend,
+			    const struct fs_operations *ops,
+			    const gchar * path);
+
+//Invalidates a directory so that the next readdir reads it from the device.
+void slot_cache_invalidate_dir (struct backend *backend,
+				const struct fs_operations *ops,
+				const gchar * dir);
+
+//Returns a counter incremented on every invalidation.
+guint slot_cache_get_generation ();
+
+//Returns the directory where the data cached for the device is stored. It is unique for every MIDI device and port.
+gchar *slot_cache_get_device_dir (struct backend *backend);
+
+#endif
@@ -0,0 +1,593 @@
+/*
+ *   sysex_codec.c
+ *   Copyright (C) 2024 David García Goñi <dagargo@gmail.com>
+ *
+ *   This file is part of Elektroid.
+ *
+ *   Elektroid is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Elektroid is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Elektroid. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include "sysex_codec.h"
+#include "utils.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SYSEX_CODEC_X86
+#include <immintrin.h>
+#define SYSEX_CODEC_SSE2 __attribute__ ((target ("sse2")))
+#define SYSEX_CODEC_AVX2 __attribute__ ((target ("avx2")))
+#endif
+
+#if defined(__aarch64__)
+#define SYSEX_CODEC_NEON
+#include <arm_neon.h>
+#endif
+
+#define SYSEX_CODEC_GROUP_LEN 7
+#define SYSEX_CODEC_PACKET_LEN 8
+
+//Kernels process as many groups as they can and return the consumed input bytes. The scalar kernel completes the rest.
+typedef guint (*sysex_codec_kernel_fn) (const guint8 * src, guint len,
+					guint8 * dst,
+					enum sysex_codec_layout layout);
+
+typedef guint (*sysex_codec_swap_fn) (const guint8 * src, guint len,
+				      guint8 * dst);
+
+struct sysex_codec_kernel_ops
+{
+  const gchar *name;
+  sysex_codec_kernel_fn encode;
+  sysex_codec_kernel_fn decode;
+  sysex_codec_swap_fn swap16;
+};
+
+//Bit of the header for every byte in a packet, including the header itself, for 4 packets.
+static const guint8 SYSEX_CODEC_WEIGHTS[][32] = {
+  {
+   0, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01,
+   0, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01,
+   0, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01,
+   0, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01},
+  {
+   0, 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40,
+   0, 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40,
+   0, 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40,
+   0, 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40}
+};
+
+//Moves 2 groups into 2 packets leaving room for the headers.
+static const guint8 SYSEX_CODEC_SPREAD[] = {
+  0x80, 0, 1, 2, 3, 4, 5, 6, 0x80, 7, 8, 9, 10, 11, 12, 13,
+  0x80, 0, 1, 2, 3, 4, 5, 6, 0x80, 7, 8, 9, 10, 11, 12, 13
+};
+
+//Moves 2 packets into 2 groups removing the headers.
+static const guint8 SYSEX_CODEC_COMPACT[] = {
+  1, 2, 3, 4, 5, 6, 7, 9, 10, 11, 12, 13, 14, 15, 0x80, 0x80,
+  1, 2, 3, 4, 5, 6, 7, 9, 10, 11, 12, 13, 14, 15, 0x80, 0x80
+};
+
+static const struct sysex_codec_kernel_ops *sysex_codec_kernel;
+static guint8 sysex_codec_reversed[1 << SYSEX_CODEC_GROUP_LEN];
+
+guint
+sysex_codec_get_encoded_len (guint len)
+{
+  return len + (len + SYSEX_CODEC_GROUP_LEN - 1) / SYSEX_CODEC_GROUP_LEN;
+}
+
+guint
+sysex_codec_get_decoded_len (guint len)
+{
+  return len - (len + SYSEX_CODEC_PACKET_LEN - 1) / SYSEX_CODEC_PACKET_LEN;
+}
+
+static inline guint8
+sysex_codec_get_header_bit (guint pos, enum sysex_codec_layout layout)
+{
+  return SYSEX_CODEC_WEIGHTS[layout][pos + 1];
+}
+
+static guint
+sysex_codec_encode_scalar (const guint8 *src, guint len, guint8 *dst,
+			   enum sysex_codec_layout layout)
+{
+  guint k;
+  guint8 header;
+
+  for (guint i = 0; i < len; i += SYSEX_CODEC_GROUP_LEN)
+    {
+      header = 0;
+      for (k = 0; k < SYSEX_CODEC_GROUP_LEN && i + k < len; k++)
+	{
+	  header |= (src[i + k] >> 7) * sysex_codec_get_header_bit (k, layout);
+	  dst[k + 1] = src[i + k] & 0x7f;
+	}
+      dst[0] = header;
+      dst += k + 1;
+    }
+
+  return len;
+}
+
+static guint
+sysex_codec_decode_scalar (const guint8 *src, guint len, guint8 *dst,
+			   enum sysex_codec_layout layout)
+{
+  guint8 header;
+
+  for (guint i = 0; i < len; i += SYSEX_CODEC_PACKET_LEN)
+    {
+      header = src[i];
+      for (guint k = 0; k < SYSEX_CODEC_GROUP_LEN && i + k + 1 < len;
+	   k++, dst++)
+	{
+	  *dst = src[i + k + 1] |
+	    (!!(header & sysex_codec_get_header_bit (k, layout)) << 7);
+	}
+    }
+
+  return len;
+}
+
+static guint
+sysex_codec_swap16_scalar (const guint8 *src, guint len, guint8 *dst)
+{
+  for (guint i = 0; i + 1 < len; i += 2)
+    {
+      dst[i] = src[i + 1];
+      dst[i + 1] = src[i];
+    }
+
+  return len;
+}
+
+#if defined(SYSEX_CODEC_X86)
+
+static inline guint8
+sysex_codec_get_header_sse2 (guint msbs, enum sysex_codec_layout layout)
+{
+  msbs &= (1 << SYSEX_CODEC_GROUP_LEN) - 1;
+  return layout == SYSEX_CODEC_MSB_FIRST ? sysex_codec_reversed[msbs] : msbs;
+}
+
+//SSE2 has no byte shuffles so the headers are built from the MSB mask and the groups are copied.
+
+static guint SYSEX_CODEC_SSE2
+sysex_codec_encode_sse2 (const guint8 *src, guint len, guint8 *dst,
+			 enum sysex_codec_layout layout)
+{
+  guint i;
+  guint msbs;
+  __m128i v;
+  guint8 data[16];
+  const __m128i mask = _mm_set1_epi8 (0x7f);
+
+  for (i = 0; i + 16 <= len; i += 14, dst += 16)
+    {
+      v = _mm_loadu_si128 ((const __m128i *) &src[i]);
+      msbs = _mm_movemask_epi8 (v);
+      _mm_storeu_si128 ((__m128i *) data, _mm_and_si128 (v, mask));
+      dst[0] = sysex_codec_get_header_sse2 (msbs, layout);
+      memcpy (&dst[1], data, SYSEX_CODEC_GROUP_LEN);
+      dst[8] = sysex_codec_get_header_sse2 (msbs >> 7, layout);
+      memcpy (&dst[9], &data[7], SYSEX_CODEC_GROUP_LEN);
+    }
+
+  return i;
+}
+
+static guint SYSEX_CODEC_SSE2
+sysex_codec_decode_sse2 (const guint8 *src, guint len, guint8 *dst,
+			 enum sysex_codec_layout layout)
+{
+  guint i;
+  __m128i v, headers, msbs;
+  guint8 data[16];
+  const __m128i msb = _mm_set1_epi8 ((gchar) 0x80);
+  const __m128i weights =
+    _mm_loadu_si128 ((const __m128i *) SYSEX_CODEC_WEIGHTS[layout]);
+
+  for (i = 0; i + 16 <= len; i += 16, dst += 14)
+    {
+      v = _mm_loadu_si128 ((const __m128i *) &src[i]);
+      headers =
+	_mm_set_epi64x (src[i + 8] * G_GUINT64_CONSTANT (0x0101010101010101),
+			src[i] * G_GUINT64_CONSTANT (0x0101010101010101));
+      msbs = _mm_cmpeq_epi8 (_mm_and_si128 (headers, weights), weights);
+      msbs = _mm_and_si128 (msbs, msb);
+      _mm_storeu_si128 ((__m128i *) data, _mm_or_si128 (v, msbs));
+      memcpy (dst, &data[1], SYSEX_CODEC_GROUP_LEN);
+      memcpy (&dst[7], &data[9], SYSEX_CODEC_GROUP_LEN);
+    }
+
+  return i;
+}
+
+static guint SYSEX_CODEC_SSE2
+sysex_codec_swap16_sse2 (const guint8 *src, guint len, guint8 *dst)
+{
+  guint i;
+  __m128i v;
+
+  for (i = 0; i + 16 <= len; i += 16)
+    {
+      v = _mm_loadu_si128 ((const __m128i *) &src[i]);
+      v = _mm_or_si128 (_mm_slli_epi16 (v, 8), _mm_srli_epi16 (v, 8));
+      _mm_storeu_si128 ((__m128i *) & dst[i], v);
+    }
+
+  return i;
+}
+
+//The headers are the sums of the weights of the bytes with the MSB set, which are computed with SAD.
+
+static guint SYSEX_CODEC_AVX2
+sysex_codec_encode_avx2 (const guint8 *src, guint len, guint8 *dst,
+			 enum sysex_codec_layout layout)
+{
+  guint i;
+  __m256i v, msbs, headers;
+  const __m256i zero = _mm256_setzero_si256 ();
+  const __m256i mask = _mm256_set1_epi8 (0x7f);
+  const __m256i spread =
+    _mm256_loadu_si256 ((const __m256i *) SYSEX_CODEC_SPREAD);
+  const __m256i weights =
+    _mm256_loadu_si256 ((const __m256i *) SYSEX_CODEC_WEIGHTS[layout]);
+
+  for (i = 0; i + 32 <= len; i += 28, dst += 32)
+    {
+      v = _mm256_castsi128_si256 (_mm_loadu_si128 ((const __m128i *)
+						   &src[i]));
+      v = _mm256_inserti128_si256 (v, _mm_loadu_si128 ((const __m128i *)
+						       &src[i + 14]), 1);
+      v = _mm256_shuffle_epi8 (v, spread);
+      msbs = _mm256_cmpgt_epi8 (zero, v);
+      headers = _mm256_sad_epu8 (_mm256_and_si256 (msbs, weights), zero);
+      v = _mm256_or_si256 (_mm256_and_si256 (v, mask), headers);
+      _mm256_storeu_si256 ((__m256i *) dst, v);
+    }
+
+  return i;
+}
+
+static guint SYSEX_CODEC_AVX2
+sysex_codec_decode_avx2 (const guint8 *src, guint len, guint8 *dst,
+			 enum sysex_codec_layout layout)
+{
+  guint i;
+  __m256i v, msbs;
+  const __m256i msb = _mm256_set1_epi8 ((gchar) 0x80);
+  const __m256i replicate = _mm256_set_epi64x (0x0808080808080808, 0,
+					       0x0808080808080808, 0);
+  const __m256i compact =
+    _mm256_loadu_si256 ((const __m256i *) SYSEX_CODEC_COMPACT);
+  const __m256i weights =
+    _mm256_loadu_si256 ((const __m256i *) SYSEX_CODEC_WEIGHTS[layout]);
+
+  //Every lane is stored with 2 trailing bytes that are overwritten later so an additional packet is needed.
+  for (i = 0; i + 40 <= len; i += 32, dst += 28)
+    {
+      v = _mm256_loadu_si256 ((const __m256i *) &src[i]);
+      msbs = _mm256_shuffle_epi8 (v, replicate);
+      msbs = _mm256_cmpeq_epi8 (_mm256_and_si256 (msbs, weights), weights);
+      msbs = _mm256_and_si256 (msbs, msb);
+      v = _mm256_shuffle_epi8 (_mm256_or_si256 (v, msbs), compact);
+      _mm_storeu_si128 ((__m128i *) dst, _mm256_castsi256_si128 (v));
+      _mm_storeu_si128 ((__m128i *) & dst[14],
+			_mm256_extracti128_si256 (v, 1));
+    }
+
+  return i;
+}
+
+static guint SYSEX_CODEC_AVX2
+sysex_codec_swap16_avx2 (const guint8 *src, guint len, guint8 *dst)
+{
+  guint i;
+  __m256i v;
+
+  for (i = 0; i + 32 <= len; i += 32)
+    {
+      v = _mm256_loadu_si256 ((const __m256i *) &src[i]);
+      v = _mm256_or_si256 (_mm256_slli_epi16 (v, 8),
+			   _mm256_srli_epi16 (v, 8));
+      _mm256_storeu_si256 ((__m256i *) & dst[i], v);
+    }
+
+  return i;
+}
+
+#endif
+
+#if defined(SYSEX_CODEC_NEON)
+
+static guint
+sysex_codec_encode_neon (const guint8 *src, guint len, guint8 *dst,
+			 enum sysex_codec_layout layout)
+{
+  guint i;
+  uint8x16_t v, msbs;
+  const uint8x16_t msb = vdupq_n_u8 (0x80);
+  const uint8x16_t mask = vdupq_n_u8 (0x7f);
+  const uint8x16_t spread = vld1q_u8 (SYSEX_CODEC_SPREAD);
+  const uint8x16_t weights = vld1q_u8 (SYSEX_CODEC_WEIGHTS[layout]);
+
+  for (i = 0; i + 16 <= len; i += 14, dst += 16)
+    {
+      v = vqtbl1q_u8 (vld1q_u8 (&src[i]), spread);
+      msbs = vandq_u8 (vtstq_u8 (v, msb), weights);
+      v = vandq_u8 (v, mask);
+      v = vsetq_lane_u8 (vaddv_u8 (vget_low_u8 (msbs)), v, 0);
+      v = vsetq_lane_u8 (vaddv_u8 (vget_high_u8 (msbs)), v, 8);
+      vst1q_u8 (dst, v);
+    }
+
+  return i;
+}
+
+static guint
+sysex_codec_decode_neon (const guint8 *src, guint len, guint8 *dst,
+			 enum sysex_codec_layout layout)
+{
+  guint i;
+  uint8x16_t v, msbs;
+  guint8 data[16];
+  const uint8x16_t msb = vdupq_n_u8 (0x80);
+  const uint8x16_t compact = vld1q_u8 (SYSEX_CODEC_COMPACT);
+  const uint8x16_t weights = vld1q_u8 (SYSEX_CODEC_WEIGHTS[layout]);
+
+  for (i = 0; i + 16 <= len; i += 16, dst += 14)
+    {
+      v = vld1q_u8 (&src[i]);
+      msbs = vcombine_u8 (vdup_n_u8 (src[i]), vdup_n_u8 (src[i + 8]));
+      msbs = vandq_u8 (vtstq_u8 (msbs, weights), msb);
+      v = vqtbl1q_u8 (vorrq_u8 (v, msbs), compact);
+      vst1q_u8 (data, v);
+      memcpy (dst, data, 14);
+    }
+
+  return i;
+}
+
+static guint
+sysex_codec_swap16_neon (const guint8 *src, guint len, guint8 *dst)
+{
+  guint i;
+
+  for (i = 0; i + 16 <= len; i += 16)
+    {
+      vst1q_u8 (&dst[i], vrev16q_u8 (vld1q_u8 (&src[i])));
+    }
+
+  return i;
+}
+
+#endif
+
+static const struct sysex_codec_kernel_ops SYSEX_CODEC_KERNELS[] = {
+  [SYSEX_CODEC_KERNEL_SCALAR] = {
+				 .name = "scalar",
+				 .encode = sysex_codec_encode_scalar,
+				 .decode = sysex_codec_decode_scalar,
+				 .swap16 = sysex_codec_swap16_scalar},
+#if defined(SYSEX_CODEC_X86)
+  [SYSEX_CODEC_KERNEL_SSE2] = {
+			       .name = "SSE2",
+			       .encode = sysex_codec_encode_sse2,
+			       .decode = sysex_codec_decode_sse2,
+			       .swap16 = sysex_codec_swap16_sse2},
+  [SYSEX_CODEC_KERNEL_AVX2] = {
+			       .name = "AVX2",
+			       .encode = sysex_codec_encode_avx2,
+			       .decode = sysex_codec_decode_avx2,
+			       .swap16 = sysex_codec_swap16_avx2},
+#endif
+#if defined(SYSEX_CODEC_NEON)
+  [SYSEX_CODEC_KERNEL_NEON] = {
+			       .name = "NEON",
+			       .encode = sysex_codec_encode_neon,
+			       .decode = sysex_codec_decode_neon,
+			       .swap16 = sysex_codec_swap16_neon},
+#endif
+  [SYSEX_CODEC_KERNEL_AUTO] = {
+			       .name = NULL}
+};
+
+static gboolean
+sysex_codec_is_supported (enum sysex_codec_kernel kernel)
+{
+  if (!SYSEX_CODEC_KERNELS[kernel].name)
+    {
+      return FALSE;
+    }
+
+#if defined(SYSEX_CODEC_X86)
+  __builtin_cpu_init ();
+  if (kernel == SYSEX_CODEC_KERNEL_SSE2)
+    {
+      return __builtin_cpu_supports ("sse2");
+    }
+  if (kernel == SYSEX_CODEC_KERNEL_AVX2)
+    {
+      return __builtin_cpu_supports ("avx2");
+    }
+#endif
+
+  return TRUE;
+}
+
+static enum sysex_codec_kernel
+sysex_codec_get_best_kernel ()
+{
+  enum sysex_codec_kernel kernel = SYSEX_CODEC_KERNEL_AUTO - 1;
+
+  while (!sysex_codec_is_supported (kernel))
+    {
+      kernel--;
+    }
+
+  return kernel;
+}
+
+static void
+sysex_codec_init ()
+{
+  static gsize init = 0;
+
+  if (g_once_init_enter (&init))
+    {
+      for (guint i = 0; i < G_N_ELEMENTS (sysex_codec_reversed); i++)
+	{
+	  sysex_codec_reversed[i] = 0;
+	  for (guint k = 0; k < SYSEX_CODEC_GROUP_LEN; k++)
+	    {
+	      if (i & (1 << k))
+		{
+		  sysex_codec_reversed[i] |= 0x40 >> k;
+		}
+	    }
+	}
+
+      sysex_codec_kernel =
+	&SYSEX_CODEC_KERNELS[sysex_codec_get_best_kernel ()];
+
+      debug_print (1, "Using %s SysEx codec", sysex_codec_kernel->name);
+
+      g_once_init_leave (&init, 1);
+    }
+}
+
+gint
+sysex_codec_set_kernel (enum sysex_codec_kernel kernel)
+{
+  sysex_codec_init ();
+
+  if (kernel == SYSEX_CODEC_KERNEL_AUTO)
+    {
+      kernel = sysex_codec_get_best_kernel ();
+    }
+  else if (!sysex_codec_is_supported (kernel))
+    {
+      return -ENOTSUP;
+    }
+
+  sysex_codec_kernel = &SYSEX_CODEC_KERNELS[kernel];
+
+  return 0;
+}
+
+const gchar *
+sysex_codec_get_kernel_name ()
+{
+  sysex_codec_init ();
+  return sysex_codec_kernel->name;
+}
+
+guint
+sysex_codec_encode (const guint8 *src, guint len, guint8 *dst,
+		    enum sysex_codec_layout layout)
+{
+  guint consumed, written;
+
+  sysex_codec_init ();
+
+  consumed = sysex_codec_kernel->encode (src, len, dst, layout);
+  written = consumed / SYSEX_CODEC_GROUP_LEN * SYSEX_CODEC_PACKET_LEN;
+  sysex_codec_encode_scalar (&src[consumed], len - consumed, &dst[written],
+			     layout);
+
+  return sysex_codec_get_encoded_len (len);
+}
+
+guint
+sysex_codec_decode (const guint8 *src, guint len, guint8 *dst,
+		    enum sysex_codec_layout layout)
+{
+  guint consumed, written;
+
+  sysex_codec_init ();
+
+  consumed = sysex_codec_kernel->decode (src, len, dst, layout);
+  written = consumed / SYSEX_CODEC_PACKET_LEN * SYSEX_CODEC_GROUP_LEN;
+  sysex_codec_decode_scalar (&src[consumed], len - consumed, &dst[written],
+			     layout);
+
+  return sysex_codec_get_decoded_len (len);
+}
+
+void
+sysex_codec_copy_be16 (const guint8 *src, guint len, guint8 *dst)
+{
+#if G_BYTE_ORDER == G_BIG_ENDIAN
+  memcpy (dst, src, len);
+#else
+  guint consumed;
+
+  sysex_codec_init ();
+
+  consumed = sysex_codec_kernel->swap16 (src, len, dst);
+  sysex_codec_swap16_scalar (&src[consumed], len - consumed, &dst[consumed]);
+#endif
+}
+
+void
+sysex_codec_sds_encode (const gint16 *src, guint words, guint8 *dst,
+			guint bits, guint bytes_per_word)
+{
+  guint value;
+  guint shift = bytes_per_word * 7 - bits;
+
+  for (guint i = 0; i < words; i++, src++, dst += bytes_per_word)
+    {
+      value = (((gint) *src) + 0x8000) << shift;
+      for (gint j = bytes_per_word - 1; j >= 0; j--, value >>= 7)
+	{
+	  dst[j] = value & 0x7f;
+	}
+    }
+}
+
+void
+sysex_codec_sds_decode (const guint8 *src, guint words, gint16 *dst,
+			guint bits, guint bytes_per_word)
+{
+  guint value;
+  guint shift = bytes_per_word * 7 - bits;
+
+  for (guint i = 0; i < words; i++, src += bytes_per_word, dst++)
+    {
+      value = 0;
+      for (guint j = 0; j < bytes_per_word; j++)
+	{
+	  value = (value << 7) | src[j];
+	}
+      *dst = (gint16) ((value >> shift) - 0x8000);
+    }
+}
+
+guint8
+sysex_codec_sds_checksum (const guint8 *data, guint len)
+{
+  guint8 checksum = 0;
+
+  for (guint i = 0; i < len; i++)
+    {
+      checksum ^= data[i];
+    }
+
+  return checksum & 0x7f;
+}
@@ -0,0 +1,73 @@
+/*
+ *   sysex_codec.h
+ *   Copyright (C) 2024 David García Goñi <dagargo@gmail.com>
+ *
+ *   This file is part of Elektroid.
+ *
+ *   Elektroid is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Elektroid is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Elektroid. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SYSEX_CODEC_H
+#define SYSEX_CODEC_H
+
+#include <glib.h>
+
+//8-bit data is sent in groups of up to 7 bytes preceded by a byte containing their MSBs.
+//In the MSB first layout (Elektron), the MSB of the first byte is bit 6 of the header.
+//In the LSB first layout (Arturia, Korg), the MSB of the first byte is bit 0 of the header.
+enum sysex_codec_layout
+{
+  SYSEX_CODEC_MSB_FIRST,
+  SYSEX_CODEC_LSB_FIRST
+};
+
+enum sysex_codec_kernel
+{
+  SYSEX_CODEC_KERNEL_SCALAR,
+  SYSEX_CODEC_KERNEL_SSE2,
+  SYSEX_CODEC_KERNEL_AVX2,
+  SYSEX_CODEC_KERNEL_NEON,
+  SYSEX_CODEC_KERNEL_AUTO
+};
+
+guint sysex_codec_get_encoded_len (guint len);
+
+guint sysex_codec_get_decoded_len (guint len);
+
+//Returns the amount of bytes written, which is sysex_codec_get_encoded_len (len).
+guint sysex_codec_encode (const guint8 * src, guint len, guint8 * dst,
+			  enum sysex_codec_layout layout);
+
+//Returns the amount of bytes written, which is sysex_codec_get_decoded_len (len).
+guint sysex_codec_decode (const guint8 * src, guint len, guint8 * dst,
+			  enum sysex_codec_layout layout);
+
+//Copies 16-bit words from host to big endian order or vice versa. The length is in bytes and must be even.
+void sysex_codec_copy_be16 (const guint8 * src, guint len, guint8 * dst);
+
+//The fastest kernel supported by the CPU is used by default. This is only intended for tests and benchmarks.
+gint sysex_codec_set_kernel (enum sysex_codec_kernel kernel);
+
+const gchar *sysex_codec_get_kernel_name (void);
+
+//SDS words are left justified in bytes_per_word bytes, most significant bits first, and stored with a 0x8000 offset.
+void sysex_codec_sds_encode (const gint16 * src, guint words, guint8 * dst,
+			     guint bits, guint bytes_per_word);
+
+void sysex_codec_sds_decode (const guint8 * src, guint words, gint16 * dst,
+			     guint bits, guint bytes_per_word);
+
+guint8 sysex_codec_sds_checksum (const guint8 * data, guint len);
+
+#endif
@@ -0,0 +1,397 @@
+/*
+ *   task_queue.c
+ *   Copyright (C) 2024 David García Goñi <dagargo@gmail.com>
+ *
+ *   This file is part of Elektroid.
+ *
+ *   Elektroid is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Elektroid is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Elektroid. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "task_queue.h"
+
+//The links are embedded in the tasks so that any task can be unlinked from any queue in constant time.
+//Hence, g_queue_clear and g_queue_free must never be called on non empty queues.
+
+static void
+task_free (struct task *task)
+{
+  g_free (task->src);
+  g_free (task->dst);
+  g_free (task);
+}
+
+void
+task_queue_init (struct task_queue *queue)
+{
+  g_mutex_init (&queue->mutex);
+  g_queue_init (&queue->pending);
+  g_queue_init (&queue->finished);
+  g_queue_init (&queue->dirty);
+  g_queue_init (&queue->current);
+  queue->batches = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+					  NULL, (GDestroyNotify) g_queue_free);
+}
+
+static void
+task_queue_free_tasks (GQueue *tasks)
+{
+  GList *link;
+
+  while ((link = g_queue_pop_head_link (tasks)))
+    {
+      task_free (link->data);
+    }
+}
+
+void
+task_queue_free (struct task_queue *queue)
+{
+  GHashTableIter iter;
+  gpointer batch;
+
+  g_mutex_lock (&queue->mutex);
+
+  g_hash_table_iter_init (&iter, queue->batches);
+  while (g_hash_table_iter_next (&iter, NULL, &batch))
+    {
+      g_queue_init (batch);
+    }
+  g_hash_table_destroy (queue->batches);
+  queue->batches = NULL;
+
+  g_queue_init (&queue->dirty);
+  task_queue_free_tasks (&queue->pending);
+  task_queue_free_tasks (&queue->finished);
+  task_queue_free_tasks (&queue->current);
+
+  g_mutex_unlock (&queue->mutex);
+  g_mutex_clear (&queue->mutex);
+}
+
+static void
+task_queue_set_dirty (struct task_queue *queue, struct task *task)
+{
+  if (!task->dirty)
+    {
+      task->dirty = TRUE;
+      g_queue_push_tail_link (&queue->dirty, &task->dirty_link);
+    }
+}
+
+static void
+task_queue_unset_dirty (struct task_queue *queue, struct task *task)
+{
+  if (task->dirty)
+    {
+      task->dirty = FALSE;
+      g_queue_unlink (&queue->dirty, &task->dirty_link);
+    }
+}
+
+struct task *
+task_queue_add (struct task_queue *queue, enum task_type type,
+		const gchar *src, const gchar *dst, gint fs, guint batch_id,
+		gpointer view)
+{
+  GQueue *batch;
+  struct task *task = g_new0 (struct task, 1);
+
+  task->type = type;
+  task->status = TASK_STATUS_QUEUED;
+  task->mode = TASK_MODE_ASK;
+  task->src = g_strdup (src);
+  task->dst = g_strdup (dst);
+  task->fs = fs;
+  task->batch_id = batch_id;
+  task->view = view;
+  task->link.data = task;
+  task->batch_link.data = task;
+  task->dirty_link.data = task;
+
+  g_mutex_lock (&queue->mutex);
+
+  batch = g_hash_table_lookup (queue->batches, GUINT_TO_POINTER (batch_id));
+  if (!batch)
+    {
+      batch = g_queue_new ();
+      g_hash_table_insert (queue->batches, GUINT_TO_POINTER (batch_id),
+			   batch);
+    }
+
+  g_queue_push_tail_link (&queue->pending, &task->link);
+  g_queue_push_tail_link (batch, &task->batch_link);
+  task_queue_set_dirty (queue, task);
+
+  g_mutex_unlock (&queue->mutex);
+
+  return task;
+}
+
+gboolean
+task_queue_has_queued (struct task_queue *queue)
+{
+  gboolean queued;
+
+  g_mutex_lock (&queue->mutex);
+  queued = !g_queue_is_empty (&queue->pending);
+  g_mutex_unlock (&queue->mutex);
+
+  return queued;
+}
+
+gboolean
+task_queue_has_finished (struct task_queue *queue)
+{
+  gboolean finished;
+
+  g_mutex_lock (&queue->mutex);
+  finished = !g_queue_is_empty (&queue->finished);
+  g_mutex_unlock (&queue->mutex);
+
+  return finished;
+}
+
+static void
+task_queue_unlink_pending (struct task_queue *queue, struct task *task)
+{
+  gpointer key = GUINT_TO_POINTER (task->batch_id);
+  GQueue *batch = g_hash_table_lookup (queue->batches, key);
+
+  g_queue_unlink (&queue->pending, &task->link);
+  g_queue_unlink (batch, &task->batch_link);
+  if (g_queue_is_empty (batch))
+    {
+      g_hash_table_remove (queue->batches, key);
+    }
+}
+
+static void
+task_queue_finish (struct task_queue *queue, struct task *task,
+		   enum task_status status)
+{
+  task->status = status;
+  g_queue_push_tail_link (&queue->finished, &task->link);
+  task_queue_set_dirty (queue, task);
+}
+
+static struct task *
+task_queue_start_head (struct task_queue *queue)
+{
+  struct task *task = queue->pending.head->data;
+
+  task_queue_unlink_pending (queue, task);
+  task->status = TASK_STATUS_RUNNING;
+  g_queue_push_tail_link (&queue->current, &task->link);
+  task_queue_set_dirty (queue, task);
+
+  return task;
+}
+
+struct task *
+task_queue_start_next (struct task_queue *queue)
+{
+  struct task *task = NULL;
+
+  g_mutex_lock (&queue->mutex);
+
+  if (g_queue_is_empty (&queue->current) && queue->pending.head)
+    {
+      task = task_queue_start_head (queue);
+    }
+
+  g_mutex_unlock (&queue->mutex);
+
+  return task;
+}
+
+struct task *
+task_queue_start_next_if (struct task_queue *queue, task_queue_filter filter,
+			  gpointer data)
+{
+  struct task *task = NULL;
+
+  g_mutex_lock (&queue->mutex);
+
+  if (!g_queue_is_empty (&queue->current) && queue->pending.head &&
+      filter (queue->pending.head->data, data))
+    {
+      task = task_queue_start_head (queue);
+    }
+
+  g_mutex_unlock (&queue->mutex);
+
+  return task;
+}
+
+struct task *
+task_queue_complete_current (struct task_queue *queue,
+			     enum task_status status)
+{
+  GList *link;
+  struct task *task = NULL;
+
+  g_mutex_lock (&queue->mutex);
+
+  link = g_queue_pop_head_link (&queue->current);
+  if (link)
+    {
+      task = link->data;
+      task_queue_finish (queue, task, status);
+    }
+
+  g_mutex_unlock (&queue->mutex);
+
+  return task;
+}
+
+void
+task_queue_cancel_all (struct task_queue *queue)
+{
+  struct task *task;
+
+  g_mutex_lock (&queue->mutex);
+
+  while (queue->pending.head)
+    {
+      task = queue->pending.head->data;
+      task_queue_unlink_pending (queue, task);
+      task_queue_finish (queue, task, TASK_STATUS_CANCELED);
+    }
+
+  g_mutex_unlock (&queue->mutex);
+}
+
+void
+task_queue_cancel_batch (struct task_queue *queue, guint batch_id)
+{
+  guint len;
+  GQueue *batch;
+  struct task *task;
+
+  g_mutex_lock (&queue->mutex);
+
+  batch = g_hash_table_lookup (queue->batches, GUINT_TO_POINTER (batch_id));
+  //The batch queue is freed when its last task is unlinked.
+  len = batch ? batch->length : 0;
+  for (guint i = 0; i < len; i++)
+    {
+      task = batch->head->data;
+      task_queue_unlink_pending (queue, task);
+      task_queue_finish (queue, task, TASK_STATUS_CANCELED);
+    }
+
+  g_mutex_unlock (&queue->mutex);
+}
+
+void
+task_queue_set_batch_mode (struct task_queue *queue, guint batch_id,
+			   enum task_mode mode)
+{
+  GQueue *batch;
+  struct task *task;
+
+  g_mutex_lock (&queue->mutex);
+
+  batch = g_hash_table_lookup (queue->batches, GUINT_TO_POINTER (batch_id));
+  for (GList *l = batch ? batch->head : NULL; l; l = l->next)
+    {
+      task = l->data;
+      if (task->mode != mode)
+	{
+	  task->mode = mode;
+	  task_queue_set_dirty (queue, task);
+	}
+    }
+
+  g_mutex_unlock (&queue->mutex);
+}
+
+void
+task_queue_visit_pending (struct task_queue *queue, guint max,
+			  task_queue_visitor visitor, gpointer data)
+{
+  guint i = 0;
+
+  g_mutex_lock (&queue->mutex);
+
+  for (GList *l = queue->pending.head; l && i < max; l = l->next, i++)
+    {
+      visitor (l->data, data);
+    }
+
+  g_mutex_unlock (&queue->mutex);
+}
+
+void
+task_queue_remove_queued (struct task_queue *queue,
+			  task_queue_visitor visitor, gpointer data)
+{
+  struct task *task;
+
+  g_mutex_lock (&queue->mutex);
+
+  while (queue->pending.head)
+    {
+      task = queue->pending.head->data;
+      task_queue_unlink_pending (queue, task);
+      task_queue_unset_dirty (queue, task);
+      visitor (task, data);
+      task_free (task);
+    }
+
+  g_mutex_unlock (&queue->mutex);
+}
+
+void
+task_queue_remove_finished (struct task_queue *queue,
+			    task_queue_visitor visitor, gpointer data)
+{
+  GList *link;
+  struct task *task;
+
+  g_mutex_lock (&queue->mutex);
+
+  while ((link = g_queue_pop_head_link (&queue->finished)))
+    {
+      task = link->data;
+      task_queue_unset_dirty (queue, task);
+      visitor (task, data);
+      task_free (task);
+    }
+
+  g_mutex_unlock (&queue->mutex);
+}
+
+guint
+task_queue_flush (struct task_queue *queue, task_queue_visitor visitor,
+		  gpointer data)
+{
+  guint n = 0;
+  GList *link;
+  struct task *task;
+
+  g_mutex_lock (&queue->mutex);
+
+  while ((link = g_queue_pop_head_link (&queue->dirty)))
+    {
+      task = link->data;
+      task->dirty = FALSE;
+      visitor (task, data);
+      n++;
+    }
+
+  g_mutex_unlock (&queue->mutex);
+
+  return n;
+}
@@ -0,0 +1,132 @@
+/*
+ *   task_queue.h
+ *   Copyright (C) 2024 David García Goñi <dagargo@gmail.com>
+ *
+ *   This file is part of Elektroid.
+ *
+ *   Elektroid is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Elektroid is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Elektroid. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TASK_QUEUE_H
+#define TASK_QUEUE_H
+
+#include <glib.h>
+
+enum task_status
+{
+  TASK_STATUS_QUEUED,
+  TASK_STATUS_RUNNING,
+  TASK_STATUS_COMPLETED_OK,
+  TASK_STATUS_COMPLETED_ERROR,
+  TASK_STATUS_CANCELED
+};
+
+enum task_mode
+{
+  TASK_MODE_ASK,
+  TASK_MODE_REPLACE,
+  TASK_MODE_SKIP
+};
+
+enum task_type
+{
+  TASK_TYPE_UPLOAD,
+  TASK_TYPE_DOWNLOAD,
+  TASK_TYPE_DELETE
+};
+
+//A task is always in one of these places: the pending queue (and the pending queue of its batch), the current queue or the finished queue.
+//Besides, it is in the dirty queue if it has changed since the last flush.
+
+struct task
+{
+  enum task_type type;
+  enum task_status status;
+  enum task_mode mode;
+  gchar *src;
+  gchar *dst;
+  gint fs;
+  guint batch_id;
+  gpointer view;		//Owned by the caller
+  gboolean dirty;
+  GList link;
+  GList batch_link;
+  GList dirty_link;
+};
+
+struct task_queue
+{
+  GMutex mutex;
+  GQueue pending;
+  GQueue finished;
+  GQueue dirty;
+  GHashTable *batches;		//Pending tasks by batch id
+  GQueue current;		//Several tasks when they run as a single operation
+};
+
+//Visitors are called with the queue locked so they must not call any task_queue function.
+typedef void (*task_queue_visitor) (struct task * task, gpointer data);
+
+//Filters are called with the queue locked too.
+typedef gboolean (*task_queue_filter) (struct task * task, gpointer data);
+
+void task_queue_init (struct task_queue *queue);
+
+//Tasks are freed without visiting them.
+void task_queue_free (struct task_queue *queue);
+
+//Tasks are only freed by the remove functions so the returned pointers are valid until then.
+struct task *task_queue_add (struct task_queue *queue, enum task_type type,
+			     const gchar * src, const gchar * dst, gint fs,
+			     guint batch_id, gpointer view);
+
+gboolean task_queue_has_queued (struct task_queue *queue);
+
+gboolean task_queue_has_finished (struct task_queue *queue);
+
+//Dequeues the first pending task and makes it the current one.
+struct task *task_queue_start_next (struct task_queue *queue);
+
+//Dequeues the first pending task and adds it to the current ones if there are current tasks and the filter accepts it.
+struct task *task_queue_start_next_if (struct task_queue *queue,
+				       task_queue_filter filter,
+				       gpointer data);
+
+//Moves the first current task to the finished queue.
+struct task *task_queue_complete_current (struct task_queue *queue,
+					  enum task_status status);
+
+void task_queue_cancel_all (struct task_queue *queue);
+
+void task_queue_cancel_batch (struct task_queue *queue, guint batch_id);
+
+void task_queue_set_batch_mode (struct task_queue *queue, guint batch_id,
+				enum task_mode mode);
+
+//Visits up to max pending tasks in order.
+void task_queue_visit_pending (struct task_queue *queue, guint max,
+			       task_queue_visitor visitor, gpointer data);
+
+//The visitor is called for every task right before freeing it.
+void task_queue_remove_queued (struct task_queue *queue,
+			       task_queue_visitor visitor, gpointer data);
+
+void task_queue_remove_finished (struct task_queue *queue,
+				 task_queue_visitor visitor, gpointer data);
+
+//Visits the tasks changed since the last call in the order they changed and returns how many there were.
+guint task_queue_flush (struct task_queue *queue, task_queue_visitor visitor,
+			gpointer data);
+
+#endif
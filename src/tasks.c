@@ -55,6 +55,8 @@ tasks_get_human_type (enum task_type type)
       return _("Upload");
     case TASK_TYPE_DOWNLOAD:
       return _("Download");
+    case TASK_TYPE_DELETE:
+      return _("Delete");
     default:
       return _("Undefined");
     }
@@ -66,68 +68,120 @@ tasks_stop_current (GtkWidget *object, gpointer data)
   controllable_set_active (&tasks.transfer.control.controllable, FALSE);
 }
 
-void
-tasks_visit_pending (void (*visitor) (GtkTreeIter *iter))
+//The row is inserted in the list store the first time the task is flushed.
+
+struct tasks_row
 {
-  enum task_status status;
   GtkTreeIter iter;
-  gboolean valid =
-    gtk_tree_model_get_iter_first (GTK_TREE_MODEL (tasks.list_store), &iter);
+  gboolean inserted;
+  const gchar *icon;
+};
+
+static void
+tasks_update_row (struct task *task, gpointer data)
+{
+  struct tasks_row *row = task->view;
+  const gchar *status_human = tasks_get_human_status (task->status);
+  const gchar *type_human;
+
+  if (row->inserted)
+    {
+      gtk_list_store_set (tasks.list_store, &row->iter,
+			  TASK_LIST_STORE_STATUS_FIELD, task->status,
+			  TASK_LIST_STORE_STATUS_HUMAN_FIELD, status_human,
+			  TASK_LIST_STORE_MODE_FIELD, task->mode, -1);
+      return;
+    }
+
+  type_human = tasks_get_human_type (task->type);
+  gtk_list_store_insert_with_values (tasks.list_store, &row->iter, -1,
+				     TASK_LIST_STORE_STATUS_FIELD,
+				     task->status,
+				     TASK_LIST_STORE_TYPE_FIELD, task->type,
+				     TASK_LIST_STORE_SRC_FIELD, task->src,
+				     TASK_LIST_STORE_DST_FIELD, task->dst,
+				     TASK_LIST_STORE_PROGRESS_FIELD, 0,
+				     TASK_LIST_STORE_STATUS_HUMAN_FIELD,
+				     status_human,
+				     TASK_LIST_STORE_TYPE_HUMAN_FIELD,
+				     type_human,
+				     TASK_LIST_STORE_REMOTE_FS_ID_FIELD,
+				     task->fs,
+				     TASK_LIST_STORE_REMOTE_FS_ICON_FIELD,
+				     row->icon,
+				     TASK_LIST_STORE_BATCH_ID_FIELD,
+				     task->batch_id,
+				     TASK_LIST_STORE_MODE_FIELD, task->mode,
+				     -1);
+  row->inserted = TRUE;
+}
+
+static void
+tasks_remove_row (struct task *task, gpointer data)
+{
+  struct tasks_row *row = task->view;
 
-  while (valid)
+  if (row->inserted)
     {
-      gtk_tree_model_get (GTK_TREE_MODEL (tasks.list_store), &iter,
-			  TASK_LIST_STORE_STATUS_FIELD, &status, -1);
-      if (status == TASK_STATUS_QUEUED)
-	{
-	  visitor (&iter);
-	}
-      valid = gtk_tree_model_iter_next (GTK_TREE_MODEL (tasks.list_store),
-					&iter);
+      gtk_list_store_remove (tasks.list_store, &row->iter);
     }
+  g_free (row);
 }
 
 static gboolean
-tasks_get_current (GtkTreeIter *iter)
+tasks_update_view (gpointer data)
 {
-  enum task_status status;
-  gboolean found = FALSE;
-  gboolean valid =
-    gtk_tree_model_get_iter_first (GTK_TREE_MODEL (tasks.list_store), iter);
+  guint n;
 
-  while (valid)
-    {
-      gtk_tree_model_get (GTK_TREE_MODEL (tasks.list_store), iter,
-			  TASK_LIST_STORE_STATUS_FIELD, &status, -1);
+  g_atomic_int_set (&tasks.view_scheduled, FALSE);
+  n = task_queue_flush (&tasks.queue, tasks_update_row, NULL);
+  debug_print (2, "%d task rows updated", n);
+  tasks_check_buttons ();
 
-      if (status == TASK_STATUS_RUNNING)
-	{
-	  found = TRUE;
-	  break;
-	}
+  return FALSE;
+}
+
+//Tasks are added from other threads too but the list store is only updated from the main loop.
 
-      valid =
-	gtk_tree_model_iter_next (GTK_TREE_MODEL (tasks.list_store), iter);
+static void
+tasks_schedule_view_update ()
+{
+  if (g_atomic_int_compare_and_exchange (&tasks.view_scheduled, FALSE, TRUE))
+    {
+      g_idle_add (tasks_update_view, NULL);
     }
+}
 
-  return found;
+static enum task_status
+tasks_get_final_status (guint index)
+{
+  if (index < tasks.transfer.group_len)
+    {
+      return tasks.transfer.group_status[index];
+    }
+  return tasks.transfer.status;
 }
 
 gboolean
 tasks_complete_current (gpointer data)
 {
-  GtkTreeIter iter;
-  const gchar *status = tasks_get_human_status (tasks.transfer.status);
+  guint completed = 0;
+
+  while (task_queue_complete_current (&tasks.queue,
+				      tasks_get_final_status (completed)))
+    {
+      completed++;
+    }
 
-  if (tasks_get_current (&iter))
+  if (completed)
     {
-      gtk_list_store_set (tasks.list_store, &iter,
-			  TASK_LIST_STORE_STATUS_FIELD,
-			  tasks.transfer.status,
-			  TASK_LIST_STORE_STATUS_HUMAN_FIELD, status, -1);
+      tasks_update_view (NULL);
       tasks_stop_current (NULL, NULL);
       g_free (tasks.transfer.src);
       g_free (tasks.transfer.dst);
+      g_free (tasks.transfer.group_status);
+      tasks.transfer.group_status = NULL;
+      tasks.transfer.group_len = 0;
 
       gtk_widget_set_sensitive (tasks.cancel_task_button, FALSE);
     }
@@ -140,221 +194,113 @@ tasks_complete_current (gpointer data)
 }
 
 gboolean
-tasks_get_next_queued (GtkTreeIter *iter,
-		       enum task_type *type, gchar **src,
-		       gchar **dst, gint *fs, guint *batch_id, guint *mode)
+tasks_has_queued ()
+{
+  return task_queue_has_queued (&tasks.queue);
+}
+
+struct task *
+tasks_start_next ()
 {
-  enum task_status status;
-  gboolean found = FALSE;
-  gboolean valid =
-    gtk_tree_model_get_iter_first (GTK_TREE_MODEL (tasks.list_store), iter);
+  GtkTreePath *path;
+  struct tasks_row *row;
+  struct task *task = task_queue_start_next (&tasks.queue);
 
-  while (valid)
+  if (!task)
     {
-      if (type)
-	{
-	  gtk_tree_model_get (GTK_TREE_MODEL (tasks.list_store), iter,
-			      TASK_LIST_STORE_STATUS_FIELD, &status,
-			      TASK_LIST_STORE_TYPE_FIELD, type,
-			      TASK_LIST_STORE_SRC_FIELD, src,
-			      TASK_LIST_STORE_DST_FIELD, dst,
-			      TASK_LIST_STORE_REMOTE_FS_ID_FIELD, fs,
-			      TASK_LIST_STORE_BATCH_ID_FIELD, batch_id,
-			      TASK_LIST_STORE_MODE_FIELD, mode, -1);
-	}
-      else
-	{
-	  gtk_tree_model_get (GTK_TREE_MODEL (tasks.list_store), iter,
-			      TASK_LIST_STORE_STATUS_FIELD, &status, -1);
-	}
-
-      if (status == TASK_STATUS_QUEUED)
-	{
-	  found = TRUE;
-	  break;
-	}
-      valid = gtk_tree_model_iter_next (GTK_TREE_MODEL (tasks.list_store),
-					iter);
+      return NULL;
     }
 
-  return found;
-}
+  //The row must be in the list store before moving the cursor to it.
+  tasks_update_view (NULL);
 
-static gboolean
-tasks_is_queued (enum task_status status)
-{
-  return (status == TASK_STATUS_QUEUED);
-}
+  row = task->view;
+  path = gtk_tree_model_get_path (GTK_TREE_MODEL (tasks.list_store),
+				  &row->iter);
+  gtk_tree_view_set_cursor (GTK_TREE_VIEW (tasks.tree_view), path, NULL,
+			    FALSE);
+  gtk_tree_path_free (path);
 
-static gboolean
-tasks_is_finished (enum task_status status)
-{
-  return (status == TASK_STATUS_COMPLETED_OK ||
-	  status == TASK_STATUS_COMPLETED_ERROR ||
-	  status == TASK_STATUS_CANCELED);
+  return task;
 }
 
-void
-tasks_check_buttons ()
+struct task *
+tasks_start_next_if (task_queue_filter filter, gpointer data)
 {
-  enum task_status status;
-  gboolean queued = FALSE;
-  gboolean finished = FALSE;
-  GtkTreeIter iter;
-  gboolean valid =
-    gtk_tree_model_get_iter_first (GTK_TREE_MODEL (tasks.list_store),
-				   &iter);
+  struct task *task = task_queue_start_next_if (&tasks.queue, filter, data);
 
-  while (valid)
+  if (task)
     {
-      gtk_tree_model_get (GTK_TREE_MODEL (tasks.list_store), &iter,
-			  TASK_LIST_STORE_STATUS_FIELD, &status, -1);
-
-      if (tasks_is_queued (status))
-	{
-	  queued = TRUE;
-	}
-
-      if (tasks_is_finished (status))
-	{
-	  finished = TRUE;
-	}
-
-      valid =
-	gtk_tree_model_iter_next (GTK_TREE_MODEL (tasks.list_store), &iter);
+      tasks_schedule_view_update ();
     }
 
-  gtk_widget_set_sensitive (tasks.remove_tasks_button, queued);
-  gtk_widget_set_sensitive (tasks.clear_tasks_button, finished);
+  return task;
 }
 
-static void
-tasks_remove_on_cond (gboolean (*selector) (enum task_status))
+void
+tasks_check_buttons ()
 {
-  enum task_status status;
-  GtkTreeIter iter;
-  gboolean valid =
-    gtk_tree_model_get_iter_first (GTK_TREE_MODEL (tasks.list_store),
-				   &iter);
-
-  while (valid)
-    {
-      gtk_tree_model_get (GTK_TREE_MODEL (tasks.list_store), &iter,
-			  TASK_LIST_STORE_STATUS_FIELD, &status, -1);
-
-      if (selector (status))
-	{
-	  gtk_list_store_remove (tasks.list_store, &iter);
-	  valid = gtk_list_store_iter_is_valid (tasks.list_store, &iter);
-	}
-      else
-	{
-	  valid =
-	    gtk_tree_model_iter_next (GTK_TREE_MODEL (tasks.list_store),
-				      &iter);
-	}
-    }
+  gboolean queued = task_queue_has_queued (&tasks.queue);
+  gboolean finished = task_queue_has_finished (&tasks.queue);
 
-  tasks_check_buttons ();
+  gtk_widget_set_sensitive (tasks.remove_tasks_button, queued);
+  gtk_widget_set_sensitive (tasks.clear_tasks_button, finished);
 }
 
 static void
 tasks_remove_queued (GtkWidget *object, gpointer data)
 {
-  tasks_remove_on_cond (tasks_is_queued);
+  task_queue_remove_queued (&tasks.queue, tasks_remove_row, NULL);
+  tasks_check_buttons ();
 }
 
 static void
 tasks_clear_finished (GtkWidget *object, gpointer data)
 {
-  tasks_remove_on_cond (tasks_is_finished);
-}
-
-static void
-tasks_visitor_set_canceled (GtkTreeIter *iter)
-{
-  const gchar *canceled = tasks_get_human_status (TASK_STATUS_CANCELED);
-  gtk_list_store_set (tasks.list_store, iter,
-		      TASK_LIST_STORE_STATUS_FIELD,
-		      TASK_STATUS_CANCELED,
-		      TASK_LIST_STORE_STATUS_HUMAN_FIELD, canceled, -1);
+  task_queue_remove_finished (&tasks.queue, tasks_remove_row, NULL);
+  tasks_check_buttons ();
 }
 
 void
 tasks_cancel_all (GtkWidget *object, gpointer data)
 {
-  tasks_visit_pending (tasks_visitor_set_canceled);
+  task_queue_cancel_all (&tasks.queue);
   tasks_stop_current (NULL, NULL);
-  tasks_check_buttons ();
+  tasks_update_view (NULL);
 }
 
 void
-tasks_visitor_set_batch_status (GtkTreeIter *iter, enum task_mode mode)
+tasks_cancel_batch (guint batch_id)
 {
-  gint batch_id;
-  gtk_tree_model_get (GTK_TREE_MODEL (tasks.list_store), iter,
-		      TASK_LIST_STORE_BATCH_ID_FIELD, &batch_id, -1);
-  if (batch_id == tasks.transfer.batch_id)
-    {
-      gtk_list_store_set (tasks.list_store, iter, TASK_LIST_STORE_MODE_FIELD,
-			  mode, -1);
-    }
-}
-
-void
-tasks_visitor_set_batch_canceled (GtkTreeIter *iter)
-{
-  gint batch_id;
-  gtk_tree_model_get (GTK_TREE_MODEL (tasks.list_store), iter,
-		      TASK_LIST_STORE_BATCH_ID_FIELD, &batch_id, -1);
-  if (batch_id == tasks.transfer.batch_id)
-    {
-      tasks_visitor_set_canceled (iter);
-    }
+  task_queue_cancel_batch (&tasks.queue, batch_id);
+  tasks_schedule_view_update ();
 }
 
 void
-tasks_batch_visitor_set_skip (GtkTreeIter *iter)
+tasks_set_batch_mode (guint batch_id, enum task_mode mode)
 {
-  tasks_visitor_set_batch_status (iter, TASK_MODE_SKIP);
+  task_queue_set_batch_mode (&tasks.queue, batch_id, mode);
+  tasks_schedule_view_update ();
 }
 
 void
-tasks_batch_visitor_set_replace (GtkTreeIter *iter)
+tasks_visit_pending (guint max, task_queue_visitor visitor, gpointer data)
 {
-  tasks_visitor_set_batch_status (iter, TASK_MODE_REPLACE);
+  task_queue_visit_pending (&tasks.queue, max, visitor, data);
 }
 
 void
 tasks_add (enum task_type type, const char *src, const char *dst,
 	   gint remote_fs_id, struct backend *backend)
 {
-  const gchar *status_human = tasks_get_human_status (TASK_STATUS_QUEUED);
-  const gchar *type_human = tasks_get_human_type (type);
   const struct fs_operations *ops = backend_get_fs_operations_by_id (backend,
 								     remote_fs_id);
+  struct tasks_row *row = g_new0 (struct tasks_row, 1);
 
-  gtk_list_store_insert_with_values (tasks.list_store, NULL, -1,
-				     TASK_LIST_STORE_STATUS_FIELD,
-				     TASK_STATUS_QUEUED,
-				     TASK_LIST_STORE_TYPE_FIELD, type,
-				     TASK_LIST_STORE_SRC_FIELD, src,
-				     TASK_LIST_STORE_DST_FIELD, dst,
-				     TASK_LIST_STORE_PROGRESS_FIELD, 0,
-				     TASK_LIST_STORE_STATUS_HUMAN_FIELD,
-				     status_human,
-				     TASK_LIST_STORE_TYPE_HUMAN_FIELD,
-				     type_human,
-				     TASK_LIST_STORE_REMOTE_FS_ID_FIELD,
-				     remote_fs_id,
-				     TASK_LIST_STORE_REMOTE_FS_ICON_FIELD,
-				     ops->gui_icon,
-				     TASK_LIST_STORE_BATCH_ID_FIELD,
-				     tasks.batch_id,
-				     TASK_LIST_STORE_MODE_FIELD,
-				     TASK_MODE_ASK, -1);
-
-  gtk_widget_set_sensitive (tasks.remove_tasks_button, TRUE);
+  row->icon = ops->gui_icon;
+  task_queue_add (&tasks.queue, type, src, dst, remote_fs_id, tasks.batch_id,
+		  row);
+  tasks_schedule_view_update ();
 }
 
 static void
@@ -381,22 +327,32 @@ tasks_stop_thread ()
   tasks_join_thread ();
 }
 
+//The current tasks are only changed from the main loop.
+//The progress of a group is split evenly among its tasks.
+
 gboolean
 tasks_update_current_progress (gpointer data)
 {
-  GtkTreeIter iter;
+  guint i = 0, len;
   gdouble progress;
   gint percent;
+  struct tasks_row *row;
 
-  if (tasks_get_current (&iter))
+  len = tasks.queue.current.length;
+  if (!len)
     {
-      g_mutex_lock (&tasks.transfer.control.controllable.mutex);
-      progress = tasks.transfer.control.progress;
-      g_mutex_unlock (&tasks.transfer.control.controllable.mutex);
+      return FALSE;
+    }
 
-      percent = (gint) (100.0 * progress);
+  g_mutex_lock (&tasks.transfer.control.controllable.mutex);
+  progress = tasks.transfer.control.progress;
+  g_mutex_unlock (&tasks.transfer.control.controllable.mutex);
 
-      gtk_list_store_set (tasks.list_store, &iter,
+  for (GList *l = tasks.queue.current.head; l; l = l->next, i++)
+    {
+      percent = (gint) (100.0 * CLAMP (progress * len - i, 0.0, 1.0));
+      row = ((struct task *) l->data)->view;
+      gtk_list_store_set (tasks.list_store, &row->iter,
 			  TASK_LIST_STORE_PROGRESS_FIELD, percent, -1);
     }
 
@@ -407,6 +363,10 @@ void
 tasks_init (GtkBuilder *builder)
 {
   tasks.thread = NULL;
+  tasks.view_scheduled = FALSE;
+  tasks.transfer.group_len = 0;
+  tasks.transfer.group_status = NULL;
+  task_queue_init (&tasks.queue);
 
   tasks.list_store =
     GTK_LIST_STORE (gtk_builder_get_object (builder, "task_list_store"));
@@ -23,6 +23,7 @@
 
 #include <gtk/gtk.h>
 #include "connector.h"
+#include "task_queue.h"
 
 enum task_list_store_columns
 {
@@ -39,28 +40,6 @@ enum task_list_store_columns
   TASK_LIST_STORE_MODE_FIELD
 };
 
-enum task_status
-{
-  TASK_STATUS_QUEUED,
-  TASK_STATUS_RUNNING,
-  TASK_STATUS_COMPLETED_OK,
-  TASK_STATUS_COMPLETED_ERROR,
-  TASK_STATUS_CANCELED
-};
-
-enum task_mode
-{
-  TASK_MODE_ASK,
-  TASK_MODE_REPLACE,
-  TASK_MODE_SKIP
-};
-
-enum task_type
-{
-  TASK_TYPE_UPLOAD,
-  TASK_TYPE_DOWNLOAD
-};
-
 struct task_transfer
 {
   struct task_control control;
@@ -70,11 +49,15 @@ struct task_transfer
   const struct fs_operations *fs_ops;	//Contains the fs_operations to use in this transfer
   guint mode;
   guint batch_id;
+  guint group_len;		//Tasks run as a single operation
+  enum task_status *group_status;	//Contains the final status of every task in the group
 };
 
 struct tasks
 {
   struct task_transfer transfer;
+  struct task_queue queue;
+  gint view_scheduled;		//The list store is a view of the queue updated in batches
   GThread *thread;
   gint batch_id;
   GtkListStore *list_store;
@@ -88,20 +71,22 @@ extern struct tasks tasks;
 
 void tasks_init (GtkBuilder * builder);
 
-gboolean tasks_get_next_queued (GtkTreeIter * iter,
-				enum task_type *type, gchar ** src,
-				gchar ** dst, gint * fs, guint * batch_id,
-				guint * mode);
+gboolean tasks_has_queued ();
+
+struct task *tasks_start_next ();
+
+struct task *tasks_start_next_if (task_queue_filter filter, gpointer data);
 
 gboolean tasks_complete_current (gpointer data);
 
 void tasks_cancel_all (GtkWidget * object, gpointer data);
 
-void tasks_visitor_set_batch_canceled (GtkTreeIter * iter);
+void tasks_cancel_batch (guint batch_id);
 
-void tasks_batch_visitor_set_skip (GtkTreeIter * iter);
+void tasks_set_batch_mode (guint batch_id, enum task_mode mode);
 
-void tasks_batch_visitor_set_replace (GtkTreeIter * iter);
+void tasks_visit_pending (guint max, task_queue_visitor visitor,
+			  gpointer data);
 
 void tasks_stop_thread ();
 
@@ -109,8 +94,6 @@ const gchar *tasks_get_human_status (enum task_status status);
 
 void tasks_check_buttons ();
 
-void tasks_visit_pending (void (*visitor) (GtkTreeIter * iter));
-
 void tasks_add (enum task_type type,
 		const char *src, const char *dst, gint remote_fs_id,
 		struct backend *backend);
@@ -0,0 +1,288 @@
+/*
+ *   telemetry.c
+ *   Copyright (C) 2024 David García Goñi <dagargo@gmail.com>
+ *
+ *   This file is part of Elektroid.
+ *
+ *   Elektroid is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Elektroid is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Elektroid. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <inttypes.h>
+#include <json-glib/json-glib.h>
+#include "telemetry.h"
+
+void
+telemetry_init (struct telemetry *telemetry)
+{
+  g_mutex_init (&telemetry->mutex);
+  telemetry->tx_msgs = 0;
+  telemetry->tx_bytes = 0;
+  telemetry->rx_msgs = 0;
+  telemetry->rx_bytes = 0;
+  telemetry->rx_skipped = 0;
+  telemetry->timeouts = 0;
+  telemetry->retries = 0;
+  telemetry->rest_time = 0;
+  telemetry->rtts = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+					   NULL, g_free);
+}
+
+void
+telemetry_clear (struct telemetry *telemetry)
+{
+  if (!telemetry->rtts)
+    {
+      return;
+    }
+
+  g_hash_table_destroy (telemetry->rtts);
+  telemetry->rtts = NULL;
+  g_mutex_clear (&telemetry->mutex);
+}
+
+void
+telemetry_add_tx (struct telemetry *telemetry, guint msgs, guint bytes)
+{
+  g_mutex_lock (&telemetry->mutex);
+  telemetry->tx_msgs += msgs;
+  telemetry->tx_bytes += bytes;
+  g_mutex_unlock (&telemetry->mutex);
+}
+
+void
+telemetry_add_rx (struct telemetry *telemetry, guint msgs, guint bytes)
+{
+  g_mutex_lock (&telemetry->mutex);
+  telemetry->rx_msgs += msgs;
+  telemetry->rx_bytes += bytes;
+  g_mutex_unlock (&telemetry->mutex);
+}
+
+void
+telemetry_add_rx_skipped (struct telemetry *telemetry, guint bytes)
+{
+  g_mutex_lock (&telemetry->mutex);
+  telemetry->rx_skipped += bytes;
+  g_mutex_unlock (&telemetry->mutex);
+}
+
+void
+telemetry_add_timeout (struct telemetry *telemetry)
+{
+  g_mutex_lock (&telemetry->mutex);
+  telemetry->timeouts++;
+  g_mutex_unlock (&telemetry->mutex);
+}
+
+void
+telemetry_add_retry (struct telemetry *telemetry)
+{
+  g_mutex_lock (&telemetry->mutex);
+  telemetry->retries++;
+  g_mutex_unlock (&telemetry->mutex);
+}
+
+void
+telemetry_add_rest (struct telemetry *telemetry, gint64 time)
+{
+  g_mutex_lock (&telemetry->mutex);
+  telemetry->rest_time += time;
+  g_mutex_unlock (&telemetry->mutex);
+}
+
+void
+telemetry_add_rtt (struct telemetry *telemetry, guint type, gint64 rtt)
+{
+  guint i = 0;
+  gint64 v = rtt;
+  struct telemetry_rtt *t;
+
+  while (v > 1 && i < TELEMETRY_RTT_HISTOGRAM_LEN - 1)
+    {
+      v >>= 1;
+      i++;
+    }
+
+  g_mutex_lock (&telemetry->mutex);
+
+  t = g_hash_table_lookup (telemetry->rtts, GUINT_TO_POINTER (type));
+  if (!t)
+    {
+      t = g_new0 (struct telemetry_rtt, 1);
+      g_hash_table_insert (telemetry->rtts, GUINT_TO_POINTER (type), t);
+    }
+
+  t->count++;
+  t->total += rtt;
+  t->max = MAX (t->max, rtt);
+  t->histogram[i]++;
+
+  g_mutex_unlock (&telemetry->mutex);
+}
+
+static gint
+telemetry_compare_types (gconstpointer a, gconstpointer b)
+{
+  return GPOINTER_TO_UINT (a) - GPOINTER_TO_UINT (b);
+}
+
+static gchar *
+telemetry_get_type_name (guint type)
+{
+  if (type == TELEMETRY_MSG_TYPE_SYSEX)
+    {
+      return g_strdup ("sysex");
+    }
+  return g_strdup_printf ("0x%02x", type);
+}
+
+//Must be called with the mutex locked.
+
+static GList *
+telemetry_get_sorted_types (struct telemetry *telemetry)
+{
+  GList *types = g_hash_table_get_keys (telemetry->rtts);
+  return g_list_sort (types, telemetry_compare_types);
+}
+
+gchar *
+telemetry_to_string (struct telemetry *telemetry)
+{
+  GList *types, *l;
+  GString *str = g_string_new (NULL);
+
+  g_mutex_lock (&telemetry->mutex);
+
+  g_string_append_printf (str, "Sent: %" PRIu64 " messages, %" PRIu64
+			  " B\n", telemetry->tx_msgs, telemetry->tx_bytes);
+  g_string_append_printf (str, "Received: %" PRIu64 " messages, %" PRIu64
+			  " B\n", telemetry->rx_msgs, telemetry->rx_bytes);
+  g_string_append_printf (str, "Skipped: %" PRIu64 " B\n",
+			  telemetry->rx_skipped);
+  g_string_append_printf (str, "Timeouts: %" PRIu64 "\n",
+			  telemetry->timeouts);
+  g_string_append_printf (str, "Retries: %" PRIu64 "\n", telemetry->retries);
+  g_string_append_printf (str, "Rest time: %.3f s\n",
+			  telemetry->rest_time / 1000000.0);
+
+  types = telemetry_get_sorted_types (telemetry);
+  for (l = types; l; l = l->next)
+    {
+      struct telemetry_rtt *t = g_hash_table_lookup (telemetry->rtts,
+						     l->data);
+      gchar *name = telemetry_get_type_name (GPOINTER_TO_UINT (l->data));
+
+      g_string_append_printf (str, "RTT %s: %" PRIu64 " requests, %.3f ms"
+			      " average, %.3f ms max\n", name, t->count,
+			      t->total / (t->count * 1000.0),
+			      t->max / 1000.0);
+      for (guint i = 0; i < TELEMETRY_RTT_HISTOGRAM_LEN; i++)
+	{
+	  if (t->histogram[i])
+	    {
+	      //The last bin also counts every longer time.
+	      if (i == TELEMETRY_RTT_HISTOGRAM_LEN - 1)
+		{
+		  g_string_append_printf (str, "  >= %d us: %" PRIu64 "\n",
+					  1 << i, t->histogram[i]);
+		}
+	      else
+		{
+		  g_string_append_printf (str, "  < %d us: %" PRIu64 "\n",
+					  1 << (i + 1), t->histogram[i]);
+		}
+	    }
+	}
+
+      g_free (name);
+    }
+  g_list_free (types);
+
+  g_mutex_unlock (&telemetry->mutex);
+
+  return g_string_free (str, FALSE);
+}
+
+static void
+telemetry_add_member (JsonBuilder *builder, const gchar *name, gint64 v)
+{
+  json_builder_set_member_name (builder, name);
+  json_builder_add_int_value (builder, v);
+}
+
+gchar *
+telemetry_to_json (struct telemetry *telemetry)
+{
+  gchar *json;
+  JsonNode *root;
+  GList *types, *l;
+  JsonGenerator *gen;
+  JsonBuilder *builder = json_builder_new ();
+
+  g_mutex_lock (&telemetry->mutex);
+
+  json_builder_begin_object (builder);
+  telemetry_add_member (builder, "tx_msgs", telemetry->tx_msgs);
+  telemetry_add_member (builder, "tx_bytes", telemetry->tx_bytes);
+  telemetry_add_member (builder, "rx_msgs", telemetry->rx_msgs);
+  telemetry_add_member (builder, "rx_bytes", telemetry->rx_bytes);
+  telemetry_add_member (builder, "rx_skipped", telemetry->rx_skipped);
+  telemetry_add_member (builder, "timeouts", telemetry->timeouts);
+  telemetry_add_member (builder, "retries", telemetry->retries);
+  telemetry_add_member (builder, "rest_time_us", telemetry->rest_time);
+
+  json_builder_set_member_name (builder, "rtts");
+  json_builder_begin_object (builder);
+  types = telemetry_get_sorted_types (telemetry);
+  for (l = types; l; l = l->next)
+    {
+      struct telemetry_rtt *t = g_hash_table_lookup (telemetry->rtts,
+						     l->data);
+      gchar *name = telemetry_get_type_name (GPOINTER_TO_UINT (l->data));
+
+      json_builder_set_member_name (builder, name);
+      json_builder_begin_object (builder);
+      telemetry_add_member (builder, "count", t->count);
+      telemetry_add_member (builder, "total_us", t->total);
+      telemetry_add_member (builder, "max_us", t->max);
+      //The upper limit of the i-th bin is 2^(i+1) us but the last one has none.
+      json_builder_set_member_name (builder, "histogram");
+      json_builder_begin_array (builder);
+      for (guint i = 0; i < TELEMETRY_RTT_HISTOGRAM_LEN; i++)
+	{
+	  json_builder_add_int_value (builder, t->histogram[i]);
+	}
+      json_builder_end_array (builder);
+      json_builder_end_object (builder);
+
+      g_free (name);
+    }
+  g_list_free (types);
+  json_builder_end_object (builder);
+  json_builder_end_object (builder);
+
+  g_mutex_unlock (&telemetry->mutex);
+
+  gen = json_generator_new ();
+  root = json_builder_get_root (builder);
+  json_generator_set_root (gen, root);
+  json_generator_set_pretty (gen, TRUE);
+  json = json_generator_to_data (gen, NULL);
+
+  json_node_free (root);
+  g_object_unref (gen);
+  g_object_unref (builder);
+
+  return json;
+}
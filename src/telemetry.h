@@ -0,0 +1,78 @@
+/*
+ *   telemetry.h
+ *   Copyright (C) 2024 David García Goñi <dagargo@gmail.com>
+ *
+ *   This file is part of Elektroid.
+ *
+ *   Elektroid is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Elektroid is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Elektroid. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include "utils.h"
+
+#define TELEMETRY_RTT_HISTOGRAM_LEN 24
+//Connectors use the values below this to identify their own message types.
+#define TELEMETRY_MSG_TYPE_SYSEX 0x100
+
+#define TELEMETRY_ENV_FILE "ELEKTROID_STATS_FILE"
+
+//Request and response round trip times in powers of 2 of us.
+struct telemetry_rtt
+{
+  guint64 count;
+  gint64 total;
+  gint64 max;
+  guint64 histogram[TELEMETRY_RTT_HISTOGRAM_LEN];
+};
+
+//Transport counters of a backend. Every function is synchronized so the counters can be read while transferring.
+struct telemetry
+{
+  GMutex mutex;
+  guint64 tx_msgs;
+  guint64 tx_bytes;
+  guint64 rx_msgs;
+  guint64 rx_bytes;
+  guint64 rx_skipped;		//Non SysEx bytes discarded.
+  guint64 timeouts;
+  guint64 retries;
+  gint64 rest_time;		//Measured in us.
+  GHashTable *rtts;		//Message type to struct telemetry_rtt.
+};
+
+void telemetry_init (struct telemetry *telemetry);
+
+void telemetry_clear (struct telemetry *telemetry);
+
+void telemetry_add_tx (struct telemetry *telemetry, guint msgs, guint bytes);
+
+void telemetry_add_rx (struct telemetry *telemetry, guint msgs, guint bytes);
+
+void telemetry_add_rx_skipped (struct telemetry *telemetry, guint bytes);
+
+void telemetry_add_timeout (struct telemetry *telemetry);
+
+void telemetry_add_retry (struct telemetry *telemetry);
+
+void telemetry_add_rest (struct telemetry *telemetry, gint64 time);
+
+void telemetry_add_rtt (struct telemetry *telemetry, guint type, gint64 rtt);
+
+gchar *telemetry_to_string (struct telemetry *telemetry);
+
+gchar *telemetry_to_json (struct telemetry *telemetry);
+
+#endif
@@ -36,81 +36,52 @@
 
 gint debug_level;
 
-static guint
-get_max_message_length (guint msg_len)
-{
-  guint len;
-
-  if (debug_level >= DEBUG_FULL_HEX_THRES)
-    {
-      len = msg_len;
-    }
-  else
-    {
-      len = msg_len > DEBUG_SHORT_HEX_LEN ? DEBUG_SHORT_HEX_LEN : msg_len;
-    }
-
-  return len;
-}
+static const gchar HEX_DIGITS[] = "0123456789abcdef";
 
 gchar *
 debug_get_hex_data (gint level, guint8 *data, guint len)
 {
-  gint i;
   guint8 *b;
   guint size;
   guint bytes_shown;
-  guint extra;
+  gboolean ellipsis;
   gchar *str;
   gchar *next;
 
-  if (level >= DEBUG_FULL_HEX_THRES)
-    {
-      bytes_shown = len;
-      extra = 0;
-    }
-  else
-    {
-      if (len > DEBUG_SHORT_HEX_LEN)
-	{
-	  bytes_shown = DEBUG_SHORT_HEX_LEN;
-	  extra = 3;
-	}
-      else
-	{
-	  bytes_shown = len;
-	  extra = 0;
-	}
-    }
-  size = bytes_shown * 3 + extra;
-  if (!size)
+  if (!len)
     {
       return NULL;
     }
 
-  str = g_malloc (sizeof (char) * size);
-  b = data;
-  next = str;
+  ellipsis = level < DEBUG_FULL_HEX_THRES && len > DEBUG_SHORT_HEX_LEN;
+  bytes_shown = ellipsis ? DEBUG_SHORT_HEX_LEN : len;
 
-  sprintf (next, "%02x", *b);
-  next += 2;
-  b++;
+  //Every byte takes 2 digits and a separator but the first byte has no separator and there is a terminating NUL character.
+  size = bytes_shown * 3 + (ellipsis ? 3 : 0);
+  str = g_malloc (size);
+  next = str;
+  b = data;
 
-  i = 1;
-  while (i < get_max_message_length (len))
+  for (guint i = 0; i < bytes_shown; i++, b++)
     {
-      sprintf (next, " %02x", *b);
-      next += 3;
-      b++;
-      i++;
+      if (i)
+	{
+	  *next = ' ';
+	  next++;
+	}
+      next[0] = HEX_DIGITS[*b >> 4];
+      next[1] = HEX_DIGITS[*b & 0xf];
+      next += 2;
     }
 
-  if (level < DEBUG_FULL_HEX_THRES && len > DEBUG_SHORT_HEX_LEN)
+  if (ellipsis)
     {
-      sprintf (next, "...");
+      memcpy (next, "...", 3);
       next += 3;
     }
 
+  *next = 0;
+
   return str;
 }
 
@@ -317,14 +288,15 @@ end:
   return res;
 }
 
-gint
-file_save_data (const gchar *path, const guint8 *data, ssize_t len)
+static gint
+file_write_data (const gchar *path, const guint8 *data, ssize_t len,
+		 const gchar *mode)
 {
   gint res;
   size_t bytes;
   FILE *file;
 
-  file = fopen (path, "wb");
+  file = fopen (path, mode);
 
   if (!file)
     {
@@ -350,6 +322,18 @@ file_save_data (const gchar *path, const guint8 *data, ssize_t len)
   return res;
 }
 
+gint
+file_save_data (const gchar *path, const guint8 *data, ssize_t len)
+{
+  return file_write_data (path, data, len, "wb");
+}
+
+gint
+file_append_data (const gchar *path, const guint8 *data, ssize_t len)
+{
+  return file_write_data (path, data, len, "ab");
+}
+
 gint
 file_save (const gchar *path, struct idata *idata,
 	   struct task_control *control)
@@ -892,3 +876,102 @@ tags_add (GHashTable *set, GHashTable *other)
     }
   g_list_free (tags);
 }
+
+struct parallel_for_data
+{
+  parallel_for_func func;
+  gpointer data;
+  gint len;
+  gint next;
+  gint running;
+  GMutex mutex;
+  GCond cond;
+};
+
+static GThreadPool *parallel_for_pool;
+static GPrivate parallel_for_worker;
+
+static void
+parallel_for_run (struct parallel_for_data *pfd)
+{
+  gint i;
+
+  while ((i = g_atomic_int_add (&pfd->next, 1)) < pfd->len)
+    {
+      pfd->func (pfd->data, i);
+    }
+}
+
+static void
+parallel_for_run_worker (gpointer data, gpointer user_data)
+{
+  struct parallel_for_data *pfd = data;
+
+  g_private_set (&parallel_for_worker, GINT_TO_POINTER (TRUE));
+
+  parallel_for_run (pfd);
+
+  g_mutex_lock (&pfd->mutex);
+  pfd->running--;
+  g_cond_signal (&pfd->cond);
+  g_mutex_unlock (&pfd->mutex);
+}
+
+void
+parallel_for (parallel_for_func func, gpointer data, gint len)
+{
+  gint workers;
+  guint threads;
+  static gsize init = 0;
+  struct parallel_for_data pfd;
+
+  if (g_once_init_enter (&init))
+    {
+      //The caller thread is the remaining one.
+      threads = g_get_num_processors () - 1;
+      if (threads)
+	{
+	  parallel_for_pool = g_thread_pool_new (parallel_for_run_worker,
+						 NULL, threads, FALSE, NULL);
+	}
+      debug_print (1, "Using %d threads for parallel loops", threads + 1);
+      g_once_init_leave (&init, 1);
+    }
+
+  workers = parallel_for_pool ?
+    MIN (len - 1, g_thread_pool_get_max_threads (parallel_for_pool)) : 0;
+
+  if (workers <= 0 || g_private_get (&parallel_for_worker))
+    {
+      for (gint i = 0; i < len; i++)
+	{
+	  func (data, i);
+	}
+      return;
+    }
+
+  pfd.func = func;
+  pfd.data = data;
+  pfd.len = len;
+  pfd.next = 0;
+  pfd.running = workers;
+  g_mutex_init (&pfd.mutex);
+  g_cond_init (&pfd.cond);
+
+  for (gint i = 0; i < workers; i++)
+    {
+      g_thread_pool_push (parallel_for_pool, &pfd, NULL);
+    }
+
+  parallel_for_run (&pfd);
+
+  g_mutex_lock (&pfd.mutex);
+  while (pfd.running)
+    {
+      g_cond_wait (&pfd.cond, &pfd.mutex);
+    }
+  g_mutex_unlock (&pfd.mutex);
+
+  g_cond_clear (&pfd.cond);
+  g_mutex_clear (&pfd.mutex);
+}
@@ -29,6 +29,7 @@
 #include "../config.h"
 
 #define CONF_DIR "/.config/" PACKAGE
+#define CACHE_DIR "/.cache/" PACKAGE
 
 #define APP_NAME "Elektroid"
 
@@ -48,13 +49,32 @@
 
 #define CONTROLLABLE_IS_NULL_OR_ACTIVE(c) (!c || controllable_is_active(c))
 
+//Debug levels greater than or equal to DEBUG_STRIP_LEVEL are removed at compile time.
+#ifndef DEBUG_STRIP_LEVEL
+#define DEBUG_STRIP_LEVEL G_MAXINT
+#endif
+
+#define debug_enabled(level) ((level) < DEBUG_STRIP_LEVEL && (level) <= debug_level)
+
 #define debug_print(level, format, ...) {\
-  if (level <= debug_level) \
+  if (debug_enabled (level)) \
     { \
       fprintf(stderr, "DEBUG:" __FILE__ ":%d:%s: " format "\n", __LINE__, __FUNCTION__, ## __VA_ARGS__); \
     } \
 }
 
+//The hex dump is only built if the level is enabled. The format must end with a "%s" conversion for it.
+#define debug_print_hex(level, data, len, format, ...) {\
+  if (debug_enabled (level)) \
+    { \
+      gchar *debug_hex = debug_get_hex_data (debug_level, (guint8 *) (data), len); \
+      fprintf(stderr, "DEBUG:" __FILE__ ":%d:%s: " format "\n", __LINE__, __FUNCTION__, ## __VA_ARGS__, debug_hex ? debug_hex : ""); \
+      g_free (debug_hex); \
+    } \
+}
+
+#define debug_print_hex_msg(level, msg, format, ...) debug_print_hex(level, (msg)->data, (msg)->len, format, ## __VA_ARGS__)
+
 #define color_print(title, color, format, ...) { \
   gboolean tty = isatty(fileno(stderr)); \
   fprintf(stderr, "%s%s:" __FILE__ ":%d:%s: " format "%s\n", tty ? color : "", title, __LINE__, __FUNCTION__, ## __VA_ARGS__, tty ? "\x1b[m" : ""); \
@@ -153,6 +173,9 @@ gint file_save (const char *path, struct idata *idata,
 
 gint file_save_data (const gchar * path, const guint8 * data, ssize_t len);
 
+gint file_append_data (const gchar * path, const guint8 * data,
+		       ssize_t len);
+
 gchar *get_human_size (gint64, gboolean);
 
 void task_control_set_progress_no_sync (struct task_control *control,
@@ -234,4 +257,10 @@ GHashTable *ikey_format_to_tags (const gchar * text);
 
 void tags_add (GHashTable * set, GHashTable * other);
 
+typedef void (*parallel_for_func) (gpointer data, gint index);
+
+//Calls func for every index in [0, len) using a shared pool of threads and returns when all the calls have finished.
+//The caller thread takes part too. Nested calls from the workers run sequentially.
+void parallel_for (parallel_for_func func, gpointer data, gint len);
+
 #endif
@@ -0,0 +1,159 @@
+#include <stdio.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <glib/gstdio.h>
+#include "../src/connector.h"
+
+#define BENCH_FILES 100000
+
+//This is the item as it was before the strings were moved to the heap or an arena. It is kept here as the reference.
+
+struct bench_legacy_item
+{
+  enum item_type type;
+  gchar name[PATH_MAX];
+  gint32 id;
+  gint64 size;
+  struct sample_info sample_info;
+  gchar object_info[PATH_MAX];
+};
+
+struct bench_legacy_iterator
+{
+  GDir *dir;
+  struct bench_legacy_item item;
+};
+
+static gint
+bench_next_dentry (struct item_iterator *iter)
+{
+  const gchar *name;
+  GDir *dir = iter->data;
+
+  if (!(name = g_dir_read_name (dir)))
+    {
+      return -ENOENT;
+    }
+
+  item_set_name (&iter->item, "%s", name);
+  iter->item.type = ITEM_TYPE_FILE;
+  iter->item.size = 0;
+  iter->item.id = -1;
+
+  return 0;
+}
+
+//Every listed item is kept as the browser and the CLI did.
+
+static void
+bench_list_legacy (const gchar *path)
+{
+  const gchar *name;
+  struct bench_legacy_iterator iter;
+  GArray *items = g_array_new (FALSE, FALSE,
+			       sizeof (struct bench_legacy_item));
+
+  iter.dir = g_dir_open (path, 0, NULL);
+  while ((name = g_dir_read_name (iter.dir)))
+    {
+      snprintf (iter.item.name, PATH_MAX, "%s", name);
+      iter.item.type = ITEM_TYPE_FILE;
+      iter.item.size = 0;
+      iter.item.id = -1;
+      iter.item.object_info[0] = 0;
+      g_array_append_val (items, iter.item);
+    }
+  g_dir_close (iter.dir);
+
+  printf ("%d items\n", items->len);
+  g_array_free (items, TRUE);
+}
+
+static void
+bench_list (const gchar *path)
+{
+  struct item_iterator iter;
+  GArray *items = g_array_new (FALSE, FALSE, sizeof (struct item));
+
+  item_iterator_init (&iter, path, g_dir_open (path, 0, NULL),
+		      bench_next_dentry, (iterator_free) g_dir_close);
+  while (!item_iterator_next (&iter))
+    {
+      g_array_append_val (items, iter.item);
+    }
+
+  printf ("%d items\n", items->len);
+  item_iterator_free (&iter);
+  g_array_free (items, TRUE);
+}
+
+//Every case runs in its own process so that the maximum RSS is not shared.
+
+static void
+bench_run (const gchar *name, void (*list) (const gchar *),
+	   const gchar *path)
+{
+  gint64 start;
+  pid_t pid;
+  struct rusage usage;
+
+  pid = fork ();
+  if (pid < 0)
+    {
+      error_print ("Error while forking");
+      return;
+    }
+
+  if (!pid)
+    {
+      start = g_get_monotonic_time ();
+      list (path);
+      getrusage (RUSAGE_SELF, &usage);
+      printf ("%-24s %10.3f ms %10ld KiB max RSS\n", name,
+	      (g_get_monotonic_time () - start) / 1000.0, usage.ru_maxrss);
+      exit (0);
+    }
+
+  waitpid (pid, NULL, 0);
+}
+
+gint
+main (gint argc, gchar *argv[])
+{
+  gchar *dir, *path, name[LABEL_MAX];
+
+  dir = g_dir_make_tmp ("elektroid-bench-item-XXXXXX", NULL);
+  if (!dir)
+    {
+      return 1;
+    }
+
+  printf ("Creating %d files in %s...\n", BENCH_FILES, dir);
+
+  for (gint i = 0; i < BENCH_FILES; i++)
+    {
+      snprintf (name, LABEL_MAX, "sample %06d.wav", i);
+      path = g_build_filename (dir, name, NULL);
+      g_file_set_contents (path, "", 0, NULL);
+      g_free (path);
+    }
+
+  printf ("Listing %d files\n", BENCH_FILES);
+
+  bench_run ("Legacy items", bench_list_legacy, dir);
+  bench_run ("Arena items", bench_list, dir);
+
+  for (gint i = 0; i < BENCH_FILES; i++)
+    {
+      snprintf (name, LABEL_MAX, "sample %06d.wav", i);
+      path = g_build_filename (dir, name, NULL);
+      g_unlink (path);
+      g_free (path);
+    }
+  g_rmdir (dir);
+  g_free (dir);
+
+  return 0;
+}
@@ -0,0 +1,77 @@
+#include <stdio.h>
+#include "../src/sysex_codec.h"
+#include "../src/utils.h"
+
+#define BENCH_MSG_LEN (64 * KI)
+#define BENCH_ITERATIONS 2000
+
+static const gchar *BENCH_LAYOUTS[] = { "MSB first", "LSB first" };
+
+static void
+bench_print_result (const gchar *kernel, const gchar *layout,
+		    const gchar *op, gint64 start)
+{
+  gint64 elapsed = g_get_monotonic_time () - start;
+  gdouble bytes = BENCH_MSG_LEN * (gdouble) BENCH_ITERATIONS;
+  printf ("%-8s %-10s %-8s %10.1f MiB/s\n", kernel, layout, op,
+	  bytes / elapsed * 1e6 / MI);
+}
+
+gint
+main (gint argc, gchar *argv[])
+{
+  gint64 start;
+  const gchar *name;
+  guint8 *src = g_malloc (BENCH_MSG_LEN);
+  guint8 *encoded = g_malloc (sysex_codec_get_encoded_len (BENCH_MSG_LEN));
+  guint8 *decoded = g_malloc (BENCH_MSG_LEN);
+  guint encoded_len = sysex_codec_get_encoded_len (BENCH_MSG_LEN);
+
+  for (guint i = 0; i < BENCH_MSG_LEN; i++)
+    {
+      src[i] = g_random_int () & 0xff;
+    }
+
+  printf ("SysEx codec throughput for a %d B message\n", BENCH_MSG_LEN);
+
+  for (gint kernel = SYSEX_CODEC_KERNEL_SCALAR;
+       kernel < SYSEX_CODEC_KERNEL_AUTO; kernel++)
+    {
+      if (sysex_codec_set_kernel (kernel))
+	{
+	  continue;
+	}
+
+      name = sysex_codec_get_kernel_name ();
+
+      for (gint layout = SYSEX_CODEC_MSB_FIRST;
+	   layout <= SYSEX_CODEC_LSB_FIRST; layout++)
+	{
+	  start = g_get_monotonic_time ();
+	  for (guint i = 0; i < BENCH_ITERATIONS; i++)
+	    {
+	      sysex_codec_encode (src, BENCH_MSG_LEN, encoded, layout);
+	    }
+	  bench_print_result (name, BENCH_LAYOUTS[layout], "encode", start);
+
+	  start = g_get_monotonic_time ();
+	  for (guint i = 0; i < BENCH_ITERATIONS; i++)
+	    {
+	      sysex_codec_decode (encoded, encoded_len, decoded, layout);
+	    }
+	  bench_print_result (name, BENCH_LAYOUTS[layout], "decode", start);
+
+	  if (memcmp (src, decoded, BENCH_MSG_LEN))
+	    {
+	      fprintf (stderr, "Round trip failed\n");
+	      return EXIT_FAILURE;
+	    }
+	}
+    }
+
+  g_free (src);
+  g_free (encoded);
+  g_free (decoded);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,110 @@
+#include <stdio.h>
+#include "../src/utils.h"
+
+#define BENCH_MSG_LEN (4 * KI)
+#define BENCH_ITERATIONS 10000
+
+//This is the hex dump as it was done before the formatting was deferred. It is kept here as the reference.
+
+static gchar *
+bench_legacy_get_hex_data (gint level, guint8 *data, guint len)
+{
+  guint8 *b;
+  guint size, bytes_shown, extra;
+  gchar *str, *next;
+
+  if (level >= 5)
+    {
+      bytes_shown = len;
+      extra = 0;
+    }
+  else
+    {
+      bytes_shown = len > 64 ? 64 : len;
+      extra = len > 64 ? 3 : 0;
+    }
+
+  size = bytes_shown * 3 + extra;
+  str = g_malloc (size);
+  b = data;
+  next = str;
+
+  sprintf (next, "%02x", *b);
+  next += 2;
+  b++;
+
+  for (guint i = 1; i < bytes_shown; i++, b++)
+    {
+      sprintf (next, " %02x", *b);
+      next += 3;
+    }
+
+  if (extra)
+    {
+      sprintf (next, "...");
+    }
+
+  return str;
+}
+
+static void
+bench_print_result (const gchar *name, gint64 start)
+{
+  gint64 elapsed = g_get_monotonic_time () - start;
+  printf ("%-48s %10.3f us/msg\n", name,
+	  elapsed / (gdouble) BENCH_ITERATIONS);
+}
+
+gint
+main (gint argc, gchar *argv[])
+{
+  gint64 start;
+  gchar *text;
+  GByteArray *msg = g_byte_array_sized_new (BENCH_MSG_LEN);
+
+  msg->len = BENCH_MSG_LEN;
+  for (guint i = 0; i < BENCH_MSG_LEN; i++)
+    {
+      msg->data[i] = i;
+    }
+
+  printf ("Debug logging cost for a %d B message\n", BENCH_MSG_LEN);
+
+  debug_level = 0;
+
+  start = g_get_monotonic_time ();
+  for (guint i = 0; i < BENCH_ITERATIONS; i++)
+    {
+      text = bench_legacy_get_hex_data (debug_level, msg->data, msg->len);
+      debug_print (1, "Message sent (%d): %s", msg->len, text);
+      g_free (text);
+    }
+  bench_print_result ("Level 0, eager hex dump (before)", start);
+
+  start = g_get_monotonic_time ();
+  for (guint i = 0; i < BENCH_ITERATIONS; i++)
+    {
+      debug_print_hex_msg (1, msg, "Message sent (%d): %s", msg->len);
+    }
+  bench_print_result ("Level 0, deferred hex dump (after)", start);
+
+  start = g_get_monotonic_time ();
+  for (guint i = 0; i < BENCH_ITERATIONS; i++)
+    {
+      text = bench_legacy_get_hex_data (5, msg->data, msg->len);
+      g_free (text);
+    }
+  bench_print_result ("Full hex dump, sprintf encoder (before)", start);
+
+  start = g_get_monotonic_time ();
+  for (guint i = 0; i < BENCH_ITERATIONS; i++)
+    {
+      text = debug_get_hex_data (5, msg->data, msg->len);
+      g_free (text);
+    }
+  bench_print_result ("Full hex dump, table encoder (after)", start);
+
+  g_byte_array_free (msg, TRUE);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,110 @@
+#include <stdio.h>
+#include <math.h>
+#include "../src/connectors/volca_sample_sdk/korg_syro_volcasample.h"
+#include "../src/connectors/volca_sample_sdk/korg_syro_comp.h"
+#include "../src/utils.h"
+
+#define BENCH_KIT_SAMPLES 100
+#define BENCH_SAMPLE_FRAMES 31250	//1 s at the device rate
+#define BENCH_QUALITY 16
+
+struct bench_kit
+{
+  guint8 *samples[BENCH_KIT_SAMPLES];
+  guint8 *comp[BENCH_KIT_SAMPLES];
+  guint32 comp_len[BENCH_KIT_SAMPLES];
+};
+
+//Decaying tones with some noise compress like real drum hits do.
+
+static guint8 *
+bench_get_sample (gint index)
+{
+  gint16 *sample = g_malloc (BENCH_SAMPLE_FRAMES * sizeof (gint16));
+  gdouble freq = 40.0 + index * 20.0;
+  gdouble decay = 2.0 + (index % 10);
+
+  for (guint i = 0; i < BENCH_SAMPLE_FRAMES; i++)
+    {
+      gdouble t = i / (gdouble) BENCH_SAMPLE_FRAMES;
+      gdouble v = sin (2 * M_PI * freq * t) * exp (-decay * t) * 30000;
+      v += g_random_double_range (-64, 64);
+      sample[i] = GINT16_TO_LE ((gint16) v);
+    }
+
+  return (guint8 *) sample;
+}
+
+static gint64
+bench_compress (struct bench_kit *kit, SyroComp_ParallelFor pfor)
+{
+  gint64 start;
+
+  SyroComp_SetParallelFor (pfor);
+
+  start = g_get_monotonic_time ();
+  for (guint i = 0; i < BENCH_KIT_SAMPLES; i++)
+    {
+      kit->comp_len[i] = SyroComp_GetCompSize (kit->samples[i],
+					       BENCH_SAMPLE_FRAMES,
+					       BENCH_QUALITY, LittleEndian);
+      kit->comp[i] = g_malloc0 (kit->comp_len[i]);
+      SyroComp_Comp (kit->samples[i], kit->comp[i], BENCH_SAMPLE_FRAMES,
+		     BENCH_QUALITY, LittleEndian);
+    }
+
+  return g_get_monotonic_time () - start;
+}
+
+static void
+bench_free_comp (struct bench_kit *kit)
+{
+  for (guint i = 0; i < BENCH_KIT_SAMPLES; i++)
+    {
+      g_free (kit->comp[i]);
+    }
+}
+
+gint
+main (gint argc, gchar *argv[])
+{
+  gint err = EXIT_SUCCESS;
+  gint64 seq_time, par_time;
+  struct bench_kit seq, par;
+
+  for (guint i = 0; i < BENCH_KIT_SAMPLES; i++)
+    {
+      seq.samples[i] = bench_get_sample (i);
+      par.samples[i] = seq.samples[i];
+    }
+
+  printf ("Syro compression of a %d sample kit (%d frames each) on %d cores\n",
+	  BENCH_KIT_SAMPLES, BENCH_SAMPLE_FRAMES, g_get_num_processors ());
+
+  seq_time = bench_compress (&seq, NULL);
+  par_time = bench_compress (&par, parallel_for);
+
+  printf ("%-10s %10.1f ms\n", "sequential", seq_time / 1000.0);
+  printf ("%-10s %10.1f ms (%.2fx)\n", "parallel", par_time / 1000.0,
+	  seq_time / (gdouble) par_time);
+
+  for (guint i = 0; i < BENCH_KIT_SAMPLES; i++)
+    {
+      if (seq.comp_len[i] != par.comp_len[i] ||
+	  memcmp (seq.comp[i], par.comp[i], seq.comp_len[i]))
+	{
+	  fprintf (stderr, "Compressed data differs for sample %d\n", i);
+	  err = EXIT_FAILURE;
+	  break;
+	}
+    }
+
+  bench_free_comp (&seq);
+  bench_free_comp (&par);
+  for (guint i = 0; i < BENCH_KIT_SAMPLES; i++)
+    {
+      g_free (seq.samples[i]);
+    }
+
+  return err;
+}
@@ -0,0 +1,347 @@
+#include <CUnit/CUnit.h>
+#include <CUnit/Basic.h>
+#include <sndfile.h>
+#include <unistd.h>
+#include "../src/audio.h"
+#include "../src/preferences.h"
+#include "../src/utils.h"
+
+//With this rate, the stream holds 2000 frames and the playback starts with 1000.
+#define TEST_RATE 1000
+#define TEST_PERIOD_FRAMES 50
+#define TEST_FRAMES 5000
+
+//The audio backend is replaced by a consumer thread that behaves like the audio callbacks.
+
+static GThread *consumer_thread;
+static gboolean consumer_running;
+static guint consumer_sleep_us;
+static gint16 received[TEST_FRAMES];
+static guint received_frames;
+static guint received_mismatches;	//Frames with different channels
+
+void
+audio_stop_playback ()
+{
+  g_mutex_lock (&audio.control.controllable.mutex);
+  if (audio.status == AUDIO_STATUS_PLAYING)
+    {
+      audio.status = AUDIO_STATUS_STOPPED;
+    }
+  g_mutex_unlock (&audio.control.controllable.mutex);
+}
+
+void
+audio_start_playback (audio_playback_cursor_notifier cursor_notifier)
+{
+  audio_stop_playback ();
+  audio_prepare (AUDIO_STATUS_PREPARING_PLAYBACK);
+}
+
+void
+audio_stop_recording ()
+{
+}
+
+void
+audio_start_recording (guint options, audio_monitor_notifier notifier,
+		       void *data)
+{
+}
+
+void
+audio_init_int ()
+{
+#if defined(ELEKTROID_RTAUDIO)
+  audio.volume = 1.0;
+#endif
+  audio.rate = TEST_RATE;
+}
+
+void
+audio_destroy_int ()
+{
+}
+
+gboolean
+audio_check ()
+{
+  return TRUE;
+}
+
+void
+audio_set_volume (gdouble volume)
+{
+}
+
+const gchar *
+audio_name ()
+{
+  return "Test";
+}
+
+const gchar *
+audio_version ()
+{
+  return "0";
+}
+
+static gpointer
+test_consumer (gpointer data)
+{
+  gboolean playing;
+  gint16 buffer[TEST_PERIOD_FRAMES * AUDIO_CHANNELS];
+
+  while (g_atomic_int_get (&consumer_running))
+    {
+      g_mutex_lock (&audio.control.controllable.mutex);
+      playing = audio.status == AUDIO_STATUS_PREPARING_PLAYBACK ||
+	audio.status == AUDIO_STATUS_PLAYING;
+      g_mutex_unlock (&audio.control.controllable.mutex);
+
+      if (playing)
+	{
+	  audio_write_to_output (buffer, TEST_PERIOD_FRAMES);
+	  //The silence is not part of the stream.
+	  for (gint i = 0; i < TEST_PERIOD_FRAMES; i++)
+	    {
+	      if (buffer[i * AUDIO_CHANNELS]
+		  && received_frames < TEST_FRAMES)
+		{
+		  received[received_frames] = buffer[i * AUDIO_CHANNELS];
+		  if (buffer[i * AUDIO_CHANNELS + 1] !=
+		      received[received_frames])
+		    {
+		      received_mismatches++;
+		    }
+		  received_frames++;
+		}
+	    }
+	}
+
+      usleep (consumer_sleep_us);
+    }
+
+  return NULL;
+}
+
+static void
+test_start_consumer (guint sleep_us)
+{
+  received_frames = 0;
+  received_mismatches = 0;
+  consumer_sleep_us = sleep_us;
+  g_atomic_int_set (&consumer_running, TRUE);
+  consumer_thread = g_thread_new ("consumer", test_consumer, NULL);
+}
+
+static void
+test_stop_consumer ()
+{
+  g_atomic_int_set (&consumer_running, FALSE);
+  g_thread_join (consumer_thread);
+}
+
+static gint
+test_write_ramp (struct audio_stream *stream, gint16 first, guint frames,
+		 struct task_control *control)
+{
+  gint err;
+  gint16 *data = g_malloc (frames * AUDIO_CHANNELS * sizeof (gint16));
+
+  for (guint i = 0; i < frames; i++)
+    {
+      data[i * AUDIO_CHANNELS] = first + i;
+      data[i * AUDIO_CHANNELS + 1] = first + i;
+    }
+
+  err = audio_stream_write (stream, data, frames, control);
+  g_free (data);
+
+  return err;
+}
+
+static void
+test_stream ()
+{
+  gint err;
+  struct audio_stream stream;
+  struct task_control control;
+
+  printf ("\n");
+
+  controllable_init (&control.controllable);
+  control.callback = NULL;
+  control.parts = 1;
+  control.part = 0;
+
+  //A slow consumer makes the producer wait for free space.
+  test_start_consumer (2000);
+
+  audio_stream_init (&stream, TEST_FRAMES);
+  CU_ASSERT_EQUAL (stream.capacity, 2 * TEST_RATE);
+  CU_ASSERT_EQUAL (stream.prefill, TEST_RATE);
+
+  err = test_write_ramp (&stream, 1, stream.prefill - 1, &control);
+  CU_ASSERT_EQUAL (err, 0);
+  CU_ASSERT_FALSE (stream.started);
+  CU_ASSERT_PTR_NULL (audio.stream);
+
+  //The playback starts once the prefill is reached.
+  err = test_write_ramp (&stream, stream.prefill, 1, &control);
+  CU_ASSERT_EQUAL (err, 0);
+  CU_ASSERT_TRUE (stream.started);
+  CU_ASSERT_PTR_EQUAL (audio.stream, &stream);
+
+  //The ring buffer wraps around several times.
+  for (guint i = stream.prefill + 1; i <= TEST_FRAMES; i += 300)
+    {
+      err = test_write_ramp (&stream, i, MIN (300, TEST_FRAMES - i + 1),
+			     &control);
+      CU_ASSERT_EQUAL (err, 0);
+    }
+
+  err = audio_stream_end (&stream, &control);
+  CU_ASSERT_EQUAL (err, 0);
+  CU_ASSERT_PTR_NULL (audio.stream);
+
+  test_stop_consumer ();
+
+  CU_ASSERT_EQUAL (received_frames, TEST_FRAMES);
+  CU_ASSERT_EQUAL (received_mismatches, 0);
+  for (guint i = 0; i < received_frames; i++)
+    {
+      CU_ASSERT_EQUAL (received[i], i + 1);
+    }
+
+  controllable_clear (&control.controllable);
+}
+
+static void
+test_stream_short ()
+{
+  gint err;
+  struct audio_stream stream;
+
+  printf ("\n");
+
+  test_start_consumer (0);
+
+  //Streams shorter than the prefill start when closed.
+  audio_stream_init (&stream, 100);
+  err = test_write_ramp (&stream, 1, 100, NULL);
+  CU_ASSERT_EQUAL (err, 0);
+  CU_ASSERT_FALSE (stream.started);
+
+  err = audio_stream_end (&stream, NULL);
+  CU_ASSERT_EQUAL (err, 0);
+
+  test_stop_consumer ();
+
+  CU_ASSERT_EQUAL (received_frames, 100);
+}
+
+static void
+test_stream_underrun ()
+{
+  gint err;
+  struct audio_stream stream;
+
+  printf ("\n");
+
+  //The consumer runs out of frames while the producer is sleeping.
+  test_start_consumer (0);
+
+  audio_stream_init (&stream, 2 * TEST_RATE);
+  err = test_write_ramp (&stream, 1, TEST_RATE, NULL);
+  CU_ASSERT_EQUAL (err, 0);
+  CU_ASSERT_TRUE (stream.started);
+
+  usleep (200000);
+
+  err = test_write_ramp (&stream, TEST_RATE + 1, TEST_RATE, NULL);
+  CU_ASSERT_EQUAL (err, 0);
+
+  err = audio_stream_end (&stream, NULL);
+  CU_ASSERT_EQUAL (err, -EIO);
+
+  test_stop_consumer ();
+}
+
+static void
+test_stream_detached ()
+{
+  gint err;
+  struct audio_stream stream;
+
+  printf ("\n");
+
+  //No frames are consumed so the producer waits until the stream is detached.
+  audio_stream_init (&stream, 4 * TEST_RATE);
+  err = test_write_ramp (&stream, 1, 2 * TEST_RATE, NULL);
+  CU_ASSERT_EQUAL (err, 0);
+  CU_ASSERT_TRUE (stream.started);
+
+  audio_reset_sample ();
+  CU_ASSERT_TRUE (stream.detached);
+
+  err = test_write_ramp (&stream, 1, TEST_RATE, NULL);
+  CU_ASSERT_EQUAL (err, -EIO);
+
+  audio_stream_end (&stream, NULL);
+  CU_ASSERT_PTR_NULL (audio.stream);
+}
+
+gint
+main (gint argc, gchar *argv[])
+{
+  gint err = 0;
+
+  preferences_hashtable = g_hash_table_new_full (g_str_hash, g_str_equal,
+						 NULL, g_free);
+  preferences_set_boolean (PREF_KEY_AUDIO_USE_FLOAT, FALSE);
+  preferences_set_int (PREF_KEY_AUDIO_BUFFER_LEN, TEST_PERIOD_FRAMES);
+
+  audio_init (NULL, NULL);
+
+  if (CU_initialize_registry () != CUE_SUCCESS)
+    {
+      goto cleanup;
+    }
+  CU_pSuite suite = CU_add_suite ("Elektroid audio stream tests", 0, 0);
+  if (!suite)
+    {
+      goto cleanup;
+    }
+
+  if (!CU_add_test (suite, "stream", test_stream))
+    {
+      goto cleanup;
+    }
+
+  if (!CU_add_test (suite, "stream_short", test_stream_short))
+    {
+      goto cleanup;
+    }
+
+  if (!CU_add_test (suite, "stream_underrun", test_stream_underrun))
+    {
+      goto cleanup;
+    }
+
+  if (!CU_add_test (suite, "stream_detached", test_stream_detached))
+    {
+      goto cleanup;
+    }
+
+  CU_basic_set_mode (CU_BRM_VERBOSE);
+
+  CU_basic_run_tests ();
+  err = CU_get_number_of_tests_failed ();
+
+cleanup:
+  CU_cleanup_registry ();
+  audio_destroy ();
+  g_hash_table_destroy (preferences_hashtable);
+  return err || CU_get_error ();
+}
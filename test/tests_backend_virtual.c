@@ -0,0 +1,598 @@
+#include <CUnit/CUnit.h>
+#include <CUnit/Basic.h>
+#include <glib/gstdio.h>
+#include "../src/backend.h"
+#include "../src/preferences.h"
+#include "../src/connectors/elektron.h"
+#include "../src/connectors/microfreak.h"
+#include "../src/connectors/sds.h"
+
+#define SAMPLE_FRAMES 1000
+#define RAW_LEN 20000
+
+gint microfreak_serialize_preset (GByteArray * output,
+				  struct microfreak_preset *mfp);
+
+gint microfreak_deserialize_preset (struct microfreak_preset *mfp,
+				    GByteArray * input);
+
+static struct backend backend;
+
+static gint
+connect_virtual_device (gint model, const gchar *conn_name)
+{
+  struct backend_device device;
+
+  device.type = BE_TYPE_MIDI;
+  snprintf (device.id, LABEL_MAX, "virtual:%d", model);
+  snprintf (device.name, LABEL_MAX, "virtual:%d", model);
+
+  memset (&backend, 0, sizeof (struct backend));
+  return backend_init_connector (&backend, &device, conn_name, NULL);
+}
+
+static void
+init_task_control (struct task_control *control)
+{
+  controllable_init (&control->controllable);
+  control->callback = NULL;
+  control->parts = 0;
+  control->part = 0;
+}
+
+static GByteArray *
+get_sample (guint frames)
+{
+  gint16 v;
+  GByteArray *sample = g_byte_array_sized_new (frames * sizeof (gint16));
+
+  for (guint i = 0; i < frames; i++)
+    {
+      v = (gint16) g_random_int ();
+      g_byte_array_append (sample, (guint8 *) & v, sizeof (gint16));
+    }
+
+  return sample;
+}
+
+static struct sample_info *
+get_sample_info (guint frames, guint rate)
+{
+  struct sample_info *sample_info = sample_info_new (FALSE);
+  sample_info->frames = frames;
+  sample_info->rate = rate;
+  sample_info->channels = 1;
+  sample_info->format = SF_FORMAT_WAV | SF_FORMAT_PCM_16;
+  sample_info->loop_start = 0;
+  sample_info->loop_end = frames - 1;
+  sample_info->loop_type = 0;
+  return sample_info;
+}
+
+static gboolean
+dir_contains (const struct fs_operations *ops, const gchar *dir,
+	      const gchar *name)
+{
+  gboolean found = FALSE;
+  struct item_iterator iter;
+
+  if (ops->readdir (&backend, &iter, dir, NULL))
+    {
+      return FALSE;
+    }
+
+  while (!item_iterator_next (&iter))
+    {
+      if (!strcmp (iter.item.name, name))
+	{
+	  found = TRUE;
+	}
+    }
+  item_iterator_free (&iter);
+
+  return found;
+}
+
+void
+test_parse_link ()
+{
+  gint err;
+  struct backend_virtual_link link;
+
+  printf ("\n");
+
+  err = backend_virtual_parse_link (&link, "bandwidth=3125,latency=1000");
+  CU_ASSERT_EQUAL (err, 0);
+  CU_ASSERT_EQUAL (link.bandwidth, BE_VIRTUAL_MIDI_DIN_BANDWIDTH);
+  CU_ASSERT_EQUAL (link.latency, 1000);
+  CU_ASSERT_EQUAL (link.drop_period, 0);
+  CU_ASSERT_EQUAL (link.corrupt_period, 0);
+
+  err = backend_virtual_parse_link (&link, "drop=3,corrupt=5");
+  CU_ASSERT_EQUAL (err, 0);
+  CU_ASSERT_EQUAL (link.bandwidth, 0);
+  CU_ASSERT_EQUAL (link.drop_period, 3);
+  CU_ASSERT_EQUAL (link.corrupt_period, 5);
+
+  err = backend_virtual_parse_link (&link, "bandwidth=fast");
+  CU_ASSERT_EQUAL (err, -EINVAL);
+
+  err = backend_virtual_parse_link (&link, "jitter=1");
+  CU_ASSERT_EQUAL (err, -EINVAL);
+}
+
+void
+test_elektron_sample ()
+{
+  gint err;
+  struct idata input, output;
+  struct task_control control;
+  const struct fs_operations *ops;
+  struct backend_virtual_link link = { 0, 0, 0, 0 };
+
+  printf ("\n");
+
+  backend_virtual_set_link (&link);
+  err = connect_virtual_device (0, "elektron");
+  CU_ASSERT_EQUAL (err, 0);
+  if (err)
+    {
+      return;
+    }
+
+  ops = backend_get_fs_operations_by_name (&backend, "sample");
+  CU_ASSERT_PTR_NOT_NULL (ops);
+
+  init_task_control (&control);
+
+  err = ops->mkdir (&backend, "/dir");
+  CU_ASSERT_EQUAL (err, 0);
+
+  idata_init (&input, get_sample (SAMPLE_FRAMES), NULL,
+	      get_sample_info (SAMPLE_FRAMES, 48000), sample_info_free);
+  err = ops->upload (&backend, "/dir/sample", &input, &control);
+  CU_ASSERT_EQUAL (err, 0);
+
+  CU_ASSERT_TRUE (dir_contains (ops, "/", "dir"));
+  CU_ASSERT_TRUE (dir_contains (ops, "/dir", "sample"));
+
+  err = ops->download (&backend, "/dir/sample", &output, &control);
+  CU_ASSERT_EQUAL (err, 0);
+  if (!err)
+    {
+      CU_ASSERT_EQUAL (output.content->len, input.content->len);
+      CU_ASSERT_EQUAL (memcmp (output.content->data, input.content->data,
+			       input.content->len), 0);
+      idata_clear (&output);
+    }
+
+  err = ops->delete (&backend, "/dir/sample");
+  CU_ASSERT_EQUAL (err, 0);
+  CU_ASSERT_FALSE (dir_contains (ops, "/dir", "sample"));
+
+  idata_clear (&input);
+  controllable_clear (&control.controllable);
+  backend_destroy (&backend);
+}
+
+void
+test_elektron_raw ()
+{
+  gint err;
+  GByteArray *raw;
+  struct idata input, output;
+  struct task_control control;
+  const struct fs_operations *ops;
+  struct backend_virtual_link link = { 0, 0, 0, 0 };
+
+  printf ("\n");
+
+  backend_virtual_set_link (&link);
+  err = connect_virtual_device (1, "elektron");
+  CU_ASSERT_EQUAL (err, 0);
+  if (err)
+    {
+      return;
+    }
+
+  ops = backend_get_fs_operations_by_name (&backend, "raw");
+  CU_ASSERT_PTR_NOT_NULL (ops);
+
+  init_task_control (&control);
+
+  raw = g_byte_array_sized_new (RAW_LEN);
+  for (guint i = 0; i < RAW_LEN; i++)
+    {
+      guint8 v = g_random_int ();
+      g_byte_array_append (raw, &v, 1);
+    }
+  idata_init (&input, raw, NULL, NULL, NULL);
+
+  err = ops->upload (&backend, "/raw", &input, &control);
+  CU_ASSERT_EQUAL (err, 0);
+
+  CU_ASSERT_TRUE (dir_contains (ops, "/", "raw"));
+
+  err = ops->download (&backend, "/raw", &output, &control);
+  CU_ASSERT_EQUAL (err, 0);
+  if (!err)
+    {
+      CU_ASSERT_EQUAL (output.content->len, RAW_LEN);
+      CU_ASSERT_EQUAL (memcmp (output.content->data, raw->data, RAW_LEN),
+		       0);
+      idata_clear (&output);
+    }
+
+  idata_clear (&input);
+  controllable_clear (&control.controllable);
+  backend_destroy (&backend);
+}
+
+//The same transfers are run against the capture of the first session, which must not diverge.
+
+static void
+run_capture_replay (gint model, const gchar *fs_name, struct idata *input,
+		    const struct backend_virtual_link *link)
+{
+  gint err;
+  struct idata output;
+  struct task_control control;
+  const struct fs_operations *ops;
+  struct backend_device device;
+  gchar *path = g_build_filename (g_get_tmp_dir (),
+				  "elektroid_test.cap", NULL);
+
+  init_task_control (&control);
+
+  device.type = BE_TYPE_MIDI;
+  snprintf (device.name, LABEL_MAX, "virtual:%d", model);
+
+  for (gint i = 0; i < 2; i++)
+    {
+      if (i)
+	{
+	  g_unsetenv (CAPTURE_ENV_FILE);
+	  g_setenv (CAPTURE_ENV_REPLAY_FAST, "1", TRUE);
+	  snprintf (device.id, LABEL_MAX, "%s%s", CAPTURE_REPLAY_ID_PREFIX,
+		    path);
+	}
+      else
+	{
+	  g_setenv (CAPTURE_ENV_FILE, path, TRUE);
+	  snprintf (device.id, LABEL_MAX, "virtual:%d", model);
+	}
+
+      backend_virtual_set_link (link);
+      memset (&backend, 0, sizeof (struct backend));
+      err = backend_init_connector (&backend, &device, "elektron", NULL);
+      CU_ASSERT_EQUAL (err, 0);
+      if (err)
+	{
+	  break;
+	}
+
+      CU_ASSERT_EQUAL (backend.capture->replay, i);
+
+      ops = backend_get_fs_operations_by_name (&backend, fs_name);
+
+      err = ops->upload (&backend, "/replay", input, &control);
+      CU_ASSERT_EQUAL (err, 0);
+
+      err = ops->download (&backend, "/replay", &output, &control);
+      CU_ASSERT_EQUAL (err, 0);
+      if (!err)
+	{
+	  CU_ASSERT_EQUAL (output.content->len, input->content->len);
+	  CU_ASSERT_EQUAL (memcmp (output.content->data,
+				   input->content->data,
+				   input->content->len), 0);
+	  idata_clear (&output);
+	}
+
+      backend_destroy (&backend);
+    }
+
+  g_unsetenv (CAPTURE_ENV_FILE);
+  g_unsetenv (CAPTURE_ENV_REPLAY_FAST);
+  g_unlink (path);
+  g_free (path);
+  controllable_clear (&control.controllable);
+}
+
+void
+test_capture_replay ()
+{
+  GByteArray *raw;
+  struct idata input;
+  struct backend_virtual_link link = { 0, 0, 0, 0 };
+
+  printf ("\n");
+
+  raw = g_byte_array_sized_new (RAW_LEN);
+  for (guint i = 0; i < RAW_LEN; i++)
+    {
+      guint8 v = g_random_int ();
+      g_byte_array_append (raw, &v, 1);
+    }
+  idata_init (&input, raw, NULL, NULL, NULL);
+
+  run_capture_replay (1, "raw", &input, &link);
+
+  idata_clear (&input);
+}
+
+//The block window would adapt differently to the latency while capturing and while replaying.
+
+void
+test_capture_replay_sample ()
+{
+  struct idata input;
+  struct backend_virtual_link link = { 0, 500, 0, 0 };
+
+  printf ("\n");
+
+  idata_init (&input, get_sample (SAMPLE_FRAMES * 16), NULL,
+	      get_sample_info (SAMPLE_FRAMES * 16, 48000), sample_info_free);
+
+  run_capture_replay (0, "sample", &input, &link);
+
+  idata_clear (&input);
+}
+
+//Upload packets and download packets are corrupted, so both NAK paths are tested.
+
+void
+test_sds_corrupted_link ()
+{
+  gint err;
+  struct idata input, output;
+  struct task_control control;
+  const struct fs_operations *ops;
+  struct backend_virtual_link link = { 0, 0, 0, 7 };
+
+  printf ("\n");
+
+  backend_virtual_set_link (&link);
+  err = connect_virtual_device (2, "sds");
+  CU_ASSERT_EQUAL (err, 0);
+  if (err)
+    {
+      return;
+    }
+
+  ops = backend_get_fs_operations_by_name (&backend, "mono-16b");
+  CU_ASSERT_PTR_NOT_NULL (ops);
+
+  init_task_control (&control);
+
+  idata_init (&input, get_sample (SAMPLE_FRAMES), g_strdup ("sample"),
+	      get_sample_info (SAMPLE_FRAMES, 44100), sample_info_free);
+  err = ops->upload (&backend, "/5", &input, &control);
+  CU_ASSERT_EQUAL (err, 0);
+
+  err = ops->download (&backend, "/5", &output, &control);
+  CU_ASSERT_EQUAL (err, 0);
+  if (!err)
+    {
+      CU_ASSERT_EQUAL (output.content->len, input.content->len);
+      CU_ASSERT_EQUAL (memcmp (output.content->data, input.content->data,
+			       input.content->len), 0);
+      idata_clear (&output);
+    }
+
+  CU_ASSERT_NOT_EQUAL (backend.telemetry.retries, 0);
+
+  idata_clear (&input);
+  controllable_clear (&control.controllable);
+  backend_destroy (&backend);
+}
+
+void
+test_sds_calibrate ()
+{
+  gint err, rest_time;
+  gchar *filename;
+  GList *members;
+  JsonNode *root;
+  JsonParser *parser;
+  JsonObject *profiles;
+  struct task_control control;
+  struct backend_virtual_link link = { 0, 0, 0, 0 };
+
+  printf ("\n");
+
+  backend_virtual_set_link (&link);
+  err = connect_virtual_device (2, "sds");
+  CU_ASSERT_EQUAL (err, 0);
+  if (err)
+    {
+      return;
+    }
+
+  CU_ASSERT_PTR_NOT_NULL (backend.calibrate);
+  if (backend.calibrate)
+    {
+      init_task_control (&control);
+
+      err = backend.calibrate (&backend, "/5", &control, &rest_time);
+      CU_ASSERT_EQUAL (err, 0);
+      CU_ASSERT_TRUE (rest_time > 0);
+
+      //HOME is a temporary directory so this is the only profile.
+      filename = get_user_dir (CACHE_DIR "/sds.json");
+      parser = json_parser_new ();
+      CU_ASSERT_TRUE (json_parser_load_from_file (parser, filename, NULL));
+      root = json_parser_get_root (parser);
+      CU_ASSERT_TRUE (root && JSON_NODE_HOLDS_OBJECT (root));
+      if (root && JSON_NODE_HOLDS_OBJECT (root))
+	{
+	  profiles = json_node_get_object (root);
+	  members = json_object_get_members (profiles);
+	  CU_ASSERT_EQUAL (g_list_length (members), 1);
+	  if (members)
+	    {
+	      CU_ASSERT_EQUAL (json_object_get_int_member (profiles,
+							   members->data),
+			       rest_time);
+	    }
+	  g_list_free (members);
+	}
+      g_object_unref (parser);
+      g_unlink (filename);
+      g_free (filename);
+
+      controllable_clear (&control.controllable);
+    }
+
+  backend_destroy (&backend);
+}
+
+void
+test_microfreak_preset ()
+{
+  gint err;
+  GByteArray *serialized;
+  struct idata input, output;
+  struct task_control control;
+  struct microfreak_preset mfp_src, mfp_dst;
+  const struct fs_operations *ops;
+  struct backend_virtual_link link = { 0, 0, 0, 0 };
+
+  printf ("\n");
+
+  backend_virtual_set_link (&link);
+  err = connect_virtual_device (3, MICROFREAK_NAME);
+  CU_ASSERT_EQUAL (err, 0);
+  if (err)
+    {
+      return;
+    }
+
+  ops = backend_get_fs_operations_by_name (&backend, "ppreset");
+  CU_ASSERT_PTR_NOT_NULL (ops);
+
+  init_task_control (&control);
+
+  memset (mfp_src.header, 0, MICROFREAK_PRESET_HEADER_MSG_LEN);
+  memcpy (&mfp_src.header[12], "Virtual", 7);
+  mfp_src.parts = MICROFREAK_PRESET_PARTS;
+  for (guint i = 0; i < MICROFREAK_PRESET_DATALEN; i++)
+    {
+      mfp_src.data[i] = g_random_int () & 0x7f;
+    }
+  serialized = g_byte_array_new ();
+  err = microfreak_serialize_preset (serialized, &mfp_src);
+  CU_ASSERT_EQUAL (err, 0);
+  idata_init (&input, serialized, NULL, NULL, NULL);
+
+  err = ops->upload (&backend, "/130", &input, &control);
+  CU_ASSERT_EQUAL (err, 0);
+
+  err = ops->download (&backend, "/130", &output, &control);
+  CU_ASSERT_EQUAL (err, 0);
+  if (!err)
+    {
+      CU_ASSERT_STRING_EQUAL (output.name, "Virtual");
+      err = microfreak_deserialize_preset (&mfp_dst, output.content);
+      CU_ASSERT_EQUAL (err, 0);
+      CU_ASSERT_EQUAL (mfp_dst.parts, MICROFREAK_PRESET_PARTS);
+      CU_ASSERT_EQUAL (memcmp (mfp_dst.data, mfp_src.data,
+			       MICROFREAK_PRESET_DATALEN), 0);
+      idata_clear (&output);
+    }
+
+  idata_clear (&input);
+  controllable_clear (&control.controllable);
+  backend_destroy (&backend);
+}
+
+gint
+main (gint argc, gchar *argv[])
+{
+  gint err = 0;
+  gchar *home, *dir;
+
+  debug_level = 5;
+
+  //Nothing is written in the user directories.
+  home = g_dir_make_tmp ("elektroid_tests_backend_virtual_XXXXXX", NULL);
+  g_setenv ("HOME", home, TRUE);
+
+  preferences_hashtable = g_hash_table_new_full (g_str_hash, g_str_equal,
+						 NULL, g_free);
+  preferences_set_boolean (PREF_KEY_STOP_DEVICE_WHEN_CONNECTING, FALSE);
+  preferences_set_boolean (PREF_KEY_ELEKTRON_LOAD_SOUND_TAGS, FALSE);
+
+  gslist_fill (&connectors, &CONNECTOR_ELEKTRON, &CONNECTOR_MICROFREAK,
+	       &CONNECTOR_SDS, NULL);
+
+  if (CU_initialize_registry () != CUE_SUCCESS)
+    {
+      goto cleanup;
+    }
+  CU_pSuite suite = CU_add_suite ("Elektroid virtual backend tests", 0, 0);
+  if (!suite)
+    {
+      goto cleanup;
+    }
+
+  if (!CU_add_test (suite, "parse_link", test_parse_link))
+    {
+      goto cleanup;
+    }
+
+  if (!CU_add_test (suite, "elektron_sample", test_elektron_sample))
+    {
+      goto cleanup;
+    }
+
+  if (!CU_add_test (suite, "elektron_raw", test_elektron_raw))
+    {
+      goto cleanup;
+    }
+
+  if (!CU_add_test (suite, "capture_replay", test_capture_replay))
+    {
+      goto cleanup;
+    }
+
+  if (!CU_add_test (suite, "capture_replay_sample",
+		    test_capture_replay_sample))
+    {
+      goto cleanup;
+    }
+
+  if (!CU_add_test (suite, "sds_corrupted_link", test_sds_corrupted_link))
+    {
+      goto cleanup;
+    }
+
+  if (!CU_add_test (suite, "sds_calibrate", test_sds_calibrate))
+    {
+      goto cleanup;
+    }
+
+  if (!CU_add_test (suite, "microfreak_preset", test_microfreak_preset))
+    {
+      goto cleanup;
+    }
+
+  CU_basic_set_mode (CU_BRM_VERBOSE);
+
+  CU_basic_run_tests ();
+  err = CU_get_number_of_tests_failed ();
+
+cleanup:
+  CU_cleanup_registry ();
+  g_slist_free (connectors);
+  g_hash_table_destroy (preferences_hashtable);
+  dir = get_user_dir (CACHE_DIR);
+  g_rmdir (dir);
+  g_free (dir);
+  dir = get_user_dir ("/.cache");
+  g_rmdir (dir);
+  g_free (dir);
+  g_rmdir (home);
+  g_free (home);
+  return err || CU_get_error ();
+}
@@ -0,0 +1,209 @@
+#include <CUnit/CUnit.h>
+#include <CUnit/Basic.h>
+#include <glib/gstdio.h>
+#include "../src/backup.h"
+
+#define PREFIX "conn-fs"
+
+static gchar *dir;
+
+static void
+init_item (struct item *item, gchar *name, gint64 size, gint64 hash)
+{
+  item->type = ITEM_TYPE_FILE;
+  item->name = name;
+  item->size = size;
+  item->hash = hash;
+}
+
+static gchar *
+save_file (const gchar *name, const gchar *content)
+{
+  gchar *file = path_chain (PATH_SYSTEM, dir, name);
+  CU_ASSERT_EQUAL (file_save_data (file, (guint8 *) content,
+				   strlen (content)), 0);
+  return file;
+}
+
+static gboolean
+object_exists (const gchar *object)
+{
+  gboolean exists;
+  gchar *objects_dir = path_chain (PATH_SYSTEM, dir, BACKUP_OBJECTS_DIR);
+  gchar *path = path_chain (PATH_SYSTEM, objects_dir, object);
+  exists = g_file_test (path, G_FILE_TEST_EXISTS);
+  g_free (objects_dir);
+  g_free (path);
+  return exists;
+}
+
+void
+test_dedup ()
+{
+  gchar *file;
+  struct item item;
+  struct backup backup;
+
+  printf ("\n");
+
+  CU_ASSERT_EQUAL (backup_init (&backup, dir, PREFIX), 0);
+
+  //Items with the same device hash are stored once.
+  init_item (&item, "a", 4, 0x1234);
+  file = save_file ("a.wav", "aaaa");
+  CU_ASSERT_EQUAL (backup_add (&backup, "/a", &item, file), 0);
+  g_free (file);
+
+  init_item (&item, "b", 4, 0x1234);
+  file = save_file ("b.wav", "aaaa");
+  CU_ASSERT_EQUAL (backup_add (&backup, "/b", &item, file), 0);
+  g_free (file);
+
+  CU_ASSERT_TRUE (object_exists (PREFIX "-00001234-4.wav"));
+
+  //Items without device hash are stored by content.
+  init_item (&item, "c", -1, -1);
+  file = save_file ("c.syx", "cc");
+  CU_ASSERT_EQUAL (backup_add (&backup, "/c", &item, file), 0);
+  g_free (file);
+
+  CU_ASSERT_EQUAL (backup.downloaded, 3);
+  CU_ASSERT_EQUAL (backup.stored, 2);
+
+  CU_ASSERT_EQUAL (backup_save (&backup, TRUE), 0);
+  backup_free (&backup);
+}
+
+void
+test_unchanged ()
+{
+  gchar *file;
+  struct item item;
+  struct backup backup;
+
+  printf ("\n");
+
+  CU_ASSERT_EQUAL (backup_init (&backup, dir, PREFIX), 0);
+
+  init_item (&item, "a", 4, 0x1234);
+  CU_ASSERT_TRUE (backup_keep_unchanged (&backup, "/a", &item));
+
+  //Deleted files are restored from the objects.
+  file = path_chain (PATH_SYSTEM, dir, "b.wav");
+  g_unlink (file);
+  init_item (&item, "b", 4, 0x1234);
+  CU_ASSERT_TRUE (backup_keep_unchanged (&backup, "/b", &item));
+  CU_ASSERT_TRUE (g_file_test (file, G_FILE_TEST_EXISTS));
+  g_free (file);
+
+  init_item (&item, "a", 4, 0x4321);
+  CU_ASSERT_FALSE (backup_keep_unchanged (&backup, "/a", &item));
+
+  //Items of unknown size must always be downloaded.
+  init_item (&item, "c", -1, -1);
+  CU_ASSERT_FALSE (backup_keep_unchanged (&backup, "/c", &item));
+
+  CU_ASSERT_EQUAL (backup.unchanged, 2);
+
+  //An incomplete backup keeps the items not visited.
+  CU_ASSERT_EQUAL (backup_save (&backup, FALSE), 0);
+  backup_free (&backup);
+
+  CU_ASSERT_EQUAL (backup_init (&backup, dir, PREFIX), 0);
+  CU_ASSERT_EQUAL (g_hash_table_size (backup.manifest), 3);
+  backup_free (&backup);
+}
+
+//Slots without device hash might be edited in place so they are always downloaded and compared by content.
+
+void
+test_unchanged_content ()
+{
+  gchar *file;
+  struct item item;
+  struct backup backup;
+
+  printf ("\n");
+
+  CU_ASSERT_EQUAL (backup_init (&backup, dir, PREFIX), 0);
+  init_item (&item, "d", 4, -1);
+  file = save_file ("d.syx", "dddd");
+  CU_ASSERT_EQUAL (backup_add (&backup, "/d", &item, file), 0);
+  g_free (file);
+  CU_ASSERT_EQUAL (backup_save (&backup, FALSE), 0);
+  backup_free (&backup);
+
+  //The previous file is linked to the object so it must be removed first.
+  CU_ASSERT_EQUAL (backup_init (&backup, dir, PREFIX), 0);
+  CU_ASSERT_FALSE (backup_keep_unchanged (&backup, "/d", &item));
+  file = path_chain (PATH_SYSTEM, dir, "d.syx");
+  g_unlink (file);
+  g_free (file);
+  file = save_file ("d.syx", "dddd");
+  CU_ASSERT_EQUAL (backup_add (&backup, "/d", &item, file), 0);
+  g_free (file);
+  CU_ASSERT_EQUAL (backup.unchanged, 1);
+  CU_ASSERT_EQUAL (backup.downloaded, 0);
+  CU_ASSERT_EQUAL (backup_save (&backup, FALSE), 0);
+  backup_free (&backup);
+
+  //Same name and size but different content
+  CU_ASSERT_EQUAL (backup_init (&backup, dir, PREFIX), 0);
+  CU_ASSERT_FALSE (backup_keep_unchanged (&backup, "/d", &item));
+  file = path_chain (PATH_SYSTEM, dir, "d.syx");
+  g_unlink (file);
+  g_free (file);
+  file = save_file ("d.syx", "DDDD");
+  CU_ASSERT_EQUAL (backup_add (&backup, "/d", &item, file), 0);
+  g_free (file);
+  CU_ASSERT_EQUAL (backup.unchanged, 0);
+  CU_ASSERT_EQUAL (backup.downloaded, 1);
+  CU_ASSERT_EQUAL (backup.stored, 1);
+  CU_ASSERT_EQUAL (backup_save (&backup, FALSE), 0);
+  backup_free (&backup);
+}
+
+gint
+main (gint argc, gchar *argv[])
+{
+  gint err = 0;
+
+  debug_level = 5;
+
+  dir = g_dir_make_tmp ("elektroid_tests_backup_XXXXXX", NULL);
+
+  if (CU_initialize_registry () != CUE_SUCCESS)
+    {
+      goto cleanup;
+    }
+  CU_pSuite suite = CU_add_suite ("Elektroid backup tests", 0, 0);
+  if (!suite)
+    {
+      goto cleanup;
+    }
+
+  if (!CU_add_test (suite, "dedup", test_dedup))
+    {
+      goto cleanup;
+    }
+
+  if (!CU_add_test (suite, "unchanged", test_unchanged))
+    {
+      goto cleanup;
+    }
+
+  if (!CU_add_test (suite, "unchanged_content", test_unchanged_content))
+    {
+      goto cleanup;
+    }
+
+  CU_basic_set_mode (CU_BRM_VERBOSE);
+
+  CU_basic_run_tests ();
+  err = CU_get_number_of_tests_failed ();
+
+cleanup:
+  CU_cleanup_registry ();
+  g_free (dir);
+  return err || CU_get_error ();
+}
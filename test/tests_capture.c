@@ -0,0 +1,152 @@
+#include <CUnit/CUnit.h>
+#include <CUnit/Basic.h>
+#include <glib/gstdio.h>
+#include "../src/capture.h"
+
+#define RX_LEN 200		//Lengths over 127 need 2 bytes.
+
+static const guint8 TX_MSG[] = { 0xf0, 0x7e, 0x7f, 6, 1, 0xf7 };
+
+static gchar *path;
+
+static void
+write_capture ()
+{
+  struct capture capture;
+  guint8 rx[RX_LEN];
+
+  for (guint i = 0; i < RX_LEN; i++)
+    {
+      rx[i] = i;
+    }
+
+  CU_ASSERT_EQUAL (capture_open (&capture, path, "Device"), 0);
+  capture_add (&capture, CAPTURE_DIR_TX, TX_MSG, sizeof (TX_MSG));
+  capture_add (&capture, CAPTURE_DIR_RX, rx, RX_LEN);
+  capture_close (&capture);
+}
+
+void
+test_format ()
+{
+  guint pos;
+  struct capture capture;
+  struct capture_record record;
+
+  printf ("\n");
+
+  write_capture ();
+
+  CU_ASSERT_EQUAL (capture_load (&capture, path, FALSE), 0);
+  CU_ASSERT_STRING_EQUAL (capture.name, "Device");
+
+  pos = capture.pos;
+  CU_ASSERT_EQUAL (capture_next (&capture, &pos, &record), 0);
+  CU_ASSERT_EQUAL (record.dir, CAPTURE_DIR_TX);
+  CU_ASSERT_EQUAL (record.len, sizeof (TX_MSG));
+  CU_ASSERT_EQUAL (memcmp (record.data, TX_MSG, sizeof (TX_MSG)), 0);
+
+  CU_ASSERT_EQUAL (capture_next (&capture, &pos, &record), 0);
+  CU_ASSERT_EQUAL (record.dir, CAPTURE_DIR_RX);
+  CU_ASSERT_EQUAL (record.len, RX_LEN);
+  CU_ASSERT_EQUAL (record.data[RX_LEN - 1], RX_LEN - 1);
+
+  CU_ASSERT_EQUAL (capture_next (&capture, &pos, &record), -ENODATA);
+
+  capture_close (&capture);
+}
+
+void
+test_replay ()
+{
+  struct capture capture;
+  guint8 buffer[RX_LEN];
+  guint8 wrong[sizeof (TX_MSG)];
+
+  printf ("\n");
+
+  write_capture ();
+
+  CU_ASSERT_EQUAL (capture_load (&capture, path, TRUE), 0);
+
+  //Nothing is received before sending the recorded request.
+  CU_ASSERT_EQUAL (capture_replay_rx (&capture, buffer, RX_LEN, 0), 0);
+
+  memcpy (wrong, TX_MSG, sizeof (TX_MSG));
+  wrong[3] = 7;
+  CU_ASSERT_EQUAL (capture_replay_tx (&capture, wrong, sizeof (TX_MSG)),
+		   -EIO);
+
+  CU_ASSERT_EQUAL (capture_replay_tx (&capture, TX_MSG, sizeof (TX_MSG)),
+		   sizeof (TX_MSG));
+
+  CU_ASSERT_EQUAL (capture_replay_rx (&capture, buffer, 150, 0), 150);
+  CU_ASSERT_EQUAL (buffer[149], 149);
+  CU_ASSERT_EQUAL (capture_replay_rx (&capture, buffer, 150, 0), 50);
+  CU_ASSERT_EQUAL (buffer[49], RX_LEN - 1);
+  CU_ASSERT_EQUAL (capture_replay_rx (&capture, buffer, 150, 0), 0);
+
+  capture_close (&capture);
+}
+
+void
+test_invalid ()
+{
+  struct capture capture;
+
+  printf ("\n");
+
+  CU_ASSERT_TRUE (g_file_set_contents (path, "ELKCAQ\x01", -1, NULL));
+  CU_ASSERT_EQUAL (capture_load (&capture, path, FALSE), -EINVAL);
+
+  //The device name is longer than the file.
+  CU_ASSERT_TRUE (g_file_set_contents (path, "ELKCAP\x01\x10", -1, NULL));
+  CU_ASSERT_EQUAL (capture_load (&capture, path, FALSE), -EINVAL);
+}
+
+gint
+main (gint argc, gchar *argv[])
+{
+  gint err = 0;
+
+  debug_level = 5;
+
+  path = g_build_filename (g_get_tmp_dir (), "elektroid_tests_capture.cap",
+			   NULL);
+
+  if (CU_initialize_registry () != CUE_SUCCESS)
+    {
+      goto cleanup;
+    }
+  CU_pSuite suite = CU_add_suite ("Elektroid capture tests", 0, 0);
+  if (!suite)
+    {
+      goto cleanup;
+    }
+
+  if (!CU_add_test (suite, "format", test_format))
+    {
+      goto cleanup;
+    }
+
+  if (!CU_add_test (suite, "replay", test_replay))
+    {
+      goto cleanup;
+    }
+
+  if (!CU_add_test (suite, "invalid", test_invalid))
+    {
+      goto cleanup;
+    }
+
+  CU_basic_set_mode (CU_BRM_VERBOSE);
+
+  CU_basic_run_tests ();
+  err = CU_get_number_of_tests_failed ();
+
+cleanup:
+  CU_cleanup_registry ();
+  g_unlink (path);
+  g_free (path);
+  return err || CU_get_error ();
+}
@@ -1,6 +1,274 @@
 #include <CUnit/CUnit.h>
 #include <CUnit/Basic.h>
 #include "../src/connector.h"
+#include "../src/slot_cache.h"
+
+#define TEST_SLOTS 3
+
+static guint test_readdir_calls;
+
+static gint
+test_next_dentry (struct item_iterator *iter)
+{
+  guint *next = iter->data;
+
+  if (*next >= TEST_SLOTS)
+    {
+      return -ENOENT;
+    }
+
+  item_set_name (&iter->item, "Slot %d", *next);
+  iter->item.id = *next;
+  iter->item.type = ITEM_TYPE_FILE;
+  iter->item.size = *next * 10;
+  item_set_object_info (&iter->item, "info=%d", *next);
+  sample_info_init (&iter->item.sample_info);
+  (*next)++;
+
+  return 0;
+}
+
+static gint
+test_readdir (struct backend *backend, struct item_iterator *iter,
+	      const gchar *dir, const gchar **extensions)
+{
+  guint *next = g_malloc (sizeof (guint));
+  *next = 0;
+  test_readdir_calls++;
+  item_iterator_init (iter, dir, next, test_next_dentry, g_free);
+  return 0;
+}
+
+static gint
+test_next_id_dentry (struct item_iterator *iter)
+{
+  guint *next = iter->data;
+
+  if (*next >= TEST_SLOTS)
+    {
+      return -ENOENT;
+    }
+
+  item_set_name (&iter->item, "%s", "");
+  iter->item.id = *next;
+  iter->item.type = ITEM_TYPE_FILE;
+  iter->item.size = -1;
+  sample_info_init (&iter->item.sample_info);
+  (*next)++;
+
+  return 0;
+}
+
+static gint
+test_readdir_ids (struct backend *backend, struct item_iterator *iter,
+		  const gchar *dir, const gchar **extensions)
+{
+  guint *next = g_malloc (sizeof (guint));
+  *next = 0;
+  item_iterator_init (iter, dir, next, test_next_id_dentry, g_free);
+  return 0;
+}
+
+static const struct fs_operations TEST_FS_OPERATIONS = {
+  .options = FS_OPTION_SLOT_STORAGE | FS_OPTION_SLOT_CACHE,
+  .name = "test",
+  .readdir = test_readdir
+};
+
+static const struct fs_operations TEST_IDS_FS_OPERATIONS = {
+  .options = FS_OPTION_SLOT_STORAGE | FS_OPTION_SLOT_CACHE,
+  .name = "test-ids",
+  .readdir = test_readdir,
+  .readdir_ids = test_readdir_ids
+};
+
+static guint
+test_slot_cache_list (struct backend *backend, guint max)
+{
+  guint items = 0;
+  gchar name[LABEL_MAX];
+  struct item_iterator iter;
+
+  CU_ASSERT_EQUAL (slot_cache_readdir (backend, &TEST_FS_OPERATIONS, &iter,
+				       "/", NULL), 0);
+
+  while (items < max && !item_iterator_next (&iter))
+    {
+      snprintf (name, LABEL_MAX, "Slot %d", items);
+      CU_ASSERT_STRING_EQUAL (iter.item.name, name);
+      CU_ASSERT_EQUAL (iter.item.id, items);
+      CU_ASSERT_EQUAL (iter.item.type, ITEM_TYPE_FILE);
+      CU_ASSERT_EQUAL (iter.item.size, items * 10);
+      snprintf (name, LABEL_MAX, "info=%d", items);
+      CU_ASSERT_STRING_EQUAL (iter.item.object_info, name);
+      items++;
+    }
+
+  item_iterator_free (&iter);
+
+  return items;
+}
+
+void
+test_slot_cache ()
+{
+  struct backend backend;
+  struct item_iterator iter;
+
+  printf ("\n");
+
+  memset (&backend, 0, sizeof (struct backend));
+  backend.type = BE_TYPE_MIDI;
+  backend.conn_name = "test";
+  snprintf (backend.name, LABEL_MAX, "Test device");
+
+  slot_cache_invalidate_dir (&backend, &TEST_FS_OPERATIONS, "/");
+  test_readdir_calls = 0;
+
+  CU_ASSERT_EQUAL (test_slot_cache_list (&backend, TEST_SLOTS), TEST_SLOTS);
+  CU_ASSERT_EQUAL (test_readdir_calls, 1);
+
+  CU_ASSERT_EQUAL (test_slot_cache_list (&backend, TEST_SLOTS), TEST_SLOTS);
+  CU_ASSERT_EQUAL (test_readdir_calls, 1);
+
+  slot_cache_invalidate (&backend, &TEST_FS_OPERATIONS, "/1");
+
+  //Incomplete listings are not stored.
+  CU_ASSERT_EQUAL (test_slot_cache_list (&backend, 1), 1);
+  CU_ASSERT_EQUAL (test_readdir_calls, 2);
+
+  CU_ASSERT_EQUAL (test_slot_cache_list (&backend, TEST_SLOTS), TEST_SLOTS);
+  CU_ASSERT_EQUAL (test_readdir_calls, 3);
+
+  CU_ASSERT_EQUAL (test_slot_cache_list (&backend, TEST_SLOTS), TEST_SLOTS);
+  CU_ASSERT_EQUAL (test_readdir_calls, 3);
+
+  //Listings invalidated while iterating are not stored.
+  slot_cache_invalidate (&backend, &TEST_FS_OPERATIONS, "/1");
+  CU_ASSERT_EQUAL (slot_cache_readdir (&backend, &TEST_FS_OPERATIONS, &iter,
+				       "/", NULL), 0);
+  while (!item_iterator_next (&iter))
+    {
+      if (iter.item.id == 0)
+	{
+	  slot_cache_invalidate (&backend, &TEST_FS_OPERATIONS, "/0");
+	}
+    }
+  item_iterator_free (&iter);
+  CU_ASSERT_EQUAL (test_readdir_calls, 4);
+
+  CU_ASSERT_EQUAL (test_slot_cache_list (&backend, TEST_SLOTS), TEST_SLOTS);
+  CU_ASSERT_EQUAL (test_readdir_calls, 5);
+
+  //An identical device on another port does not share the listings.
+  snprintf (backend.device_name, LABEL_MAX, "Test port 2");
+  slot_cache_invalidate_dir (&backend, &TEST_FS_OPERATIONS, "/");
+  CU_ASSERT_EQUAL (test_slot_cache_list (&backend, TEST_SLOTS), TEST_SLOTS);
+  CU_ASSERT_EQUAL (test_readdir_calls, 6);
+
+  backend.device_name[0] = 0;
+  CU_ASSERT_EQUAL (test_slot_cache_list (&backend, TEST_SLOTS), TEST_SLOTS);
+  CU_ASSERT_EQUAL (test_readdir_calls, 6);
+
+  slot_cache_invalidate_dir (&backend, &TEST_FS_OPERATIONS, "/");
+  snprintf (backend.device_name, LABEL_MAX, "Test port 2");
+  slot_cache_invalidate_dir (&backend, &TEST_FS_OPERATIONS, "/");
+}
+
+void
+test_slot_cache_ids ()
+{
+  guint items, generation;
+  gboolean placeholders;
+  gchar name[LABEL_MAX];
+  struct item *item;
+  struct backend backend;
+  struct item_iterator iter;
+  GList *completed = NULL;
+
+  printf ("\n");
+
+  memset (&backend, 0, sizeof (struct backend));
+  backend.type = BE_TYPE_MIDI;
+  backend.conn_name = "test";
+  snprintf (backend.name, LABEL_MAX, "Test device");
+
+  //Filesystems without readdir_ids are listed as usual.
+  slot_cache_invalidate_dir (&backend, &TEST_FS_OPERATIONS, "/");
+  CU_ASSERT_EQUAL (slot_cache_readdir_ids (&backend, &TEST_FS_OPERATIONS,
+					   &iter, "/", NULL, &placeholders),
+		   0);
+  CU_ASSERT_FALSE (placeholders);
+  item_iterator_free (&iter);
+
+  slot_cache_invalidate_dir (&backend, &TEST_IDS_FS_OPERATIONS, "/");
+  test_readdir_calls = 0;
+
+  generation = slot_cache_get_generation ();
+  CU_ASSERT_EQUAL (slot_cache_readdir_ids (&backend, &TEST_IDS_FS_OPERATIONS,
+					   &iter, "/", NULL, &placeholders),
+		   0);
+  CU_ASSERT_TRUE (placeholders);
+
+  //This is what load_item would do.
+  while (!item_iterator_next (&iter))
+    {
+      CU_ASSERT_STRING_EQUAL (iter.item.name, "");
+      item = g_malloc (sizeof (struct item));
+      item_init (item);
+      item->type = iter.item.type;
+      item->id = iter.item.id;
+      item->size = iter.item.id * 10;
+      item_set_name (item, "Slot %d", iter.item.id);
+      item_set_object_info (item, "%s", "");
+      sample_info_init (&item->sample_info);
+      completed = g_list_append (completed, item);
+    }
+  item_iterator_free (&iter);
+
+  CU_ASSERT_EQUAL (g_list_length (completed), TEST_SLOTS);
+
+  //An invalidation while completing the items discards the listing.
+  slot_cache_set_dir (&backend, &TEST_IDS_FS_OPERATIONS, "/", completed,
+		      generation - 1);
+  CU_ASSERT_EQUAL (slot_cache_readdir_ids (&backend, &TEST_IDS_FS_OPERATIONS,
+					   &iter, "/", NULL, &placeholders),
+		   0);
+  CU_ASSERT_TRUE (placeholders);
+  item_iterator_free (&iter);
+
+  slot_cache_set_dir (&backend, &TEST_IDS_FS_OPERATIONS, "/", completed,
+		      generation);
+
+  for (GList * e = completed; e; e = e->next)
+    {
+      item_clear (e->data);
+      g_free (e->data);
+    }
+  g_list_free (completed);
+
+  //The completed listing is served from the cache.
+  CU_ASSERT_EQUAL (slot_cache_readdir_ids (&backend, &TEST_IDS_FS_OPERATIONS,
+					   &iter, "/", NULL, &placeholders),
+		   0);
+  CU_ASSERT_FALSE (placeholders);
+
+  items = 0;
+  while (!item_iterator_next (&iter))
+    {
+      snprintf (name, LABEL_MAX, "Slot %d", items);
+      CU_ASSERT_STRING_EQUAL (iter.item.name, name);
+      CU_ASSERT_EQUAL (iter.item.id, items);
+      CU_ASSERT_EQUAL (iter.item.size, items * 10);
+      items++;
+    }
+  item_iterator_free (&iter);
+
+  CU_ASSERT_EQUAL (items, TEST_SLOTS);
+  CU_ASSERT_EQUAL (test_readdir_calls, 0);
+
+  slot_cache_invalidate_dir (&backend, &TEST_IDS_FS_OPERATIONS, "/");
+}
 
 void
 test_item_iterator_is_dir_or_matches_exts ()
@@ -13,6 +281,8 @@ test_item_iterator_is_dir_or_matches_exts ()
 
   printf ("\n");
 
+  item_init (&iter.item);
+
   iter.item.type = ITEM_TYPE_DIR;
   CU_ASSERT_EQUAL (item_iterator_is_dir_or_matches_exts (&iter, NULL), TRUE);
   CU_ASSERT_EQUAL (item_iterator_is_dir_or_matches_exts (&iter, exts0), TRUE);
@@ -22,6 +292,44 @@ test_item_iterator_is_dir_or_matches_exts ()
   CU_ASSERT_EQUAL (item_iterator_is_dir_or_matches_exts (&iter, exts1), TRUE);
   CU_ASSERT_EQUAL (item_iterator_is_dir_or_matches_exts (&iter, exts2),
 		   FALSE);
+
+  item_clear (&iter.item);
+}
+
+void
+test_item_strings ()
+{
+  gchar *name;
+  struct item item;
+  struct item_iterator iter;
+  guint next = 0;
+  gchar long_name[ITEM_NAME_MAX];
+
+  printf ("\n");
+
+  item_init (&item);
+  CU_ASSERT_STRING_EQUAL (item.name, "");
+  CU_ASSERT_STRING_EQUAL (item.object_info, "");
+  item_set_name (&item, "%s", "a");
+  item_set_name (&item, "%s-%d", "b", 1);
+  CU_ASSERT_STRING_EQUAL (item.name, "b-1");
+  item_clear (&item);
+  CU_ASSERT_STRING_EQUAL (item.name, "");
+
+  //Names set by an iterator are valid until the iterator is freed.
+  item_iterator_init (&iter, "/", &next, test_next_dentry, NULL);
+  CU_ASSERT_EQUAL (item_iterator_next (&iter), 0);
+  name = iter.item.name;
+  CU_ASSERT_EQUAL (item_iterator_next (&iter), 0);
+  CU_ASSERT_STRING_EQUAL (name, "Slot 0");
+  CU_ASSERT_STRING_EQUAL (iter.item.name, "Slot 1");
+
+  memset (long_name, 'a', ITEM_NAME_MAX - 1);
+  long_name[ITEM_NAME_MAX - 1] = 0;
+  item_set_name (&iter.item, "%s", long_name);
+  CU_ASSERT_STRING_EQUAL (iter.item.name, long_name);
+
+  item_iterator_free (&iter);
 }
 
 gint
@@ -31,6 +339,9 @@ main (gint argc, gchar *argv[])
 
   debug_level = 5;
 
+  //The cache is stored under the home directory.
+  g_setenv ("HOME", g_get_tmp_dir (), TRUE);
+
   if (CU_initialize_registry () != CUE_SUCCESS)
     {
       goto cleanup;
@@ -47,6 +358,21 @@ main (gint argc, gchar *argv[])
       goto cleanup;
     }
 
+  if (!CU_add_test (suite, "item_strings", test_item_strings))
+    {
+      goto cleanup;
+    }
+
+  if (!CU_add_test (suite, "slot_cache", test_slot_cache))
+    {
+      goto cleanup;
+    }
+
+  if (!CU_add_test (suite, "slot_cache_ids", test_slot_cache_ids))
+    {
+      goto cleanup;
+    }
+
 
   CU_basic_set_mode (CU_BRM_VERBOSE);
 
@@ -0,0 +1,117 @@
+#include <CUnit/CUnit.h>
+#include <CUnit/Basic.h>
+#include <glib/gstdio.h>
+#include "../src/connector_cache.h"
+
+#define TEST_DEVICE "Elektron Digitakt"
+
+static gchar *root;
+
+static const struct backend_midi_info TEST_MIDI_INFO = {
+  .company = {0, 0x20, 0x3c},
+  .family = {0xc, 0},
+  .model = {0, 0},
+  .version = {1, 50, 0, 0}
+};
+
+void
+test_miss ()
+{
+  gchar *conn_name;
+
+  printf ("\n");
+
+  conn_name = connector_cache_get (TEST_DEVICE, &TEST_MIDI_INFO);
+  CU_ASSERT_PTR_NULL (conn_name);
+}
+
+void
+test_set_and_get ()
+{
+  gchar *conn_name;
+  struct backend_midi_info midi_info = TEST_MIDI_INFO;
+
+  printf ("\n");
+
+  connector_cache_set (TEST_DEVICE, &midi_info, "elektron");
+
+  conn_name = connector_cache_get (TEST_DEVICE, &midi_info);
+  CU_ASSERT_STRING_EQUAL (conn_name, "elektron");
+  g_free (conn_name);
+
+  //A firmware upgrade does not change the connector.
+  midi_info.version[0]++;
+  conn_name = connector_cache_get (TEST_DEVICE, &midi_info);
+  CU_ASSERT_STRING_EQUAL (conn_name, "elektron");
+  g_free (conn_name);
+
+  midi_info.family[0]++;
+  conn_name = connector_cache_get (TEST_DEVICE, &midi_info);
+  CU_ASSERT_PTR_NULL (conn_name);
+
+  conn_name = connector_cache_get ("Other device", &TEST_MIDI_INFO);
+  CU_ASSERT_PTR_NULL (conn_name);
+
+  connector_cache_set (TEST_DEVICE, &TEST_MIDI_INFO, "default");
+  conn_name = connector_cache_get (TEST_DEVICE, &TEST_MIDI_INFO);
+  CU_ASSERT_STRING_EQUAL (conn_name, "default");
+  g_free (conn_name);
+}
+
+gint
+main (gint argc, gchar *argv[])
+{
+  gint err = 0;
+  gchar *file, *cache;
+
+  debug_level = 5;
+
+  root = g_dir_make_tmp ("elektroid-connector-cache-XXXXXX", NULL);
+  if (!root)
+    {
+      return 1;
+    }
+
+  //The cache is stored in the cache directory of the user.
+  g_setenv ("HOME", root, TRUE);
+
+  if (CU_initialize_registry () != CUE_SUCCESS)
+    {
+      goto cleanup;
+    }
+  CU_pSuite suite = CU_add_suite ("Elektroid connector cache tests", 0, 0);
+  if (!suite)
+    {
+      goto cleanup;
+    }
+
+  if (!CU_add_test (suite, "miss", test_miss))
+    {
+      goto cleanup;
+    }
+
+  if (!CU_add_test (suite, "set_and_get", test_set_and_get))
+    {
+      goto cleanup;
+    }
+
+  CU_basic_set_mode (CU_BRM_VERBOSE);
+
+  CU_basic_run_tests ();
+  err = CU_get_number_of_tests_failed ();
+
+cleanup:
+  CU_cleanup_registry ();
+  file = get_user_dir (CACHE_DIR "/connectors.json");
+  g_unlink (file);
+  g_free (file);
+  cache = get_user_dir (CACHE_DIR);
+  g_rmdir (cache);
+  g_free (cache);
+  cache = get_user_dir ("/.cache");
+  g_rmdir (cache);
+  g_free (cache);
+  g_rmdir (root);
+  g_free (root);
+  return err || CU_get_error ();
+}
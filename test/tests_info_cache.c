@@ -0,0 +1,161 @@
+#include <CUnit/CUnit.h>
+#include <CUnit/Basic.h>
+#include <glib/gstdio.h>
+#include "../src/info_cache.h"
+
+static gchar *filename;
+
+void
+test_get_set ()
+{
+  gchar *info;
+  struct info_cache cache;
+
+  printf ("\n");
+
+  info_cache_init (&cache, filename);
+
+  CU_ASSERT_PTR_NULL (info_cache_get (&cache, "/A/1", 100));
+
+  info_cache_set (&cache, "/A/1", 100, "tags=bass");
+  info = info_cache_get (&cache, "/A/1", 100);
+  CU_ASSERT_STRING_EQUAL (info, "tags=bass");
+  g_free (info);
+
+  //A different size means the item has changed.
+  CU_ASSERT_PTR_NULL (info_cache_get (&cache, "/A/1", 101));
+
+  info_cache_set (&cache, "/A/1", 101, "tags=lead");
+  info = info_cache_get (&cache, "/A/1", 101);
+  CU_ASSERT_STRING_EQUAL (info, "tags=lead");
+  g_free (info);
+
+  info_cache_free (&cache);
+}
+
+void
+test_persistence ()
+{
+  gchar *info;
+  struct info_cache cache;
+
+  printf ("\n");
+
+  //The pending changes were saved when freeing the cache.
+  info_cache_init (&cache, filename);
+  info = info_cache_get (&cache, "/A/1", 101);
+  CU_ASSERT_STRING_EQUAL (info, "tags=lead");
+  g_free (info);
+
+  info_cache_set (&cache, "/A/2", 200, "tags=");
+  CU_ASSERT_EQUAL (info_cache_save (&cache), 0);
+  info_cache_free (&cache);
+
+  info_cache_init (&cache, filename);
+  info = info_cache_get (&cache, "/A/2", 200);
+  CU_ASSERT_STRING_EQUAL (info, "tags=");
+  g_free (info);
+  info_cache_free (&cache);
+}
+
+void
+test_invalidate ()
+{
+  gchar *info;
+  struct info_cache cache;
+
+  printf ("\n");
+
+  info_cache_init (&cache, filename);
+  info_cache_invalidate (&cache, "/A/1");
+  CU_ASSERT_PTR_NULL (info_cache_get (&cache, "/A/1", 101));
+  info_cache_free (&cache);
+
+  info_cache_init (&cache, filename);
+  CU_ASSERT_PTR_NULL (info_cache_get (&cache, "/A/1", 101));
+  info = info_cache_get (&cache, "/A/2", 200);
+  CU_ASSERT_STRING_EQUAL (info, "tags=");
+  g_free (info);
+  info_cache_free (&cache);
+}
+
+void
+test_memory ()
+{
+  gchar *info;
+  struct info_cache cache;
+
+  printf ("\n");
+
+  //Without a file, nothing is read from or written to disk.
+  info_cache_init (&cache, NULL);
+  CU_ASSERT_PTR_NULL (info_cache_get (&cache, "/A/2", 200));
+
+  info_cache_set (&cache, "/A/2", 200, "tags=pad");
+  CU_ASSERT_EQUAL (info_cache_save (&cache), 0);
+  info = info_cache_get (&cache, "/A/2", 200);
+  CU_ASSERT_STRING_EQUAL (info, "tags=pad");
+  g_free (info);
+  info_cache_free (&cache);
+
+  info_cache_init (&cache, filename);
+  info = info_cache_get (&cache, "/A/2", 200);
+  CU_ASSERT_STRING_EQUAL (info, "tags=");
+  g_free (info);
+  info_cache_free (&cache);
+}
+
+gint
+main (gint argc, gchar *argv[])
+{
+  gint err = 0;
+  gchar *dir;
+
+  debug_level = 5;
+
+  dir = g_dir_make_tmp ("elektroid_tests_info_cache_XXXXXX", NULL);
+  filename = path_chain (PATH_SYSTEM, dir, "info.json");
+
+  if (CU_initialize_registry () != CUE_SUCCESS)
+    {
+      goto cleanup;
+    }
+  CU_pSuite suite = CU_add_suite ("Elektroid info cache tests", 0, 0);
+  if (!suite)
+    {
+      goto cleanup;
+    }
+
+  if (!CU_add_test (suite, "get_set", test_get_set))
+    {
+      goto cleanup;
+    }
+
+  if (!CU_add_test (suite, "persistence", test_persistence))
+    {
+      goto cleanup;
+    }
+
+  if (!CU_add_test (suite, "invalidate", test_invalidate))
+    {
+      goto cleanup;
+    }
+
+  if (!CU_add_test (suite, "memory", test_memory))
+    {
+      goto cleanup;
+    }
+
+  CU_basic_set_mode (CU_BRM_VERBOSE);
+
+  CU_basic_run_tests ();
+  err = CU_get_number_of_tests_failed ();
+
+cleanup:
+  CU_cleanup_registry ();
+  g_unlink (filename);
+  g_rmdir (dir);
+  g_free (filename);
+  g_free (dir);
+  return err || CU_get_error ();
+}
@@ -0,0 +1,199 @@
+#include <CUnit/CUnit.h>
+#include <CUnit/Basic.h>
+#include <glib/gstdio.h>
+#include "../src/preloader.h"
+
+#define TEST_FILE_LEN 600
+#define TEST_MAX_BYTES 1000
+
+static gchar *dir;
+static gchar *path_a;
+static gchar *path_b;
+static gint loads;
+
+static gint
+test_load (struct backend *backend, const gchar *path, struct idata *idata,
+	   struct task_control *control)
+{
+  gint err = file_load (path, idata, NULL);
+
+  if (!err)
+    {
+      task_control_reset (control, 2);
+      control->part++;
+      g_atomic_int_inc (&loads);
+    }
+
+  return err;
+}
+
+static const struct fs_operations FS_TEST_OPERATIONS = {
+  .id = 1,
+  .name = "test",
+  .load = test_load
+};
+
+static void
+test_check (struct preloader *preloader, const gchar *path)
+{
+  gint err;
+  struct idata idata;
+  struct task_control control;
+
+  controllable_init (&control.controllable);
+  control.callback = NULL;
+  control.parts = 0;
+  control.part = 0;
+
+  err = preloader_load (preloader, NULL, &FS_TEST_OPERATIONS, path, &idata,
+			&control);
+  CU_ASSERT_EQUAL (err, 0);
+  CU_ASSERT_EQUAL (idata.content->len, TEST_FILE_LEN);
+  CU_ASSERT_EQUAL (control.parts, 2);
+  CU_ASSERT_EQUAL (control.part, 1);
+
+  idata_clear (&idata);
+  controllable_clear (&control.controllable);
+}
+
+void
+test_preload ()
+{
+  struct preloader preloader;
+
+  printf ("\n");
+
+  loads = 0;
+  preloader_init (&preloader, TEST_MAX_BYTES);
+
+  CU_ASSERT_TRUE (preloader_add (&preloader, NULL, &FS_TEST_OPERATIONS,
+				 path_a));
+  //Adding it again does not load it twice.
+  CU_ASSERT_TRUE (preloader_add (&preloader, NULL, &FS_TEST_OPERATIONS,
+				 path_a));
+  test_check (&preloader, path_a);
+  CU_ASSERT_EQUAL (loads, 1);
+
+  //Not preloaded paths are loaded directly.
+  test_check (&preloader, path_b);
+  CU_ASSERT_EQUAL (loads, 2);
+
+  CU_ASSERT_EQUAL (preloader.bytes, 0);
+
+  preloader_destroy (&preloader);
+}
+
+void
+test_cap ()
+{
+  struct preloader preloader;
+
+  printf ("\n");
+
+  preloader_init (&preloader, TEST_MAX_BYTES);
+
+  CU_ASSERT_TRUE (preloader_add (&preloader, NULL, &FS_TEST_OPERATIONS,
+				 path_a));
+  CU_ASSERT_FALSE (preloader_add (&preloader, NULL, &FS_TEST_OPERATIONS,
+				  path_b));
+  test_check (&preloader, path_a);
+  CU_ASSERT_TRUE (preloader_add (&preloader, NULL, &FS_TEST_OPERATIONS,
+				 path_b));
+  test_check (&preloader, path_b);
+
+  CU_ASSERT_EQUAL (preloader.bytes, 0);
+
+  preloader_destroy (&preloader);
+}
+
+void
+test_sweep ()
+{
+  struct preloader preloader;
+
+  printf ("\n");
+
+  preloader_init (&preloader, TEST_MAX_BYTES * 2);
+
+  CU_ASSERT_TRUE (preloader_add (&preloader, NULL, &FS_TEST_OPERATIONS,
+				 path_a));
+  CU_ASSERT_TRUE (preloader_add (&preloader, NULL, &FS_TEST_OPERATIONS,
+				 path_b));
+
+  preloader_mark (&preloader);
+  CU_ASSERT_TRUE (preloader_add (&preloader, NULL, &FS_TEST_OPERATIONS,
+				 path_b));
+  preloader_sweep (&preloader);
+  CU_ASSERT_EQUAL (g_hash_table_size (preloader.jobs), 1);
+
+  test_check (&preloader, path_a);
+  test_check (&preloader, path_b);
+
+  preloader_clear (&preloader);
+  CU_ASSERT_EQUAL (preloader.bytes, 0);
+  CU_ASSERT_EQUAL (preloader.running, 0);
+
+  preloader_destroy (&preloader);
+}
+
+gint
+main (gint argc, gchar *argv[])
+{
+  gint err = 0;
+  gchar *contents;
+
+  debug_level = 5;
+
+  dir = g_dir_make_tmp ("elektroid-preloader-XXXXXX", NULL);
+  if (!dir)
+    {
+      return 1;
+    }
+
+  contents = g_malloc0 (TEST_FILE_LEN);
+  path_a = g_build_filename (dir, "a", NULL);
+  path_b = g_build_filename (dir, "b", NULL);
+  g_file_set_contents (path_a, contents, TEST_FILE_LEN, NULL);
+  g_file_set_contents (path_b, contents, TEST_FILE_LEN, NULL);
+  g_free (contents);
+
+  if (CU_initialize_registry () != CUE_SUCCESS)
+    {
+      goto cleanup;
+    }
+  CU_pSuite suite = CU_add_suite ("Elektroid preloader tests", 0, 0);
+  if (!suite)
+    {
+      goto cleanup;
+    }
+
+  if (!CU_add_test (suite, "preload", test_preload))
+    {
+      goto cleanup;
+    }
+
+  if (!CU_add_test (suite, "cap", test_cap))
+    {
+      goto cleanup;
+    }
+
+  if (!CU_add_test (suite, "sweep", test_sweep))
+    {
+      goto cleanup;
+    }
+
+  CU_basic_set_mode (CU_BRM_VERBOSE);
+
+  CU_basic_run_tests ();
+  err = CU_get_number_of_tests_failed ();
+
+cleanup:
+  CU_cleanup_registry ();
+  g_unlink (path_a);
+  g_unlink (path_b);
+  g_rmdir (dir);
+  g_free (path_a);
+  g_free (path_b);
+  g_free (dir);
+  return err || CU_get_error ();
+}
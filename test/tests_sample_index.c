@@ -0,0 +1,212 @@
+#include <CUnit/CUnit.h>
+#include <CUnit/Basic.h>
+#include <errno.h>
+#include <glib/gstdio.h>
+#include <unistd.h>
+#include "../src/sample_index.h"
+#include "../src/sample.h"
+#include "../src/preferences.h"
+
+#define TEST_SAMPLE TEST_DATA_DIR "/connectors/square-wav-stereo-44k1-8b.wav"
+#define TEST_WAIT_US 10000
+#define TEST_WAIT_TIMES 500
+
+static gchar *root;
+static gchar *sample_path;
+
+static const gchar *WAV_EXTS[] = { "wav", NULL };
+
+struct test_search_data
+{
+  guint dirs;
+  guint files;
+  guint32 frames;
+};
+
+static gboolean
+test_search_cb (struct item *item, gchar *rel_path, gpointer data)
+{
+  struct test_search_data *search_data = data;
+
+  printf ("Found %s (%s)\n", rel_path, item->name);
+
+  if (item->type == ITEM_TYPE_DIR)
+    {
+      CU_ASSERT_STRING_EQUAL (rel_path, "sub");
+      search_data->dirs++;
+    }
+  else
+    {
+      CU_ASSERT_STRING_EQUAL (rel_path, "sub/a.wav");
+      CU_ASSERT_STRING_EQUAL (item->name, "a.wav");
+      search_data->files++;
+      search_data->frames = item->sample_info.frames;
+    }
+
+  sample_info_clear (&item->sample_info);
+  g_free (rel_path);
+
+  return TRUE;
+}
+
+static gint
+test_wait_search (struct test_search_data *data)
+{
+  gint err;
+
+  for (gint i = 0; i < TEST_WAIT_TIMES; i++)
+    {
+      memset (data, 0, sizeof (struct test_search_data));
+      err = sample_index_search (root, WAV_EXTS, TRUE, test_search_cb, data);
+      if (!err)
+	{
+	  return 0;
+	}
+      g_usleep (TEST_WAIT_US);
+    }
+
+  return -ETIMEDOUT;
+}
+
+static void
+test_search (struct test_search_data *data)
+{
+  gint err = test_wait_search (data);
+
+  CU_ASSERT_EQUAL (err, 0);
+  CU_ASSERT_EQUAL (data->dirs, 1);
+  CU_ASSERT_EQUAL (data->files, 1);
+  CU_ASSERT_EQUAL (data->frames, 44100);
+}
+
+static void
+test_scan_and_search ()
+{
+  gint err;
+  gint64 mtime;
+  GStatBuf sb;
+  struct sample_info sample_info;
+  struct test_search_data data;
+
+  printf ("\n");
+
+  sample_index_init ();
+
+  err = sample_index_search (root, WAV_EXTS, TRUE, test_search_cb, &data);
+  CU_ASSERT_EQUAL (err, -ENOENT);
+
+  sample_index_add_dir (root);
+  test_search (&data);
+
+  CU_ASSERT_EQUAL (g_stat (sample_path, &sb), 0);
+  mtime = sample_index_get_mtime (&sb);
+  CU_ASSERT_TRUE (sample_index_get_sample_info (sample_path, sb.st_size,
+						mtime, &sample_info));
+  CU_ASSERT_EQUAL (sample_info.frames, 44100);
+  CU_ASSERT_EQUAL (sample_info.channels, 2);
+  sample_info_clear (&sample_info);
+
+  //Changes within the same second are detected.
+  CU_ASSERT_FALSE (sample_index_get_sample_info (sample_path, sb.st_size,
+						 mtime + 1, &sample_info));
+
+  sample_index_destroy ();
+}
+
+static void
+test_reload ()
+{
+  struct test_search_data data;
+
+  printf ("\n");
+
+  sample_index_init ();
+  test_search (&data);
+  sample_index_destroy ();
+}
+
+gint
+main (gint argc, gchar *argv[])
+{
+  gint err = 0;
+  gchar *contents, *sub, *txt, *loop, *index, *cache;
+  gsize len;
+
+  debug_level = 5;
+
+  root = g_dir_make_tmp ("elektroid-sample-index-XXXXXX", NULL);
+  if (!root)
+    {
+      return 1;
+    }
+
+  //The index is stored in the cache directory of the user.
+  g_setenv ("HOME", root, TRUE);
+
+  sub = g_build_filename (root, "sub", NULL);
+  g_mkdir (sub, 0755);
+  sample_path = g_build_filename (sub, "a.wav", NULL);
+  txt = g_build_filename (sub, "a.txt", NULL);
+  g_file_get_contents (TEST_SAMPLE, &contents, &len, NULL);
+  g_file_set_contents (sample_path, contents, len, NULL);
+  g_file_set_contents (txt, "", 0, NULL);
+  g_free (contents);
+  //This would make the scan recurse forever if directory links were followed.
+  loop = g_build_filename (sub, "loop", NULL);
+  if (symlink (root, loop))
+    {
+      return 1;
+    }
+
+  preferences_hashtable = g_hash_table_new_full (g_str_hash, g_str_equal,
+						 NULL, g_free);
+
+  if (CU_initialize_registry () != CUE_SUCCESS)
+    {
+      goto cleanup;
+    }
+  CU_pSuite suite = CU_add_suite ("Elektroid sample index tests", 0, 0);
+  if (!suite)
+    {
+      goto cleanup;
+    }
+
+  if (!CU_add_test (suite, "scan_and_search", test_scan_and_search))
+    {
+      goto cleanup;
+    }
+
+  if (!CU_add_test (suite, "reload", test_reload))
+    {
+      goto cleanup;
+    }
+
+  CU_basic_set_mode (CU_BRM_VERBOSE);
+
+  CU_basic_run_tests ();
+  err = CU_get_number_of_tests_failed ();
+
+cleanup:
+  preferences_free ();
+  CU_cleanup_registry ();
+  g_unlink (sample_path);
+  g_unlink (txt);
+  g_unlink (loop);
+  g_rmdir (sub);
+  index = get_user_dir (CACHE_DIR "/sample_index");
+  g_unlink (index);
+  cache = get_user_dir (CACHE_DIR);
+  g_rmdir (cache);
+  g_free (cache);
+  cache = get_user_dir ("/.cache");
+  g_rmdir (cache);
+  g_rmdir (root);
+  g_free (cache);
+  g_free (index);
+  g_free (sample_path);
+  g_free (txt);
+  g_free (loop);
+  g_free (sub);
+  g_free (root);
+  return err || CU_get_error ();
+}
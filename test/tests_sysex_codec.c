@@ -0,0 +1,343 @@
+#include <CUnit/CUnit.h>
+#include <CUnit/Basic.h>
+#include "../src/sysex_codec.h"
+#include "../src/utils.h"
+
+#define MAX_LEN 1024
+#define ITERATIONS 200
+#define SDS_WORDS 40
+
+//These are the implementations used before the codec. They are kept here as the reference.
+
+static guint
+ref_elektron_decode (const guint8 *src, guint len, guint8 *dst)
+{
+  guint i, j, k;
+  guint8 shift;
+
+  for (i = 0, j = 0; i < len; i += 8, j += 7)
+    {
+      shift = 0x40;
+      for (k = 0; k < 7 && i + k + 1 < len; k++)
+	{
+	  dst[j + k] = src[i + k + 1] | (src[i] & shift ? 0x80 : 0);
+	  shift = shift >> 1;
+	}
+    }
+
+  return len - (len + 7) / 8;
+}
+
+static guint
+ref_elektron_encode (const guint8 *src, guint len, guint8 *dst)
+{
+  guint i, j, k, accum;
+
+  for (i = 0, j = 0; j < len; i += 8, j += 7)
+    {
+      accum = 0;
+      for (k = 0; k < 7; k++)
+	{
+	  accum = accum << 1;
+	  if (j + k < len)
+	    {
+	      if (src[j + k] & 0x80)
+		{
+		  accum |= 1;
+		}
+	      dst[i + k + 1] = src[j + k] & 0x7f;
+	    }
+	}
+      dst[i] = accum;
+    }
+
+  return len + (len + 6) / 7;
+}
+
+static void
+ref_common_decode (const guint8 *src, guint len, guint8 *dst)
+{
+  for (guint i = 0; i < len; i++)
+    {
+      guint8 bits = *src;
+      src++;
+      for (guint j = 0; j < 7 && i < len; j++, i++, src++, dst++)
+	{
+	  *dst = *src | (bits & 0x1 ? 0x80 : 0);
+	  bits >>= 1;
+	}
+    }
+}
+
+static void
+ref_common_encode (const guint8 *src, guint len, guint8 *dst)
+{
+  guint8 *bits = NULL;
+  guint rem;
+
+  for (guint i = 0; i < len;)
+    {
+      bits = dst;
+      *bits = 0;
+      dst++;
+      for (guint j = 0; j < 7 && i < len; j++, i++, src++, dst++)
+	{
+	  *dst = *src & 0x7f;
+	  *bits |= *src & 0x80;
+	  *bits >>= 1;
+	}
+    }
+  rem = len % 7;
+  if (rem)
+    {
+      *bits >>= 7 - rem;
+    }
+}
+
+static gint16
+ref_sds_get (const guint8 *data, gint length, guint bits)
+{
+  guint value = 0;
+  for (gint i = length - 1, shift = 0; i >= 0; i--, shift += 7)
+    {
+      value |= (((guint) data[i]) << shift);
+    }
+  value >>= length * 7 - bits;
+  return (gint16) (value - 0x8000);
+}
+
+static void
+ref_sds_set (guint8 *data, gint length, guint bits, gint16 svalue)
+{
+  gint value = svalue;
+  value += (guint) 0x8000;
+  value <<= length * 7 - bits;
+  for (gint i = length - 1, shift = 0; i >= 0; i--, shift += 7)
+    {
+      data[i] = (guint8) (0x7f & (value >> shift));
+    }
+}
+
+static void
+fill_random (guint8 *data, guint len)
+{
+  for (guint i = 0; i < len; i++)
+    {
+      data[i] = g_random_int () & 0xff;
+    }
+}
+
+//Every length is tested so that all the combinations of kernel blocks and scalar tails are covered.
+
+static void
+test_kernel (enum sysex_codec_kernel kernel)
+{
+  guint len, even_len, exp_len;
+  guint8 src[MAX_LEN], exp[MAX_LEN * 2], act[MAX_LEN * 2];
+
+  if (sysex_codec_set_kernel (kernel))
+    {
+      printf ("Kernel %d not supported. Skipping...\n", kernel);
+      return;
+    }
+
+  printf ("Testing %s kernel...\n", sysex_codec_get_kernel_name ());
+
+  for (guint i = 0; i < ITERATIONS; i++)
+    {
+      len = i < 64 ? i : g_random_int_range (64, MAX_LEN);
+      fill_random (src, len);
+
+      memset (exp, 0, sizeof (exp));
+      memset (act, 0, sizeof (act));
+      exp_len = ref_elektron_encode (src, len, exp);
+      CU_ASSERT_EQUAL (sysex_codec_encode (src, len, act,
+					   SYSEX_CODEC_MSB_FIRST), exp_len);
+      CU_ASSERT_EQUAL (memcmp (exp, act, sizeof (exp)), 0);
+
+      memset (exp, 0, sizeof (exp));
+      memset (act, 0, sizeof (act));
+      exp_len = ref_elektron_decode (src, len, exp);
+      CU_ASSERT_EQUAL (sysex_codec_decode (src, len, act,
+					   SYSEX_CODEC_MSB_FIRST), exp_len);
+      CU_ASSERT_EQUAL (memcmp (exp, act, sizeof (exp)), 0);
+
+      memset (exp, 0, sizeof (exp));
+      memset (act, 0, sizeof (act));
+      ref_common_encode (src, len, exp);
+      exp_len = sysex_codec_encode (src, len, act, SYSEX_CODEC_LSB_FIRST);
+      CU_ASSERT_EQUAL (exp_len, sysex_codec_get_encoded_len (len));
+      CU_ASSERT_EQUAL (memcmp (exp, act, sizeof (exp)), 0);
+
+      //The reference wrote an additional byte with garbage when the last packet was not complete.
+      memset (exp, 0, sizeof (exp));
+      memset (act, 0, sizeof (act));
+      ref_common_decode (src, len, exp);
+      exp_len = sysex_codec_decode (src, len, act, SYSEX_CODEC_LSB_FIRST);
+      CU_ASSERT_EQUAL (exp_len, sysex_codec_get_decoded_len (len));
+      CU_ASSERT_EQUAL (memcmp (exp, act, exp_len), 0);
+
+      even_len = len & ~1;
+      sysex_codec_copy_be16 (src, even_len, act);
+      for (guint j = 0; j < even_len; j += sizeof (guint16))
+	{
+	  guint16 v = GUINT16_FROM_BE (*((guint16 *) & src[j]));
+	  CU_ASSERT_EQUAL (memcmp (&v, &act[j], sizeof (guint16)), 0);
+	}
+
+      //Round trip
+      sysex_codec_encode (src, len, exp, SYSEX_CODEC_MSB_FIRST);
+      sysex_codec_decode (exp, sysex_codec_get_encoded_len (len), act,
+			  SYSEX_CODEC_MSB_FIRST);
+      CU_ASSERT_EQUAL (memcmp (src, act, len), 0);
+    }
+
+  sysex_codec_set_kernel (SYSEX_CODEC_KERNEL_AUTO);
+}
+
+void
+test_scalar ()
+{
+  printf ("\n");
+  test_kernel (SYSEX_CODEC_KERNEL_SCALAR);
+}
+
+void
+test_sse2 ()
+{
+  printf ("\n");
+  test_kernel (SYSEX_CODEC_KERNEL_SSE2);
+}
+
+void
+test_avx2 ()
+{
+  printf ("\n");
+  test_kernel (SYSEX_CODEC_KERNEL_AVX2);
+}
+
+void
+test_neon ()
+{
+  printf ("\n");
+  test_kernel (SYSEX_CODEC_KERNEL_NEON);
+}
+
+void
+test_lens ()
+{
+  printf ("\n");
+
+  CU_ASSERT_EQUAL (sysex_codec_get_encoded_len (0), 0);
+  CU_ASSERT_EQUAL (sysex_codec_get_encoded_len (1), 2);
+  CU_ASSERT_EQUAL (sysex_codec_get_encoded_len (7), 8);
+  CU_ASSERT_EQUAL (sysex_codec_get_encoded_len (8), 10);
+  CU_ASSERT_EQUAL (sysex_codec_get_decoded_len (0), 0);
+  CU_ASSERT_EQUAL (sysex_codec_get_decoded_len (2), 1);
+  CU_ASSERT_EQUAL (sysex_codec_get_decoded_len (8), 7);
+  CU_ASSERT_EQUAL (sysex_codec_get_decoded_len (10), 8);
+}
+
+void
+test_sds ()
+{
+  guint bytes_per_word;
+  gint16 words[SDS_WORDS], act_words[SDS_WORDS];
+  guint8 exp[SDS_WORDS * 3], act[SDS_WORDS * 3];
+  guint8 checksum;
+
+  printf ("\n");
+
+  for (guint bits = 8; bits <= 16; bits++)
+    {
+      bytes_per_word = bits < 15 ? 2 : 3;
+
+      fill_random ((guint8 *) words, sizeof (words));
+      for (guint i = 0; i < SDS_WORDS; i++)
+	{
+	  ref_sds_set (&exp[i * bytes_per_word], bytes_per_word, bits,
+		       words[i]);
+	}
+      sysex_codec_sds_encode (words, SDS_WORDS, act, bits, bytes_per_word);
+      CU_ASSERT_EQUAL (memcmp (exp, act, SDS_WORDS * bytes_per_word), 0);
+
+      fill_random (exp, sizeof (exp));
+      for (guint i = 0; i < sizeof (exp); i++)
+	{
+	  exp[i] &= 0x7f;
+	}
+      sysex_codec_sds_decode (exp, SDS_WORDS, act_words, bits,
+			      bytes_per_word);
+      for (guint i = 0; i < SDS_WORDS; i++)
+	{
+	  CU_ASSERT_EQUAL (act_words[i],
+			   ref_sds_get (&exp[i * bytes_per_word],
+					bytes_per_word, bits));
+	}
+    }
+
+  checksum = 0;
+  for (guint i = 0; i < sizeof (exp); i++)
+    {
+      checksum ^= exp[i];
+    }
+  CU_ASSERT_EQUAL (sysex_codec_sds_checksum (exp, sizeof (exp)),
+		   checksum & 0x7f);
+}
+
+gint
+main (gint argc, gchar *argv[])
+{
+  gint err = 0;
+
+  debug_level = 5;
+
+  if (CU_initialize_registry () != CUE_SUCCESS)
+    {
+      goto cleanup;
+    }
+  CU_pSuite suite = CU_add_suite ("Elektroid SysEx codec tests", 0, 0);
+  if (!suite)
+    {
+      goto cleanup;
+    }
+
+  if (!CU_add_test (suite, "lens", test_lens))
+    {
+      goto cleanup;
+    }
+
+  if (!CU_add_test (suite, "scalar", test_scalar))
+    {
+      goto cleanup;
+    }
+
+  if (!CU_add_test (suite, "sse2", test_sse2))
+    {
+      goto cleanup;
+    }
+
+  if (!CU_add_test (suite, "avx2", test_avx2))
+    {
+      goto cleanup;
+    }
+
+  if (!CU_add_test (suite, "neon", test_neon))
+    {
+      goto cleanup;
+    }
+
+  if (!CU_add_test (suite, "sds", test_sds))
+    {
+      goto cleanup;
+    }
+
+  CU_basic_set_mode (CU_BRM_VERBOSE);
+
+  CU_basic_run_tests ();
+  err = CU_get_number_of_tests_failed ();
+
+cleanup:
+  CU_cleanup_registry ();
+  return err || CU_get_error ();
+}
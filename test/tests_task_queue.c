@@ -0,0 +1,257 @@
+#include <CUnit/CUnit.h>
+#include <CUnit/Basic.h>
+#include "../src/task_queue.h"
+
+static void
+test_count_visitor (struct task *task, gpointer data)
+{
+  guint *n = data;
+  (*n)++;
+}
+
+static void
+test_add_tasks (struct task_queue *queue)
+{
+  task_queue_add (queue, TASK_TYPE_UPLOAD, "/a0", "/b", 0, 0, NULL);
+  task_queue_add (queue, TASK_TYPE_UPLOAD, "/a1", "/b", 0, 1, NULL);
+  task_queue_add (queue, TASK_TYPE_DOWNLOAD, "/a2", "/b", 1, 0, NULL);
+  task_queue_add (queue, TASK_TYPE_UPLOAD, "/a3", "/b", 0, 1, NULL);
+}
+
+void
+test_fifo ()
+{
+  guint n = 0;
+  struct task *task;
+  struct task_queue queue;
+
+  task_queue_init (&queue);
+
+  CU_ASSERT_FALSE (task_queue_has_queued (&queue));
+  CU_ASSERT_PTR_NULL (task_queue_start_next (&queue));
+
+  test_add_tasks (&queue);
+  CU_ASSERT_TRUE (task_queue_has_queued (&queue));
+  CU_ASSERT_EQUAL (task_queue_flush (&queue, test_count_visitor, &n), 4);
+  CU_ASSERT_EQUAL (n, 4);
+  CU_ASSERT_EQUAL (task_queue_flush (&queue, test_count_visitor, &n), 0);
+
+  for (gint i = 0; i < 4; i++)
+    {
+      gchar *src = g_strdup_printf ("/a%d", i);
+
+      task = task_queue_start_next (&queue);
+      CU_ASSERT_PTR_NOT_NULL (task);
+      CU_ASSERT_STRING_EQUAL (task->src, src);
+      CU_ASSERT_EQUAL (task->status, TASK_STATUS_RUNNING);
+      CU_ASSERT_PTR_EQUAL (queue.current.head->data, task);
+
+      //Only one task can run at a time.
+      CU_ASSERT_PTR_NULL (task_queue_start_next (&queue));
+
+      CU_ASSERT_PTR_EQUAL (task_queue_complete_current
+			   (&queue, TASK_STATUS_COMPLETED_OK), task);
+      CU_ASSERT_EQUAL (task->status, TASK_STATUS_COMPLETED_OK);
+      CU_ASSERT_TRUE (g_queue_is_empty (&queue.current));
+
+      g_free (src);
+    }
+
+  CU_ASSERT_FALSE (task_queue_has_queued (&queue));
+  CU_ASSERT_TRUE (task_queue_has_finished (&queue));
+
+  n = 0;
+  task_queue_remove_finished (&queue, test_count_visitor, &n);
+  CU_ASSERT_EQUAL (n, 4);
+  CU_ASSERT_FALSE (task_queue_has_finished (&queue));
+
+  //Removed tasks are not flushed.
+  CU_ASSERT_EQUAL (task_queue_flush (&queue, test_count_visitor, &n), 0);
+
+  task_queue_free (&queue);
+}
+
+void
+test_batches ()
+{
+  guint n = 0;
+  struct task *task;
+  struct task_queue queue;
+
+  task_queue_init (&queue);
+
+  test_add_tasks (&queue);
+  task_queue_flush (&queue, test_count_visitor, &n);
+
+  task_queue_set_batch_mode (&queue, 1, TASK_MODE_SKIP);
+  CU_ASSERT_EQUAL (task_queue_flush (&queue, test_count_visitor, &n), 2);
+  task_queue_set_batch_mode (&queue, 1, TASK_MODE_SKIP);
+  CU_ASSERT_EQUAL (task_queue_flush (&queue, test_count_visitor, &n), 0);
+
+  task = task_queue_start_next (&queue);
+  CU_ASSERT_STRING_EQUAL (task->src, "/a0");
+  CU_ASSERT_EQUAL (task->mode, TASK_MODE_ASK);
+  task_queue_complete_current (&queue, TASK_STATUS_COMPLETED_OK);
+
+  task = task_queue_start_next (&queue);
+  CU_ASSERT_STRING_EQUAL (task->src, "/a1");
+  CU_ASSERT_EQUAL (task->mode, TASK_MODE_SKIP);
+  task_queue_complete_current (&queue, TASK_STATUS_CANCELED);
+
+  task_queue_cancel_batch (&queue, 1);
+  task_queue_cancel_batch (&queue, 2);
+
+  task = task_queue_start_next (&queue);
+  CU_ASSERT_STRING_EQUAL (task->src, "/a2");
+  task_queue_complete_current (&queue, TASK_STATUS_COMPLETED_OK);
+
+  CU_ASSERT_FALSE (task_queue_has_queued (&queue));
+
+  n = 0;
+  task_queue_remove_finished (&queue, test_count_visitor, &n);
+  CU_ASSERT_EQUAL (n, 4);
+
+  task_queue_free (&queue);
+}
+
+static gboolean
+test_same_fs_filter (struct task *task, gpointer data)
+{
+  struct task *first = data;
+  return task->fs == first->fs && task->type != TASK_TYPE_DOWNLOAD;
+}
+
+void
+test_groups ()
+{
+  guint n = 0;
+  struct task *first, *task;
+  struct task_queue queue;
+
+  task_queue_init (&queue);
+
+  //Without current tasks, nothing can be added to them.
+  test_add_tasks (&queue);
+  CU_ASSERT_PTR_NULL (task_queue_start_next_if (&queue, test_same_fs_filter,
+						queue.pending.head->data));
+  task_queue_remove_queued (&queue, test_count_visitor, &n);
+
+  task_queue_add (&queue, TASK_TYPE_UPLOAD, "/a0", "/b", 0, 0, NULL);
+  task_queue_add (&queue, TASK_TYPE_DELETE, "/b/1", NULL, 0, 1, NULL);
+  task_queue_add (&queue, TASK_TYPE_UPLOAD, "/a2", "/b", 0, 0, NULL);
+  task_queue_add (&queue, TASK_TYPE_UPLOAD, "/a3", "/b", 1, 0, NULL);
+  task_queue_add (&queue, TASK_TYPE_UPLOAD, "/a4", "/b", 0, 0, NULL);
+
+  first = task_queue_start_next (&queue);
+  CU_ASSERT_STRING_EQUAL (first->src, "/a0");
+  n = 1;
+  while ((task = task_queue_start_next_if (&queue, test_same_fs_filter,
+					   first)))
+    {
+      CU_ASSERT_EQUAL (task->status, TASK_STATUS_RUNNING);
+      n++;
+    }
+  //Only consecutive tasks are grouped.
+  CU_ASSERT_EQUAL (n, 3);
+  CU_ASSERT_EQUAL (g_queue_get_length (&queue.current), 3);
+  CU_ASSERT_STRING_EQUAL (((struct task *) queue.pending.head->data)->src,
+			  "/a3");
+
+  //Only one group can run at a time.
+  CU_ASSERT_PTR_NULL (task_queue_start_next (&queue));
+
+  //Every task in the group is completed with its own status.
+  task = task_queue_complete_current (&queue, TASK_STATUS_COMPLETED_OK);
+  CU_ASSERT_STRING_EQUAL (task->src, "/a0");
+  task = task_queue_complete_current (&queue, TASK_STATUS_COMPLETED_ERROR);
+  CU_ASSERT_EQUAL (task->type, TASK_TYPE_DELETE);
+  CU_ASSERT_EQUAL (task->status, TASK_STATUS_COMPLETED_ERROR);
+  task = task_queue_complete_current (&queue, TASK_STATUS_COMPLETED_OK);
+  CU_ASSERT_STRING_EQUAL (task->src, "/a2");
+  CU_ASSERT_PTR_NULL (task_queue_complete_current
+		      (&queue, TASK_STATUS_COMPLETED_OK));
+
+  task = task_queue_start_next (&queue);
+  CU_ASSERT_STRING_EQUAL (task->src, "/a3");
+  CU_ASSERT_PTR_NULL (task_queue_start_next_if (&queue, test_same_fs_filter,
+						task));
+
+  task_queue_free (&queue);
+}
+
+void
+test_cancel_and_remove ()
+{
+  guint n = 0;
+  struct task_queue queue;
+
+  task_queue_init (&queue);
+
+  test_add_tasks (&queue);
+  task_queue_start_next (&queue);
+  task_queue_cancel_all (&queue);
+  CU_ASSERT_FALSE (task_queue_has_queued (&queue));
+  CU_ASSERT_TRUE (task_queue_has_finished (&queue));
+  CU_ASSERT_FALSE (g_queue_is_empty (&queue.current));
+
+  test_add_tasks (&queue);
+  task_queue_remove_queued (&queue, test_count_visitor, &n);
+  CU_ASSERT_EQUAL (n, 4);
+  CU_ASSERT_FALSE (task_queue_has_queued (&queue));
+
+  //The current and the canceled tasks.
+  CU_ASSERT_EQUAL (task_queue_flush (&queue, test_count_visitor, &n), 4);
+
+  //A batch id that was used before must work after its tasks were removed.
+  test_add_tasks (&queue);
+  task_queue_cancel_batch (&queue, 0);
+  CU_ASSERT_STRING_EQUAL (((struct task *) queue.pending.head->data)->src,
+			  "/a1");
+
+  task_queue_free (&queue);
+}
+
+gint
+main (gint argc, gchar *argv[])
+{
+  gint err = 0;
+
+  if (CU_initialize_registry () != CUE_SUCCESS)
+    {
+      goto cleanup;
+    }
+  CU_pSuite suite = CU_add_suite ("Elektroid task queue tests", 0, 0);
+  if (!suite)
+    {
+      goto cleanup;
+    }
+
+  if (!CU_add_test (suite, "fifo", test_fifo))
+    {
+      goto cleanup;
+    }
+
+  if (!CU_add_test (suite, "batches", test_batches))
+    {
+      goto cleanup;
+    }
+
+  if (!CU_add_test (suite, "groups", test_groups))
+    {
+      goto cleanup;
+    }
+
+  if (!CU_add_test (suite, "cancel_and_remove", test_cancel_and_remove))
+    {
+      goto cleanup;
+    }
+
+  CU_basic_set_mode (CU_BRM_VERBOSE);
+
+  CU_basic_run_tests ();
+  err = CU_get_number_of_tests_failed ();
+
+cleanup:
+  CU_cleanup_registry ();
+  return err || CU_get_error ();
+}
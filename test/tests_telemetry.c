@@ -0,0 +1,159 @@
+#include <CUnit/CUnit.h>
+#include <CUnit/Basic.h>
+#include <json-glib/json-glib.h>
+#include "../src/telemetry.h"
+
+void
+test_counters ()
+{
+  struct telemetry telemetry;
+
+  printf ("\n");
+
+  telemetry_init (&telemetry);
+
+  telemetry_add_tx (&telemetry, 2, 100);
+  telemetry_add_tx (&telemetry, 1, 10);
+  telemetry_add_rx (&telemetry, 1, 50);
+  telemetry_add_rx_skipped (&telemetry, 3);
+  telemetry_add_timeout (&telemetry);
+  telemetry_add_retry (&telemetry);
+  telemetry_add_retry (&telemetry);
+  telemetry_add_rest (&telemetry, 50000);
+
+  CU_ASSERT_EQUAL (telemetry.tx_msgs, 3);
+  CU_ASSERT_EQUAL (telemetry.tx_bytes, 110);
+  CU_ASSERT_EQUAL (telemetry.rx_msgs, 1);
+  CU_ASSERT_EQUAL (telemetry.rx_bytes, 50);
+  CU_ASSERT_EQUAL (telemetry.rx_skipped, 3);
+  CU_ASSERT_EQUAL (telemetry.timeouts, 1);
+  CU_ASSERT_EQUAL (telemetry.retries, 2);
+  CU_ASSERT_EQUAL (telemetry.rest_time, 50000);
+
+  telemetry_clear (&telemetry);
+}
+
+void
+test_rtt ()
+{
+  gchar *str;
+  struct telemetry telemetry;
+  struct telemetry_rtt *rtt;
+
+  printf ("\n");
+
+  telemetry_init (&telemetry);
+
+  telemetry_add_rtt (&telemetry, 0x32, 1);
+  telemetry_add_rtt (&telemetry, 0x32, 3);
+  telemetry_add_rtt (&telemetry, 0x32, 1000);
+  telemetry_add_rtt (&telemetry, TELEMETRY_MSG_TYPE_SYSEX, G_MAXINT64);
+
+  CU_ASSERT_EQUAL (g_hash_table_size (telemetry.rtts), 2);
+
+  rtt = g_hash_table_lookup (telemetry.rtts, GUINT_TO_POINTER (0x32));
+  CU_ASSERT_EQUAL (rtt->count, 3);
+  CU_ASSERT_EQUAL (rtt->total, 1004);
+  CU_ASSERT_EQUAL (rtt->max, 1000);
+  CU_ASSERT_EQUAL (rtt->histogram[0], 1);
+  CU_ASSERT_EQUAL (rtt->histogram[1], 1);
+  CU_ASSERT_EQUAL (rtt->histogram[9], 1);
+
+  //The last bin has no upper limit.
+  rtt = g_hash_table_lookup (telemetry.rtts,
+			     GUINT_TO_POINTER (TELEMETRY_MSG_TYPE_SYSEX));
+  CU_ASSERT_EQUAL (rtt->histogram[TELEMETRY_RTT_HISTOGRAM_LEN - 1], 1);
+
+  str = telemetry_to_string (&telemetry);
+  printf ("%s", str);
+  CU_ASSERT_PTR_NOT_NULL (strstr (str, "  < 2 us: 1\n"));
+  CU_ASSERT_PTR_NOT_NULL (strstr (str, "  >= 8388608 us: 1\n"));
+  g_free (str);
+
+  telemetry_clear (&telemetry);
+}
+
+void
+test_json ()
+{
+  gchar *json;
+  JsonParser *parser;
+  JsonReader *reader;
+  struct telemetry telemetry;
+
+  printf ("\n");
+
+  telemetry_init (&telemetry);
+  telemetry_add_tx (&telemetry, 1, 10);
+  telemetry_add_rtt (&telemetry, 0x10, 500);
+
+  json = telemetry_to_json (&telemetry);
+
+  parser = json_parser_new ();
+  CU_ASSERT_TRUE (json_parser_load_from_data (parser, json, -1, NULL));
+  reader = json_reader_new (json_parser_get_root (parser));
+
+  CU_ASSERT_TRUE (json_reader_read_member (reader, "tx_bytes"));
+  CU_ASSERT_EQUAL (json_reader_get_int_value (reader), 10);
+  json_reader_end_member (reader);
+
+  CU_ASSERT_TRUE (json_reader_read_member (reader, "rtts"));
+  CU_ASSERT_TRUE (json_reader_read_member (reader, "0x10"));
+  CU_ASSERT_TRUE (json_reader_read_member (reader, "count"));
+  CU_ASSERT_EQUAL (json_reader_get_int_value (reader), 1);
+  json_reader_end_member (reader);
+  CU_ASSERT_TRUE (json_reader_read_member (reader, "histogram"));
+  CU_ASSERT_EQUAL (json_reader_count_elements (reader),
+		   TELEMETRY_RTT_HISTOGRAM_LEN);
+  json_reader_end_member (reader);
+  json_reader_end_member (reader);
+  json_reader_end_member (reader);
+
+  g_object_unref (reader);
+  g_object_unref (parser);
+  g_free (json);
+
+  telemetry_clear (&telemetry);
+}
+
+gint
+main (gint argc, gchar *argv[])
+{
+  gint err = 0;
+
+  debug_level = 5;
+
+  if (CU_initialize_registry () != CUE_SUCCESS)
+    {
+      goto cleanup;
+    }
+  CU_pSuite suite = CU_add_suite ("Elektroid telemetry tests", 0, 0);
+  if (!suite)
+    {
+      goto cleanup;
+    }
+
+  if (!CU_add_test (suite, "counters", test_counters))
+    {
+      goto cleanup;
+    }
+
+  if (!CU_add_test (suite, "rtt", test_rtt))
+    {
+      goto cleanup;
+    }
+
+  if (!CU_add_test (suite, "json", test_json))
+    {
+      goto cleanup;
+    }
+
+  CU_basic_set_mode (CU_BRM_VERBOSE);
+
+  CU_basic_run_tests ();
+  err = CU_get_number_of_tests_failed ();
+
+cleanup:
+  CU_cleanup_registry ();
+  return err || CU_get_error ();
+}
@@ -2,6 +2,8 @@
 #include <CUnit/Basic.h>
 #include "../src/utils.h"
 
+#define DEBUG_TEST_HEX_LEN 256
+
 void
 test_filename_matches_exts ()
 {
@@ -80,6 +82,37 @@ test_command_set_parts ()
   CU_ASSERT_STRING_EQUAL (op, "c");
 }
 
+void
+test_debug_get_hex_data ()
+{
+  gchar *text;
+  guint8 data[DEBUG_TEST_HEX_LEN];
+
+  printf ("\n");
+
+  for (guint i = 0; i < DEBUG_TEST_HEX_LEN; i++)
+    {
+      data[i] = i;
+    }
+
+  CU_ASSERT_EQUAL (debug_get_hex_data (0, data, 0), NULL);
+
+  text = debug_get_hex_data (0, (guint8 *) "\xf0\x7e\xf7", 3);
+  CU_ASSERT_STRING_EQUAL (text, "f0 7e f7");
+  g_free (text);
+
+  text = debug_get_hex_data (0, data, DEBUG_TEST_HEX_LEN);
+  CU_ASSERT_EQUAL (strlen (text), 64 * 3 - 1 + 3);
+  CU_ASSERT_TRUE (g_str_has_prefix (text, "00 01 02"));
+  CU_ASSERT_TRUE (g_str_has_suffix (text, "3e 3f..."));
+  g_free (text);
+
+  text = debug_get_hex_data (5, data, DEBUG_TEST_HEX_LEN);
+  CU_ASSERT_EQUAL (strlen (text), DEBUG_TEST_HEX_LEN * 3 - 1);
+  CU_ASSERT_TRUE (g_str_has_suffix (text, "fe ff"));
+  g_free (text);
+}
+
 gint
 main (gint argc, gchar *argv[])
 {
@@ -118,6 +151,11 @@ main (gint argc, gchar *argv[])
       goto cleanup;
     }
 
+  if (!CU_add_test (suite, "debug_get_hex_data", test_debug_get_hex_data))
+    {
+      goto cleanup;
+    }
+
   CU_basic_set_mode (CU_BRM_VERBOSE);
 
   CU_basic_run_tests ();
@@ -13,6 +13,16 @@ gint volca_sample_get_upload (guint id, struct idata *input,
 			      struct idata *syro_op, guint32 quality,
 			      struct task_control *control);
 
+gint volca_sample_get_syro_op (SyroData * data, guint entries,
+			       struct idata *syro_op,
+			       struct task_control *control);
+
+guint volca_sample_get_batch_len (SyroData * data, guint entries);
+
+guint volca_sample_init_batch_data (struct fs_batch_item *items, guint len,
+				    guint32 quality, SyroData * data,
+				    struct fs_batch_item **entry_items);
+
 static void
 test_volca_sample_compare_to (struct idata *actual, const gchar *path)
 {
@@ -142,6 +152,137 @@ test_volca_sample_get_update_8b ()
 				       71, 8);
 }
 
+static void
+test_volca_sample_get_batch ()
+{
+  gint err;
+  struct idata sample, upload, delete, batch;
+  struct sample_info *upload_si, *delete_si, *batch_si;
+  SyroData data[2], sizes[VOLCA_SAMPLE_MAX_SAMPLES + 10];
+
+  printf ("\n");
+
+  for (guint i = 0; i < VOLCA_SAMPLE_MAX_SAMPLES + 10; i++)
+    {
+      sizes[i].Size = 0;
+    }
+  CU_ASSERT_EQUAL (volca_sample_get_batch_len (sizes, 3), 3);
+  CU_ASSERT_EQUAL (volca_sample_get_batch_len
+		   (sizes, VOLCA_SAMPLE_MAX_SAMPLES + 10),
+		   VOLCA_SAMPLE_MAX_SAMPLES);
+
+  //A single entry is always allowed regardless of its size.
+  for (guint i = 0; i < 3; i++)
+    {
+      sizes[i].Size = 5 * 1024 * 1024;
+    }
+  CU_ASSERT_EQUAL (volca_sample_get_batch_len (sizes, 3), 1);
+
+  err = common_sample_load (TEST_DATA_DIR "/connectors/square.wav",
+			    &sample, NULL, 1, 31250, SF_FORMAT_PCM_16, FALSE);
+  CU_ASSERT_EQUAL (err, 0);
+  if (err)
+    {
+      return;
+    }
+
+  CU_ASSERT_EQUAL (volca_sample_get_upload (59, &sample, &upload, 0, NULL),
+		   0);
+  CU_ASSERT_EQUAL (volca_sample_get_delete (17, &delete), 0);
+
+  data[0].DataType = DataType_Sample_Liner;
+  data[0].pData = sample.content->data;
+  data[0].Number = 59;
+  data[0].Size = sample.content->len;
+  data[0].Quality = 0;
+  data[0].Fs = 31250;
+  data[0].SampleEndian = LittleEndian;
+  data[1].DataType = DataType_Sample_Erase;
+  data[1].pData = NULL;
+  data[1].Number = 17;
+  data[1].Size = 0;
+  data[1].SampleEndian = LittleEndian;
+
+  CU_ASSERT_EQUAL (volca_sample_get_batch_len (data, 2), 2);
+
+  err = volca_sample_get_syro_op (data, 2, &batch, NULL);
+  CU_ASSERT_EQUAL (err, 0);
+  if (!err)
+    {
+      //The end tone is only sent once.
+      upload_si = upload.info;
+      delete_si = delete.info;
+      batch_si = batch.info;
+      CU_ASSERT (batch_si->frames < upload_si->frames + delete_si->frames);
+      CU_ASSERT (batch_si->frames > upload_si->frames);
+      CU_ASSERT_EQUAL (batch.content->len,
+		       batch_si->frames * 2 * sizeof (gint16));
+      idata_clear (&batch);
+    }
+
+  idata_clear (&upload);
+  idata_clear (&delete);
+  idata_clear (&sample);
+}
+
+static void
+test_volca_sample_init_batch_data ()
+{
+  gint err;
+  guint entries;
+  struct idata sample;
+  SyroData data[6];
+  struct fs_batch_item *entry_items[6];
+  struct fs_batch_item items[6] = {
+    {.path = "/59",.idata = &sample},
+    {.path = "/17",.idata = NULL},
+    {.path = "/100",.idata = &sample},
+    {.path = "/x",.idata = NULL},
+    {.path = "/3",.idata = &sample},
+    {.path = NULL,.idata = NULL,.err = -ENOENT}
+  };
+
+  printf ("\n");
+
+  err = common_sample_load (TEST_DATA_DIR "/connectors/square.wav",
+			    &sample, NULL, 1, 31250, SF_FORMAT_PCM_16, FALSE);
+  CU_ASSERT_EQUAL (err, 0);
+  if (err)
+    {
+      return;
+    }
+
+  //Uploads and deletes are mixed and only the invalid and failed items are left out.
+  entries = volca_sample_init_batch_data (items, 6, 16, data, entry_items);
+  CU_ASSERT_EQUAL (entries, 3);
+
+  CU_ASSERT_EQUAL (items[0].err, 0);
+  CU_ASSERT_EQUAL (items[1].err, 0);
+  CU_ASSERT_EQUAL (items[2].err, -EINVAL);
+  CU_ASSERT_EQUAL (items[3].err, -EINVAL);
+  CU_ASSERT_EQUAL (items[4].err, 0);
+  CU_ASSERT_EQUAL (items[5].err, -ENOENT);
+
+  CU_ASSERT_PTR_EQUAL (entry_items[0], &items[0]);
+  CU_ASSERT_EQUAL (data[0].DataType, DataType_Sample_Compress);
+  CU_ASSERT_EQUAL (data[0].Number, 59);
+  CU_ASSERT_EQUAL (data[0].Size, sample.content->len);
+  CU_ASSERT_EQUAL (data[0].Quality, 16);
+
+  CU_ASSERT_PTR_EQUAL (entry_items[1], &items[1]);
+  CU_ASSERT_EQUAL (data[1].DataType, DataType_Sample_Erase);
+  CU_ASSERT_EQUAL (data[1].Number, 17);
+  CU_ASSERT_EQUAL (data[1].Size, 0);
+
+  CU_ASSERT_PTR_EQUAL (entry_items[2], &items[4]);
+  CU_ASSERT_EQUAL (data[2].DataType, DataType_Sample_Compress);
+  CU_ASSERT_EQUAL (data[2].Number, 3);
+
+  CU_ASSERT_EQUAL (volca_sample_get_batch_len (data, entries), 3);
+
+  idata_clear (&sample);
+}
+
 gint
 main (gint argc, gchar *argv[])
 {
@@ -183,6 +324,18 @@ main (gint argc, gchar *argv[])
       goto cleanup;
     }
 
+  if (!CU_add_test (suite, "volca_sample_get_batch",
+		    test_volca_sample_get_batch))
+    {
+      goto cleanup;
+    }
+
+  if (!CU_add_test (suite, "volca_sample_init_batch_data",
+		    test_volca_sample_init_batch_data))
+    {
+      goto cleanup;
+    }
+
   CU_basic_set_mode (CU_BRM_VERBOSE);
 
   CU_basic_run_tests ();